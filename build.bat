@@ -9,7 +9,7 @@ pushd build
 del *.pdb > NUL 2> NUL
 del *.rdi > NUL 2> NUL
 
-cl.exe %CompilerFlags% ..\src\main.c ..\src\enemy.c ..\src\error.c ..\src\log.c ..\src\game.c /link %LinkerFlags% /OUT:hh.exe 
+cl.exe %CompilerFlags% ..\src\main.c ..\src\enemy.c ..\src\arena.c ..\src\error.c ..\src\log.c ..\src\input.c ..\src\alloc.c ..\src\replay.c ..\src\sim.c ..\src\flow.c ..\src\script.c ..\src\timer.c ..\src\mask.c ..\src\perf.c ..\src\event.c ..\src\transport.c ..\src\rollback.c ..\src\feed.c ..\src\assets.c ..\src\audio.c ..\src\hot_reload.c ..\src\particles.c ..\src\post.c ..\src\ghosts.c ..\src\golden.c ..\src\editor.c ..\src\game.c /link %LinkerFlags% /OUT:hh.exe 
 REM -LD - create dynamic lib
 
 popd
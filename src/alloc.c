@@ -0,0 +1,190 @@
+#include "alloc.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Heap blocks are prefixed with their size so frees can be accounted for
+#define ALLOC_HEADER_SIZE 16
+
+static const char *ALLOC_KIND_NAMES[NUM_ALLOC_KINDS] = {"heap", "surface", "texture"};
+
+static alloc_site_t sites[ALLOC_MAX_SITES];
+static uint8_t num_sites;
+static alloc_site_t overflow_site = {"(other)", 0, ALLOC_HEAP, {0}};
+static alloc_stats_t stats;
+static bool expect_none;
+static bool exclude_from_frame;
+
+static void count_alloc(const uint8_t kind, const size_t bytes, const char *file, const int line);
+static void count_free(const size_t bytes);
+static alloc_site_t *find_site(const uint8_t kind, const char *file, const int line);
+static size_t texture_bytes(SDL_Texture *texture);
+
+void *alloc_malloc(const size_t size, const char *file, const int line)
+{
+    uint8_t *block = malloc(size + ALLOC_HEADER_SIZE);
+    if (!block) {
+        return NULL;
+    }
+
+    memcpy(block, &size, sizeof(size));
+    count_alloc(ALLOC_HEAP, size, file, line);
+
+    return block + ALLOC_HEADER_SIZE;
+}
+
+void alloc_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    uint8_t *block = (uint8_t *)ptr - ALLOC_HEADER_SIZE;
+    size_t size;
+    memcpy(&size, block, sizeof(size));
+    count_free(size);
+
+    free(block);
+}
+
+SDL_Surface *alloc_surface(SDL_Surface *surface, const char *file, const int line)
+{
+    if (surface) {
+        count_alloc(ALLOC_SURFACE, (size_t)surface->pitch * surface->h, file, line);
+    }
+
+    return surface;
+}
+
+void alloc_free_surface(SDL_Surface *surface)
+{
+    if (!surface) {
+        return;
+    }
+
+    count_free((size_t)surface->pitch * surface->h);
+    SDL_FreeSurface(surface);
+}
+
+SDL_Texture *alloc_texture(SDL_Texture *texture, const char *file, const int line)
+{
+    if (texture) {
+        count_alloc(ALLOC_TEXTURE, texture_bytes(texture), file, line);
+    }
+
+    return texture;
+}
+
+void alloc_destroy_texture(SDL_Texture *texture)
+{
+    if (!texture) {
+        return;
+    }
+
+    count_free(texture_bytes(texture));
+    SDL_DestroyTexture(texture);
+}
+
+void alloc_frame_end(void)
+{
+    if (stats.cur_frame.allocs > stats.max_frame_allocs) {
+        stats.max_frame_allocs = stats.cur_frame.allocs;
+    }
+
+    stats.frame = stats.cur_frame;
+    memset(&stats.cur_frame, 0, sizeof(alloc_counts_t));
+    stats.frames++;
+}
+
+void alloc_expect_none(const bool expect) { expect_none = expect; }
+
+void alloc_exclude_from_frame(const bool exclude) { exclude_from_frame = exclude; }
+
+const alloc_stats_t *alloc_stats(void) { return &stats; }
+
+void alloc_report(void)
+{
+    printf("allocations: %u (%llu bytes) over %u frames, max %u in a frame, %lld bytes live\n", stats.total.allocs,
+           (unsigned long long)stats.total.bytes, stats.frames, stats.max_frame_allocs, (long long)stats.live_bytes);
+
+    for (uint8_t i = 0; i < num_sites; i++) {
+        printf("  %-8s %s:%d: %u allocations, %llu bytes\n", ALLOC_KIND_NAMES[sites[i].kind], sites[i].file,
+               sites[i].line, sites[i].counts.allocs, (unsigned long long)sites[i].counts.bytes);
+    }
+    if (overflow_site.counts.allocs) {
+        printf("  %-8s %s: %u allocations, %llu bytes\n", "", overflow_site.file, overflow_site.counts.allocs,
+               (unsigned long long)overflow_site.counts.bytes);
+    }
+
+    if (stats.violations) {
+        printf("steady state allocations: %u, first at %s:%d\n", stats.violations, stats.first_violation->file,
+               stats.first_violation->line);
+    }
+}
+
+static void count_alloc(const uint8_t kind, const size_t bytes, const char *file, const int line)
+{
+    alloc_site_t *site = find_site(kind, file, line);
+    site->counts.allocs++;
+    site->counts.bytes += bytes;
+
+    stats.total.allocs++;
+    stats.total.bytes += bytes;
+    stats.live_bytes += bytes;
+
+    if (exclude_from_frame) {
+        return;
+    }
+
+    stats.cur_frame.allocs++;
+    stats.cur_frame.bytes += bytes;
+
+    if (expect_none) {
+        if (!stats.violations) {
+            stats.first_violation = site;
+        }
+        stats.violations++;
+        LOG_INFO("alloc", "%s allocation of %zu bytes in steady state at %s:%d", ALLOC_KIND_NAMES[kind], bytes, file,
+                 line);
+    }
+}
+
+static void count_free(const size_t bytes)
+{
+    stats.total.frees++;
+    stats.live_bytes -= bytes;
+
+    if (!exclude_from_frame) {
+        stats.cur_frame.frees++;
+    }
+}
+
+static alloc_site_t *find_site(const uint8_t kind, const char *file, const int line)
+{
+    for (uint8_t i = 0; i < num_sites; i++) {
+        if (sites[i].line == line && sites[i].kind == kind && strcmp(sites[i].file, file) == 0) {
+            return &sites[i];
+        }
+    }
+
+    if (num_sites == ALLOC_MAX_SITES) {
+        return &overflow_site;
+    }
+
+    alloc_site_t *site = &sites[num_sites++];
+    site->file = file;
+    site->line = line;
+    site->kind = kind;
+
+    return site;
+}
+
+static size_t texture_bytes(SDL_Texture *texture)
+{
+    int w = 0, h = 0;
+    SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+
+    // NOTE: an estimate, the driver decides the real format
+    return (size_t)w * h * 4;
+}
@@ -0,0 +1,76 @@
+#ifndef HH_ALLOC_H
+#define HH_ALLOC_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tracked allocations - use these instead of calling malloc/free or creating SDL surfaces/textures directly so every
+// allocation is counted against its call site
+#define HH_MALLOC(size) alloc_malloc((size), __FILE__, __LINE__)
+#define HH_FREE(ptr) alloc_free(ptr)
+#define HH_LOAD_BMP(fname) alloc_surface(SDL_LoadBMP(fname), __FILE__, __LINE__)
+#define HH_CREATE_SURFACE(w, h, depth, format)                                                                        \
+    alloc_surface(SDL_CreateRGBSurfaceWithFormat(0, (w), (h), (depth), (format)), __FILE__, __LINE__)
+#define HH_RENDER_TEXT(font, text, colour) alloc_surface(TTF_RenderText_Solid((font), (text), (colour)), __FILE__, __LINE__)
+// For surfaces made without the tracker e.g. off the main thread
+#define HH_TRACK_SURFACE(surface) alloc_surface((surface), __FILE__, __LINE__)
+#define HH_FREE_SURFACE(surface) alloc_free_surface(surface)
+#define HH_CREATE_TEXTURE_FROM_SURFACE(renderer, surface)                                                             \
+    alloc_texture(SDL_CreateTextureFromSurface((renderer), (surface)), __FILE__, __LINE__)
+#define HH_CREATE_TEXTURE(renderer, format, access, w, h)                                                             \
+    alloc_texture(SDL_CreateTexture((renderer), (format), (access), (w), (h)), __FILE__, __LINE__)
+#define HH_DESTROY_TEXTURE(texture) alloc_destroy_texture(texture)
+
+#define ALLOC_MAX_SITES 64
+
+enum {
+    ALLOC_HEAP,
+    ALLOC_SURFACE,
+    ALLOC_TEXTURE,
+    NUM_ALLOC_KINDS,
+};
+
+typedef struct {
+    uint32_t allocs;
+    uint32_t frees;
+    uint64_t bytes;
+} alloc_counts_t;
+
+typedef struct {
+    const char *file;
+    int line;
+    uint8_t kind;
+    alloc_counts_t counts;
+} alloc_site_t;
+
+typedef struct {
+    // The last completed frame and the current one
+    alloc_counts_t frame;
+    alloc_counts_t cur_frame;
+    alloc_counts_t total;
+    int64_t live_bytes;
+    uint32_t frames;
+    uint32_t max_frame_allocs;
+
+    // Allocations made while none were expected e.g. after the first frame of a level
+    uint32_t violations;
+    const alloc_site_t *first_violation;
+} alloc_stats_t;
+
+// NOTE: the tracker isn't thread-safe, allocate from the main thread
+void *alloc_malloc(const size_t size, const char *file, const int line);
+void alloc_free(void *ptr);
+SDL_Surface *alloc_surface(SDL_Surface *surface, const char *file, const int line);
+void alloc_free_surface(SDL_Surface *surface);
+SDL_Texture *alloc_texture(SDL_Texture *texture, const char *file, const int line);
+void alloc_destroy_texture(SDL_Texture *texture);
+
+void alloc_frame_end(void);
+void alloc_expect_none(const bool expect_none);
+void alloc_exclude_from_frame(const bool exclude);
+const alloc_stats_t *alloc_stats(void);
+void alloc_report(void);
+
+#endif // !HH_ALLOC_H
@@ -0,0 +1,70 @@
+#include "arena.h"
+#include "alloc.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+int arena_init(arena_t *arena, const size_t size)
+{
+    memset(arena, 0, sizeof(arena_t));
+
+    // Over-allocate so the base can be aligned to a cache line
+    arena->block = HH_MALLOC(size + ARENA_ALIGN);
+    if (!arena->block) {
+        return err_fatal(ERR_ALLOC, "arena");
+    }
+    arena->base = (uint8_t *)(((uintptr_t)arena->block + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1));
+    arena->size = size;
+
+    return SUCCESS;
+}
+
+void *arena_alloc(arena_t *arena, const size_t size, const char *tag)
+{
+    size_t offset = (arena->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (offset > arena->size || size > arena->size - offset) {
+        LOG_INFO("arena_alloc", "out of space for %s: %zu bytes requested, %zu used of %zu", tag, size, arena->used,
+                 arena->size);
+        return NULL;
+    }
+    arena->used = offset + size;
+
+    // Account the allocation against its subsystem
+    arena_tag_t *t = NULL;
+    for (uint8_t i = 0; i < arena->num_tags; i++) {
+        if (strcmp(arena->tags[i].name, tag) == 0) {
+            t = &arena->tags[i];
+            break;
+        }
+    }
+    if (!t && arena->num_tags < ARENA_MAX_TAGS) {
+        t = &arena->tags[arena->num_tags++];
+        t->name = tag;
+    }
+    if (t) {
+        t->bytes += size;
+        t->allocs++;
+    }
+
+    memset(arena->base + offset, 0, size);
+
+    return arena->base + offset;
+}
+
+void arena_report(const arena_t *arena)
+{
+    LOG_INFO("arena_report", "arena: %zu of %zu bytes used", arena->used, arena->size);
+
+    for (uint8_t i = 0; i < arena->num_tags; i++) {
+        LOG_INFO("arena_report", "  %-16s %8zu bytes in %u allocation(s)", arena->tags[i].name, arena->tags[i].bytes,
+                 arena->tags[i].allocs);
+    }
+}
+
+void arena_destroy(arena_t *arena)
+{
+    HH_FREE(arena->block);
+    memset(arena, 0, sizeof(arena_t));
+}
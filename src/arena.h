@@ -0,0 +1,35 @@
+#ifndef HH_ARENA_H
+#define HH_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE_SIZE 64
+#define ARENA_ALIGN CACHE_LINE_SIZE
+#define ARENA_MAX_TAGS 16
+
+// Size of a type once it has been padded out to the arena alignment
+#define ARENA_SIZEOF(type) ((sizeof(type) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct {
+    const char *name;
+    size_t bytes;
+    uint32_t allocs;
+} arena_tag_t;
+
+// A linear allocator sized once at init. Everything allocated from it lives until arena_destroy().
+typedef struct {
+    void *block;
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    uint8_t num_tags;
+    arena_tag_t tags[ARENA_MAX_TAGS];
+} arena_t;
+
+int arena_init(arena_t *arena, const size_t size);
+void *arena_alloc(arena_t *arena, const size_t size, const char *tag);
+void arena_report(const arena_t *arena);
+void arena_destroy(arena_t *arena);
+
+#endif // !HH_ARENA_H
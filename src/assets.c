@@ -0,0 +1,128 @@
+#include "assets.h"
+#include "enemy.h"
+#include "error.h"
+#include "game.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool is_player_tile(uint8_t tile);
+static bool is_enemy_tile(uint8_t tile);
+
+void assets_tile_fname(char *fname, const uint8_t tile)
+{
+    char *basename = "res/assets/tile";
+    char file_num[4] = {0};
+
+    fname[0] = '\0';
+    strncat(fname, basename, strlen(basename));
+    sprintf(&file_num[0], "%u", tile);
+    strncat(fname, file_num, strlen(file_num));
+    strncat(fname, ".bmp", strlen(".bmp") + 1);
+}
+
+int assets_decode_tile(const uint8_t tile, SDL_Surface **surface)
+{
+    char error[ERR_ADDITIONAL_SIZE];
+    int err = assets_read_tile(tile, surface, error, sizeof(error));
+
+    return err == SUCCESS ? SUCCESS : err_fatal(err, error);
+}
+
+int assets_read_tile(const uint8_t tile, SDL_Surface **surface, char *error, const size_t error_size)
+{
+    char fname[ASSET_FNAME_SIZE] = {0};
+    char mname[ASSET_FNAME_SIZE] = {0};
+    uint8_t mask = 0;
+
+    assets_tile_fname(fname, tile);
+    *surface = SDL_LoadBMP(fname);
+    if (!*surface) {
+        snprintf(error, error_size, "%s", fname);
+        return ERR_SDL_LOADING_BMP;
+    }
+
+    // Load player tiles
+    if (assets_mask_tile(tile, &mask)) {
+        assets_tile_fname(mname, mask);
+        SDL_Surface *mask_surface = SDL_LoadBMP(mname);
+        if (!mask_surface) {
+            SDL_FreeSurface(*surface);
+            *surface = NULL;
+            snprintf(error, error_size, "%s", mname);
+            return ERR_SDL_LOADING_BMP;
+        }
+
+        uint8_t *player_pixels = (uint8_t *)(*surface)->pixels;
+        uint8_t *mask_pixels = (uint8_t *)mask_surface->pixels;
+
+        // Go through tile and make pixels white where they aren't black
+        // ---pitch---
+        // ··········· |
+        // ··········· h
+        // ··········· |
+        for (size_t j = 0; j < (uint64_t)mask_surface->pitch * mask_surface->h; j++) {
+            player_pixels[j] = mask_pixels[j] ? 0xff : player_pixels[j];
+        }
+        SDL_SetColorKey(*surface, 1, SDL_MapRGB((*surface)->format, 0xff, 0xff, 0xff));
+
+        SDL_FreeSurface(mask_surface);
+
+        return SUCCESS;
+    }
+
+    // Colour key enemy and death tiles
+    if (is_enemy_tile(tile) || in_array(TILES_DEATH, tile, NUM_TILES_DEATH)) {
+        SDL_SetColorKey(*surface, 1, SDL_MapRGB((*surface)->format, 0x00, 0x00, 0x00));
+    }
+
+    return SUCCESS;
+}
+
+bool assets_mask_tile(const uint8_t tile, uint8_t *mask)
+{
+    if (!is_player_tile(tile)) {
+        return false;
+    }
+
+    // Apply mask to walking tiles
+    uint8_t mask_offset = TILES_PLAYER_WALKING_MASK_OFFSET;
+
+    // Apply mask to climbing tiles
+    if (in_array(TILES_PLAYER_CLIMBING, tile, NUM_TILES_PLAYER_CLIMBING)) {
+        mask_offset = TILES_PLAYER_CLIMBING_MASK_OFFSET;
+    }
+
+    // Apply mask to jumping left and right
+    if (tile == TILE_PLAYER_JUMP_LEFT || tile == TILE_PLAYER_JUMP_RIGHT) {
+        mask_offset = TILE_PLAYER_JUMP_MASK_OFFSET;
+    }
+
+    // Apply mask to jetpack tiles
+    if (in_array(TILES_PLAYER_JETPACK, tile, NUM_TILES_PLAYER_JETPACK)) {
+        mask_offset = TILES_PLAYER_JETPACK_MASK_OFFSET;
+    }
+
+    *mask = tile + mask_offset;
+
+    return true;
+}
+
+static bool is_player_tile(uint8_t tile)
+{
+    return in_array(TILES_PLAYER_WALKING, tile, NUM_TILES_PLAYER_WALKING) || tile == TILE_PLAYER_JUMP_LEFT ||
+           tile == TILE_PLAYER_JUMP_RIGHT || in_array(TILES_PLAYER_CLIMBING, tile, NUM_TILES_PLAYER_CLIMBING) ||
+           in_array(TILES_PLAYER_JETPACK, tile, NUM_TILES_PLAYER_JETPACK);
+}
+
+static bool is_enemy_tile(uint8_t tile)
+{
+    return in_array(TILES_ENEMY_LEVEL_TWO, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_THREE, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_FOUR, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_FIVE, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_SIX, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_SEVEN, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_EIGHT, tile, NUM_TILES_ENEMIES) ||
+           in_array(TILES_ENEMY_LEVEL_NINE, tile, NUM_TILES_ENEMIES);
+}
@@ -0,0 +1,21 @@
+#ifndef HH_ASSETS_H
+#define HH_ASSETS_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Turning the tiles in res/assets into surfaces ready to become textures. NOTE: this calls SDL directly rather than
+// going through the allocation tracker so that it can run off the main thread too, so the surfaces handed back still
+// need to be tracked with HH_TRACK_SURFACE() on the main thread.
+
+void assets_tile_fname(char *fname, const uint8_t tile);
+// Loads a tile with player tiles masked and enemy and death tiles colour keyed
+int assets_decode_tile(const uint8_t tile, SDL_Surface **surface);
+// The same off the main thread, with what went wrong written to error rather than err_additional
+int assets_read_tile(const uint8_t tile, SDL_Surface **surface, char *error, const size_t error_size);
+// The tile whose pixels are cut out of a player tile, false for tiles that aren't masked
+bool assets_mask_tile(const uint8_t tile, uint8_t *mask);
+
+#endif // !HH_ASSETS_H
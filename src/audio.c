@@ -0,0 +1,345 @@
+#include "audio.h"
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include <string.h>
+
+#ifdef HH_SSE2
+#include <emmintrin.h>
+#endif
+
+// Loud enough to hear, quiet enough that a handful of voices at once don't clip
+#define VOLUME 3000
+#define MAX_NOTES 4
+
+// The effects are square waves in the spirit of the original's PC speaker, so they're made rather than loaded. A note
+// slides from one pitch to the other over its length.
+typedef struct {
+    uint16_t from_hz;
+    uint16_t to_hz;
+    uint16_t ms;
+} note_t;
+
+typedef struct {
+    note_t notes[MAX_NOTES];
+    bool loop;
+} recipe_t;
+
+static const recipe_t RECIPES[NUM_SOUNDS] = {
+    [SOUND_PICKUP] = {{{1200, 1200, 30}, {1800, 1800, 40}}, false},
+    [SOUND_TROPHY] = {{{800, 800, 60}, {1000, 1000, 60}, {1200, 1200, 60}, {1600, 1600, 60}}, false},
+    [SOUND_ITEM] = {{{600, 1400, 120}}, false},
+    [SOUND_SHOT] = {{{2000, 400, 80}}, false},
+    [SOUND_ENEMY_SHOT] = {{{1200, 300, 100}}, false},
+    [SOUND_ENEMY_KILLED] = {{{300, 80, 250}}, false},
+    [SOUND_DEATH] = {{{900, 60, 600}}, false},
+    [SOUND_JETPACK] = {{{90, 110, 50}, {110, 90, 50}}, true},
+    [SOUND_LEVEL_CLEARED] = {{{523, 523, 90}, {659, 659, 90}, {784, 784, 90}, {1046, 1046, 90}}, false},
+    [SOUND_EXTRA_LIFE] = {{{1046, 1046, 70}, {1318, 1318, 70}, {1046, 1046, 70}, {1568, 1568, 70}}, false},
+    [SOUND_GAME_OVER] = {{{392, 392, 200}, {330, 330, 200}, {262, 262, 200}, {196, 196, 400}}, false},
+    [SOUND_GAME_WON] = {{{523, 523, 120}, {659, 659, 120}, {784, 784, 120}, {1046, 1046, 400}}, false},
+};
+
+static void callback(void *data, Uint8 *stream, int len);
+static void handle_event(audio_t *audio, const game_event_t *event);
+static uint8_t sound_for(const game_event_t *event);
+static void play(audio_t *audio, const uint8_t sound);
+static void stop(audio_t *audio, const uint8_t sound);
+static void mix_voice(int32_t *mix, const int16_t *samples, const uint32_t n);
+static void clip(const int32_t *mix, int16_t *out, const uint32_t n);
+
+int audio_init(audio_t *audio)
+{
+    LOG_INFO("audio_init", "making sound effects");
+
+    memset(audio, 0, sizeof(audio_t));
+
+    for (uint8_t i = 0; i < NUM_SOUNDS; i++) {
+        const recipe_t *recipe = &RECIPES[i];
+        sound_t *sound = &audio->sounds[i];
+        sound->offset = audio->num_samples;
+        sound->loop = recipe->loop;
+
+        // NOTE: phase carries over from note to note so there are no clicks in between
+        float phase = 0.0f;
+        for (size_t j = 0; j < MAX_NOTES && recipe->notes[j].ms; j++) {
+            const note_t *note = &recipe->notes[j];
+            uint32_t length = (uint32_t)note->ms * AUDIO_RATE / 1000;
+            if (audio->num_samples + length > AUDIO_ARENA_SAMPLES) {
+                return err_fatal(ERR_ALLOC, "sound effects");
+            }
+
+            for (uint32_t k = 0; k < length; k++) {
+                float hz = note->from_hz + ((float)note->to_hz - note->from_hz) * k / length;
+                phase += hz / AUDIO_RATE;
+                phase -= (int)phase;
+                audio->samples[audio->num_samples++] = phase < 0.5f ? VOLUME : -VOLUME;
+            }
+        }
+
+        sound->length = audio->num_samples - sound->offset;
+    }
+
+    LOG_INFO("audio_init", "%u samples of sound effects", audio->num_samples);
+
+    return SUCCESS;
+}
+
+int audio_open(audio_t *audio)
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        LOG_INFO("audio_open", "no sound: %s", SDL_GetError());
+        return SUCCESS;
+    }
+
+    SDL_AudioSpec want = {0}, have;
+    want.freq = AUDIO_RATE;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = AUDIO_BUFFER_SAMPLES;
+    want.callback = callback;
+    want.userdata = audio;
+
+    // NOTE: no changes allowed, so the callback always gets what it mixes
+    audio->device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (!audio->device) {
+        LOG_INFO("audio_open", "no sound: %s", SDL_GetError());
+        return SUCCESS;
+    }
+
+    LOG_INFO("audio_open", "%d Hz, %u samples per callback", have.freq, have.samples);
+    SDL_PauseAudioDevice(audio->device, 0);
+
+    return SUCCESS;
+}
+
+void audio_close(audio_t *audio)
+{
+    if (audio->device) {
+        SDL_CloseAudioDevice(audio->device);
+        audio->device = 0;
+    }
+}
+
+void audio_report(const audio_t *audio)
+{
+    LOG_INFO("audio_report", "%d callbacks, slowest mix %d us of a %u us buffer, %d voices stolen, %d events dropped",
+             SDL_AtomicGet((SDL_atomic_t *)&audio->callbacks), SDL_AtomicGet((SDL_atomic_t *)&audio->worst_mix_us),
+             AUDIO_BUFFER_SAMPLES * 1000000u / AUDIO_RATE, SDL_AtomicGet((SDL_atomic_t *)&audio->stolen),
+             SDL_AtomicGet((SDL_atomic_t *)&audio->queue.dropped));
+}
+
+void audio_mix(audio_t *audio, int16_t *out, uint32_t samples)
+{
+    game_event_t event;
+    while (event_pop(&audio->queue, &event)) {
+        handle_event(audio, &event);
+    }
+
+    while (samples) {
+        uint32_t n = samples < AUDIO_BUFFER_SAMPLES ? samples : AUDIO_BUFFER_SAMPLES;
+        memset(audio->mix, 0, n * sizeof(int32_t));
+
+        for (size_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+            voice_t *voice = &audio->voices[i];
+            if (!voice->active) {
+                continue;
+            }
+
+            const sound_t *sound = &audio->sounds[voice->sound];
+            for (uint32_t done = 0; done < n && voice->active;) {
+                uint32_t left = sound->length - voice->pos;
+                uint32_t count = n - done < left ? n - done : left;
+
+                mix_voice(&audio->mix[done], &audio->samples[sound->offset + voice->pos], count);
+                done += count;
+                voice->pos += count;
+
+                if (voice->pos == sound->length) {
+                    voice->pos = 0;
+                    voice->active = sound->loop;
+                }
+            }
+        }
+
+        clip(audio->mix, out, n);
+        out += n;
+        samples -= n;
+    }
+}
+
+int audio_write_wav_header(FILE *fd, const uint32_t samples)
+{
+    uint32_t data_size = samples * sizeof(int16_t);
+    uint8_t header[44] = "RIFF____WAVEfmt ";
+    uint32_t fields[] = {16, 1 | 1 << 16, AUDIO_RATE, AUDIO_RATE * sizeof(int16_t), sizeof(int16_t) | 16 << 16};
+
+    // NOTE: WAV is little-endian
+    for (size_t i = 0; i < 4; i++) {
+        header[4 + i] = (uint8_t)((36 + data_size) >> (i * 8));
+    }
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        for (size_t j = 0; j < 4; j++) {
+            header[16 + i * 4 + j] = (uint8_t)(fields[i] >> (j * 8));
+        }
+    }
+    memcpy(&header[36], "data", 4);
+    for (size_t i = 0; i < 4; i++) {
+        header[40 + i] = (uint8_t)(data_size >> (i * 8));
+    }
+
+    if (fseek(fd, 0, SEEK_SET) != 0 || fwrite(header, 1, sizeof(header), fd) != sizeof(header)) {
+        return err_fatal(ERR_OPENING_FILE, "WAV header");
+    }
+
+    return fseek(fd, 0, SEEK_END) == 0 ? SUCCESS : err_fatal(ERR_OPENING_FILE, "WAV header");
+}
+
+// Runs on SDL's audio thread
+static void callback(void *data, Uint8 *stream, int len)
+{
+    audio_t *audio = data;
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    audio_mix(audio, (int16_t *)stream, (uint32_t)len / sizeof(int16_t));
+
+    int us = (int)((SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency());
+    if (us > SDL_AtomicGet(&audio->worst_mix_us)) {
+        SDL_AtomicSet(&audio->worst_mix_us, us);
+    }
+    SDL_AtomicIncRef(&audio->callbacks);
+}
+
+static void handle_event(audio_t *audio, const game_event_t *event)
+{
+    // The jetpack hums for as long as it's on
+    if (event->type == EVENT_JETPACK) {
+        if (event->value) {
+            play(audio, SOUND_JETPACK);
+        } else {
+            stop(audio, SOUND_JETPACK);
+        }
+        return;
+    }
+    if (event->type == EVENT_PLAYER_DIED || event->type == EVENT_LEVEL_CLEARED || event->type == EVENT_GAME_OVER) {
+        stop(audio, SOUND_JETPACK);
+    }
+
+    uint8_t sound = sound_for(event);
+    if (sound != NUM_SOUNDS) {
+        play(audio, sound);
+    }
+}
+
+static uint8_t sound_for(const game_event_t *event)
+{
+    switch (event->type) {
+    case EVENT_PICKUP:
+        if (event->value == TILE_TROPHY) {
+            return SOUND_TROPHY;
+        }
+        return event->value == TILE_GUN || event->value == TILE_JETPACK ? SOUND_ITEM : SOUND_PICKUP;
+    case EVENT_PLAYER_FIRED:
+        return SOUND_SHOT;
+    case EVENT_ENEMY_FIRED:
+        return SOUND_ENEMY_SHOT;
+    case EVENT_ENEMY_KILLED:
+        return SOUND_ENEMY_KILLED;
+    case EVENT_PLAYER_DIED:
+        return SOUND_DEATH;
+    case EVENT_LEVEL_CLEARED:
+        return SOUND_LEVEL_CLEARED;
+    case EVENT_EXTRA_LIFE:
+        return SOUND_EXTRA_LIFE;
+    case EVENT_GAME_OVER:
+        return SOUND_GAME_OVER;
+    case EVENT_GAME_WON:
+        return SOUND_GAME_WON;
+    // NOTE: the door fires every tick the player stands in it, clearing the level is what gets a sound
+    default:
+        return NUM_SOUNDS;
+    }
+}
+
+// Takes a free voice, or the one furthest through its sound when they're all busy
+static void play(audio_t *audio, const uint8_t sound)
+{
+    voice_t *voice = NULL;
+
+    for (size_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+        voice_t *candidate = &audio->voices[i];
+        if (!candidate->active) {
+            voice = candidate;
+            break;
+        }
+        // Loops are left alone, and only one of them plays at a time
+        if (audio->sounds[candidate->sound].loop) {
+            if (candidate->sound == sound) {
+                return;
+            }
+            continue;
+        }
+        if (!voice || candidate->pos > voice->pos) {
+            voice = candidate;
+        }
+    }
+    if (!voice) {
+        return;
+    }
+    if (voice->active) {
+        SDL_AtomicIncRef(&audio->stolen);
+    }
+
+    voice->active = true;
+    voice->sound = sound;
+    voice->pos = 0;
+}
+
+static void stop(audio_t *audio, const uint8_t sound)
+{
+    for (size_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+        if (audio->voices[i].sound == sound) {
+            audio->voices[i].active = false;
+        }
+    }
+}
+
+static void mix_voice(int32_t *mix, const int16_t *samples, const uint32_t n)
+{
+    uint32_t i = 0;
+
+#ifdef HH_SSE2
+    // 8 samples at a time, widened to 32 bits so the sum can't overflow before it's clipped
+    for (; i + 8 <= n; i += 8) {
+        __m128i in = _mm_loadu_si128((const __m128i *)&samples[i]);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+
+        __m128i *out = (__m128i *)&mix[i];
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), lo));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), hi));
+    }
+#endif
+
+    for (; i < n; i++) {
+        mix[i] += samples[i];
+    }
+}
+
+static void clip(const int32_t *mix, int16_t *out, const uint32_t n)
+{
+    uint32_t i = 0;
+
+#ifdef HH_SSE2
+    // Packing saturates, which is the clipping
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_load_si128((const __m128i *)&mix[i]);
+        __m128i hi = _mm_load_si128((const __m128i *)&mix[i + 4]);
+        _mm_storeu_si128((__m128i *)&out[i], _mm_packs_epi32(lo, hi));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i] = (int16_t)(mix[i] > INT16_MAX ? INT16_MAX : mix[i] < INT16_MIN ? INT16_MIN : mix[i]);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef HH_AUDIO_H
+#define HH_AUDIO_H
+
+#include "event.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define AUDIO_RATE 44100
+// Samples per callback, ~5.8 ms at AUDIO_RATE. NOTE: must be a multiple of 8 for the mixer.
+#define AUDIO_BUFFER_SAMPLES 256
+#define AUDIO_MAX_VOICES 16
+// Room for every sound effect back to back
+#define AUDIO_ARENA_SAMPLES (AUDIO_RATE * 9 / 2)
+
+enum {
+    SOUND_PICKUP,
+    SOUND_TROPHY,
+    SOUND_ITEM,
+    SOUND_SHOT,
+    SOUND_ENEMY_SHOT,
+    SOUND_ENEMY_KILLED,
+    SOUND_DEATH,
+    SOUND_JETPACK,
+    SOUND_LEVEL_CLEARED,
+    SOUND_EXTRA_LIFE,
+    SOUND_GAME_OVER,
+    SOUND_GAME_WON,
+    NUM_SOUNDS,
+};
+
+// Where a sound lives in the sample arena
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    bool loop;
+} sound_t;
+
+typedef struct {
+    bool active;
+    uint8_t sound;
+    uint32_t pos;
+} voice_t;
+
+// Mixes sound effects on SDL's audio thread. The simulation's events arrive through the same kind of
+// single-producer/single-consumer queue as every other subscriber, and the callback turns them into voices, so nothing
+// in the callback allocates or locks.
+typedef struct {
+    // Every sound decoded once, back to back
+    int16_t samples[AUDIO_ARENA_SAMPLES];
+    uint32_t num_samples;
+    sound_t sounds[NUM_SOUNDS];
+
+    voice_t voices[AUDIO_MAX_VOICES];
+    _Alignas(16) int32_t mix[AUDIO_BUFFER_SAMPLES];
+
+    event_queue_t queue;
+    SDL_AudioDeviceID device;
+
+    // Written by the callback, read when reporting
+    SDL_atomic_t callbacks;
+    SDL_atomic_t worst_mix_us;
+    SDL_atomic_t stolen;
+} audio_t;
+
+int audio_init(audio_t *audio);
+// Starts playing through the default device. NOTE: without a device the game carries on silently.
+int audio_open(audio_t *audio);
+// Turns any events waiting in the queue into voices and mixes the next samples, for the callback or rendering a file
+void audio_mix(audio_t *audio, int16_t *out, uint32_t samples);
+void audio_close(audio_t *audio);
+void audio_report(const audio_t *audio);
+
+// 16-bit mono at AUDIO_RATE, write the header again once the number of samples is known
+int audio_write_wav_header(FILE *fd, const uint32_t samples);
+
+#endif // !HH_AUDIO_H
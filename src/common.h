@@ -5,5 +5,11 @@
 
 #define TILE_SIZE 16
 #define NUM_LEVELS 10
+#define NUM_TILES 158
+
+// SSE2 is always there on x86-64, anything else takes the plain loops
+#if defined(__SSE2__) || defined(_M_X64)
+#define HH_SSE2
+#endif
 
 #endif // !HH_COMMON_H
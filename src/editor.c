@@ -0,0 +1,651 @@
+#include "editor.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_PATH_LEVEL 0xff
+// Largest move a single step of a path can make on either axis
+#define PATH_STEP_MAX 127
+#define LAST_ENEMY_TYPE (TILE_LAST_ENEMY - NUM_TILES_ENEMIES + 1)
+
+const char *EDITOR_TOOL_NAMES[NUM_TOOLS] = {"tiles", "path", "spawns", "start"};
+
+static uint8_t *level_byte(level_t *level, const uint8_t kind, const uint16_t i);
+static void edit(editor_t *editor, game_state_t *game, const uint8_t kind, const uint16_t offset, const uint8_t size,
+                 const uint8_t *after);
+static void apply(editor_t *editor, game_state_t *game, const edit_t *e, const uint8_t *bytes);
+static void refresh(editor_t *editor, game_state_t *game, const edit_t *e);
+static void undo(editor_t *editor, game_state_t *game);
+static void redo(editor_t *editor, game_state_t *game);
+static void use_tool(editor_t *editor, game_state_t *game, const int x, const int y, const uint8_t button);
+static void append_step(editor_t *editor, game_state_t *game, const int x, const int y);
+static void remove_step(editor_t *editor, game_state_t *game);
+static void add_or_remove_spawn(editor_t *editor, game_state_t *game, const int x, const int y);
+static void move_spawn(editor_t *editor, game_state_t *game, const int x, const int y);
+static void cycle(editor_t *editor, game_state_t *game, const int by);
+static void restart_enemy(game_state_t *game, const uint8_t i);
+static spawn_t spawn_at(const game_state_t *game, const uint8_t i);
+static uint8_t num_spawns(const game_state_t *game);
+static int find_spawn(const game_state_t *game, const int x, const int y);
+static void sum_path(editor_t *editor, const level_t *level, uint8_t from);
+static void ensure_path(editor_t *editor, const game_state_t *game);
+
+void editor_init(editor_t *editor, const level_t *levels)
+{
+    memset(editor, 0, sizeof(editor_t));
+    editor->brush = 1;
+    editor->spawn = NUM_ENEMIES;
+    editor->cursor_x = -1;
+    editor->cursor_y = -1;
+    editor->path_level = NO_PATH_LEVEL;
+    for (size_t i = 0; i < NUM_LEVELS; i++) {
+        memcpy(editor->tiles[i], levels[i].tiles, sizeof(editor->tiles[i]));
+    }
+}
+
+void editor_toggle(editor_t *editor, const game_state_t *game)
+{
+    editor->active = !editor->active;
+    editor->held = 0;
+    if (editor->active) {
+        editor->camera_x = game->players[0].camera_x;
+        editor->spawn = num_spawns(game) ? 0 : NUM_ENEMIES;
+    }
+
+    LOG_INFO("editor_toggle", "%s level %u", editor->active ? "editing" : "stopped editing", game->cur_level + 1);
+}
+
+void editor_key(editor_t *editor, game_state_t *game, const SDL_Keysym *key)
+{
+    bool ctrl = key->mod & KMOD_CTRL;
+    bool shift = key->mod & KMOD_SHIFT;
+
+    switch (key->sym) {
+    case SDLK_z: {
+        if (ctrl && shift) {
+            redo(editor, game);
+        } else if (ctrl) {
+            undo(editor, game);
+        }
+    } break;
+
+    case SDLK_y: {
+        if (ctrl) {
+            redo(editor, game);
+        }
+    } break;
+
+    case SDLK_s: {
+        if (ctrl) {
+            // NOTE: a file that can't be written leaves the edits in place to try again
+            int err = editor_save(editor, game);
+            if (err != SUCCESS) {
+                LOG_INFO("editor_key", "%s: %s", err_messages[err], err_additional);
+            }
+        }
+    } break;
+
+    case SDLK_h: {
+        // NOTE: an edit of its own, as if clicked
+        sim_level_defaults(game->level, game->cur_level);
+        uint8_t flags = game->level->flags ^ LEVEL_HUNTERS;
+        editor->stroke++;
+        edit(editor, game, EDIT_FLAGS, 0, sizeof(flags), &flags);
+        LOG_INFO("editor_key", "enemies %s", flags & LEVEL_HUNTERS ? "hunt" : "follow the path");
+    } break;
+
+    case SDLK_1:
+    case SDLK_2:
+    case SDLK_3:
+    case SDLK_4: {
+        editor->tool = (uint8_t)(key->sym - SDLK_1);
+    } break;
+
+    case SDLK_LEFTBRACKET: {
+        cycle(editor, game, -1);
+    } break;
+
+    case SDLK_RIGHTBRACKET: {
+        cycle(editor, game, 1);
+    } break;
+
+    case SDLK_LEFT:
+    case SDLK_RIGHT: {
+        int by = (shift ? EDITOR_VIEW_W : 1) * (key->sym == SDLK_LEFT ? -1 : 1);
+        int camera_x = SDL_max(editor->camera_x + by, 0);
+        editor->camera_x = (uint8_t)SDL_min(camera_x, LEVEL_W - EDITOR_VIEW_W);
+    } break;
+
+    default:
+        break;
+    }
+}
+
+void editor_press(editor_t *editor, game_state_t *game, const int x, const int y, const uint8_t button)
+{
+    editor->cursor_x = (int8_t)x;
+    editor->cursor_y = (int8_t)y;
+    if (x < 0 || y < 0) {
+        return;
+    }
+
+    editor->held = button;
+    editor->stroke++;
+    use_tool(editor, game, x, y, button);
+}
+
+void editor_move(editor_t *editor, game_state_t *game, const int x, const int y)
+{
+    bool moved = x != editor->cursor_x || y != editor->cursor_y;
+    editor->cursor_x = (int8_t)x;
+    editor->cursor_y = (int8_t)y;
+
+    // Dragging paints, or carries a spawn or the start along. Paths are only ever clicked.
+    if (!moved || !editor->held || x < 0 || y < 0 || editor->tool == TOOL_PATH) {
+        return;
+    }
+    if (editor->tool != TOOL_TILES && editor->held != SDL_BUTTON_LEFT) {
+        return;
+    }
+    use_tool(editor, game, x, y, editor->held);
+}
+
+void editor_release(editor_t *editor)
+{
+    editor->held = 0;
+}
+
+void editor_level_replaced(editor_t *editor, const level_t *level, const uint8_t index)
+{
+    memcpy(editor->tiles[index], level->tiles, sizeof(editor->tiles[index]));
+    if (editor->path_level == index) {
+        editor->path_level = NO_PATH_LEVEL;
+    }
+}
+
+int editor_save(editor_t *editor, const game_state_t *game)
+{
+    char fname[DATA_FNAME_SIZE];
+    snprintf(fname, sizeof(fname), "res/data/level%u.dat", game->cur_level);
+
+    // NOTE: the items picked up while playing are put back, they're only gone from this run of the level
+    level_t level = *game->level;
+    memcpy(level.tiles, editor->tiles[game->cur_level], sizeof(level.tiles));
+    int err = sim_save_level(&level, fname);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    LOG_INFO("editor_save", "saved %s", fname);
+
+    return SUCCESS;
+}
+
+void editor_render(editor_t *editor, SDL_Renderer *renderer, const game_state_t *game, SDL_Texture *const *tiles,
+                   const int top)
+{
+    if (!editor->active) {
+        return;
+    }
+    ensure_path(editor, game);
+
+    int left = -editor->camera_x * TILE_SIZE;
+    SDL_Point points[PATH_MAX_STEPS + 1];
+
+    // The path as each enemy walks it from its spawn, the spawn the path tool adds to brighter
+    for (uint8_t i = 0; i < num_spawns(game); i++) {
+        spawn_t spawn = spawn_at(game, i);
+        int x = left + spawn.x * TILE_SIZE;
+        int y = top + spawn.y * TILE_SIZE;
+
+        for (uint8_t k = 0; k <= editor->path_steps; k++) {
+            points[k] = (SDL_Point){x + TILE_SIZE / 2 + editor->path_x[k], y + TILE_SIZE / 2 + editor->path_y[k]};
+        }
+        uint8_t bright = i == editor->spawn ? 0xff : 0x80;
+        SDL_SetRenderDrawColor(renderer, bright, bright, 0x00, 0xff);
+        SDL_RenderDrawLines(renderer, points, editor->path_steps + 1);
+
+        SDL_SetRenderDrawColor(renderer, bright, 0x00, 0x00, 0xff);
+        SDL_RenderDrawRect(renderer, &(SDL_Rect){x, y, TILE_SIZE, TILE_SIZE});
+    }
+
+    uint8_t start_x, start_y;
+    sim_level_start(game->level, game->cur_level, &start_x, &start_y);
+    SDL_SetRenderDrawColor(renderer, 0x00, 0xff, 0x00, 0xff);
+    SDL_RenderDrawRect(renderer, &(SDL_Rect){left + start_x * TILE_SIZE, top + start_y * TILE_SIZE, TILE_SIZE,
+                                             TILE_SIZE});
+
+    if (editor->cursor_x < 0 || editor->cursor_y < 0) {
+        return;
+    }
+    SDL_Rect cursor = {left + editor->cursor_x * TILE_SIZE, top + editor->cursor_y * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+    if (editor->tool == TOOL_TILES) {
+        SDL_RenderCopy(renderer, tiles[editor->brush], NULL, &cursor);
+    }
+    SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
+    SDL_RenderDrawRect(renderer, &cursor);
+}
+
+uint32_t editor_undoable(const editor_t *editor)
+{
+    return editor->cursor - editor->oldest;
+}
+
+static uint8_t *level_byte(level_t *level, const uint8_t kind, const uint16_t i)
+{
+    switch (kind) {
+    case EDIT_TILES: {
+        return &level->tiles[i];
+    }
+
+    case EDIT_PATH: {
+        return &level->path[i];
+    }
+
+    case EDIT_SPAWNS: {
+        if (i == 0) {
+            return &level->num_spawns;
+        }
+        spawn_t *spawn = &level->spawns[(i - 1) / 3];
+        return (i - 1) % 3 == 0 ? &spawn->type : (i - 1) % 3 == 1 ? &spawn->x : &spawn->y;
+    }
+
+    case EDIT_START: {
+        return i == 0 ? &level->start_x : &level->start_y;
+    }
+
+    default: {
+        return &level->flags;
+    }
+    }
+}
+
+// Makes a change to the current level, one undo step with the others in the stroke
+static void edit(editor_t *editor, game_state_t *game, const uint8_t kind, const uint16_t offset, const uint8_t size,
+                 const uint8_t *after)
+{
+    edit_t e = {
+        .kind = kind,
+        .level = game->cur_level,
+        .size = size,
+        .offset = offset,
+        .stroke = editor->stroke,
+    };
+    for (uint8_t i = 0; i < size; i++) {
+        // NOTE: tiles as they are in the file, not as they are after this run's pickups
+        e.before[i] =
+            kind == EDIT_TILES ? editor->tiles[e.level][offset + i] : *level_byte(game->level, kind, offset + i);
+    }
+    memcpy(e.after, after, size);
+    if (memcmp(e.before, e.after, size) == 0) {
+        return;
+    }
+
+    // A new edit drops whatever was undone, and the oldest once the history is full
+    editor->history[editor->cursor++ % EDITOR_HISTORY_SIZE] = e;
+    editor->newest = editor->cursor;
+    if (editor->newest - editor->oldest > EDITOR_HISTORY_SIZE) {
+        editor->oldest++;
+    }
+
+    apply(editor, game, &e, e.after);
+}
+
+static void apply(editor_t *editor, game_state_t *game, const edit_t *e, const uint8_t *bytes)
+{
+    level_t *level = &game->levels[e->level];
+    for (uint8_t i = 0; i < e->size; i++) {
+        *level_byte(level, e->kind, e->offset + i) = bytes[i];
+    }
+    if (e->kind == EDIT_TILES) {
+        memcpy(&editor->tiles[e->level][e->offset], bytes, e->size);
+    }
+
+    refresh(editor, game, e);
+}
+
+// Brings what was worked out from the edited bytes up to date, touching only what they affect
+static void refresh(editor_t *editor, game_state_t *game, const edit_t *e)
+{
+    if (e->level != game->cur_level) {
+        if (e->kind == EDIT_PATH && editor->path_level == e->level) {
+            editor->path_level = NO_PATH_LEVEL;
+        }
+        // NOTE: the rest is only read from the level when it starts
+        return;
+    }
+
+    switch (e->kind) {
+    case EDIT_PATH: {
+        // Enemies past the change would carry on from steps that are no longer there
+        for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
+            if (game->enemies[i].type && !game->enemies[i].dying && game->enemies[i].path_index > e->offset) {
+                restart_enemy(game, i);
+            }
+        }
+        if (editor->path_level == e->level) {
+            sum_path(editor, game->level, (uint8_t)(e->offset / 2));
+        }
+    } break;
+
+    case EDIT_SPAWNS: {
+        // NOTE: a change to the number of spawns can move every spawn after it, otherwise only the one edited moved
+        uint8_t first = e->offset ? (uint8_t)((e->offset - 1) / 3) : 0;
+        uint8_t last = e->offset ? (uint8_t)((e->offset + e->size - 2) / 3) : NUM_ENEMIES - 1;
+        for (uint8_t i = first; i <= last; i++) {
+            restart_enemy(game, i);
+        }
+        if (editor->spawn >= num_spawns(game)) {
+            editor->spawn = num_spawns(game) ? num_spawns(game) - 1 : NUM_ENEMIES;
+        }
+    } break;
+
+    case EDIT_START: {
+        for (size_t i = 0; i < game->num_players; i++) {
+            player_t *player = &game->players[i];
+            player->x = (int8_t)game->level->start_x;
+            player->y = (int8_t)game->level->start_y;
+            player->px = player->x * TILE_SIZE;
+            player->py = player->y * TILE_SIZE;
+        }
+    } break;
+
+    case EDIT_FLAGS: {
+        // Hunters move a tile at a time from wherever they are, and the path is read from its start
+        for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
+            restart_enemy(game, i);
+        }
+    } break;
+
+    case EDIT_TILES: {
+        // NOTE: rendering and collisions read the tiles each tick, only the flow field keeps which of them are solid
+        for (uint8_t i = 0; i < e->size; i++) {
+            flow_tile_changed(game->flow, game->level->tiles, (uint16_t)(e->offset + i));
+        }
+    } break;
+    }
+}
+
+static void undo(editor_t *editor, game_state_t *game)
+{
+    if (editor->cursor == editor->oldest) {
+        return;
+    }
+
+    uint32_t stroke = editor->history[(editor->cursor - 1) % EDITOR_HISTORY_SIZE].stroke;
+    while (editor->cursor != editor->oldest &&
+           editor->history[(editor->cursor - 1) % EDITOR_HISTORY_SIZE].stroke == stroke) {
+        const edit_t *e = &editor->history[--editor->cursor % EDITOR_HISTORY_SIZE];
+        apply(editor, game, e, e->before);
+    }
+}
+
+static void redo(editor_t *editor, game_state_t *game)
+{
+    if (editor->cursor == editor->newest) {
+        return;
+    }
+
+    uint32_t stroke = editor->history[editor->cursor % EDITOR_HISTORY_SIZE].stroke;
+    while (editor->cursor != editor->newest && editor->history[editor->cursor % EDITOR_HISTORY_SIZE].stroke == stroke) {
+        const edit_t *e = &editor->history[editor->cursor++ % EDITOR_HISTORY_SIZE];
+        apply(editor, game, e, e->after);
+    }
+}
+
+static void use_tool(editor_t *editor, game_state_t *game, const int x, const int y, const uint8_t button)
+{
+    switch (editor->tool) {
+    case TOOL_TILES: {
+        uint16_t i = (uint16_t)(y * LEVEL_W + x);
+        if (button == SDL_BUTTON_MIDDLE) {
+            uint8_t tile = editor->tiles[game->cur_level][i];
+            editor->brush = tile < TILE_FIRST_PLAYER ? tile : editor->brush;
+            return;
+        }
+        uint8_t tile = button == SDL_BUTTON_LEFT ? editor->brush : 0;
+        edit(editor, game, EDIT_TILES, i, 1, &tile);
+    } break;
+
+    case TOOL_PATH: {
+        if (button == SDL_BUTTON_LEFT) {
+            append_step(editor, game, x, y);
+        } else if (button == SDL_BUTTON_RIGHT) {
+            remove_step(editor, game);
+        }
+    } break;
+
+    case TOOL_SPAWNS: {
+        sim_level_defaults(game->level, game->cur_level);
+        if (button == SDL_BUTTON_LEFT) {
+            move_spawn(editor, game, x, y);
+        } else if (button == SDL_BUTTON_RIGHT) {
+            add_or_remove_spawn(editor, game, x, y);
+        }
+    } break;
+
+    default: {
+        if (button == SDL_BUTTON_LEFT) {
+            sim_level_defaults(game->level, game->cur_level);
+            uint8_t start[2] = {(uint8_t)x, (uint8_t)y};
+            edit(editor, game, EDIT_START, 0, sizeof(start), start);
+        }
+    } break;
+    }
+}
+
+// Adds steps from the end of the path to the tile, as many as it takes to get there
+static void append_step(editor_t *editor, game_state_t *game, const int x, const int y)
+{
+    if (editor->spawn >= num_spawns(game)) {
+        LOG_INFO("append_step", "paths start from a spawn, add one first");
+        return;
+    }
+    ensure_path(editor, game);
+
+    spawn_t spawn = spawn_at(game, editor->spawn);
+    int dx = (x - spawn.x) * TILE_SIZE - editor->path_x[editor->path_steps];
+    int dy = (y - spawn.y) * TILE_SIZE - editor->path_y[editor->path_steps];
+    if (!dx && !dy) {
+        return;
+    }
+
+    // NOTE: a step that happens to be the end marker would cut the path short, so the move is split another way
+    int steps = (SDL_max(abs(dx), abs(dy)) + PATH_STEP_MAX - 1) / PATH_STEP_MAX;
+    for (bool clash = true; clash; steps += clash) {
+        clash = false;
+        for (int k = 0; k < steps && !clash; k++) {
+            clash = (uint8_t)(dx * (k + 1) / steps - dx * k / steps) == PATH_END &&
+                    (uint8_t)(dy * (k + 1) / steps - dy * k / steps) == PATH_END;
+        }
+    }
+    if (editor->path_steps + steps > (int)PATH_MAX_STEPS) {
+        LOG_INFO("append_step", "paths are at most %u steps", (unsigned int)PATH_MAX_STEPS);
+        return;
+    }
+
+    for (int k = 0; k < steps; k++) {
+        uint8_t step[4] = {
+            (uint8_t)(dx * (k + 1) / steps - dx * k / steps),
+            (uint8_t)(dy * (k + 1) / steps - dy * k / steps),
+            PATH_END,
+            PATH_END,
+        };
+        edit(editor, game, EDIT_PATH, (uint16_t)(editor->path_steps * 2), sizeof(step), step);
+    }
+}
+
+static void remove_step(editor_t *editor, game_state_t *game)
+{
+    ensure_path(editor, game);
+    if (!editor->path_steps) {
+        return;
+    }
+
+    // The old end marker is cleared, like the unused bytes after the original levels' paths
+    uint8_t end[4] = {PATH_END, PATH_END, 0, 0};
+    edit(editor, game, EDIT_PATH, (uint16_t)((editor->path_steps - 1) * 2), sizeof(end), end);
+}
+
+// Right clicking a spawn removes it, anywhere else adds one
+static void add_or_remove_spawn(editor_t *editor, game_state_t *game, const int x, const int y)
+{
+    level_t *level = game->level;
+    uint8_t bytes[EDIT_MAX_BYTES];
+    for (uint8_t i = 0; i < EDIT_MAX_BYTES; i++) {
+        bytes[i] = *level_byte(level, EDIT_SPAWNS, i);
+    }
+
+    int found = find_spawn(game, x, y);
+    if (found >= 0) {
+        uint8_t size = (uint8_t)(1 + level->num_spawns * 3);
+        memmove(&bytes[1 + found * 3], &bytes[1 + (found + 1) * 3], (size_t)(size - 1 - (found + 1) * 3));
+        bytes[0]--;
+        edit(editor, game, EDIT_SPAWNS, 0, size, bytes);
+        return;
+    }
+
+    if (level->num_spawns == NUM_ENEMIES) {
+        LOG_INFO("add_or_remove_spawn", "levels have at most %d enemies", NUM_ENEMIES);
+        return;
+    }
+    uint8_t type = level->num_spawns ? level->spawns[level->num_spawns - 1].type : TILE_ENEMY_SPIDY;
+    uint8_t *spawn = &bytes[1 + level->num_spawns * 3];
+    spawn[0] = type;
+    spawn[1] = (uint8_t)x;
+    spawn[2] = (uint8_t)y;
+    bytes[0]++;
+    edit(editor, game, EDIT_SPAWNS, 0, (uint8_t)(1 + bytes[0] * 3), bytes);
+    editor->spawn = (uint8_t)(bytes[0] - 1);
+}
+
+// Left clicking a spawn picks it, anywhere else moves the one picked there
+static void move_spawn(editor_t *editor, game_state_t *game, const int x, const int y)
+{
+    int found = find_spawn(game, x, y);
+    if (found >= 0) {
+        editor->spawn = (uint8_t)found;
+        return;
+    }
+    if (editor->spawn >= game->level->num_spawns) {
+        return;
+    }
+
+    uint8_t spawn[3] = {game->level->spawns[editor->spawn].type, (uint8_t)x, (uint8_t)y};
+    edit(editor, game, EDIT_SPAWNS, (uint16_t)(1 + editor->spawn * 3), sizeof(spawn), spawn);
+}
+
+// Picks the next or previous tile to paint, or kind of enemy for the picked spawn
+static void cycle(editor_t *editor, game_state_t *game, const int by)
+{
+    if (editor->tool == TOOL_TILES) {
+        editor->brush = (uint8_t)((editor->brush + TILE_FIRST_PLAYER + by) % TILE_FIRST_PLAYER);
+        return;
+    }
+    if (editor->tool != TOOL_SPAWNS || editor->spawn >= num_spawns(game)) {
+        return;
+    }
+
+    sim_level_defaults(game->level, game->cur_level);
+    int type = game->level->spawns[editor->spawn].type + by * NUM_TILES_ENEMIES;
+    if (type < TILE_FIRST_ENEMY) {
+        type = LAST_ENEMY_TYPE;
+    } else if (type > LAST_ENEMY_TYPE) {
+        type = TILE_FIRST_ENEMY;
+    }
+
+    editor->stroke++;
+    uint8_t bytes[1] = {(uint8_t)type};
+    edit(editor, game, EDIT_SPAWNS, (uint16_t)(1 + editor->spawn * 3), sizeof(bytes), bytes);
+}
+
+// Puts an enemy back on its spawn at the start of the path, or takes it away if its spawn is gone
+static void restart_enemy(game_state_t *game, const uint8_t i)
+{
+    enemy_t *enemy = &game->enemies[i];
+    memset(enemy, 0, sizeof(enemy_t));
+    timer_cancel(&game->timers, ENEMY_TIMER(i));
+    if (i >= num_spawns(game)) {
+        return;
+    }
+
+    spawn_t spawn = spawn_at(game, i);
+    enemy->type = spawn.type;
+    enemy->x = spawn.x;
+    enemy->y = spawn.y;
+    enemy->px = spawn.x * TILE_SIZE;
+    enemy->py = spawn.y * TILE_SIZE;
+    sim_restart_routine(game, i);
+}
+
+static spawn_t spawn_at(const game_state_t *game, const uint8_t i)
+{
+    if (game->level->has_extra) {
+        return game->level->spawns[i];
+    }
+
+    const enemy_t *start = &ENEMIES_START_STATE[game->cur_level][i];
+    return (spawn_t){start->type, (uint8_t)(start->px / TILE_SIZE), (uint8_t)(start->py / TILE_SIZE)};
+}
+
+static uint8_t num_spawns(const game_state_t *game)
+{
+    if (game->level->has_extra) {
+        return game->level->num_spawns;
+    }
+
+    uint8_t count = 0;
+    while (count < NUM_ENEMIES && ENEMIES_START_STATE[game->cur_level][count].type) {
+        count++;
+    }
+    return count;
+}
+
+static int find_spawn(const game_state_t *game, const int x, const int y)
+{
+    for (uint8_t i = 0; i < num_spawns(game); i++) {
+        spawn_t spawn = spawn_at(game, i);
+        if (spawn.x == x && spawn.y == y) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Sums the path's steps again from step from on, which for adding or removing the last step is just that one
+static void sum_path(editor_t *editor, const level_t *level, uint8_t from)
+{
+    if (from > editor->path_steps) {
+        from = editor->path_steps;
+    }
+    if (from == 0) {
+        editor->path_x[0] = 0;
+        editor->path_y[0] = 0;
+    }
+
+    uint8_t k = from;
+    for (; k < PATH_MAX_STEPS; k++) {
+        uint8_t step_x = level->path[k * 2];
+        uint8_t step_y = level->path[k * 2 + 1];
+        if (step_x == PATH_END && step_y == PATH_END) {
+            break;
+        }
+        editor->path_x[k + 1] = (int16_t)(editor->path_x[k] + (int8_t)step_x);
+        editor->path_y[k + 1] = (int16_t)(editor->path_y[k] + (int8_t)step_y);
+    }
+    editor->path_steps = k;
+}
+
+// The path is only summed from the start for a level the editor hasn't seen yet
+static void ensure_path(editor_t *editor, const game_state_t *game)
+{
+    if (editor->path_level == game->cur_level) {
+        return;
+    }
+
+    editor->path_level = game->cur_level;
+    editor->path_steps = 0;
+    sum_path(editor, game->level, 0);
+}
@@ -0,0 +1,107 @@
+#ifndef HH_EDITOR_H
+#define HH_EDITOR_H
+
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: must be a power of two
+#define EDITOR_HISTORY_SIZE 1024
+// Enough for every spawn at once, see edit_t
+#define EDIT_MAX_BYTES (1 + NUM_ENEMIES * 3)
+// Steps in a path, the last pair of its bytes is always the end marker
+#define PATH_MAX_STEPS (sizeof(((level_t *)0)->path) / 2 - 1)
+#define PATH_END 0xea
+// Tiles across the screen
+#define EDITOR_VIEW_W 20
+
+enum {
+    TOOL_TILES,
+    TOOL_PATH,
+    TOOL_SPAWNS,
+    TOOL_START,
+    NUM_TOOLS,
+};
+
+extern const char *EDITOR_TOOL_NAMES[NUM_TOOLS];
+
+// What an edit changed in a level_t, seen as bytes so undo and redo are the same copy whatever was edited
+enum {
+    // tiles[]
+    EDIT_TILES,
+    // path[]
+    EDIT_PATH,
+    // num_spawns, then the type, x and y of each spawn
+    EDIT_SPAWNS,
+    // start_x, start_y
+    EDIT_START,
+    // flags
+    EDIT_FLAGS,
+};
+
+typedef struct {
+    uint8_t kind;
+    uint8_t level;
+    uint8_t size;
+    uint16_t offset;
+    // Edits with the same stroke are undone together e.g. one drag of the brush
+    uint32_t stroke;
+    uint8_t before[EDIT_MAX_BYTES];
+    uint8_t after[EDIT_MAX_BYTES];
+} edit_t;
+
+// Paints the level being played while it's played. Edits go straight into game->level, and anything the game keeps
+// about what was edited is brought up to date from the edit alone: enemies on a changed part of the path start it
+// again, enemies follow their spawns and the player their start, and the path's positions are summed again only from
+// the step that changed.
+typedef struct {
+    bool active;
+    uint8_t tool;
+    uint8_t brush;
+    // The spawn moved by the spawn tool and the path is drawn from, NUM_ENEMIES for none
+    uint8_t spawn;
+    uint8_t camera_x;
+    // Tile under the mouse, -1 when it's off the level
+    int8_t cursor_x;
+    int8_t cursor_y;
+    // Mouse button held since the last press, 0 if none
+    uint8_t held;
+
+    // Edits numbered from the first, edit n is kept at n % EDITOR_HISTORY_SIZE. Those from cursor to newest were
+    // undone and can be redone.
+    edit_t history[EDITOR_HISTORY_SIZE];
+    uint32_t oldest;
+    uint32_t cursor;
+    uint32_t newest;
+    uint32_t stroke;
+
+    // The tiles as they are in the files plus the edits, without the items picked up while playing
+    uint8_t tiles[NUM_LEVELS][LEVEL_W * LEVEL_H];
+
+    // Where each step of the current level's path ends, relative to where it starts
+    uint8_t path_level;
+    uint8_t path_steps;
+    int16_t path_x[PATH_MAX_STEPS + 1];
+    int16_t path_y[PATH_MAX_STEPS + 1];
+} editor_t;
+
+void editor_init(editor_t *editor, const level_t *levels);
+void editor_toggle(editor_t *editor, const game_state_t *game);
+// Tools, brushes, scrolling, hunting enemies (h), undo (ctrl+z), redo (ctrl+y) and saving (ctrl+s)
+void editor_key(editor_t *editor, game_state_t *game, const SDL_Keysym *key);
+// Mouse positions are in level tiles, x and y are -1 when the mouse is off the level
+void editor_press(editor_t *editor, game_state_t *game, const int x, const int y, const uint8_t button);
+void editor_move(editor_t *editor, game_state_t *game, const int x, const int y);
+void editor_release(editor_t *editor);
+// A level was swapped for another copy of it e.g. by a reload
+void editor_level_replaced(editor_t *editor, const level_t *level, const uint8_t index);
+// Writes the current level back to its file in res/data
+int editor_save(editor_t *editor, const game_state_t *game);
+// Draws the path, spawns, start and cursor over the frame, top is where the level's first row is on screen
+void editor_render(editor_t *editor, SDL_Renderer *renderer, const game_state_t *game, SDL_Texture *const *tiles,
+                   const int top);
+// Edits that can be undone
+uint32_t editor_undoable(const editor_t *editor);
+
+#endif // !HH_EDITOR_H
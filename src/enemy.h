@@ -2,6 +2,7 @@
 #define HH_ENEMY_H
 
 #include "common.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 #define NUM_ENEMIES 5
@@ -32,7 +33,8 @@ static const uint8_t TILES_ENEMY_LEVEL_NINE[NUM_TILES_ENEMIES] = {117, 118, 119,
 typedef struct {
     uint8_t type;
     uint8_t path_index;
-    uint8_t death_timer;
+    // Shot or run into, until its death timer fires
+    bool dying;
 
     uint8_t x;
     uint8_t y;
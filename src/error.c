@@ -3,7 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-char err_additional[256] = {0};
+char err_additional[ERR_ADDITIONAL_SIZE] = {0};
 
 const char *err_messages[] = {
     "",
@@ -14,6 +14,18 @@ const char *err_messages[] = {
     "Error loading BMP",
     "Error initialising fonts",
     "Error loading font",
+    "Error reading replay",
+    "Replay finished with a different result",
+    "Allocation after the first frame of a level",
+    "Network error",
+    "Lost the connection to the other player",
+    "Players went out of sync",
+    "Error sharing the game state",
+    "Error watching for changed files",
+    "Error setting up post-processing",
+    "Rendered frames don't match their golden images",
+    "Error compiling a script",
+    "Level can't be finished",
 };
 
 void err_handle(const int err)
@@ -10,9 +10,25 @@ enum {
     ERR_SDL_LOADING_BMP,
     ERR_SDL_TTF,
     ERR_SDL_TTF_LOAD_FONT,
+    ERR_REPLAY,
+    ERR_REPLAY_MISMATCH,
+    ERR_STEADY_STATE_ALLOC,
+    ERR_NET,
+    ERR_NET_TIMEOUT,
+    ERR_NET_DESYNC,
+    ERR_FEED,
+    ERR_HOT_RELOAD,
+    ERR_POST,
+    ERR_GOLDEN_MISMATCH,
+    ERR_SCRIPT,
+    ERR_LEVEL,
 };
 
-extern char err_additional[256];
+// NOTE: one for the whole process, so only the main thread may write it through err_fatal(). Code off the main thread
+// uses the functions that hand what went wrong back in a buffer of this size instead.
+#define ERR_ADDITIONAL_SIZE 256
+
+extern char err_additional[ERR_ADDITIONAL_SIZE];
 extern const char *err_messages[];
 
 void err_handle(const int);
@@ -0,0 +1,132 @@
+#include "event.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+
+static const char *EVENT_NAMES[NUM_EVENT_TYPES] = {
+    "level start", "level cleared", "pickup", "door reached", "hazard touched", "enemy killed", "player died",
+    "life lost",   "extra life",    "player fired", "enemy fired", "jetpack", "game over", "game won",
+    "tile set",
+};
+
+static const char *DEATH_CAUSES[NUM_DEATH_CAUSES] = {"hazard", "enemy", "enemy bullet"};
+
+static void queue_push(event_queue_t *queue, const game_event_t *event);
+
+int event_subscribe(event_bus_t *bus, event_queue_t *queue)
+{
+    if (bus->num_queues >= MAX_EVENT_SUBSCRIBERS) {
+        return err_fatal(ERR_ALLOC, "too many event subscribers");
+    }
+
+    bus->queues[bus->num_queues++] = queue;
+
+    return SUCCESS;
+}
+
+void event_publish(event_bus_t *bus, const event_buffer_t *buffer, const uint32_t tick)
+{
+    for (size_t i = 0; i < buffer->count; i++) {
+        game_event_t event = buffer->events[i];
+        event.tick = tick;
+
+        for (size_t j = 0; j < bus->num_queues; j++) {
+            queue_push(bus->queues[j], &event);
+        }
+    }
+}
+
+bool event_pop(event_queue_t *queue, game_event_t *event)
+{
+    uint32_t head = (uint32_t)SDL_AtomicGet(&queue->head);
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&queue->tail);
+
+    SDL_MemoryBarrierAcquire();
+
+    if (head == tail) {
+        return false;
+    }
+
+    *event = queue->events[head & (EVENT_QUEUE_SIZE - 1)];
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->head, (int)(head + 1));
+
+    return true;
+}
+
+const char *event_name(const uint8_t type)
+{
+    return type < NUM_EVENT_TYPES ? EVENT_NAMES[type] : "unknown";
+}
+
+void event_log(const game_event_t *event)
+{
+    switch (event->type) {
+    case EVENT_GAME_WON: {
+        printf("Winner, winner, chicken dinner - your score was %u!\n", event->value);
+    } break;
+
+    case EVENT_PLAYER_DIED: {
+        LOG_INFO("event_log", "tick %u: player died on level %u at %u,%u (%s)", event->tick, event->level + 1,
+                 event->x, event->y, event->value < NUM_DEATH_CAUSES ? DEATH_CAUSES[event->value] : "unknown");
+    } break;
+
+    // NOTE: these happen every few frames so would drown out everything else
+    case EVENT_DOOR_REACHED:
+    case EVENT_PLAYER_FIRED:
+    case EVENT_ENEMY_FIRED:
+        break;
+
+    default: {
+        LOG_INFO("event_log", "tick %u: %s on level %u at %u,%u (%u)", event->tick, event_name(event->type),
+                 event->level + 1, event->x, event->y, event->value);
+    } break;
+    }
+}
+
+void event_count(event_stats_t *stats, const game_event_t *event)
+{
+    if (event->type >= NUM_EVENT_TYPES) {
+        return;
+    }
+
+    stats->counts[event->type]++;
+    if (event->type == EVENT_PLAYER_DIED && event->value < NUM_DEATH_CAUSES) {
+        stats->deaths[event->value]++;
+    }
+}
+
+void event_stats_report(const event_stats_t *stats)
+{
+    printf("events:\n");
+    for (size_t i = 0; i < NUM_EVENT_TYPES; i++) {
+        if (stats->counts[i]) {
+            printf("  %-16s %u\n", EVENT_NAMES[i], stats->counts[i]);
+        }
+    }
+    for (size_t i = 0; i < NUM_DEATH_CAUSES; i++) {
+        if (stats->deaths[i]) {
+            printf("  died by %-8s %u\n", DEATH_CAUSES[i], stats->deaths[i]);
+        }
+    }
+}
+
+static void queue_push(event_queue_t *queue, const game_event_t *event)
+{
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&queue->tail);
+    uint32_t head = (uint32_t)SDL_AtomicGet(&queue->head);
+
+    SDL_MemoryBarrierAcquire();
+
+    // Never block the simulation on a slow consumer
+    if (tail - head >= EVENT_QUEUE_SIZE) {
+        SDL_AtomicIncRef(&queue->dropped);
+        return;
+    }
+
+    queue->events[tail & (EVENT_QUEUE_SIZE - 1)] = *event;
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, (int)(tail + 1));
+}
@@ -0,0 +1,45 @@
+#ifndef HH_EVENT_H
+#define HH_EVENT_H
+
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: must be a power of two
+#define EVENT_QUEUE_SIZE 1024
+
+// The game's sound, log, stats and particles. Every tick's events are copied into each queue, so there's no room kept
+// spare; a fifth subscriber makes event_subscribe() fail until this goes up.
+#define MAX_EVENT_SUBSCRIBERS 4
+
+// Single-producer/single-consumer ring of events, one per subscriber
+typedef struct {
+    game_event_t events[EVENT_QUEUE_SIZE];
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t dropped;
+} event_queue_t;
+
+// Fans the events emitted by each tick out to every subscriber's queue
+typedef struct {
+    uint8_t num_queues;
+    event_queue_t *queues[MAX_EVENT_SUBSCRIBERS];
+} event_bus_t;
+
+typedef struct {
+    uint32_t counts[NUM_EVENT_TYPES];
+    uint32_t deaths[NUM_DEATH_CAUSES];
+} event_stats_t;
+
+int event_subscribe(event_bus_t *bus, event_queue_t *queue);
+void event_publish(event_bus_t *bus, const event_buffer_t *buffer, const uint32_t tick);
+bool event_pop(event_queue_t *queue, game_event_t *event);
+const char *event_name(const uint8_t type);
+
+// Consumers
+void event_log(const game_event_t *event);
+void event_count(event_stats_t *stats, const game_event_t *event);
+void event_stats_report(const event_stats_t *stats);
+
+#endif // !HH_EVENT_H
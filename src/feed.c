@@ -0,0 +1,186 @@
+// shm_open(), mmap() and friends are POSIX, not C11
+#define _POSIX_C_SOURCE 200112L
+
+#include "feed.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static void write_frame(feed_t *feed, feed_frame_t *frame, const game_state_t *game);
+static void write_tiles(feed_t *feed, feed_frame_t *frame, const game_state_t *game);
+
+#ifndef _WIN32
+
+// NOTE: names start with a slash, e.g. FEED_DEFAULT_NAME
+int feed_create(feed_t *feed, const char *name)
+{
+    LOG_INFO("feed_create", "publishing to %s", name);
+
+    memset(feed, 0, sizeof(feed_t));
+    if (strlen(name) >= sizeof(feed->name)) {
+        return err_fatal(ERR_FEED, "name too long");
+    }
+    strcpy(feed->name, name);
+
+    feed->fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (feed->fd < 0) {
+        return err_fatal(ERR_FEED, strerror(errno));
+    }
+    if (ftruncate(feed->fd, sizeof(feed_shared_t)) != 0) {
+        close(feed->fd);
+        return err_fatal(ERR_FEED, strerror(errno));
+    }
+
+    feed->shared = mmap(NULL, sizeof(feed_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, feed->fd, 0);
+    if (feed->shared == MAP_FAILED) {
+        feed->shared = NULL;
+        close(feed->fd);
+        return err_fatal(ERR_FEED, strerror(errno));
+    }
+
+    // NOTE: readers still attached from a previous game see the frame count start again and catch up from there
+    feed_shared_t *shared = feed->shared;
+    memset(shared, 0, sizeof(feed_shared_t));
+    shared->version = FEED_VERSION;
+    shared->frame_size = sizeof(feed_frame_t);
+    shared->num_slots = FEED_SLOTS;
+    shared->level = UINT8_MAX;
+    SDL_MemoryBarrierRelease();
+    memcpy(shared->magic, FEED_MAGIC, sizeof(shared->magic));
+
+    return SUCCESS;
+}
+
+void feed_destroy(feed_t *feed)
+{
+    if (!feed->shared) {
+        return;
+    }
+
+    munmap(feed->shared, sizeof(feed_shared_t));
+    close(feed->fd);
+    shm_unlink(feed->name);
+    feed->shared = NULL;
+}
+
+#else
+
+int feed_create(feed_t *feed, const char *name)
+{
+    (void)name;
+    memset(feed, 0, sizeof(feed_t));
+    return err_fatal(ERR_FEED, "shared memory isn't supported on this platform yet");
+}
+
+void feed_destroy(feed_t *feed)
+{
+    (void)feed;
+}
+
+#endif
+
+// Writes the frame straight into its slot. NOTE: never blocks, a reader in the middle of copying the slot just finds
+// out it has to give up on it.
+void feed_publish(feed_t *feed, const game_state_t *game)
+{
+    feed_slot_t *slot = &feed->shared->slots[feed->published % FEED_SLOTS];
+    int seq = SDL_AtomicGet(&slot->seq);
+
+    // Odd while the frame is half written
+    SDL_AtomicSet(&slot->seq, seq + 1);
+    SDL_MemoryBarrierRelease();
+
+    write_frame(feed, &slot->frame, game);
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&slot->seq, seq + 2);
+
+    SDL_AtomicSet(&feed->shared->published, (int)++feed->published);
+}
+
+static void write_frame(feed_t *feed, feed_frame_t *frame, const game_state_t *game)
+{
+    frame->frame = feed->published;
+    frame->level = game->cur_level;
+    frame->is_running = game->is_running;
+    frame->num_players = game->num_players;
+
+    for (size_t i = 0; i < MAX_PLAYERS; i++) {
+        const player_t *player = &game->players[i];
+        feed_player_t *out = &frame->players[i];
+
+        out->px = player->px;
+        out->py = player->py;
+        out->camera_x = player->camera_x;
+        out->camera_y = player->camera_y;
+        out->lives = player->lives;
+        out->flags = (player->has_trophy ? FEED_HAS_TROPHY : 0) | (player->has_gun ? FEED_HAS_GUN : 0) |
+                     (player->using_jetpack ? FEED_USING_JETPACK : 0) | (player->dying ? FEED_DYING : 0) |
+                     (player->climb ? FEED_CLIMBING : 0);
+        out->score = player->score;
+        out->jetpack_fuel = sim_jetpack_fuel(game, player);
+        out->last_dir = player->last_dir;
+        out->bullet = player->bullet;
+    }
+
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        const enemy_t *enemy = &game->enemies[i];
+        frame->enemies[i].type = enemy->type;
+        frame->enemies[i].dying = enemy->type && enemy->dying;
+        frame->enemies[i].px = enemy->px;
+        frame->enemies[i].py = enemy->py;
+    }
+    frame->ebullet = game->ebullet;
+
+    write_tiles(feed, frame, game);
+}
+
+// Compares the level against the shared copy rather than going by pickup events, so items that come back when netplay
+// rolls back are caught too
+static void write_tiles(feed_t *feed, feed_frame_t *frame, const game_state_t *game)
+{
+    feed_shared_t *shared = feed->shared;
+    const uint8_t *tiles = game->level->tiles;
+
+    frame->new_level = shared->level != game->cur_level;
+    frame->all_tiles = frame->new_level;
+    frame->num_tiles = 0;
+
+    if (!frame->new_level && memcmp(shared->tiles, tiles, sizeof(shared->tiles)) == 0) {
+        return;
+    }
+
+    int seq = SDL_AtomicGet(&shared->tiles_seq);
+    SDL_AtomicSet(&shared->tiles_seq, seq + 1);
+    SDL_MemoryBarrierRelease();
+
+    if (frame->new_level) {
+        shared->level = game->cur_level;
+        memcpy(shared->tiles, tiles, sizeof(shared->tiles));
+    } else {
+        for (uint16_t i = 0; i < LEVEL_W * LEVEL_H; i++) {
+            if (shared->tiles[i] == tiles[i]) {
+                continue;
+            }
+
+            shared->tiles[i] = tiles[i];
+            if (frame->num_tiles < FEED_MAX_TILES) {
+                frame->tiles[frame->num_tiles] = i;
+                frame->tile_values[frame->num_tiles++] = tiles[i];
+            } else {
+                frame->all_tiles = true;
+            }
+        }
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&shared->tiles_seq, seq + 2);
+}
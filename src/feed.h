@@ -0,0 +1,107 @@
+#ifndef HH_FEED_H
+#define HH_FEED_H
+
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Every frame's render-relevant state, published into POSIX shared memory for spectators, overlays and analysis tools
+// in other processes. The game writes straight into a ring of slots and never waits on anyone. Each slot has a sequence
+// number that is odd while the slot is being written, so a reader copies a slot out and keeps it only if the number
+// was even and unchanged on both sides of the copy. See src/tools/feed_reader.h for the reading side.
+//
+// NOTE: the SDL atomics are plain lock-free integers, which is what lets them work between processes
+
+#define FEED_MAGIC "HHF1"
+#define FEED_VERSION 1
+#define FEED_DEFAULT_NAME "/hh-feed"
+// A reader more than this many frames behind loses the oldest ones. NOTE: must be a power of two.
+#define FEED_SLOTS 64
+// Tiles a frame can say changed, more than this and readers take the whole level again
+#define FEED_MAX_TILES 32
+
+// Player flags
+#define FEED_HAS_TROPHY (1 << 0)
+#define FEED_HAS_GUN (1 << 1)
+#define FEED_USING_JETPACK (1 << 2)
+#define FEED_DYING (1 << 3)
+#define FEED_CLIMBING (1 << 4)
+
+typedef struct {
+    int16_t px;
+    int16_t py;
+    uint8_t camera_x;
+    uint8_t camera_y;
+    uint8_t lives;
+    uint8_t flags;
+    uint32_t score;
+    uint8_t jetpack_fuel;
+    int8_t last_dir;
+    bullet_t bullet;
+} feed_player_t;
+
+typedef struct {
+    uint8_t type;
+    bool dying;
+    uint16_t px;
+    uint16_t py;
+} feed_enemy_t;
+
+typedef struct {
+    // Frames published before this one, slot number is frame % FEED_SLOTS
+    uint32_t frame;
+    uint8_t level;
+    bool is_running;
+    // The level changed since the last frame, its tiles are only in feed_shared_t
+    bool new_level;
+    uint8_t num_players;
+
+    feed_player_t players[MAX_PLAYERS];
+    feed_enemy_t enemies[NUM_ENEMIES];
+    bullet_t ebullet;
+
+    // Tiles that changed since the last frame, e.g. items picked up. Too many for the list and all_tiles is set instead.
+    bool all_tiles;
+    uint8_t num_tiles;
+    uint16_t tiles[FEED_MAX_TILES];
+    uint8_t tile_values[FEED_MAX_TILES];
+} feed_frame_t;
+
+typedef struct {
+    SDL_atomic_t seq;
+    feed_frame_t frame;
+} feed_slot_t;
+
+// The whole shared memory object
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t frame_size;
+    uint32_t num_slots;
+
+    // Frames published so far
+    SDL_atomic_t published;
+
+    // The current level's tiles as they are now, under their own sequence number, for readers joining part way through
+    SDL_atomic_t tiles_seq;
+    uint8_t level;
+    uint8_t tiles[LEVEL_W * LEVEL_H];
+
+    feed_slot_t slots[FEED_SLOTS];
+} feed_shared_t;
+
+// The game's end
+typedef struct {
+    int fd;
+    char name[64];
+    feed_shared_t *shared;
+    uint32_t published;
+} feed_t;
+
+int feed_create(feed_t *feed, const char *name);
+void feed_publish(feed_t *feed, const game_state_t *game);
+void feed_destroy(feed_t *feed);
+
+#endif // !HH_FEED_H
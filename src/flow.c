@@ -0,0 +1,131 @@
+#include "flow.h"
+#include "sim.h"
+#include <string.h>
+
+_Static_assert(FLOW_W == LEVEL_W && FLOW_H == LEVEL_H, "the flow field covers a level's tiles");
+_Static_assert(FLOW_CELLS < FLOW_FAR, "distances fit below FLOW_FAR");
+
+const int8_t FLOW_STEP_X[NUM_FLOW_STEPS] = {0, -1, 1, 0, 0};
+const int8_t FLOW_STEP_Y[NUM_FLOW_STEPS] = {0, 0, 0, -1, 1};
+
+static void search(flow_field_t *flow);
+
+void flow_init(flow_field_t *flow)
+{
+    memset(flow, 0, sizeof(*flow));
+    flow->stale = true;
+}
+
+void flow_update(flow_field_t *flow, const uint8_t *tiles, const uint16_t *targets, const uint8_t num_targets)
+{
+    uint8_t n = num_targets < FLOW_MAX_TARGETS ? num_targets : FLOW_MAX_TARGETS;
+
+    if (flow->tiles != tiles) {
+        for (uint16_t i = 0; i < FLOW_CELLS; i++) {
+            flow->open[i] = !sim_is_solid(tiles[i]);
+        }
+        flow->tiles = tiles;
+        flow->stale = true;
+    }
+
+    if (!flow->stale && n == flow->num_targets &&
+        memcmp(flow->targets, targets, n * sizeof(*targets)) == 0) {
+        return;
+    }
+
+    flow->num_targets = n;
+    memcpy(flow->targets, targets, n * sizeof(*targets));
+    search(flow);
+    flow->stale = false;
+}
+
+void flow_tile_changed(flow_field_t *flow, const uint8_t *tiles, const uint16_t cell)
+{
+    if (flow->tiles != tiles || cell >= FLOW_CELLS) {
+        return;
+    }
+
+    bool open = !sim_is_solid(tiles[cell]);
+    if (open != flow->open[cell]) {
+        flow->open[cell] = open;
+        flow->stale = true;
+    }
+}
+
+uint8_t flow_step(const flow_field_t *flow, const uint16_t cell)
+{
+    if (cell >= FLOW_CELLS) {
+        return FLOW_STAY;
+    }
+    if (flow->open[cell]) {
+        return flow->step[cell];
+    }
+
+    uint8_t best = FLOW_STAY;
+    uint16_t best_dist = FLOW_FAR;
+    int x = cell % FLOW_W;
+    int y = cell / FLOW_W;
+    for (uint8_t s = FLOW_LEFT; s < NUM_FLOW_STEPS; s++) {
+        int nx = x + FLOW_STEP_X[s];
+        int ny = y + FLOW_STEP_Y[s];
+        if (nx >= 0 && nx < FLOW_W && ny >= 0 && ny < FLOW_H && flow->dist[ny * FLOW_W + nx] < best_dist) {
+            best = s;
+            best_dist = flow->dist[ny * FLOW_W + nx];
+        }
+    }
+
+    return best;
+}
+
+void flow_invalidate(flow_field_t *flow)
+{
+    flow->tiles = NULL;
+    flow->stale = true;
+}
+
+// Breadth-first from every target at once. Each cell steps toward the neighbour it was first reached from, and
+// neighbours are always tried in the same order, so ties go the same way every time.
+static void search(flow_field_t *flow)
+{
+    uint16_t head = 0;
+    uint16_t tail = 0;
+
+    flow->searches++;
+
+    for (uint16_t i = 0; i < FLOW_CELLS; i++) {
+        flow->dist[i] = FLOW_FAR;
+    }
+    memset(flow->step, FLOW_STAY, sizeof(flow->step));
+
+    for (uint8_t t = 0; t < flow->num_targets; t++) {
+        uint16_t cell = flow->targets[t];
+        if (cell < FLOW_CELLS && flow->dist[cell] == FLOW_FAR) {
+            flow->dist[cell] = 0;
+            flow->queue[tail++] = cell;
+        }
+    }
+
+    while (head < tail) {
+        uint16_t cell = flow->queue[head++];
+        int x = cell % FLOW_W;
+        int y = cell / FLOW_W;
+
+        for (uint8_t s = FLOW_LEFT; s < NUM_FLOW_STEPS; s++) {
+            int nx = x + FLOW_STEP_X[s];
+            int ny = y + FLOW_STEP_Y[s];
+            if (nx < 0 || nx >= FLOW_W || ny < 0 || ny >= FLOW_H) {
+                continue;
+            }
+
+            uint16_t next = (uint16_t)(ny * FLOW_W + nx);
+            if (!flow->open[next] || flow->dist[next] != FLOW_FAR) {
+                continue;
+            }
+
+            flow->dist[next] = (uint16_t)(flow->dist[cell] + 1);
+            // NOTE: the neighbour moves the opposite way to get here, LEFT/RIGHT and UP/DOWN are pairs
+            flow->step[next] = (uint8_t)(s & 1 ? s + 1 : s - 1);
+            flow->queue[tail++] = next;
+        }
+    }
+}
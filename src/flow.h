@@ -0,0 +1,62 @@
+#ifndef HH_FLOW_H
+#define HH_FLOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The level's grid, LEVEL_W x LEVEL_H
+#define FLOW_W 100
+#define FLOW_H 10
+#define FLOW_CELLS (FLOW_W * FLOW_H)
+#define FLOW_FAR UINT16_MAX
+// One per player
+#define FLOW_MAX_TARGETS 2
+
+// Which way to move from a cell to get a step closer
+enum {
+    FLOW_STAY,
+    FLOW_LEFT,
+    FLOW_RIGHT,
+    FLOW_UP,
+    FLOW_DOWN,
+    NUM_FLOW_STEPS,
+};
+
+extern const int8_t FLOW_STEP_X[NUM_FLOW_STEPS];
+extern const int8_t FLOW_STEP_Y[NUM_FLOW_STEPS];
+
+// Distance from every cell of a level to the nearest of a few target cells, moving between cells that aren't solid,
+// and the step to take from each. Worked out by a breadth-first search only when the targets move to another cell or a
+// cell opens or closes, so reading it is a lookup however many enemies do.
+// NOTE: the field only depends on the tiles and the targets, never on when it was last worked out, so simulations
+// that rewind or share one stay deterministic.
+typedef struct {
+    // What the field was worked out for, NULL tiles when it has to be again
+    const uint8_t *tiles;
+    uint8_t num_targets;
+    uint16_t targets[FLOW_MAX_TARGETS];
+    bool stale;
+
+    // Whether each cell can be moved through, see flow_tile_changed()
+    bool open[FLOW_CELLS];
+    // FLOW_FAR and FLOW_STAY for cells with no way to a target
+    uint16_t dist[FLOW_CELLS];
+    uint8_t step[FLOW_CELLS];
+    uint16_t queue[FLOW_CELLS];
+
+    // Searches done, for seeing how rarely it happens
+    uint32_t searches;
+} flow_field_t;
+
+void flow_init(flow_field_t *flow);
+// Searches again if the tiles or the targets have changed since the last time, otherwise leaves the field as it is.
+// Targets are cells, y * FLOW_W + x.
+void flow_update(flow_field_t *flow, const uint8_t *tiles, const uint16_t *targets, const uint8_t num_targets);
+// Called after one of the tiles changed, only a change between solid and open means searching again
+void flow_tile_changed(flow_field_t *flow, const uint8_t *tiles, const uint16_t cell);
+// The way to move from a cell. A solid cell e.g. one an enemy spawned in steps out to its closest open neighbour.
+uint8_t flow_step(const flow_field_t *flow, const uint16_t cell);
+// Forgets the tiles, for when all of them might have changed e.g. the level was reloaded
+void flow_invalidate(flow_field_t *flow);
+
+#endif // !HH_FLOW_H
@@ -1,9 +1,24 @@
 #include "game.h"
+#include "arena.h"
+#include "assets.h"
+#include "audio.h"
 #include "common.h"
+#include "alloc.h"
 #include "error.h"
+#include "event.h"
+#include "hot_reload.h"
+#include "input.h"
 #include "log.h"
+#include "particles.h"
+#include "perf.h"
+#include "post.h"
+#include "replay.h"
+#include "rollback.h"
+#include "sim.h"
+#include "transport.h"
 #include "utils.h"
 #include <SDL_ttf.h>
+#include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -19,108 +34,340 @@
 // BUG:(lukefilewalker) collision doesn't always work very well e.g. player gets stuck on walls sometimes
 // BUG:(lukefilewalker) jetpack doesn't count down
 
+static arena_t arena;
 static game_state_t *game;
+// The player on this machine, whose view is rendered
+static player_t *local_player;
+// Quitting can't be left to game->is_running, netplay may roll it back
+static bool quit;
+static game_cold_t *cold;
+static event_buffer_t *events;
+static flow_field_t *flow;
 static game_assets_t *assets;
 static SDL_Window *window;
 static SDL_Renderer *renderer;
+// Drawn into instead of a window when checking golden frames
+static SDL_Surface *offscreen;
 static TTF_Font *font;
 static SDL_GameController *controller;
 
-// TODO:(lukefilewalker): make this better :( i.e. game debug funcs or encapsulate this or something
-#define MAX_DEBUG_MESSAGES 20
-static uint8_t num_debug_msgs;
-static char debug_msgs[MAX_DEBUG_MESSAGES][1000];
+// Input-to-present latency, measured from the oldest press consumed by a frame to the SDL_RenderPresent that first
+// shows it
+typedef struct {
+    float last_ms;
+    float min_ms;
+    float max_ms;
+    float avg_ms;
+    uint32_t samples;
+    // Carried over frames that are skipped rather than drawn
+    uint64_t pending_press;
+    // Over the last FPS drawn frames, logged together rather than a line per press
+    float window_total_ms;
+    float window_max_ms;
+    uint32_t window_samples;
+    uint32_t window_frames;
+} latency_stats_t;
+
+static latency_stats_t latency;
+static uint8_t latency_msg;
+
+// Everything a frame is drawn from that changes while playing, a frame is only drawn when it differs from the last
+typedef struct {
+    uint8_t view_x;
+    uint8_t cur_level;
+    // The tiles on screen as they're animated
+    uint8_t tiles[LEVEL_H][NATIVE_WIDTH / TILE_SIZE];
+    struct {
+        int16_t px;
+        int16_t py;
+        uint8_t tile;
+        bullet_t bullet;
+    } players[MAX_PLAYERS];
+    struct {
+        uint16_t px;
+        uint16_t py;
+        uint8_t tile;
+    } enemies[NUM_ENEMIES];
+    bullet_t ebullet;
+    // The local player's UI
+    uint32_t score;
+    uint8_t lives;
+    bool has_trophy;
+    bool has_gun;
+    uint8_t jetpack_fuel;
+    uint8_t fuel_left;
+} frame_key_t;
+
+// Nothing is simulated or drawn while paused, or while minimized unless the other player needs the game to go on
+static bool paused;
+static bool minimized;
+static bool unfocused;
+// Set when the frame changes in a way the frame key can't see e.g. the window was uncovered or a tile was reloaded
+static bool redraw;
+static frame_key_t frame_key;
+static uint32_t frames_since_drawn;
+static uint32_t frames_drawn;
+static uint32_t frames_skipped;
+static uint8_t frames_msg;
+static uint8_t alloc_msg;
+
+// Hardware counters summed over the frames since the overlay last showed them
+static perf_counts_t perf_window[NUM_PERF_PHASES];
+static uint32_t perf_window_frames;
+static uint8_t perf_msg;
+static uint8_t post_msg;
+static uint8_t ghosts_msg;
+static uint8_t editor_msg;
+
+// The debug overlay is only rebuilt when one of its messages changes
+static SDL_Texture *debug_texture;
+static SDL_Rect debug_rect;
+
+// Everything but the debug overlay is drawn at NATIVE_WIDTH x NATIVE_HEIGHT into this, then copied once into
+// frame_rect, which is worked out again whenever the window changes size
+static SDL_Texture *frame_texture;
+static SDL_Rect frame_rect;
+// The first column of the level on screen, the player's camera or the editor's
+static uint8_t view_x;
 
 static int init_assets(void);
-
-static bool is_player_tile(uint8_t);
-static bool is_enemy_tile(uint8_t);
-static void check_collisions(void);
-static void process_controller_input(void);
-static void process_keyboard_input(void);
-static void update(float);
-static void scroll_screen(void);
-static void update_level(void);
-static void start_level(void);
-static void restart_level(void);
-static void update_pbullet(void);
-static void update_ebullet(void);
-static void verify_input(void);
-static void move_player(float dt);
-static void move_enemies(float dt);
-static void pickup_item(uint8_t, uint8_t);
-static void add_score(uint16_t new_score);
-static void clear_input(void);
+static void apply_reloads(void);
+
+static int init_display(const game_options_t *options);
+static int init_frame(const game_options_t *options);
+static int fit_frame(void);
+static void toggle_fullscreen(void);
+
+static void process_events(void);
+static void handle_event(const SDL_Event *event);
+static void open_controller(const int device_index);
+static void close_controller(const SDL_JoystickID instance_id);
+static void wait_next_frame(const uint32_t deadline);
+static bool idle(void);
+static void wait_idle(void);
+static void toggle_pause(void);
+static bool frame_due(void);
+static void build_frame_key(frame_key_t *key);
+static void drain_events(void);
+static void count_events(void);
+static void report_latency(void);
+static void report_allocs(void);
+static void report_perf(void);
+static void report_post(void);
+static void report_ghosts(void);
+static void report_editor(void);
+static void report_frames(void);
+static void handle_editor_event(const SDL_Event *event);
+static bool window_to_level(const int x, const int y, int *tile_x, int *tile_y);
+static int run_headless(void);
+static int render_audio(const uint32_t tick);
 static uint8_t update_frame(uint8_t, uint8_t);
 
 static void render(void);
 static void render_world(void);
-static void render_player(void);
+static void render_player(const player_t *player);
 static void render_enemies(void);
 // TODO:(lukefilewalker) combine these into render funcs?
-static void render_player_bullet(void);
+static void render_player_bullet(const player_t *player);
 static void render_enemies_bullet(void);
 static void render_ui(void);
 static void render_debug_ui(void);
+static void build_debug_texture(void);
 
-static uint8_t is_clear(uint16_t px, uint16_t py, uint8_t is_player);
-static uint8_t is_visible(uint16_t px);
 static void add_debug_msg(char *format, char *msg);
+static void set_debug_msg(const uint8_t index, const char *format, ...);
 
-int game_init(const bool debug)
+int game_init(const game_options_t *options)
 {
     LOG_INFO("game_init", "initialising game");
 
+    LOG_INFO("game_init", "allocating memory for game state");
+
+    bool use_replay = options->record_fname || options->replay_fname;
+    size_t arena_size = ARENA_SIZEOF(game_state_t) + ARENA_SIZEOF(event_buffer_t) + ARENA_SIZEOF(flow_field_t) +
+                        ARENA_SIZEOF(game_cold_t);
+    if (!options->headless) {
+        arena_size += ARENA_SIZEOF(game_assets_t) + 2 * ARENA_SIZEOF(event_queue_t) + ARENA_SIZEOF(particles_t);
+    }
+    if (!options->headless && !use_replay && !options->net_address) {
+        arena_size += ARENA_SIZEOF(editor_t);
+    }
+    if (use_replay) {
+        arena_size += ARENA_SIZEOF(replay_t);
+    }
+    if (options->net_address) {
+        if (use_replay || options->headless) {
+            return err_fatal(ERR_NET, "netplay can't be recorded or replayed");
+        }
+        if (options->net_player < 1 || options->net_player > MAX_PLAYERS) {
+            return err_fatal(ERR_NET, "--player is 1 or 2");
+        }
+        arena_size += ARENA_SIZEOF(transport_t) + ARENA_SIZEOF(rollback_t);
+    }
+    if (options->feed_name) {
+        arena_size += ARENA_SIZEOF(feed_t);
+    }
+    if (options->hot_reload) {
+        if (use_replay || options->headless || options->net_address) {
+            return err_fatal(ERR_HOT_RELOAD, "replays and netplay need the files as they were");
+        }
+        arena_size += ARENA_SIZEOF(hot_reload_t);
+    }
+    if (options->ghosts_dir) {
+        if (options->headless) {
+            return err_fatal(ERR_REPLAY, "ghosts need a window to be raced in");
+        }
+        arena_size += ARENA_SIZEOF(ghosts_t);
+    }
+    if (options->golden_dir) {
+        if (!options->replay_fname || options->headless) {
+            return err_fatal(ERR_REPLAY, "golden frames are drawn from a replay, and not headless");
+        }
+        arena_size += ARENA_SIZEOF(golden_t);
+    }
+    if (options->audio_fname && !options->headless) {
+        return err_fatal(ERR_REPLAY, "--audio-out renders a headless run");
+    }
+    if (!options->headless || options->audio_fname) {
+        arena_size += ARENA_SIZEOF(audio_t);
+    }
+
+    // All runtime allocations come from here
+    int err = arena_init(&arena, arena_size);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    game = arena_alloc(&arena, sizeof(game_state_t), "game state");
+    events = arena_alloc(&arena, sizeof(event_buffer_t), "tick events");
+    flow = arena_alloc(&arena, sizeof(flow_field_t), "flow field");
+    cold = arena_alloc(&arena, sizeof(game_cold_t), "levels & debug");
+    if (!game || !events || !flow || !cold) {
+        return err_fatal(ERR_ALLOC, "game state");
+    }
+
     char *version = "0.1.0";
     add_debug_msg("version: %s", version);
 
-    LOG_INFO("game_init", "allocating memory for game state");
+    cold->debug = options->debug;
+    cold->headless = options->headless;
+    cold->assert_no_alloc = options->assert_no_alloc;
+    cold->background_fps = options->background_fps < FPS ? options->background_fps : FPS;
+    cold->record_fname = options->record_fname;
+    cold->perf = options->perf;
+    cold->perf_fname = options->perf_fname;
 
-    game = malloc(sizeof(game_state_t));
-    if (!game) {
-        return err_fatal(ERR_ALLOC, "game state");
+    err = sim_load_levels(cold->level);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    err = mask_load_sprites(cold->masks);
+    if (err != SUCCESS) {
+        return err;
     }
 
     // Init game state
-    memset(game, 0, sizeof(game_state_t));
-    game->debug = debug;
-    game->ticks_last_frame = SDL_GetTicks();
-    game->cur_level = LEVEL_1;
+    sim_init(game, cold->level, cold->masks, flow, events);
+    local_player = &game->players[0];
 
-    // Init player
-    game->player.on_ground = 1;
-    game->player.lives = NUM_START_LIVES;
+    if (options->ghosts_dir) {
+        cold->ghosts = arena_alloc(&arena, sizeof(ghosts_t), "ghosts");
+        if (!cold->ghosts) {
+            return err_fatal(ERR_ALLOC, "ghosts");
+        }
+
+        err = ghosts_load(cold->ghosts, options->ghosts_dir, cold->level, cold->masks);
+        if (err != SUCCESS) {
+            return err;
+        }
+    }
+
+    // NOTE: after the ghosts are loaded, as the counters only follow this thread and the ghosts are simulated on others
+    if (cold->perf) {
+        // NOTE: without counters the game carries on, reporting why they're unavailable instead
+        perf_open();
+    }
+
+    if (use_replay) {
+        cold->replay = arena_alloc(&arena, sizeof(replay_t), "replay");
+        if (!cold->replay) {
+            return err_fatal(ERR_ALLOC, "replay");
+        }
+
+        if (options->replay_fname) {
+            err = replay_load(cold->replay, options->replay_fname);
+            if (err != SUCCESS) {
+                return err;
+            }
+            game->cur_level = cold->replay->start_level;
+        }
+    }
+
+    if (options->golden_dir) {
+        cold->golden = arena_alloc(&arena, sizeof(golden_t), "golden frames");
+        if (!cold->golden) {
+            return err_fatal(ERR_ALLOC, "golden frames");
+        }
+
+        err = golden_open(cold->golden, options->golden_dir, options->golden_update, NATIVE_WIDTH, NATIVE_HEIGHT);
+        if (err != SUCCESS) {
+            return err;
+        }
 
-    LOG_INFO("game_init", "loading levels");
+        // NOTE: no window or sound device, only the frames are wanted and as fast as they can be drawn
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
 
-    FILE *fd_level;
-    char fname[DATA_FNAME_SIZE];
-    char file_num[4];
-    char *basename = "res/data/level";
+    if (options->feed_name) {
+        cold->feed = arena_alloc(&arena, sizeof(feed_t), "feed");
+        if (!cold->feed) {
+            return err_fatal(ERR_ALLOC, "feed");
+        }
 
-    for (int i = 0; i < NUM_LEVELS; i++) {
-        fname[0] = '\0';
-        strncat(fname, basename, strlen(basename));
-        sprintf(&file_num[0], "%u", i);
-        strncat(fname, file_num, strlen(file_num));
-        strncat(fname, ".dat", strlen(".dat") + 1);
+        err = feed_create(cold->feed, options->feed_name);
+        if (err != SUCCESS) {
+            return err;
+        }
+    }
 
-        fd_level = fopen(fname, "rb");
-        if (!fd_level) {
-            return err_fatal(ERR_OPENING_FILE, fname);
+    if (!options->headless || options->audio_fname) {
+        cold->audio = arena_alloc(&arena, sizeof(audio_t), "sound");
+        if (!cold->audio) {
+            return err_fatal(ERR_ALLOC, "sound");
         }
 
-        for (size_t j = 0; j < sizeof(game->level[i].path); j++) {
-            game->level[i].path[j] = fgetc(fd_level);
+        err = audio_init(cold->audio);
+        if (err != SUCCESS) {
+            return err;
         }
-        for (size_t j = 0; j < sizeof(game->level[i].tiles); j++) {
-            game->level[i].tiles[j] = fgetc(fd_level);
+        err = event_subscribe(&cold->event_bus, &cold->audio->queue);
+        if (err != SUCCESS) {
+            return err;
         }
-        for (size_t j = 0; j < sizeof(game->level[i].padding); j++) {
-            game->level[i].padding[j] = fgetc(fd_level);
+    }
+
+    if (cold->headless) {
+        if (!options->replay_fname) {
+            return err_fatal(ERR_REPLAY, "headless runs need a replay");
         }
 
-        fclose(fd_level);
+        if (options->audio_fname) {
+            cold->audio_out = fopen(options->audio_fname, "wb");
+            if (!cold->audio_out) {
+                return err_fatal(ERR_OPENING_FILE, options->audio_fname);
+            }
+            // Filled in with the length at the end
+            err = audio_write_wav_header(cold->audio_out, 0);
+            if (err != SUCCESS) {
+                return err;
+            }
+        }
+
+        arena_report(&arena);
+
+        return SUCCESS;
     }
 
     LOG_INFO("game_init", "initialising SDL");
@@ -133,12 +380,11 @@ int game_init(const bool debug)
         return err_fatal(ERR_SDL_TTF, SDL_GetError());
     }
 
-    if (SDL_CreateWindowAndRenderer(320 * DISPLAY_SCALE, 200 * DISPLAY_SCALE, 0, &window, &renderer) != 0) {
-        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    err = init_display(options);
+    if (err != SUCCESS) {
+        return err;
     }
 
-    SDL_RenderSetScale(renderer, DISPLAY_SCALE, DISPLAY_SCALE);
-
     font = TTF_OpenFont("./res/fonts/Roboto-Medium.ttf", 16);
     if (!font) {
         return err_fatal(ERR_SDL_TTF_LOAD_FONT, SDL_GetError());
@@ -146,33 +392,117 @@ int game_init(const bool debug)
 
     LOG_INFO("game_init", "allocating memory for assets");
 
-    assets = malloc(sizeof(game_assets_t));
+    assets = arena_alloc(&arena, sizeof(game_assets_t), "assets");
     if (!assets) {
         return err_fatal(ERR_ALLOC, "game assets");
     }
-    int err = init_assets();
+    err = init_assets();
     if (err != SUCCESS) {
         return err_fatal(err, NULL);
     }
 
-    uint8_t num_joysticks = SDL_NumJoysticks();
-    LOG_INFO("game_init", "Number of joysticks: %d", num_joysticks);
+    err = input_init();
+    if (err != SUCCESS) {
+        return err_fatal(err, NULL);
+    }
 
-    if (num_joysticks > 0) {
-        // NOTE: we only handle one controller
-        if (SDL_IsGameController(0)) {
-            controller = SDL_GameControllerOpen(0);
-            if (controller) {
-                LOG_INFO("game_init", "Opened game controller: %s", SDL_GameControllerName(controller));
-            } else {
-                LOG_INFO("game_init", "Could not open game controller 0: %s", SDL_GetError());
-            }
-        } else {
-            LOG_INFO("game_init", "Joystick is not a game controller.");
+    err = audio_open(cold->audio);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    if (options->hot_reload) {
+        cold->hot_reload = arena_alloc(&arena, sizeof(hot_reload_t), "hot reload");
+        if (!cold->hot_reload) {
+            return err_fatal(ERR_ALLOC, "hot reload");
+        }
+
+        err = hot_reload_start(cold->hot_reload);
+        if (err != SUCCESS) {
+            return err;
+        }
+    }
+
+    cold->log_queue = arena_alloc(&arena, sizeof(event_queue_t), "log events");
+    cold->stats_queue = arena_alloc(&arena, sizeof(event_queue_t), "stats events");
+    if (!cold->log_queue || !cold->stats_queue) {
+        return err_fatal(ERR_ALLOC, "event queues");
+    }
+    err = event_subscribe(&cold->event_bus, cold->log_queue);
+    if (err != SUCCESS) {
+        return err;
+    }
+    err = event_subscribe(&cold->event_bus, cold->stats_queue);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    cold->particles = arena_alloc(&arena, sizeof(particles_t), "particles");
+    if (!cold->particles) {
+        return err_fatal(ERR_ALLOC, "particles");
+    }
+    particles_init(cold->particles);
+    err = event_subscribe(&cold->event_bus, &cold->particles->queue);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    if (!cold->replay && !options->net_address) {
+        cold->editor = arena_alloc(&arena, sizeof(editor_t), "editor");
+        if (!cold->editor) {
+            return err_fatal(ERR_ALLOC, "editor");
         }
+        editor_init(cold->editor, cold->level);
     }
 
-    game->is_running = true;
+    // NOTE: controllers already plugged in at start-up arrive as SDL_CONTROLLERDEVICEADDED events too
+    LOG_INFO("game_init", "Number of joysticks: %d", SDL_NumJoysticks());
+
+    if (options->net_address) {
+        cold->transport = arena_alloc(&arena, sizeof(transport_t), "transport");
+        cold->rollback = arena_alloc(&arena, sizeof(rollback_t), "rollback");
+        if (!cold->transport || !cold->rollback) {
+            return err_fatal(ERR_ALLOC, "netplay");
+        }
+
+        err = transport_open(cold->transport, options->net_address);
+        if (err != SUCCESS) {
+            return err;
+        }
+
+        game->num_players = MAX_PLAYERS;
+        cold->local_player = options->net_player - 1;
+        local_player = &game->players[cold->local_player];
+    }
+
+    LOG_INFO("game_init", "hot game state: %zu bytes, player: %zu bytes, cold game state: %zu bytes",
+             sizeof(game_state_t), sizeof(player_t), sizeof(game_cold_t));
+    arena_report(&arena);
+
+    latency_msg = cold->num_debug_msgs;
+    add_debug_msg("input to present: %s", "-");
+    alloc_msg = cold->num_debug_msgs;
+    add_debug_msg("allocations: %s", "-");
+    frames_msg = cold->num_debug_msgs;
+    add_debug_msg("frames: %s", "-");
+    if (cold->perf) {
+        perf_msg = cold->num_debug_msgs;
+        for (uint8_t i = 0; i < NUM_PERF_PHASES; i++) {
+            add_debug_msg("perf: %s", perf_stats()->unavailable ? "unavailable" : "-");
+        }
+    }
+    if (post_enabled()) {
+        post_msg = cold->num_debug_msgs;
+        add_debug_msg("post-processing: %s", "-");
+    }
+    if (cold->ghosts) {
+        ghosts_msg = cold->num_debug_msgs;
+        add_debug_msg("ghosts: %s", "-");
+    }
+    if (cold->editor) {
+        editor_msg = cold->num_debug_msgs;
+        add_debug_msg("editor: %s", "F2");
+    }
 
     return SUCCESS;
 }
@@ -181,42 +511,124 @@ int game_run(void)
 {
     LOG_INFO("game_run", "running game");
 
-    uint32_t timer_start = 0, timer_end = 0, delay = 0;
+    if (cold->headless) {
+        return run_headless();
+    }
+
+    uint32_t timer_start = 0, timer_end = 0, deadline = 0;
+    uint32_t replay_tick = 0;
+    uint32_t frame = 0;
+    input_sample_t input;
 
-    start_level();
+    sim_start_level(game);
+    if (cold->record_fname) {
+        replay_start(cold->replay, game);
+    }
+    if (cold->rollback) {
+        rollback_init(cold->rollback, game, cold->transport, cold->local_player, SDL_GetTicks());
+        LOG_INFO("game_run", "waiting for the other player");
+    }
+    event_publish(&cold->event_bus, events, frame++);
+
+    // NOTE: netplay keeps going after the game ends until it knows the other player saw it end too
+    while (!quit && (game->is_running || (cold->rollback && !rollback_settled(cold->rollback)))) {
+        if (idle()) {
+            wait_idle();
+            continue;
+        }
 
-    while (game->is_running) {
         timer_start = SDL_GetTicks();
+        deadline = timer_start + (uint32_t)FRAME_TIME_LEN;
+        perf_begin(PERF_FRAME);
 
-        process_controller_input();
-        process_keyboard_input();
-
-        // uint32_t current_ticks = SDL_GetTicks();
-        // int time_to_wait = FRAME_TIME_LEN - (current_ticks - game->ticks_last_frame);
-        //
-        // if (time_to_wait > 0 && time_to_wait <= FRAME_TIME_LEN) {
-        //     SDL_Delay(time_to_wait);
-        // }
-        //
-        // float dt = (current_ticks - game->ticks_last_frame) / 1000.0f;
-        // game->ticks_last_frame = current_ticks;
-
-        check_collisions();
-        pickup_item(game->player.check_pickup_x, game->player.check_pickup_y);
-        update(1);
-        render();
+        if (cold->hot_reload) {
+            apply_reloads();
+        }
+        process_events();
+        // Latch input as late as possible i.e. right before the simulation step
+        input = input_sample();
+        // NOTE: the game carries on while editing, with Harry left standing as the keys are the editor's
+        if (cold->editor && cold->editor->active) {
+            input.buttons = 0;
+        }
+
+        // Replays drive the game instead of the player
+        if (cold->replay && !cold->record_fname) {
+            if (replay_tick == cold->replay->num_ticks) {
+                break;
+            }
+            input.buttons = cold->replay->inputs[replay_tick++];
+            input.oldest_press = 0;
+        }
+        if (cold->record_fname) {
+            replay_record(cold->replay, input.buttons);
+        }
+
+        if (cold->rollback) {
+            int err = rollback_advance(cold->rollback, input.buttons, SDL_GetTicks());
+            // The other player has nothing left to send once they've seen the end of the game too
+            if (err == ERR_NET_TIMEOUT && !game->is_running) {
+                break;
+            }
+            if (err != SUCCESS) {
+                return err;
+            }
+            // NOTE: events from ticks that get simulated again aren't published a second time
+            if (cold->rollback->advanced) {
+                event_publish(&cold->event_bus, events, frame++);
+            }
+        } else {
+            sim_tick(game, &input.buttons);
+            event_publish(&cold->event_bus, events, frame++);
+        }
+        if (cold->feed) {
+            feed_publish(cold->feed, game);
+        }
+        particles_update(cold->particles, game);
+        if (cold->ghosts) {
+            ghosts_update(cold->ghosts, game);
+        }
+        // NOTE: a press consumed on a skipped frame is first shown by the next one drawn, so it's timed to that
+        if (!latency.pending_press) {
+            latency.pending_press = input.oldest_press;
+        }
+        if (frame_due()) {
+            render();
+            report_latency();
+        }
+        report_allocs();
+        perf_end(PERF_FRAME);
+        report_perf();
+        report_post();
+        report_ghosts();
+        report_editor();
+        report_frames();
 
         timer_end = SDL_GetTicks();
+        cold->delay = (int32_t)(deadline - timer_end) > 0 ? deadline - timer_end : 0;
+
+        drain_events();
+        // Golden frames are checked as fast as they can be drawn
+        if (!cold->golden) {
+            wait_next_frame(deadline);
+        } else {
+            int err = golden_check(cold->golden, renderer, NULL, replay_tick);
+            if (err != SUCCESS) {
+                return err;
+            }
+        }
+    }
 
-        delay = FPS - (timer_end - timer_start);
-        delay = delay > 33 ? 0 : delay;
-        game->delay = delay;
+    // Pick up whatever the last frame emitted e.g. winning the game
+    drain_events();
 
-        // char fps_msg[256];
-        // sprintf(fps_msg, "timer_start: %d - timer_end: %d", timer_start, timer_end);
-        // log_info("game_run", fps_msg);
+    if (cold->golden) {
+        return golden_close(cold->golden);
+    }
 
-        SDL_Delay(delay);
+    if (cold->record_fname) {
+        replay_finish(cold->replay, game);
+        return replay_save(cold->replay, cold->record_fname);
     }
 
     return SUCCESS;
@@ -226,797 +638,833 @@ int game_destroy(void)
 {
     LOG_INFO("game_destroy", "cleaning up");
 
+    if (cold->feed) {
+        feed_destroy(cold->feed);
+    }
+    if (cold->audio) {
+        audio_close(cold->audio);
+        if (cold->debug) {
+            audio_report(cold->audio);
+        }
+    }
+
+    if (cold->perf) {
+        if (!cold->headless) {
+            perf_report();
+        }
+        int err = cold->perf_fname ? perf_write_json(cold->perf_fname) : SUCCESS;
+        perf_close();
+        if (err != SUCCESS) {
+            return err;
+        }
+    }
+
+    if (cold->headless) {
+        arena_destroy(&arena);
+        return SUCCESS;
+    }
+
+    if (cold->debug) {
+        event_stats_report(&cold->event_stats);
+    }
+
+    if (cold->rollback) {
+        rollback_report(cold->rollback);
+        transport_close(cold->transport);
+    }
+
+    if (latency.samples) {
+        LOG_INFO("game_destroy", "input to present: min %.2f ms, avg %.2f ms, max %.2f ms over %u presses",
+                 latency.min_ms, latency.avg_ms, latency.max_ms, latency.samples);
+    }
+
+    if (cold->hot_reload) {
+        hot_reload_stop(cold->hot_reload);
+    }
+    input_destroy();
     if (controller) {
         SDL_GameControllerClose(controller);
     }
-    free(assets);
+    post_destroy();
+    if (cold->ghosts) {
+        ghosts_destroy(cold->ghosts);
+    }
+    HH_DESTROY_TEXTURE(debug_texture);
+    HH_DESTROY_TEXTURE(frame_texture);
+    for (size_t i = 0; i < NUM_TILES; i++) {
+        HH_DESTROY_TEXTURE(assets->gfx_tiles[i]);
+    }
+    if (cold->debug) {
+        alloc_report();
+    }
     SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    HH_FREE_SURFACE(offscreen);
     SDL_Quit();
-    free(game);
+    arena_destroy(&arena);
 
     return SUCCESS;
 }
 
-static int init_assets(void)
+// Re-simulates a replay as fast as possible with no window and reports how it went
+static int run_headless(void)
 {
-    LOG_INFO("init_assets", "entered");
+    const replay_t *replay = cold->replay;
+    uint8_t level = game->cur_level;
+    uint32_t level_tick = 0;
+    uint32_t tick = 0;
+
+    sim_start_level(game);
+    count_events();
+    int err = render_audio(tick);
+    if (err != SUCCESS) {
+        return err;
+    }
 
-    char *basename = "res/assets/tile";
-    char fname[ASSET_FNAME_SIZE] = {0};
-    char file_num[4] = {0};
-    char mname[ASSET_FNAME_SIZE] = {0};
-    char mask_num[4] = {0};
-    SDL_Surface *surface = NULL;
-    SDL_Surface *mask_surface = NULL;
-    uint8_t mask_offset = 0;
-    uint8_t *player_pixels = 0;
-    uint8_t *mask_pixels = 0;
+    uint64_t start = SDL_GetPerformanceCounter();
 
-    for (size_t i = 0; i < NUM_TILES; i++) {
-        fname[0] = '\0';
-        strncat(fname, basename, strlen(basename));
-        sprintf(&file_num[0], "%u", (uint8_t)i);
-        strncat(fname, file_num, strlen(file_num));
-        strncat(fname, ".bmp", strlen(".bmp") + 1);
-
-        // Load player tiles
-        if (is_player_tile(i)) {
-            // Apply mask to walking tiles
-            if (in_array(TILES_PLAYER_WALKING, 53, NUM_TILES_PLAYER_WALKING)) {
-                mask_offset = TILES_PLAYER_WALKING_MASK_OFFSET;
-            }
-
-            // Apply mask to climbing tiles
-            if (in_array(TILES_PLAYER_CLIMBING, i, NUM_TILES_PLAYER_CLIMBING)) {
-                mask_offset = TILES_PLAYER_CLIMBING_MASK_OFFSET;
-            }
+    for (; tick < replay->num_ticks && game->is_running; tick++) {
+        // Only the first frame of a level is allowed to allocate
+        alloc_expect_none(cold->assert_no_alloc && level_tick > 0);
 
-            // Apply mask to jumping left and right
-            if (i == TILE_PLAYER_JUMP_LEFT || i == TILE_PLAYER_JUMP_RIGHT) {
-                mask_offset = TILE_PLAYER_JUMP_MASK_OFFSET;
-            }
+        perf_begin(PERF_FRAME);
+        sim_tick(game, &replay->inputs[tick]);
+        count_events();
+        if (cold->feed) {
+            feed_publish(cold->feed, game);
+        }
+        err = render_audio(tick + 1);
+        if (err != SUCCESS) {
+            return err;
+        }
+        perf_end(PERF_FRAME);
+        perf_frame_end();
+        alloc_frame_end();
 
-            // Apply mask to jetpack tiles
-            if (in_array(TILES_PLAYER_JETPACK, i, NUM_TILES_PLAYER_JETPACK)) {
-                mask_offset = TILES_PLAYER_JETPACK_MASK_OFFSET;
-            }
+        if (game->cur_level != level) {
+            level = game->cur_level;
+            level_tick = 0;
+        } else {
+            level_tick++;
+        }
+    }
 
-            surface = SDL_LoadBMP(fname);
-            if (!surface) {
-                return err_fatal(ERR_SDL_LOADING_BMP, fname);
-            }
-            player_pixels = (uint8_t *)surface->pixels;
+    uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+    double seconds = (double)elapsed / (double)SDL_GetPerformanceFrequency();
+    bool matches = replay_matches(replay, game);
 
-            mname[0] = '\0';
-            strncat(mname, basename, strlen(basename));
-            sprintf(&mask_num[0], "%u", (uint8_t)i + mask_offset);
-            strncat(mname, mask_num, strlen(mask_num));
-            strncat(mname, ".bmp", strlen(".bmp") + 1);
+    printf("ticks: %u of %u in %.3f ms (%.0f ticks/s)\n", tick, replay->num_ticks, seconds * 1000.0,
+           seconds > 0 ? tick / seconds : 0);
+    printf("result: level %u, lives %u, score %u (recorded: level %u, lives %u, score %u) - %s\n",
+           game->cur_level + 1, game->players[0].lives, game->players[0].score, replay->final_level + 1,
+           replay->final_lives, replay->final_score, matches ? "match" : "MISMATCH");
+    event_stats_report(&cold->event_stats);
+    alloc_report();
+    if (cold->perf) {
+        perf_report();
+    }
 
-            mask_surface = SDL_LoadBMP(mname);
-            if (!mask_surface) {
-                return err_fatal(ERR_SDL_LOADING_BMP, mname);
-            }
-            mask_pixels = (uint8_t *)mask_surface->pixels;
-
-            // Go through tile and make pixels white where they aren't black
-            // ---pitch---
-            // ··········· |
-            // ··········· h
-            // ··········· |
-            for (size_t j = 0; j < (uint64_t)mask_surface->pitch * mask_surface->h; j++) {
-                player_pixels[j] = mask_pixels[j] ? 0xff : player_pixels[j];
-            }
-            SDL_SetColorKey(surface, 1, SDL_MapRGB(surface->format, 0xff, 0xff, 0xff));
-            assets->gfx_tiles[i] = SDL_CreateTextureFromSurface(renderer, surface);
+    if (cold->audio_out) {
+        err = audio_write_wav_header(cold->audio_out, cold->audio_samples);
+        fclose(cold->audio_out);
+        cold->audio_out = NULL;
+        if (err != SUCCESS) {
+            return err;
+        }
+        printf("sound: %.1f s mixed\n", (double)cold->audio_samples / AUDIO_RATE);
+    }
 
-            SDL_FreeSurface(surface);
-            SDL_FreeSurface(mask_surface);
+    if (alloc_stats()->violations) {
+        return err_fatal(ERR_STEADY_STATE_ALLOC, alloc_stats()->first_violation->file);
+    }
+    if (!matches) {
+        return err_fatal(ERR_REPLAY_MISMATCH, NULL);
+    }
 
-            continue;
-        }
+    return SUCCESS;
+}
 
-        // Load all the other tiles
-        surface = SDL_LoadBMP(fname);
-        if (!surface) {
-            return err_fatal(ERR_SDL_LOADING_BMP, fname);
-        }
+// Headless runs have no audio thread, so each tick's worth of sound is mixed straight after the tick instead
+static int render_audio(const uint32_t tick)
+{
+    static int16_t samples[AUDIO_RATE / FPS];
 
-        // Colour key enemy and death tiles
-        if (is_enemy_tile(i) || in_array(TILES_DEATH, i, NUM_TILES_DEATH)) {
-            SDL_SetColorKey(surface, 1, SDL_MapRGB(surface->format, 0x00, 0x00, 0x00));
-        }
+    if (!cold->audio_out) {
+        return SUCCESS;
+    }
 
-        assets->gfx_tiles[i] = SDL_CreateTextureFromSurface(renderer, surface);
+    event_publish(&cold->event_bus, events, tick);
+    audio_mix(cold->audio, samples, AUDIO_RATE / FPS);
 
-        SDL_FreeSurface(surface);
+    if (fwrite(samples, sizeof(int16_t), AUDIO_RATE / FPS, cold->audio_out) != AUDIO_RATE / FPS) {
+        return err_fatal(ERR_OPENING_FILE, "WAV samples");
     }
+    cold->audio_samples += AUDIO_RATE / FPS;
 
     return SUCCESS;
 }
 
-static bool is_player_tile(uint8_t tile)
+static int init_assets(void)
 {
-    return in_array(TILES_PLAYER_WALKING, tile, NUM_TILES_PLAYER_WALKING) || tile == TILE_PLAYER_JUMP_LEFT ||
-           tile == TILE_PLAYER_JUMP_RIGHT || in_array(TILES_PLAYER_CLIMBING, tile, NUM_TILES_PLAYER_CLIMBING) ||
-           in_array(TILES_PLAYER_JETPACK, tile, NUM_TILES_PLAYER_JETPACK);
-}
+    LOG_INFO("init_assets", "entered");
 
-static bool is_enemy_tile(uint8_t tile)
-{
-    return in_array(TILES_ENEMY_LEVEL_TWO, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_THREE, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_FOUR, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_FIVE, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_SIX, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_SEVEN, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_EIGHT, tile, NUM_TILES_ENEMIES) ||
-           in_array(TILES_ENEMY_LEVEL_NINE, tile, NUM_TILES_ENEMIES);
-}
+    SDL_Surface *surface = NULL;
 
-// TODO:(lukefilewalker): change to is_colliding
-// TODO:(lukefilewalker) refactor this puppy still
-static void check_collisions(void)
-{
-    game->player.collision_point[0] = is_clear(game->player.px + 4, game->player.py - 1, 1);
-    game->player.collision_point[1] = is_clear(game->player.px + 10, game->player.py - 1, 1);
-    game->player.collision_point[2] = is_clear(game->player.px + 11, game->player.py + 4, 1);
-    game->player.collision_point[3] = is_clear(game->player.px + 11, game->player.py + 12, 1);
-    game->player.collision_point[4] = is_clear(game->player.px + 10, game->player.py + 16, 1);
-    game->player.collision_point[5] = is_clear(game->player.px + 4, game->player.py + 16, 1);
-    game->player.collision_point[6] = is_clear(game->player.px + 3, game->player.py + 12, 1);
-    game->player.collision_point[7] = is_clear(game->player.px + 3, game->player.py + 4, 1);
-    game->player.on_ground =
-        ((!game->player.collision_point[4] && !game->player.collision_point[5]) || game->player.climb);
-
-    uint8_t grid_x = (game->player.px + 6) / TILE_SIZE;
-    uint8_t grid_y = (game->player.py + 8) / TILE_SIZE;
-    uint8_t type;
-
-    if (grid_x < 100 && grid_y < 10) {
-        type = game->level[game->cur_level].tiles[grid_y * 100 + grid_x];
-    } else {
-        type = 0;
-    }
+    for (size_t i = 0; i < NUM_TILES; i++) {
+        int err = assets_decode_tile((uint8_t)i, &surface);
+        if (err != SUCCESS) {
+            return err;
+        }
 
-    if ((type >= TILE_TREE_1 && type <= TILE_TREE_3) || type == TILE_STAR) {
-        game->player.can_climb = 1;
-    } else {
-        game->player.can_climb = 0;
-        game->player.climb = 0;
+        HH_TRACK_SURFACE(surface);
+        assets->gfx_tiles[i] = HH_CREATE_TEXTURE_FROM_SURFACE(renderer, surface);
+        if (cold->ghosts) {
+            err = ghosts_add_sprite(cold->ghosts, (uint8_t)i, surface);
+        }
+        HH_FREE_SURFACE(surface);
+        if (err != SUCCESS) {
+            return err;
+        }
     }
-}
 
-#define DEAD_ZONE 8000
+    return cold->ghosts ? ghosts_upload(cold->ghosts, renderer) : SUCCESS;
+}
 
-static void process_controller_input(void)
+// Swaps in whatever the watcher has decoded since the last frame. NOTE: only the changed tiles and levels are touched,
+// and the spectator feed picks up a changed level from its usual diff of the tiles.
+static void apply_reloads(void)
 {
-    if (controller) {
-        int16_t left_x = SDL_GameControllerGetAxis(controller, SDL_CONTROLLER_AXIS_LEFTX);
-        int16_t left_y = SDL_GameControllerGetAxis(controller, SDL_CONTROLLER_AXIS_LEFTY);
-
-        if (left_x < -DEAD_ZONE) {
-            game->player.try_left = true;
-        } else if (left_x > DEAD_ZONE) {
-            game->player.try_right = true;
+    reload_t next;
+
+    while (hot_reload_pop(cold->hot_reload, &next)) {
+        redraw = true;
+        if (next.type == RELOAD_LEVEL) {
+            // NOTE: the level being played changes under the player straight away, items already picked up and all,
+            // but the start position and enemies only come into play the next time the level starts. Routines start
+            // again from the top, the code they were part way through is gone.
+            cold->level[next.index] = next.level;
+            flow_invalidate(flow);
+            if (next.index == game->cur_level) {
+                for (uint8_t i = 0; i < NUM_ROUTINES; i++) {
+                    sim_restart_routine(game, i);
+                }
+            }
+            if (cold->editor) {
+                editor_level_replaced(cold->editor, &next.level, next.index);
+            }
+            continue;
         }
 
-        if (left_y < -DEAD_ZONE) {
-            game->player.try_up = true;
-        } else if (left_y > DEAD_ZONE) {
-            game->player.try_down = true;
+        SDL_Surface *surface = HH_TRACK_SURFACE(next.surface);
+        SDL_Texture *texture = HH_CREATE_TEXTURE_FROM_SURFACE(renderer, surface);
+        if (!texture) {
+            LOG_INFO("apply_reloads", "couldn't make a texture for tile %u: %s", next.index, SDL_GetError());
+            HH_FREE_SURFACE(surface);
+            continue;
         }
 
-        if (SDL_GameControllerGetButton(controller, SDL_CONTROLLER_BUTTON_A)) {
-            game->player.try_jump = true;
-        }
-        if (SDL_GameControllerGetButton(controller, SDL_CONTROLLER_BUTTON_X)) {
-            game->player.try_jetpack = true;
-        }
-        if (SDL_GameControllerGetButton(controller, SDL_CONTROLLER_BUTTON_B)) {
-            game->player.try_fire = true;
+        HH_DESTROY_TEXTURE(assets->gfx_tiles[next.index]);
+        assets->gfx_tiles[next.index] = texture;
+
+        // NOTE: a sprite collides with the shape that's now drawn, and the ghosts are drawn with it too
+        mask_update_sprite(cold->masks, next.index, surface);
+        if (cold->ghosts && ghosts_replace_sprite(cold->ghosts, next.index, surface) != SUCCESS) {
+            LOG_INFO("apply_reloads", "couldn't redraw tile %u for the ghosts: %s", next.index, err_additional);
         }
+        HH_FREE_SURFACE(surface);
     }
 }
 
-static void process_keyboard_input(void)
+static int init_display(const game_options_t *options)
 {
-    SDL_PumpEvents();
-    const uint8_t *keystate = SDL_GetKeyboardState(NULL);
-
-    if (keystate[SDL_SCANCODE_RIGHT]) {
-        game->player.try_right = true;
-    }
-    if (keystate[SDL_SCANCODE_LEFT]) {
-        game->player.try_left = true;
-    }
-    if (keystate[SDL_SCANCODE_UP]) {
-        game->player.try_up = true;
-    }
-    if (keystate[SDL_SCANCODE_SPACE]) {
-        game->player.try_jump = true;
+    if (cold->golden) {
+        // NOTE: the software renderer, so the frames come out the same whatever the machine's GPU and driver
+        offscreen = HH_CREATE_SURFACE(NATIVE_WIDTH, NATIVE_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        renderer = offscreen ? SDL_CreateSoftwareRenderer(offscreen) : NULL;
+        if (!renderer) {
+            return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+        }
+        return init_frame(options);
     }
-    if (keystate[SDL_SCANCODE_DOWN]) {
-        game->player.try_down = true;
+
+    uint32_t flags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+    if (options->fullscreen) {
+        flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
     }
-    if (keystate[SDL_SCANCODE_LCTRL]) {
-        game->player.try_fire = true;
+    window = SDL_CreateWindow("Hazardous Harry", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                              NATIVE_WIDTH * DISPLAY_SCALE, NATIVE_HEIGHT * DISPLAY_SCALE, flags);
+    if (!window) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
     }
-    if (keystate[SDL_SCANCODE_LALT]) {
-        game->player.try_jetpack = true;
+    SDL_SetWindowMinimumSize(window, NATIVE_WIDTH, NATIVE_HEIGHT);
+
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_TARGETTEXTURE);
+    if (!renderer) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
     }
 
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-        case SDL_QUIT: {
-            game->is_running = false;
-        } break;
+    return init_frame(options);
+}
 
-        case SDL_KEYDOWN: {
-            if (event.key.keysym.sym == SDLK_ESCAPE) {
-                game->is_running = false;
-            }
-        } break;
+// The texture everything is drawn into before it's scaled up, and the filters run on it
+static int init_frame(const game_options_t *options)
+{
+    // NOTE: nearest neighbour, so the pixels stay square and sharp however far they're scaled
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    frame_texture =
+        HH_CREATE_TEXTURE(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, NATIVE_WIDTH, NATIVE_HEIGHT);
+    if (!frame_texture) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    }
 
-        default:
-            break;
+    if (options->post_filters) {
+        int err = post_init(options->post_filters, NATIVE_WIDTH, NATIVE_HEIGHT);
+        if (err != SUCCESS) {
+            return err;
         }
     }
-}
 
-static void update(float dt)
-{
-    update_pbullet();
-    update_ebullet();
-    verify_input();
-    move_player(dt);
-    move_enemies(dt);
-    scroll_screen();
-    update_level();
-    clear_input();
+    return fit_frame();
 }
 
-static void render(void)
+// The largest whole multiple of the native resolution that fits the window, centred with black bars around it. A
+// window too small for even that gets the largest fit that keeps the aspect ratio instead.
+static int fit_frame(void)
 {
-    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x00);
-    SDL_RenderClear(renderer);
+    // NOTE: the renderer's size rather than the window's, which differ on high DPI displays
+    int w, h;
+    if (SDL_GetRendererOutputSize(renderer, &w, &h) != 0) {
+        SDL_GetWindowSize(window, &w, &h);
+    }
+
+    int scale = SDL_min(w / NATIVE_WIDTH, h / NATIVE_HEIGHT);
+    if (scale >= 1) {
+        frame_rect.w = NATIVE_WIDTH * scale;
+        frame_rect.h = NATIVE_HEIGHT * scale;
+    } else if (w * NATIVE_HEIGHT < h * NATIVE_WIDTH) {
+        frame_rect.w = w;
+        frame_rect.h = w * NATIVE_HEIGHT / NATIVE_WIDTH;
+    } else {
+        frame_rect.w = h * NATIVE_WIDTH / NATIVE_HEIGHT;
+        frame_rect.h = h;
+    }
+    frame_rect.x = (w - frame_rect.w) / 2;
+    frame_rect.y = (h - frame_rect.h) / 2;
 
-    render_world();
-    render_player();
-    render_enemies();
-    // render_player_bullet();
-    // render_enemies_bullet();
-    render_ui();
+    LOG_INFO("fit_frame", "drawing %dx%d in %dx%d at %d,%d", NATIVE_WIDTH, NATIVE_HEIGHT, frame_rect.w, frame_rect.h,
+             frame_rect.x, frame_rect.y);
 
-    if (game->debug) {
-        SDL_RenderSetScale(renderer, 1, 1);
-        render_debug_ui();
-        SDL_RenderSetScale(renderer, DISPLAY_SCALE, DISPLAY_SCALE);
+    // NOTE: filtered at the size it's shown when that's a whole multiple, the renderer shrinks it otherwise
+    if (post_enabled()) {
+        return post_resize(renderer, scale);
     }
 
-    SDL_RenderPresent(renderer);
+    return SUCCESS;
 }
 
-static void scroll_screen(void)
+static void toggle_fullscreen(void)
 {
-    // If player is at tile 18 in x, set amount to scroll view/camera to 15 tiles
-    if (game->player.x - game->camera_x >= RIGHT_CAMERA_SCROLL_TRIGGER_TILE) {
-        game->scroll_x = NUM_TILES_TO_SCROLL_CAMERA;
-    }
-    // If camera/view needs to scroll, advance it by camera scroll amount
-    if (game->scroll_x > 0) {
-        // TODO:(lukefilewalker) was ist das?
-        if (game->camera_x == 80) {
-            game->scroll_x = 0;
-        } else {
-            game->camera_x++;
-            game->scroll_x--;
-        }
-    }
-
-    // If player is at tile 0, 1 in x, set amount to scroll view/camera back by 15 tiles
-    if (game->player.x - game->camera_x < LEFT_CAMERA_SCROLL_TRIGGER_TILE) {
-        game->scroll_x = -NUM_TILES_TO_SCROLL_CAMERA;
+    bool fullscreen = SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN_DESKTOP;
+    if (SDL_SetWindowFullscreen(window, fullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP) != 0) {
+        LOG_INFO("toggle_fullscreen", "could not switch fullscreen: %s", SDL_GetError());
     }
+    // NOTE: the size changed event that follows refits the frame
+}
 
-    // If camera/view needs to scroll, reverse it by camera scroll amount
-    if (game->scroll_x < 0) {
-        // If camera has scrolled, reset scroll_x
-        if (game->camera_x == 0) {
-            game->scroll_x = 0;
-        } else {
-            game->camera_x--;
-            game->scroll_x++;
-        }
+static void process_events(void)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        handle_event(&event);
     }
 }
 
-static void update_level(void)
+static void handle_event(const SDL_Event *event)
 {
-    game->tick++;
-
-    if (game->player.jetpack_delay) {
-        // game->player.jetpack_delay--;
-    }
+    // NOTE: keyboard and controller input has already been queued by the input event watch
+    switch (event->type) {
+    case SDL_QUIT: {
+        quit = true;
+    } break;
 
-    // Jetpacks burn fuel when in use
-    if (game->player.using_jetpack) {
-        game->player.jetpack_fuel--;
-        if (game->player.jetpack_fuel <= 0) {
-            game->player.using_jetpack = false;
+    case SDL_KEYDOWN: {
+        if (event->key.keysym.sym == SDLK_ESCAPE) {
+            quit = true;
+        } else if (event->key.keysym.sym == SDLK_F11 && !event->key.repeat) {
+            toggle_fullscreen();
+        } else if (event->key.keysym.sym == SDLK_F2 && !event->key.repeat && cold->editor) {
+            editor_toggle(cold->editor, game);
+            redraw = true;
+        } else if ((event->key.keysym.sym == SDLK_p || event->key.keysym.sym == SDLK_PAUSE) && !event->key.repeat) {
+            toggle_pause();
+        } else if (cold->editor && cold->editor->active) {
+            editor_key(cold->editor, game, &event->key.keysym);
         }
-    }
+    } break;
 
-    if (game->player.check_door) {
-        if (game->player.has_trophy) {
-            add_score(SCORE_LEVEL_COMPLETION);
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEMOTION: {
+        handle_editor_event(event);
+    } break;
 
-            if (game->cur_level < LEVEL_10) {
-                game->cur_level++;
-                start_level();
-            } else {
-                // TODO:(lukefilewalker) game cleared screen!
-                printf("Winner, winner, chicken dinner - your score was %u!\n", game->player.score);
-                game->is_running = false;
-            }
+    case SDL_WINDOWEVENT: {
+        switch (event->window.event) {
+        case SDL_WINDOWEVENT_SIZE_CHANGED: {
+            err_handle(fit_frame());
+            redraw = true;
+        } break;
 
-            return;
-        } else {
-            game->player.check_door = 0;
-        }
-    }
-
-    // If the player is dying
-    if (game->player.death_timer > 0) {
-        game->player.death_timer--;
-        // If player has died
-        if (game->player.death_timer <= 0) {
-            // And player has lives remaining
-            if (game->player.lives > 0) {
-                // Deduct a life and restart level
-                game->player.lives--;
-                // TODO:(lukefilewalker): does this have to be its own func? i.e. start_level(cur_level)
-                restart_level();
-            } else {
-                // Else, game over
-                game->is_running = false;
-            }
-        }
-    }
+        case SDL_WINDOWEVENT_MINIMIZED:
+        case SDL_WINDOWEVENT_HIDDEN: {
+            minimized = true;
+        } break;
 
-    for (size_t i = 0; i < NUM_ENEMIES; i++) {
-        // If the enemy is dying
-        if (game->enemies[i].death_timer >= 0) {
-            game->enemies[i].death_timer--;
-            // If enemy has died
-            if (game->enemies[i].death_timer <= 0) {
-                // TODO:(lukefilewalker) huh? was ist das?
-                game->enemies[i].type = 0;
-                continue;
-            }
-        }
+        case SDL_WINDOWEVENT_RESTORED:
+        case SDL_WINDOWEVENT_MAXIMIZED:
+        case SDL_WINDOWEVENT_SHOWN:
+        case SDL_WINDOWEVENT_EXPOSED: {
+            minimized = false;
+            redraw = true;
+        } break;
 
-        // TODO:(lukefilewalker) if enemy is dead
-        if (game->enemies[i].type) {
-            // If player and enemy collide, everyone dies
-            if (game->enemies[i].x == game->player.x && game->enemies[i].y == game->player.y) {
-                // Commence with the dying!
-                game->player.death_timer = DEATH_DURATION;
-                game->enemies[i].death_timer = DEATH_DURATION;
-            }
+        case SDL_WINDOWEVENT_FOCUS_LOST: {
+            unfocused = true;
+        } break;
+
+        case SDL_WINDOWEVENT_FOCUS_GAINED: {
+            unfocused = false;
+        } break;
+
+        default:
+            break;
         }
+    } break;
+
+    case SDL_CONTROLLERDEVICEADDED: {
+        open_controller(event->cdevice.which);
+    } break;
+
+    case SDL_CONTROLLERDEVICEREMOVED: {
+        close_controller(event->cdevice.which);
+    } break;
+
+    default:
+        break;
     }
 }
 
-static void start_level(void)
+static void handle_editor_event(const SDL_Event *event)
 {
-    restart_level();
-
-    // Set game start state for current level
-    game->camera_x = 0;
-    game->camera_y = 0;
+    if (!cold->editor || !cold->editor->active) {
+        return;
+    }
 
-    for (int i = 0; i < NUM_ENEMIES; i++) {
-        game->enemies[i].type = 0;
-    }
-
-    // Set enemy start state for current level
-    for (size_t i = 0; i < NUM_ENEMIES; i++) {
-        game->enemies[i] = ENEMIES_START_STATE[game->cur_level][i];
-    }
-    // TODO:(lukefilewalker) move to enemies[]?
-    game->ebullet_px = 0;
-    game->ebullet_py = 0;
-    game->ebullet_dir = 0;
-
-    // Set player start state for current level
-    game->player.px = game->player.x * TILE_SIZE;
-    game->player.py = game->player.y * TILE_SIZE;
-    game->player.has_trophy = false;
-    game->player.has_gun = false;
-    game->player.fire = false;
-    game->player.using_jetpack = false;
-    game->player.jetpack_fuel = 0;
-    game->player.death_timer = 0;
-    game->player.check_door = true;
-    game->player.jump_timer = 0;
-    game->player.last_dir = 0;
-    game->player.bullet_px = 0;
-    game->player.bullet_py = 0;
-    game->player.bullet_dir = 0;
+    int x, y;
+    if (event->type == SDL_MOUSEMOTION) {
+        if (!window_to_level(event->motion.x, event->motion.y, &x, &y)) {
+            x = y = -1;
+        }
+        editor_move(cold->editor, game, x, y);
+    } else if (event->type == SDL_MOUSEBUTTONDOWN) {
+        if (!window_to_level(event->button.x, event->button.y, &x, &y)) {
+            x = y = -1;
+        }
+        editor_press(cold->editor, game, x, y, event->button.button);
+    } else {
+        editor_release(cold->editor);
+    }
 }
 
-static void restart_level(void)
+// The level tile under a point in the window, false when it's outside the level e.g. over the UI or the bars
+static bool window_to_level(const int x, const int y, int *tile_x, int *tile_y)
 {
-    game->player.x = PLAYER_START_POS[game->cur_level][0];
-    game->player.y = PLAYER_START_POS[game->cur_level][1];
-    game->player.px = game->player.x * TILE_SIZE;
-    game->player.py = game->player.y * TILE_SIZE;
+    // NOTE: the mouse is in the window's units and frame_rect in the renderer's, which differ on high DPI displays
+    int window_w, window_h, output_w, output_h;
+    SDL_GetWindowSize(window, &window_w, &window_h);
+    if (SDL_GetRendererOutputSize(renderer, &output_w, &output_h) != 0 || !window_w || !window_h) {
+        output_w = window_w = 1;
+        output_h = window_h = 1;
+    }
+    int px = x * output_w / window_w - frame_rect.x;
+    int py = y * output_h / window_h - frame_rect.y;
+    if (px < 0 || py < 0 || px >= frame_rect.w || py >= frame_rect.h) {
+        return false;
+    }
+
+    *tile_x = view_x + px * NATIVE_WIDTH / frame_rect.w / TILE_SIZE;
+    // Down a tile for the UI
+    *tile_y = py * NATIVE_HEIGHT / frame_rect.h / TILE_SIZE - 1;
+    return *tile_x < LEVEL_W && *tile_y >= 0 && *tile_y < LEVEL_H;
 }
 
-static void update_pbullet(void)
+static void open_controller(const int device_index)
 {
-    if (!game->player.bullet_px || !game->player.bullet_py) {
+    // NOTE: we only handle one controller
+    if (controller) {
         return;
     }
 
-    // If bullet hits a collidable tile, remove the bullet
-    if (!is_clear(game->player.bullet_px, game->player.bullet_py, 0)) {
-        game->player.bullet_px = game->player.bullet_py = 0;
-    }
-
-    uint8_t grid_x = game->player.bullet_px / TILE_SIZE;
-    uint8_t grid_y = game->player.bullet_py / TILE_SIZE;
-
-    // If bullet reaches the end of the screen, remove it
-    if (grid_x - game->camera_x < 1 || grid_x - game->camera_x > 20) {
-        game->player.bullet_px = game->player.bullet_py = 0;
+    if (!SDL_IsGameController(device_index)) {
+        LOG_INFO("open_controller", "Joystick is not a game controller.");
+        return;
     }
 
-    if (game->player.bullet_px) {
-        game->player.bullet_px += game->player.bullet_dir * BULLET_SPEED;
-
-        for (size_t i = 0; i < NUM_ENEMIES; i++) {
-            if (game->enemies[i].type) {
-                uint8_t mx = game->enemies[i].x;
-                uint8_t my = game->enemies[i].y;
-
-                if ((grid_y == my || grid_y == my + 1) && (grid_x == mx || grid_x == mx + 1)) {
-                    game->player.bullet_px = game->player.bullet_py = 0;
-                    game->enemies[i].death_timer = DEATH_DURATION;
-                    add_score(SCORE_ENEMY_KILL);
-                }
-            }
-        }
+    controller = SDL_GameControllerOpen(device_index);
+    if (controller) {
+        LOG_INFO("open_controller", "Opened game controller: %s", SDL_GameControllerName(controller));
+    } else {
+        LOG_INFO("open_controller", "Could not open game controller %d: %s", device_index, SDL_GetError());
     }
 }
 
-// TODO:(lukefilewalker): combine with pullet update?
-static void update_ebullet(void)
+static void close_controller(const SDL_JoystickID instance_id)
 {
-    if (!game->ebullet_px || !game->ebullet_py) {
+    if (!controller || SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller)) != instance_id) {
         return;
     }
 
-    // If bullet hits a collidable tile, remove it
-    if (!is_clear(game->ebullet_px, game->ebullet_py, 0)) {
-        game->ebullet_px = game->ebullet_py = 0;
-    }
-
-    // If bullet reaches the end of the screen, remove it
-    if (!is_visible(game->ebullet_px)) {
-        game->ebullet_px = game->ebullet_py = 0;
-    }
+    LOG_INFO("close_controller", "Closed game controller: %s", SDL_GameControllerName(controller));
 
-    if (game->ebullet_px) {
-        game->ebullet_px += game->ebullet_dir * BULLET_SPEED;
+    SDL_GameControllerClose(controller);
+    controller = NULL;
+    input_release_source(INPUT_SOURCE_CONTROLLER);
+}
 
-        uint8_t grid_x = game->ebullet_px / TILE_SIZE;
-        uint8_t grid_y = game->ebullet_py / TILE_SIZE;
+static void wait_next_frame(const uint32_t deadline)
+{
+    SDL_Event event;
+    int32_t remaining;
 
-        if ((grid_y == game->player.y || grid_y == game->player.y + 1) &&
-            (grid_x == game->player.x || grid_x == game->player.x + 1)) {
-            game->ebullet_px = game->ebullet_py = 0;
-            game->player.death_timer = DEATH_DURATION;
+    // Rather than sleeping until the next frame, block on the event queue so input is timestamped as it arrives
+    while ((remaining = (int32_t)(deadline - SDL_GetTicks())) > 0) {
+        if (SDL_WaitEventTimeout(&event, remaining)) {
+            handle_event(&event);
         }
     }
 }
 
-static void verify_input(void)
+// Netplay can't stop, the other player would be left waiting, so it only stops drawing while minimized
+static bool idle(void)
 {
-    if (game->player.death_timer) {
-        return;
-    }
-
-    if (game->player.try_right && game->player.collision_point[2] && game->player.collision_point[3]) {
-        game->player.right = true;
-    }
-
-    if (game->player.try_left && game->player.collision_point[6] && game->player.collision_point[7]) {
-        game->player.left = true;
-    }
+    return !cold->rollback && (paused || minimized);
+}
 
-    if (game->player.try_jump && game->player.on_ground && !game->player.jump && !game->player.using_jetpack &&
-        !game->player.can_climb && game->player.collision_point[0] && game->player.collision_point[1]) {
-        game->player.jump = true;
-    }
+// Sleeps on the event queue rather than running frames, drawing only when the window asks to be drawn again
+static void wait_idle(void)
+{
+    SDL_Event event;
 
-    if (game->player.try_up && game->player.can_climb) {
-        game->player.up = true;
-        game->player.climb = true;
+    if (SDL_WaitEventTimeout(&event, IDLE_WAIT_MS)) {
+        handle_event(&event);
+        process_events();
     }
-
-    if (game->player.try_fire && game->player.has_gun && !game->player.bullet_px && !game->player.bullet_py) {
-        game->player.fire = true;
+    if (cold->hot_reload) {
+        apply_reloads();
     }
+    // NOTE: presses made while idle would otherwise all land on the first frame back
+    input_sample();
+    drain_events();
 
-    if (game->player.try_jetpack && game->player.jetpack_fuel && !game->player.jetpack_delay) {
-        game->player.using_jetpack = !game->player.using_jetpack;
-        game->player.jetpack_delay = 10;
+    if (redraw && !minimized) {
+        render();
+        redraw = false;
     }
+}
 
-    if (game->player.try_down && (game->player.using_jetpack || game->player.climb) &&
-        game->player.collision_point[4] && game->player.collision_point[5]) {
-        game->player.down = true;
+static void toggle_pause(void)
+{
+    if (cold->rollback) {
+        return;
     }
 
-    if (game->player.try_jump && game->player.using_jetpack && game->player.collision_point[0] &&
-        game->player.collision_point[1]) {
-        game->player.up = true;
-    }
+    paused = !paused;
+    // Dimmed when pausing, and back to normal when carrying on even if nothing else changed
+    redraw = true;
+    LOG_INFO("toggle_pause", "%s", paused ? "paused" : "carrying on");
 }
 
-static void move_player(float dt)
+// Golden frames are all drawn. Otherwise a frame is drawn when it would look different from the last one, and no more
+// than background_fps a second while out of focus. NOTE: animated tiles and enemies change every few ticks, so there's
+// still a frame every few ticks with any of them on screen.
+static bool frame_due(void)
 {
-    // if (game->player.death_timer) {
-    //     return;
-    // }
-
-    game->player.x = game->player.px / TILE_SIZE;
-    game->player.y = game->player.py / TILE_SIZE;
-
-    if (game->player.y > 9) {
-        game->player.y = 0;
-        game->player.py = -16;
+    frames_since_drawn++;
+    if (cold->golden) {
+        return true;
     }
-
-    if (game->player.right) {
-        // float px = PLAYER_MOVE; // * MUL * dt;
-        game->player.px += PLAYER_MOVE;
-        game->player.right = 0;
-        game->player.last_dir = 1;
-        game->player.tick++;
-    }
-    if (game->player.left) {
-        // float px = PLAYER_MOVE; // * MUL * dt;
-        game->player.px -= PLAYER_MOVE;
-        game->player.left = 0;
-        game->player.last_dir = -1;
-        game->player.tick++;
+    if (minimized || (unfocused && cold->background_fps && frames_since_drawn < FPS / cold->background_fps)) {
+        frames_skipped++;
+        return false;
     }
 
-    if (game->player.down) {
-        game->player.py += PLAYER_MOVE;
-        game->player.down = 0;
+    frame_key_t key;
+    build_frame_key(&key);
+    // NOTE: particles, ghosts and the editor's cursor move whatever the game does
+    bool moving = cold->particles->count || cold->ghosts || (cold->editor && cold->editor->active);
+    if (!redraw && !(cold->debug && cold->debug_dirty) && !moving && memcmp(&key, &frame_key, sizeof(key)) == 0) {
+        frames_skipped++;
+        return false;
     }
 
-    if (game->player.up) {
-        game->player.py -= PLAYER_MOVE;
-        game->player.up = 0;
+    frame_key = key;
+    redraw = false;
+    frames_since_drawn = 0;
+    frames_drawn++;
+    return true;
+}
+
+// Read the same way as render() and the functions it calls
+static void build_frame_key(frame_key_t *key)
+{
+    // NOTE: zeroed so the padding compares equal too
+    memset(key, 0, sizeof(frame_key_t));
+    key->view_x = cold->editor && cold->editor->active ? cold->editor->camera_x : local_player->camera_x;
+    key->cur_level = game->cur_level;
+
+    for (int i = 0; i < LEVEL_H; i++) {
+        for (int j = 0; j < NATIVE_WIDTH / TILE_SIZE; j++) {
+            key->tiles[i][j] = update_frame(game->level->tiles[i * LEVEL_W + key->view_x + j], j * TILE_SIZE);
+        }
     }
 
-    if (game->player.jetpack_fuel) {
-        game->player.jump = 0;
-        game->player.jump_timer = 0;
+    for (size_t i = 0; i < game->num_players; i++) {
+        const player_t *player = &game->players[i];
+        key->players[i].px = player->px;
+        key->players[i].py = player->py;
+        key->players[i].tile = sim_player_tile(player);
+        key->players[i].bullet = player->bullet;
     }
 
-    if (game->player.jump) {
-        if (!game->player.jump_timer) {
-            game->player.jump_timer = 30;
-            game->player.last_dir = 0;
+    for (int i = 0; i < NUM_ENEMIES; i++) {
+        const enemy_t *m = &game->enemies[i];
+        if (m->type) {
+            key->enemies[i].px = m->px;
+            key->enemies[i].py = m->py;
+            key->enemies[i].tile = m->dying ? TILE_DEATH + (game->tick / 3) % 4 : sim_enemy_tile(game, m);
         }
+    }
+    key->ebullet = game->ebullet;
 
-        // TODO:(lukefilewalker): add delta time to jump
-        if (game->player.collision_point[0] && game->player.collision_point[1]) {
-            if (game->player.jump_timer > 16) {
-                game->player.py -= PLAYER_MOVE;
-            }
-            if (game->player.jump_timer >= 12 && game->player.jump_timer <= 15) {
-                game->player.py -= PLAYER_MOVE / 2;
-            }
-        }
+    key->score = local_player->score;
+    key->lives = local_player->lives;
+    key->has_trophy = local_player->has_trophy;
+    key->has_gun = local_player->has_gun;
+    key->jetpack_fuel = local_player->jetpack_fuel;
+    key->fuel_left = sim_jetpack_fuel(game, local_player);
+}
 
-        game->player.jump_timer--;
+static void drain_events(void)
+{
+    game_event_t event;
 
-        if (game->player.jump_timer == 0) {
-            game->player.jump = 0;
-        }
+    while (event_pop(cold->log_queue, &event)) {
+        event_log(&event);
     }
-
-    // Add gravity
-    if (!game->player.jump && !game->player.on_ground && !game->player.using_jetpack && !game->player.climb) {
-        if (is_clear(game->player.px + 4, game->player.py + 17, 1)) {
-            game->player.py += PLAYER_MOVE;
-        } else {
-            uint8_t not_aligned = game->player.py % TILE_SIZE;
-            if (not_aligned) {
-                game->player.py =
-                    not_aligned < 8 ? game->player.py - not_aligned : game->player.py + TILE_SIZE - not_aligned;
-            }
-        }
+    while (event_pop(cold->stats_queue, &event)) {
+        event_count(&cold->event_stats, &event);
     }
+}
 
-    // Firing the gun
-    if (game->player.fire) {
-        game->player.bullet_dir = game->player.last_dir;
+// Headless runs have no consumers to hand off to, so count straight from the tick's events
+static void count_events(void)
+{
+    for (size_t i = 0; i < events->count; i++) {
+        event_count(&cold->event_stats, &events->events[i]);
+    }
+}
 
-        if (!game->player.bullet_dir) {
-            game->player.bullet_dir = 1;
+static void report_latency(void)
+{
+    if (latency.pending_press) {
+        float ms = (float)(SDL_GetPerformanceCounter() - latency.pending_press) * 1000.0f /
+                   (float)SDL_GetPerformanceFrequency();
+        latency.pending_press = 0;
+
+        latency.last_ms = ms;
+        if (!latency.samples || ms < latency.min_ms) {
+            latency.min_ms = ms;
         }
-
-        if (game->player.bullet_dir == 1) {
-            game->player.bullet_px = game->player.px + 18;
+        if (ms > latency.max_ms) {
+            latency.max_ms = ms;
         }
+        latency.samples++;
+        latency.avg_ms += (ms - latency.avg_ms) / latency.samples;
 
-        if (game->player.bullet_dir == -1) {
-            game->player.bullet_px = game->player.px - 8;
+        latency.window_total_ms += ms;
+        if (ms > latency.window_max_ms) {
+            latency.window_max_ms = ms;
         }
+        latency.window_samples++;
+
+        set_debug_msg(latency_msg, "input to present: %.1f ms (min %.1f, avg %.1f, max %.1f)", latency.last_ms,
+                      latency.min_ms, latency.avg_ms, latency.max_ms);
+    }
 
-        game->player.bullet_py = game->player.py + 8;
-        game->player.fire = false;
+    if (++latency.window_frames < FPS) {
+        return;
+    }
+    if (latency.window_samples) {
+        LOG_INFO("report_latency", "input to present: avg %.2f ms, max %.2f ms over %u presses in %u frames",
+                 latency.window_total_ms / latency.window_samples, latency.window_max_ms, latency.window_samples,
+                 latency.window_frames);
     }
+    latency.window_total_ms = 0.0f;
+    latency.window_max_ms = 0.0f;
+    latency.window_samples = 0;
+    latency.window_frames = 0;
 }
 
-static void move_enemies(float dt)
+static void report_allocs(void)
 {
-    for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
-        enemy_t *m = &game->enemies[i];
-        if (m->type && !m->death_timer) {
-            // Move enemies twice as fast
-            // TODO:(lukefilewalker) is there a better way to do this?
-            for (int j = 0; j < 2; j++) {
-                if (!m->next_px && !m->next_py) {
-                    m->next_px = game->level[game->cur_level].path[m->path_index];
-                    m->next_py = game->level[game->cur_level].path[m->path_index + 1];
-                    m->path_index += 2;
-                }
+    alloc_frame_end();
 
-                // If end of path, reset path to beginning
-                if (m->next_px == (int8_t)0xea && m->next_py == (int8_t)0xea) {
-                    m->next_px = game->level[game->cur_level].path[0];
-                    m->next_py = game->level[game->cur_level].path[1];
-                    m->path_index += 2;
-                }
-
-                if (m->next_px < 0) {
-                    m->px -= 1;
-                    m->next_px++;
-                }
-                if (m->next_px > 0) {
-                    m->px += 1;
-                    m->next_px--;
-                }
+    const alloc_stats_t *stats = alloc_stats();
+    set_debug_msg(alloc_msg, "allocations: %u last frame (%llu bytes), max %u, %u total, %lld bytes live",
+                  stats->frame.allocs, (unsigned long long)stats->frame.bytes, stats->max_frame_allocs,
+                  stats->total.allocs, (long long)stats->live_bytes);
+}
 
-                if (m->next_py < 0) {
-                    m->py -= 1;
-                    m->next_py++;
-                }
-                if (m->next_py > 0) {
-                    m->py += 1;
-                    m->next_py--;
-                }
-            }
+// Shows each phase's counters averaged over a second, as a frame's worth jumps about too much to read
+static void report_perf(void)
+{
+    if (!perf_enabled()) {
+        return;
+    }
+    perf_frame_end();
 
-            m->x = m->px / TILE_SIZE;
-            m->y = m->py / TILE_SIZE;
+    const perf_stats_t *stats = perf_stats();
+    for (uint8_t phase = 0; phase < NUM_PERF_PHASES; phase++) {
+        for (uint8_t i = 0; i < NUM_PERF_COUNTERS; i++) {
+            perf_window[phase].counts[i] += stats->frame[phase].counts[i];
         }
+        perf_window[phase].calls += stats->frame[phase].calls;
+    }
+    if (++perf_window_frames < FPS) {
+        return;
     }
 
-    // enemies firing
-    if (!game->ebullet_px && !game->ebullet_py) {
-        for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
-            if (game->enemies[i].type && is_visible(game->enemies[i].px) && !game->enemies[i].death_timer) {
-                game->ebullet_dir = game->player.px < game->enemies[i].px ? -1 : 1;
-
-                // Default direction of bullet should be right
-                if (!game->ebullet_dir) {
-                    game->ebullet_dir = 1;
-                }
-
-                // Create the bullet on the appropriate side of the enemy
-                if (game->ebullet_dir == 1) {
-                    game->ebullet_px = game->enemies[i].px + 18;
-                }
-                if (game->ebullet_dir == -1) {
-                    game->ebullet_px = game->enemies[i].px - 8;
-                }
-                sprintf(debug_msgs[0], "bullet px: %d", game->ebullet_px);
-
-                game->ebullet_py = game->enemies[i].py + 8;
-            }
-        }
+    for (uint8_t phase = 0; phase < NUM_PERF_PHASES; phase++) {
+        char rates[128];
+        perf_format(&perf_window[phase], rates, sizeof(rates));
+        set_debug_msg(perf_msg + phase, "%s: %.0fk cycles/frame, %s", PERF_PHASE_NAMES[phase],
+                      (double)perf_window[phase].counts[PERF_CYCLES] / perf_window_frames / 1000.0, rates);
     }
+    memset(perf_window, 0, sizeof(perf_window));
+    perf_window_frames = 0;
 }
 
-static void pickup_item(uint8_t grid_x, uint8_t grid_y)
+static void report_post(void)
 {
-    if (!grid_x || !grid_y) {
+    const post_stats_t *stats = post_stats();
+    if (!post_enabled() || stats->frames % FPS != 0) {
         return;
     }
 
-    uint8_t type = game->level[game->cur_level].tiles[grid_y * 100 + grid_x];
-
-    char pickup_msg[256];
-    sprintf(pickup_msg, "picked up item: %d", type);
-    LOG_INFO("pickup_item", pickup_msg, "something else");
-
-    switch (type) {
-    case TILE_JETPACK: {
-        game->player.jetpack_fuel = JETPACK_START_FUEL;
-    } break;
+    set_debug_msg(post_msg, "post-processing: %.2f ms (avg %.2f, max %.2f), %s on %u threads", stats->last_ms,
+                  stats->avg_ms, stats->max_ms, stats->isa, stats->threads);
+}
 
-    case TILE_TROPHY: {
-        add_score(SCORE_TROPHY);
-        game->player.has_trophy = true;
-    } break;
+static void report_ghosts(void)
+{
+    if (!cold->ghosts || cold->ghosts->level_tick % FPS != 0) {
+        return;
+    }
 
-    case TILE_GUN: {
-        game->player.has_gun = true;
-    } break;
+    set_debug_msg(ghosts_msg, "ghosts: %u drawn, %u off camera of %u", cold->ghosts->drawn, cold->ghosts->culled,
+                  cold->ghosts->count);
+}
 
-    // TODO:(lukefilewalker) pull these magic nums out
-    case 47: {
-        add_score(100);
-    } break;
+static void report_editor(void)
+{
+    static uint8_t tool = NUM_TOOLS, brush;
+    static uint32_t undoable = UINT32_MAX;
 
-    case 48: {
-        add_score(50);
-    } break;
+    const editor_t *editor = cold->editor;
+    if (!editor || !editor->active ||
+        (editor->tool == tool && editor->brush == brush && editor_undoable(editor) == undoable)) {
+        return;
+    }
 
-    case 49: {
-        add_score(150);
+    tool = editor->tool;
+    brush = editor->brush;
+    undoable = editor_undoable(editor);
+    set_debug_msg(editor_msg, "editor: %s, brush %u, %u edits to undo", EDITOR_TOOL_NAMES[tool], brush, undoable);
+}
 
-    } break;
-    case 50: {
-        add_score(300);
-    } break;
+static void report_frames(void)
+{
+    if ((frames_drawn + frames_skipped) % FPS != 0) {
+        return;
+    }
 
-    case 51: {
-        add_score(200);
-    } break;
+    set_debug_msg(frames_msg, "frames: %u drawn, %u skipped%s", frames_drawn, frames_skipped,
+                  unfocused && cold->background_fps ? " (in the background)" : "");
+}
 
-    case 52: {
-        add_score(500);
-    } break;
+static void render(void)
+{
+    perf_begin(PERF_RENDER);
+    SDL_SetRenderTarget(renderer, frame_texture);
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x00);
+    SDL_RenderClear(renderer);
+    view_x = cold->editor && cold->editor->active ? cold->editor->camera_x : local_player->camera_x;
 
-    default:
-        break;
+    perf_begin(PERF_RENDER_WORLD);
+    render_world();
+    perf_end(PERF_RENDER_WORLD);
+    // Behind the players, so the live one is never lost in a crowd of ghosts
+    if (cold->ghosts) {
+        player_t camera = *local_player;
+        camera.camera_x = view_x;
+        ghosts_render(cold->ghosts, renderer, &camera, -(float)(view_x * TILE_SIZE), TILE_SIZE);
     }
+    for (size_t i = 0; i < game->num_players; i++) {
+        render_player(&game->players[i]);
+    }
+    render_enemies();
+    // Move down a tile for the UI, like everything else in the world
+    particles_render(cold->particles, renderer, -(float)(view_x * TILE_SIZE), TILE_SIZE);
+    if (cold->editor) {
+        editor_render(cold->editor, renderer, game, assets->gfx_tiles, TILE_SIZE);
+    }
+    // render_player_bullet();
+    // render_enemies_bullet();
+    render_ui();
 
-    game->level[game->cur_level].tiles[grid_y * 100 + grid_x] = 0;
+    SDL_Texture *shown = frame_texture;
+    if (post_enabled()) {
+        perf_begin(PERF_POST);
+        SDL_Texture *filtered = post_process(renderer);
+        perf_end(PERF_POST);
+        if (filtered) {
+            shown = filtered;
+        }
+    }
 
-    game->player.check_pickup_x = 0;
-    game->player.check_pickup_y = 0;
-}
+    // The whole frame scaled up in one copy, the bars around it cleared to black
+    SDL_SetRenderTarget(renderer, NULL);
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x00);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, shown, NULL, &frame_rect);
+    if (paused) {
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x80);
+        SDL_RenderFillRect(renderer, &frame_rect);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    }
 
-static void add_score(uint16_t new_score)
-{
-    if (game->player.score / SCORE_NEW_LIFE != game->player.score + new_score / SCORE_NEW_LIFE) {
-        game->player.lives++;
+    // NOTE: drawn over the scaled frame rather than into it, as MAX_DEBUG_MESSAGES lines of 16 pt text are taller
+    // than NATIVE_HEIGHT. Its timings would never match a golden frame.
+    if (cold->debug && !cold->golden) {
+        render_debug_ui();
     }
-    game->player.score = new_score;
-}
+    // NOTE: presenting can wait for the display, which would swamp the rest
+    perf_end(PERF_RENDER);
 
-static void clear_input(void)
-{
-    game->player.try_right = false;
-    game->player.try_left = false;
-    game->player.try_jump = false;
-    game->player.try_down = false;
-    game->player.try_fire = false;
-    game->player.try_jetpack = false;
+    SDL_RenderPresent(renderer);
 }
 
 static uint8_t update_frame(uint8_t tile, uint8_t salt)
@@ -1060,7 +1508,7 @@ static void render_world(void)
         .h = TILE_SIZE,
     };
 
-    // uint16_t width = 320 * DISPLAY_SCALE;
+    // uint16_t width = NATIVE_WIDTH;
     // for (size_t i = 0; i < 156; i++) {
     //     dest.y = ((TILE_SIZE * i) / width) * TILE_SIZE + TILE_SIZE;
     //     dest.x = (i * TILE_SIZE) % width;
@@ -1075,7 +1523,7 @@ static void render_world(void)
         for (int j = 0; j < 20; j++) {
             dest.x = j * TILE_SIZE;
 
-            tile_index = game->level[game->cur_level].tiles[i * 100 + game->camera_x + j];
+            tile_index = game->level->tiles[i * 100 + view_x + j];
             tile_index = update_frame(tile_index, dest.x);
             SDL_RenderCopy(renderer, assets->gfx_tiles[tile_index], NULL, &dest);
 
@@ -1096,57 +1544,34 @@ static void render_world(void)
     }
 }
 
-static void render_player(void)
+static void render_player(const player_t *player)
 {
     SDL_Rect dest = {
-        .x = game->player.px - game->camera_x * TILE_SIZE,
+        .x = player->px - view_x * TILE_SIZE,
         // Move player down a tile for the UI
-        .y = TILE_SIZE + game->player.py,
+        .y = TILE_SIZE + player->py,
         .w = PLAYER_W,
         .h = PLAYER_H,
     };
 
-    uint8_t tile_index = TILE_PLAYER_STANDING;
-    if (game->player.last_dir) {
-        // TODO:(lukefilewalker) Check what these magic numbers are
-        tile_index = game->player.last_dir > 0 ? 53 : 57;
-        tile_index += (game->player.tick / 5) % 3;
-    }
-
-    if (game->player.using_jetpack) {
-        tile_index = game->player.last_dir >= 0 ? TILE_JETPACK_LEFT : TILE_JETPACK_RIGHT;
-    } else {
-        if (game->player.jump || !game->player.on_ground) {
-            tile_index = game->player.last_dir >= 0 ? TILE_PLAYER_JUMP_LEFT : TILE_PLAYER_JUMP_RIGHT;
-        }
-
-        if (game->player.climb) {
-            tile_index = 71 + (game->player.tick / 5) % 3;
-        }
-    }
-
-    if (game->player.death_timer) {
-        // TODO:(lukefilewalker) for some reason macros freak the complier out here - find out why
-        tile_index = 129 + ((game->player.tick / 3) % 4);
-    }
+    // NOTE: the same tile the simulation collides with
+    uint8_t tile_index = sim_player_tile(player);
 
     SDL_RenderCopy(renderer, assets->gfx_tiles[tile_index], NULL, &dest);
 
     // TODO:(lukefilewalker) render player bullet here?
-    render_player_bullet();
+    render_player_bullet(player);
 }
 
 static void render_enemies(void)
 {
     for (int i = 0; i < NUM_ENEMIES; i++) {
         enemy_t *m = &game->enemies[i];
-        // TODO:(lukefilewalker) figure out whats going on with this magic num
-        uint8_t tile_index = m->death_timer ? 129 : m->type;
-        tile_index += (game->tick / 3) % 4;
+        uint8_t tile_index = m->dying ? TILE_DEATH + (game->tick / 3) % 4 : sim_enemy_tile(game, m);
 
         if (m->type) {
             SDL_Rect dest = {
-                .x = m->px - game->camera_x * TILE_SIZE,
+                .x = m->px - view_x * TILE_SIZE,
                 // Move player down a tile for the UI
                 .y = TILE_SIZE + m->py,
                 .w = PLAYER_W,
@@ -1161,17 +1586,17 @@ static void render_enemies(void)
     render_enemies_bullet();
 }
 
-static void render_player_bullet(void)
+static void render_player_bullet(const player_t *player)
 {
-    if (game->player.bullet_px && game->player.bullet_py) {
+    if (player->bullet.px && player->bullet.py) {
         SDL_Rect dest = {
-            .x = game->player.bullet_px - game->camera_x * TILE_SIZE,
+            .x = player->bullet.px - view_x * TILE_SIZE,
             // Move player down a tile for the UI
-            .y = TILE_SIZE + game->player.bullet_py,
+            .y = TILE_SIZE + player->bullet.py,
             .w = BULLET_W,
             .h = BULLET_H,
         };
-        uint8_t tile_index = game->player.bullet_dir > 0 ? TILE_PLAYER_BULLET_LEFT : TILE_PLAYER_BULLET_RIGHT;
+        uint8_t tile_index = player->bullet.dir > 0 ? TILE_PLAYER_BULLET_LEFT : TILE_PLAYER_BULLET_RIGHT;
         SDL_RenderCopy(renderer, assets->gfx_tiles[tile_index], NULL, &dest);
     }
 }
@@ -1179,15 +1604,15 @@ static void render_player_bullet(void)
 // TODO:(lukefilewalker): combine with enemy render?
 static void render_enemies_bullet(void)
 {
-    if (game->ebullet_px && game->ebullet_py) {
+    if (game->ebullet.px && game->ebullet.py) {
         SDL_Rect dest = {
-            .x = game->ebullet_px - game->camera_x * TILE_SIZE,
+            .x = game->ebullet.px - view_x * TILE_SIZE,
             // Move player down a tile for the UI
-            .y = TILE_SIZE + game->ebullet_py,
+            .y = TILE_SIZE + game->ebullet.py,
             .w = BULLET_W,
             .h = BULLET_H,
         };
-        uint8_t tile_index = game->ebullet_dir > 0 ? TILE_ENEMY_BULLET_LEFT : TILE_ENEMY_BULLET_RIGHT;
+        uint8_t tile_index = game->ebullet.dir > 0 ? TILE_ENEMY_BULLET_LEFT : TILE_ENEMY_BULLET_RIGHT;
         SDL_RenderCopy(renderer, assets->gfx_tiles[tile_index], NULL, &dest);
     }
 }
@@ -1196,7 +1621,7 @@ static void render_enemies_bullet(void)
 static void render_ui(void)
 {
     // Draw UI frame
-    SDL_Rect dest = {.x = 0, .y = 16, .w = 960, .h = 1};
+    SDL_Rect dest = {.x = 0, .y = 16, .w = NATIVE_WIDTH, .h = 1};
     SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
     SDL_RenderFillRect(renderer, &dest);
     dest.y = 176;
@@ -1221,15 +1646,15 @@ static void render_ui(void)
     dest.x = 64;
     dest.w = 8;
     dest.h = 11;
-    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (game->player.score / 10000) % 10], NULL, &dest);
+    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (local_player->score / 10000) % 10], NULL, &dest);
     dest.x = 72;
-    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (game->player.score / 1000) % 10], NULL, &dest);
+    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (local_player->score / 1000) % 10], NULL, &dest);
     dest.x = 80;
-    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (game->player.score / 100) % 10], NULL, &dest);
+    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (local_player->score / 100) % 10], NULL, &dest);
     dest.x = 88;
-    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (game->player.score / 10) % 10], NULL, &dest);
+    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (local_player->score / 10) % 10], NULL, &dest);
     dest.x = 96;
-    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (game->player.score) % 10], NULL, &dest);
+    SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (local_player->score) % 10], NULL, &dest);
 
     // Current level
     dest.x = 170;
@@ -1238,7 +1663,7 @@ static void render_ui(void)
     SDL_RenderCopy(renderer, assets->gfx_tiles[TILE_UI_NUM_0 + (game->cur_level + 1) % 10], NULL, &dest);
 
     // Player lives
-    for (int i = 0; i < game->player.lives; i++) {
+    for (int i = 0; i < local_player->lives; i++) {
         dest.x = (255 + 16 * i);
         dest.w = 16;
         dest.h = 12;
@@ -1246,7 +1671,7 @@ static void render_ui(void)
     }
 
     // Trophy icon
-    if (game->player.has_trophy) {
+    if (local_player->has_trophy) {
         dest.x = 72;
         dest.y = 180;
         dest.w = 176;
@@ -1255,7 +1680,7 @@ static void render_ui(void)
     }
 
     // Gun icon
-    if (game->player.has_gun) {
+    if (local_player->has_gun) {
         dest.x = 255;
         dest.y = 180;
         dest.w = 62;
@@ -1264,7 +1689,7 @@ static void render_ui(void)
     }
 
     // Jetpack
-    if (game->player.jetpack_fuel) {
+    if (local_player->jetpack_fuel) {
         dest.x = 1;
         dest.y = 177;
         dest.w = 62;
@@ -1278,7 +1703,7 @@ static void render_ui(void)
 
         dest.x = 2;
         dest.y = 192;
-        dest.w = game->player.jetpack_fuel * 0.23; // TODO:(lukefilewalker) check this value :/
+        dest.w = sim_jetpack_fuel(game, local_player) * 0.23; // TODO:(lukefilewalker) check this value :/
         dest.h = 4;
         SDL_SetRenderDrawColor(renderer, 0xee, 0x00, 0x00, 0xff);
         SDL_RenderFillRect(renderer, &dest);
@@ -1287,156 +1712,104 @@ static void render_ui(void)
 
 static void render_debug_ui(void)
 {
-    if (strlen(debug_msgs[0]) == 0) {
+    if (strlen(cold->debug_msgs[0]) == 0) {
         return;
     }
 
+    if (cold->debug_dirty) {
+        // NOTE: the overlay's own allocations would otherwise change the allocation message and rebuild it every frame
+        alloc_exclude_from_frame(true);
+        build_debug_texture();
+        alloc_exclude_from_frame(false);
+        cold->debug_dirty = false;
+    }
+
+    if (debug_texture) {
+        SDL_RenderCopy(renderer, debug_texture, NULL, &debug_rect);
+    }
+}
+
+static void build_debug_texture(void)
+{
     SDL_Color text_colour = {255, 255, 255, 255};
     SDL_Surface *line_surfaces[MAX_DEBUG_MESSAGES] = {0};
     uint16_t tot_height = 0, longest_line = 0;
+    size_t num_lines = 0;
+
+    HH_DESTROY_TEXTURE(debug_texture);
+    debug_texture = NULL;
 
     // Create each line's surface and calculate the total height of al the lines
-    for (size_t i = 0; i < num_debug_msgs; i++) {
-        if (strlen(debug_msgs[i]) == 0) {
+    for (; num_lines < cold->num_debug_msgs; num_lines++) {
+        if (strlen(cold->debug_msgs[num_lines]) == 0) {
             break;
         }
 
-        line_surfaces[i] = TTF_RenderText_Solid(font, debug_msgs[i], text_colour);
-        if (!line_surfaces[i]) {
+        line_surfaces[num_lines] = HH_RENDER_TEXT(font, cold->debug_msgs[num_lines], text_colour);
+        if (!line_surfaces[num_lines]) {
             SDL_Log("Unable to create debug line surface! TTF_Error: %s", TTF_GetError());
-            return;
+            break;
         }
 
-        tot_height += line_surfaces[i]->h;
-        if (line_surfaces[i]->w > longest_line) {
-            longest_line = line_surfaces[i]->w;
+        tot_height += line_surfaces[num_lines]->h;
+        if (line_surfaces[num_lines]->w > longest_line) {
+            longest_line = line_surfaces[num_lines]->w;
         }
     }
 
     // Create the final destination surface
-    SDL_Surface *final_surface =
-        SDL_CreateRGBSurfaceWithFormat(0, longest_line, tot_height, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_Surface *final_surface = HH_CREATE_SURFACE(longest_line, tot_height, 32, SDL_PIXELFORMAT_RGBA32);
     if (!final_surface) {
         SDL_Log("Unable to create final debug surface! SDL_Error: %s", SDL_GetError());
-        return;
+    } else {
+        SDL_FillRect(final_surface, NULL, SDL_MapRGBA(final_surface->format, 0, 0, 0, (uint8_t)(255 * 0.75)));
     }
 
-    SDL_FillRect(final_surface, NULL, SDL_MapRGBA(final_surface->format, 0, 0, 0, (uint8_t)(255 * 0.75)));
-
     // Copy each line surface to the destination
-    for (size_t i = 0; i < num_debug_msgs; i++) {
-        SDL_Rect destRect = {0, line_surfaces[i]->h * i, line_surfaces[i]->w, line_surfaces[i]->h};
-        SDL_BlitSurface(line_surfaces[i], NULL, final_surface, &destRect);
-        SDL_FreeSurface(line_surfaces[i]);
+    for (size_t i = 0; i < num_lines; i++) {
+        if (final_surface) {
+            SDL_Rect destRect = {0, line_surfaces[i]->h * i, line_surfaces[i]->w, line_surfaces[i]->h};
+            SDL_BlitSurface(line_surfaces[i], NULL, final_surface, &destRect);
+        }
+        HH_FREE_SURFACE(line_surfaces[i]);
+    }
+
+    if (!final_surface) {
+        return;
     }
 
     // Create final texture
-    SDL_Texture *debug_texture = SDL_CreateTextureFromSurface(renderer, final_surface);
+    debug_texture = HH_CREATE_TEXTURE_FROM_SURFACE(renderer, final_surface);
     if (!debug_texture) {
         SDL_Log("Unable to create texture from surface! SDL_Error: %s", SDL_GetError());
-        return;
     }
 
-    SDL_Rect renderQuad = {5, 5, final_surface->w, tot_height};
-    SDL_FreeSurface(final_surface);
-
-    // Draw background
-    // SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    // SDL_RenderFillRect(renderer, &renderQuad);
-
-    SDL_RenderCopy(renderer, debug_texture, NULL, &renderQuad);
-
-    SDL_DestroyTexture(debug_texture);
+    debug_rect = (SDL_Rect){5, 5, final_surface->w, tot_height};
+    HH_FREE_SURFACE(final_surface);
 }
 
-static uint8_t is_clear(uint16_t px, uint16_t py, uint8_t is_player)
+static void add_debug_msg(char *format, char *msg)
 {
-    uint8_t grid_x = px / TILE_SIZE;
-    uint8_t grid_y = py / TILE_SIZE;
-
-    if (grid_x >= GAME_AREA_TOP || grid_y >= GAME_AREA_BOTTOM) {
-        return 1;
-    }
-
-    uint8_t type = game->level[game->cur_level].tiles[grid_y * 100 + grid_x];
-
-    // Tiles that the player collides with
-    switch (type) {
-    case 1:
-    case 3:
-    case 5:
-    case 15:
-    case 16:
-    case 17:
-    case 18:
-    case 19:
-    case 21:
-    case 22:
-    case 23:
-    case 24:
-    case 29:
-    case 30: {
-        return 0;
-    } break;
-
-    default:
-        break;
-    }
-
-    if (is_player) {
-        switch (type) {
-        case TILE_DOOR: {
-            game->player.check_door = true;
-        } break;
-
-        case TILE_GUN: {
-            game->player.has_gun = true;
-#ifdef _MSC_VER
-            __fallthrough;
-#else
-            __attribute__((fallthrough));
-#endif
-        };
-        case TILE_JETPACK:
-        case TILE_TROPHY:
-        case 47:
-        case 48:
-        case 49:
-        case 50:
-        case 51:
-        case 52: {
-            game->player.check_pickup_x = grid_x;
-            game->player.check_pickup_y = grid_y;
-        } break;
-
-        case 6:
-        case 25:
-        case 36: {
-            if (!game->player.death_timer) {
-                game->player.death_timer = DEATH_DURATION;
-            }
-        } break;
-
-        default:
-            break;
-        }
+    // TODO:(lukefilewalker): create a circular buffer for the messages
+    if (cold->num_debug_msgs > MAX_DEBUG_MESSAGES) {
+        LOG_INFO("debug messages", "we've run out of space :(");
+        return;
     }
-
-    return 1;
+    sprintf(cold->debug_msgs[cold->num_debug_msgs++], format, msg);
+    cold->debug_dirty = true;
 }
 
-static inline uint8_t is_visible(uint16_t px)
+static void set_debug_msg(const uint8_t index, const char *format, ...)
 {
-    uint8_t posx = px / TILE_SIZE;
-    return posx - game->camera_x < 20 && posx - game->camera_x >= 0;
-}
+    char msg[DEBUG_MESSAGE_SIZE];
+    va_list args;
 
-static void add_debug_msg(char *format, char *msg)
-{
-    // TODO:(lukefilewalker): create a circular buffer for the messages
-    if (num_debug_msgs > MAX_DEBUG_MESSAGES) {
-        LOG_INFO("debug messages", "we've run out of space :(");
-        return;
+    va_start(args, format);
+    vsnprintf(msg, sizeof(msg), format, args);
+    va_end(args);
+
+    if (strcmp(msg, cold->debug_msgs[index]) != 0) {
+        memcpy(cold->debug_msgs[index], msg, sizeof(msg));
+        cold->debug_dirty = true;
     }
-    sprintf(debug_msgs[num_debug_msgs++], format, msg);
 }
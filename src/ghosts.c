@@ -0,0 +1,419 @@
+#include "ghosts.h"
+#include "alloc.h"
+#include "error.h"
+#include "log.h"
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#define MAX_GHOST_WORKERS 16
+#define NAME_SIZE 256
+#define REPLAY_EXT ".hhr"
+
+// Player frames then the four of dying, in slots of PLAYER_W x PLAYER_H
+#define ATLAS_COLUMNS 8
+#define ATLAS_SLOTS (TILE_LAST_PLAYER - TILE_FIRST_PLAYER + 1 + 4)
+#define ATLAS_W (ATLAS_COLUMNS * PLAYER_W)
+#define ATLAS_H ((ATLAS_SLOTS + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS * PLAYER_H)
+#define NO_SLOT 0xff
+
+// A loading thread with its own copy of the levels and game to re-simulate runs in, taking the next run from next
+typedef struct {
+    SDL_Thread *thread;
+    level_t levels[NUM_LEVELS];
+    game_state_t game;
+    event_buffer_t events;
+    flow_field_t flow;
+} worker_t;
+
+// What the workers need while loading, read only apart from next
+static ghosts_t *loading;
+static const level_t *load_levels;
+static const mask_t *load_masks;
+static uint8_t start_levels[MAX_GHOSTS];
+static uint8_t *inputs[MAX_GHOSTS];
+static SDL_atomic_t next;
+
+static int list_replays(const char *dir, char (*names)[NAME_SIZE], uint32_t *count);
+static int compare_names(const void *a, const void *b);
+static int SDLCALL worker_run(void *data);
+static void simulate(worker_t *worker, ghost_t *ghost, const uint8_t start_level, const uint8_t *ghost_inputs);
+static SDL_Rect slot_rect(const uint8_t slot);
+static void free_inputs(const uint32_t count);
+
+int ghosts_load(ghosts_t *ghosts, const char *dir, const level_t *levels, const mask_t *masks)
+{
+    memset(ghosts, 0, sizeof(ghosts_t));
+    ghosts->level = 0xff;
+    memset(ghosts->atlas_slot, NO_SLOT, sizeof(ghosts->atlas_slot));
+
+    // Ghosts on camera are packed into the first drawn quads each frame, so only the vertices change and not these
+    for (int i = 0; i < MAX_GHOSTS; i++) {
+        int *quad = &ghosts->indices[i * 6];
+        quad[0] = i * 4;
+        quad[1] = i * 4 + 1;
+        quad[2] = i * 4 + 2;
+        quad[3] = i * 4 + 2;
+        quad[4] = i * 4 + 3;
+        quad[5] = i * 4;
+    }
+
+    char(*names)[NAME_SIZE] = HH_MALLOC(MAX_GHOSTS * NAME_SIZE);
+    replay_t *replay = HH_MALLOC(sizeof(replay_t));
+    if (!names || !replay) {
+        HH_FREE(names);
+        HH_FREE(replay);
+        return err_fatal(ERR_ALLOC, "ghost replays");
+    }
+
+    uint32_t num_names = 0;
+    int err = list_replays(dir, names, &num_names);
+    if (err != SUCCESS) {
+        HH_FREE(names);
+        HH_FREE(replay);
+        return err;
+    }
+    // NOTE: sorted so the same directory always gives the same ghosts, whatever order the files were written in
+    qsort(names, num_names, NAME_SIZE, compare_names);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint32_t total_frames = 0;
+
+    for (uint32_t i = 0; i < num_names; i++) {
+        char fname[NAME_SIZE * 2];
+        snprintf(fname, sizeof(fname), "%s/%s", dir, names[i]);
+
+        // One bad file shouldn't cost the rest of the ghosts
+        if (replay_load(replay, fname) != SUCCESS || !replay->num_ticks) {
+            LOG_INFO("ghosts_load", "skipping %s, it couldn't be read", fname);
+            continue;
+        }
+
+        ghost_t *ghost = &ghosts->ghosts[ghosts->count];
+        ghost->frames = HH_MALLOC(replay->num_ticks * sizeof(ghost_frame_t));
+        inputs[ghosts->count] = HH_MALLOC(replay->num_ticks);
+        if (!ghost->frames || !inputs[ghosts->count]) {
+            // NOTE: counted, so whichever half of this ghost was allocated goes with the ghosts before it
+            ghosts->count++;
+            free_inputs(ghosts->count);
+            ghosts_destroy(ghosts);
+            HH_FREE(names);
+            HH_FREE(replay);
+            return err_fatal(ERR_ALLOC, "ghost tracks");
+        }
+        memcpy(inputs[ghosts->count], replay->inputs, replay->num_ticks);
+        ghost->num_frames = replay->num_ticks;
+        start_levels[ghosts->count] = replay->start_level;
+        ghosts->count++;
+    }
+    HH_FREE(names);
+    HH_FREE(replay);
+
+    // Re-simulating is the slow part, so each core takes the next run until there are none left
+    loading = ghosts;
+    load_levels = levels;
+    load_masks = masks;
+    SDL_AtomicSet(&next, 0);
+
+    int cpus = SDL_GetCPUCount();
+    uint32_t num_workers = cpus < 1 ? 1 : cpus > MAX_GHOST_WORKERS ? MAX_GHOST_WORKERS : (uint32_t)cpus;
+    if (num_workers > ghosts->count) {
+        num_workers = ghosts->count ? ghosts->count : 1;
+    }
+
+    worker_t *workers = HH_MALLOC(num_workers * sizeof(worker_t));
+    if (!workers) {
+        err = err_fatal(ERR_ALLOC, "ghost workers");
+    } else {
+        // The calling thread is worker 0
+        for (uint32_t i = 1; i < num_workers; i++) {
+            workers[i].thread = SDL_CreateThread(worker_run, "ghost loader", &workers[i]);
+            if (!workers[i].thread) {
+                LOG_INFO("ghosts_load", "couldn't start worker %u: %s", i, SDL_GetError());
+            }
+        }
+        workers[0].thread = NULL;
+        worker_run(&workers[0]);
+
+        for (uint32_t i = 1; i < num_workers; i++) {
+            if (workers[i].thread) {
+                SDL_WaitThread(workers[i].thread, NULL);
+            }
+        }
+        HH_FREE(workers);
+    }
+
+    free_inputs(ghosts->count);
+    if (err != SUCCESS) {
+        ghosts_destroy(ghosts);
+        return err;
+    }
+    for (uint32_t i = 0; i < ghosts->count; i++) {
+        total_frames += ghosts->ghosts[i].num_frames;
+    }
+
+    double secs = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    LOG_INFO("ghosts_load", "%u ghosts from %s, %u frames on %u threads in %.2fs", ghosts->count, dir, total_frames,
+             num_workers, secs);
+
+    return SUCCESS;
+}
+
+int ghosts_add_sprite(ghosts_t *ghosts, const uint8_t tile, SDL_Surface *surface)
+{
+    bool is_player = tile >= TILE_FIRST_PLAYER && tile <= TILE_LAST_PLAYER;
+    bool is_death = tile >= TILE_DEATH && tile < TILE_DEATH + 4;
+    if (!is_player && !is_death) {
+        return SUCCESS;
+    }
+
+    if (!ghosts->atlas_surface) {
+        ghosts->atlas_surface = HH_CREATE_SURFACE(ATLAS_W, ATLAS_H, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!ghosts->atlas_surface) {
+            return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+        }
+        // Left clear wherever the tiles' colour key is
+        SDL_FillRect(ghosts->atlas_surface, NULL, 0);
+    }
+
+    uint8_t slot = ghosts->num_slots++;
+    SDL_Rect dest = slot_rect(slot);
+    // NOTE: scaled the same way render_player() stretches the tile over the player
+    if (SDL_BlitScaled(surface, NULL, ghosts->atlas_surface, &dest) != 0) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    }
+    ghosts->atlas_slot[tile] = slot;
+
+    return SUCCESS;
+}
+
+int ghosts_replace_sprite(ghosts_t *ghosts, const uint8_t tile, SDL_Surface *surface)
+{
+    uint8_t slot = ghosts->atlas_slot[tile];
+    if (!ghosts->atlas || slot == NO_SLOT) {
+        return SUCCESS;
+    }
+
+    SDL_Surface *sprite = HH_CREATE_SURFACE(PLAYER_W, PLAYER_H, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!sprite) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    }
+    SDL_FillRect(sprite, NULL, 0);
+
+    int err = SUCCESS;
+    SDL_Rect dest = slot_rect(slot);
+    if (SDL_BlitScaled(surface, NULL, sprite, NULL) != 0 ||
+        SDL_UpdateTexture(ghosts->atlas, &dest, sprite->pixels, sprite->pitch) != 0) {
+        err = err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    }
+    HH_FREE_SURFACE(sprite);
+
+    return err;
+}
+
+int ghosts_upload(ghosts_t *ghosts, SDL_Renderer *renderer)
+{
+    if (!ghosts->atlas_surface) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, "no player tiles for the ghosts");
+    }
+
+    ghosts->atlas = HH_CREATE_TEXTURE_FROM_SURFACE(renderer, ghosts->atlas_surface);
+    HH_FREE_SURFACE(ghosts->atlas_surface);
+    ghosts->atlas_surface = NULL;
+    if (!ghosts->atlas) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    }
+    SDL_SetTextureBlendMode(ghosts->atlas, SDL_BLENDMODE_BLEND);
+
+    return SUCCESS;
+}
+
+void ghosts_update(ghosts_t *ghosts, const game_state_t *game)
+{
+    // Every ghost starts a level when the live player does, from wherever its own run entered it
+    if (game->cur_level != ghosts->level) {
+        ghosts->level = game->cur_level;
+        ghosts->level_tick = 0;
+        return;
+    }
+
+    ghosts->level_tick++;
+}
+
+void ghosts_render(ghosts_t *ghosts, SDL_Renderer *renderer, const player_t *camera, const float left,
+                   const float top)
+{
+    ghosts->drawn = 0;
+    ghosts->culled = 0;
+    if (!ghosts->atlas || ghosts->level >= NUM_LEVELS) {
+        return;
+    }
+
+    const SDL_Color colour = {0xff, 0xff, 0xff, GHOST_ALPHA};
+    const float slot_w = (float)PLAYER_W / ATLAS_W, slot_h = (float)PLAYER_H / ATLAS_H;
+
+    for (uint32_t i = 0; i < ghosts->count; i++) {
+        const ghost_t *ghost = &ghosts->ghosts[i];
+        if (ghost->level_start[ghosts->level] == GHOST_NONE) {
+            continue;
+        }
+        uint32_t index = ghost->level_start[ghosts->level] + ghosts->level_tick;
+        if (index >= ghost->level_end[ghosts->level]) {
+            continue;
+        }
+
+        const ghost_frame_t *frame = &ghost->frames[index];
+        uint8_t slot = ghosts->atlas_slot[frame->tile];
+        // Either edge being on screen is enough
+        if (slot == NO_SLOT ||
+            (!sim_in_view(camera, frame->px) && !sim_in_view(camera, (uint16_t)(frame->px + PLAYER_W - 1)))) {
+            ghosts->culled++;
+            continue;
+        }
+
+        float x = frame->px + left, y = frame->py + top;
+        float u = (slot % ATLAS_COLUMNS) * slot_w, v = (float)(slot / ATLAS_COLUMNS) * slot_h;
+
+        SDL_Vertex *quad = &ghosts->vertices[ghosts->drawn * 4];
+        quad[0] = (SDL_Vertex){{x, y}, colour, {u, v}};
+        quad[1] = (SDL_Vertex){{x + PLAYER_W, y}, colour, {u + slot_w, v}};
+        quad[2] = (SDL_Vertex){{x + PLAYER_W, y + PLAYER_H}, colour, {u + slot_w, v + slot_h}};
+        quad[3] = (SDL_Vertex){{x, y + PLAYER_H}, colour, {u, v + slot_h}};
+        ghosts->drawn++;
+    }
+
+    if (ghosts->drawn) {
+        SDL_RenderGeometry(renderer, ghosts->atlas, ghosts->vertices, (int)ghosts->drawn * 4, ghosts->indices,
+                           (int)ghosts->drawn * 6);
+    }
+}
+
+void ghosts_destroy(ghosts_t *ghosts)
+{
+    for (uint32_t i = 0; i < ghosts->count; i++) {
+        HH_FREE(ghosts->ghosts[i].frames);
+        ghosts->ghosts[i].frames = NULL;
+    }
+    ghosts->count = 0;
+
+    HH_FREE_SURFACE(ghosts->atlas_surface);
+    ghosts->atlas_surface = NULL;
+    HH_DESTROY_TEXTURE(ghosts->atlas);
+    ghosts->atlas = NULL;
+}
+
+#ifndef _WIN32
+
+static int list_replays(const char *dir, char (*names)[NAME_SIZE], uint32_t *count)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        return err_fatal(ERR_OPENING_FILE, dir);
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(d))) {
+        size_t len = strlen(entry->d_name);
+        if (len <= strlen(REPLAY_EXT) || len >= NAME_SIZE ||
+            strcmp(entry->d_name + len - strlen(REPLAY_EXT), REPLAY_EXT) != 0) {
+            continue;
+        }
+
+        if (*count == MAX_GHOSTS) {
+            LOG_INFO("ghosts_load", "only the first %d replays in %s are raced", MAX_GHOSTS, dir);
+            break;
+        }
+        memcpy(names[(*count)++], entry->d_name, len + 1);
+    }
+
+    closedir(d);
+
+    return SUCCESS;
+}
+
+#else
+
+static int list_replays(const char *dir, char (*names)[NAME_SIZE], uint32_t *count)
+{
+    (void)dir;
+    (void)names;
+    (void)count;
+    return err_fatal(ERR_OPENING_FILE, "listing directories isn't supported on this platform yet");
+}
+
+#endif
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(a, b);
+}
+
+static int SDLCALL worker_run(void *data)
+{
+    worker_t *worker = data;
+
+    for (;;) {
+        int i = SDL_AtomicAdd(&next, 1);
+        if (i >= (int)loading->count) {
+            return 0;
+        }
+        simulate(worker, &loading->ghosts[i], start_levels[i], inputs[i]);
+    }
+}
+
+// Records where the run's Harry is after each of its ticks, and which of those ticks each level was played on
+static void simulate(worker_t *worker, ghost_t *ghost, const uint8_t start_level, const uint8_t *ghost_inputs)
+{
+    game_state_t *game = &worker->game;
+
+    // NOTE: a level's items go as they're picked up, so each worker plays on its own copy
+    memcpy(worker->levels, load_levels, sizeof(worker->levels));
+    sim_init(game, worker->levels, load_masks, &worker->flow, &worker->events);
+    game->cur_level = start_level;
+    sim_start_level(game);
+
+    for (uint8_t l = 0; l < NUM_LEVELS; l++) {
+        ghost->level_start[l] = GHOST_NONE;
+        ghost->level_end[l] = GHOST_NONE;
+    }
+
+    uint32_t n = 0;
+    for (; n < ghost->num_frames && game->is_running; n++) {
+        sim_tick(game, &ghost_inputs[n]);
+
+        const player_t *harry = &game->players[0];
+        ghost->frames[n] = (ghost_frame_t){(uint16_t)harry->px, harry->py, sim_player_tile(harry)};
+        if (game->cur_level < NUM_LEVELS) {
+            if (ghost->level_start[game->cur_level] == GHOST_NONE) {
+                ghost->level_start[game->cur_level] = n;
+            }
+            ghost->level_end[game->cur_level] = n + 1;
+        }
+    }
+    // Runs that end early e.g. on game over have nothing more to show
+    ghost->num_frames = n;
+}
+
+// Where a slot's sprite is in the atlas, a row of ATLAS_COLUMNS at a time
+static SDL_Rect slot_rect(const uint8_t slot)
+{
+    return (SDL_Rect){
+        .x = (slot % ATLAS_COLUMNS) * PLAYER_W,
+        .y = (slot / ATLAS_COLUMNS) * PLAYER_H,
+        .w = PLAYER_W,
+        .h = PLAYER_H,
+    };
+}
+
+static void free_inputs(const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        HH_FREE(inputs[i]);
+        inputs[i] = NULL;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef HH_GHOSTS_H
+#define HH_GHOSTS_H
+
+#include "mask.h"
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_GHOSTS 1024
+#define GHOST_NONE UINT32_MAX
+// How see-through ghosts are, out of 255
+#define GHOST_ALPHA 96
+
+// Where a ghost's Harry was and which frame he was showing, after each tick
+typedef struct {
+    uint16_t px;
+    int16_t py;
+    uint8_t tile;
+} ghost_frame_t;
+
+typedef struct {
+    ghost_frame_t *frames;
+    uint32_t num_frames;
+    // Each level's frames, from the tick it was entered on to the one it was left on. GHOST_NONE for levels the run
+    // never reached.
+    uint32_t level_start[NUM_LEVELS];
+    uint32_t level_end[NUM_LEVELS];
+} ghost_t;
+
+// Recorded runs raced against on every level: each ghost starts a level when the live player does, from when its own
+// run entered it. Their tracks are worked out once at start-up by re-simulating the replays' inputs, so playing them
+// back costs a lookup each.
+typedef struct {
+    uint32_t count;
+    ghost_t ghosts[MAX_GHOSTS];
+
+    // The live player's level and ticks since entering it
+    uint8_t level;
+    uint32_t level_tick;
+
+    // Last frame's
+    uint32_t drawn;
+    uint32_t culled;
+
+    // Every player frame in one texture so all the ghosts go in a single draw, see ghosts_add_sprite()
+    SDL_Surface *atlas_surface;
+    SDL_Texture *atlas;
+    uint8_t atlas_slot[NUM_TILES];
+    uint8_t num_slots;
+    SDL_Vertex vertices[MAX_GHOSTS * 4];
+    int indices[MAX_GHOSTS * 6];
+} ghosts_t;
+
+// Re-simulates every replay in dir on all cores. levels are left as they are.
+int ghosts_load(ghosts_t *ghosts, const char *dir, const level_t *levels, const mask_t *masks);
+// Called with each tile as it's loaded, copies the frames the player is drawn with into the atlas
+int ghosts_add_sprite(ghosts_t *ghosts, const uint8_t tile, SDL_Surface *surface);
+// Turns the atlas into a texture once every tile has been added
+int ghosts_upload(ghosts_t *ghosts, SDL_Renderer *renderer);
+// Redraws a hot reloaded tile's frame in the uploaded atlas, nothing if the ghosts aren't drawn with it
+int ghosts_replace_sprite(ghosts_t *ghosts, const uint8_t tile, SDL_Surface *surface);
+void ghosts_update(ghosts_t *ghosts, const game_state_t *game);
+// Draws the ghosts in camera's view, left and top are where the world's origin is on screen
+void ghosts_render(ghosts_t *ghosts, SDL_Renderer *renderer, const player_t *camera, const float left,
+                   const float top);
+void ghosts_destroy(ghosts_t *ghosts);
+
+#endif // !HH_GHOSTS_H
@@ -0,0 +1,263 @@
+#include "golden.h"
+#include "alloc.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Same primes as xxHash64, whose round this borrows
+#define PRIME_1 0x9e3779b185ebca87ULL
+#define PRIME_2 0xc2b2ae3d27d4eb4fULL
+#define DIFF_CHANGED 0xffff0000u
+
+static int load_hashes(golden_t *golden, FILE *fd);
+static int compare_ticks(const void *a, const void *b);
+static int save_frame(const uint32_t *pixels, const int w, const int h, const char *fname);
+static void write_diff(golden_t *golden, const uint32_t tick);
+static uint64_t rotl(const uint64_t x, const int r);
+
+int golden_open(golden_t *golden, const char *dir, const bool update, const int w, const int h)
+{
+    memset(golden, 0, sizeof(golden_t));
+    golden->dir = dir;
+    golden->update = update;
+    golden->w = w;
+    golden->h = h;
+
+    golden->pixels = HH_MALLOC((size_t)w * h * sizeof(uint32_t));
+    golden->diff = HH_MALLOC((size_t)w * h * sizeof(uint32_t));
+    if (!golden->pixels || !golden->diff) {
+        return err_fatal(ERR_ALLOC, "golden frames");
+    }
+
+    char fname[GOLDEN_PATH_SIZE];
+    snprintf(fname, sizeof(fname), "%s/hashes.txt", dir);
+    FILE *fd = fopen(fname, "r");
+    if (!fd) {
+        if (!update) {
+            return err_fatal(ERR_OPENING_FILE, fname);
+        }
+        golden->every = true;
+        LOG_INFO("golden_open", "no %s, writing a frame every %d ticks", fname, GOLDEN_EVERY);
+        return SUCCESS;
+    }
+
+    int err = load_hashes(golden, fd);
+    fclose(fd);
+    if (err != SUCCESS) {
+        return err;
+    }
+    golden->every = update && !golden->num_frames;
+
+    LOG_INFO("golden_open", "%s %u frames in %s", update ? "updating" : "checking", golden->num_frames, dir);
+
+    return SUCCESS;
+}
+
+int golden_check(golden_t *golden, SDL_Renderer *renderer, SDL_Texture *frame, const uint32_t tick)
+{
+    if (golden->every) {
+        if (!tick || tick % GOLDEN_EVERY != 0 || golden->num_frames == MAX_GOLDEN_FRAMES) {
+            return SUCCESS;
+        }
+        golden->frames[golden->num_frames++].tick = tick;
+    }
+    if (golden->next >= golden->num_frames || golden->frames[golden->next].tick != tick) {
+        return SUCCESS;
+    }
+    golden_frame_t *expected = &golden->frames[golden->next++];
+
+    SDL_SetRenderTarget(renderer, frame);
+    int failed = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, golden->pixels,
+                                      golden->w * (int)sizeof(uint32_t));
+    SDL_SetRenderTarget(renderer, NULL);
+    if (failed) {
+        return err_fatal(ERR_SDL_CREATE_WIN_RENDER, SDL_GetError());
+    }
+
+    uint64_t hash = golden_hash(golden->pixels, (size_t)golden->w * golden->h);
+    golden->checked++;
+
+    char fname[GOLDEN_PATH_SIZE];
+    if (golden->update) {
+        expected->hash = hash;
+        snprintf(fname, sizeof(fname), "%s/tick%u.bmp", golden->dir, tick);
+        return save_frame(golden->pixels, golden->w, golden->h, fname);
+    }
+
+    if (hash != expected->hash) {
+        LOG_INFO("golden_check", "tick %u: %016llx, expected %016llx", tick, (unsigned long long)hash,
+                 (unsigned long long)expected->hash);
+        golden->mismatched++;
+        write_diff(golden, tick);
+    }
+
+    return SUCCESS;
+}
+
+int golden_close(golden_t *golden)
+{
+    HH_FREE(golden->pixels);
+    HH_FREE(golden->diff);
+    golden->pixels = NULL;
+    golden->diff = NULL;
+
+    char fname[GOLDEN_PATH_SIZE];
+    if (golden->update) {
+        snprintf(fname, sizeof(fname), "%s/hashes.txt", golden->dir);
+        FILE *fd = fopen(fname, "w");
+        if (!fd) {
+            return err_fatal(ERR_OPENING_FILE, fname);
+        }
+        fprintf(fd, "# tick hash, see golden_hash()\n");
+        // NOTE: listed ticks the run didn't reach are left out rather than kept with no hash
+        for (uint32_t i = 0; i < golden->next; i++) {
+            fprintf(fd, "%u %016llx\n", golden->frames[i].tick, (unsigned long long)golden->frames[i].hash);
+        }
+        fclose(fd);
+
+        LOG_INFO("golden_close", "wrote %u frames to %s", golden->next, golden->dir);
+        return SUCCESS;
+    }
+
+    uint32_t missed = golden->num_frames - golden->next;
+    LOG_INFO("golden_close", "%u frames checked, %u mismatched, %u never reached", golden->checked,
+             golden->mismatched, missed);
+    if (golden->mismatched || missed) {
+        snprintf(fname, sizeof(fname), "%u of %u frames in %s", golden->mismatched + missed, golden->num_frames,
+                 golden->dir);
+        return err_fatal(ERR_GOLDEN_MISMATCH, fname);
+    }
+
+    return SUCCESS;
+}
+
+uint64_t golden_hash(const uint32_t *pixels, const size_t count)
+{
+    uint64_t lanes[4] = {PRIME_1 + PRIME_2, PRIME_2, 0, (uint64_t)0 - PRIME_1};
+    size_t i = 0;
+
+    // Two pixels a lane, eight an iteration
+    for (; i + 8 <= count; i += 8) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t v;
+            memcpy(&v, &pixels[i + l * 2], sizeof(v));
+            lanes[l] = rotl(lanes[l] + v * PRIME_2, 31) * PRIME_1;
+        }
+    }
+
+    uint64_t hash = (uint64_t)count * PRIME_1;
+    for (int l = 0; l < 4; l++) {
+        hash = rotl(hash ^ rotl(lanes[l] * PRIME_2, 31) * PRIME_1, 27) * PRIME_1 + PRIME_2;
+    }
+    for (; i < count; i++) {
+        hash = rotl(hash ^ pixels[i] * PRIME_1, 23) * PRIME_2;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_1;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+static int load_hashes(golden_t *golden, FILE *fd)
+{
+    char line[128];
+
+    while (fgets(line, sizeof(line), fd)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        unsigned int tick;
+        unsigned long long hash = 0;
+        // NOTE: a tick without a hash is a frame to be filled in by updating
+        int fields = sscanf(line, "%u %llx", &tick, &hash);
+        if (fields < 1 || (fields < 2 && !golden->update)) {
+            return err_fatal(ERR_OPENING_FILE, "hashes.txt lines are a tick and a hash");
+        }
+        if (golden->num_frames == MAX_GOLDEN_FRAMES) {
+            LOG_INFO("golden_open", "only the first %d frames are checked", MAX_GOLDEN_FRAMES);
+            break;
+        }
+        golden->frames[golden->num_frames++] = (golden_frame_t){tick, hash};
+    }
+
+    qsort(golden->frames, golden->num_frames, sizeof(golden_frame_t), compare_ticks);
+
+    return SUCCESS;
+}
+
+static int compare_ticks(const void *a, const void *b)
+{
+    const golden_frame_t *x = a, *y = b;
+    return (x->tick > y->tick) - (x->tick < y->tick);
+}
+
+static int save_frame(const uint32_t *pixels, const int w, const int h, const char *fname)
+{
+    // NOTE: only wraps the pixels, so there's nothing for the allocation tracker to count
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom((void *)pixels, w, h, 32, w * (int)sizeof(uint32_t),
+                                                              SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+        return err_fatal(ERR_SDL_LOADING_BMP, SDL_GetError());
+    }
+
+    int failed = SDL_SaveBMP(surface, fname);
+    SDL_FreeSurface(surface);
+    if (failed) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    return SUCCESS;
+}
+
+// Writes what was drawn, then the golden frame darkened with the pixels that changed in red
+static void write_diff(golden_t *golden, const uint32_t tick)
+{
+    char fname[GOLDEN_PATH_SIZE];
+    snprintf(fname, sizeof(fname), "%s/tick%u_actual.bmp", golden->dir, tick);
+    if (save_frame(golden->pixels, golden->w, golden->h, fname) != SUCCESS) {
+        LOG_INFO("golden_check", "couldn't write %s", fname);
+    }
+
+    snprintf(fname, sizeof(fname), "%s/tick%u.bmp", golden->dir, tick);
+    SDL_Surface *loaded = HH_LOAD_BMP(fname);
+    SDL_Surface *expected = loaded ? HH_TRACK_SURFACE(SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0))
+                                   : NULL;
+    HH_FREE_SURFACE(loaded);
+    if (!expected || expected->w != golden->w || expected->h != golden->h) {
+        LOG_INFO("golden_check", "no %dx%d golden frame in %s to diff against", golden->w, golden->h, fname);
+        HH_FREE_SURFACE(expected);
+        return;
+    }
+
+    uint32_t changed = 0;
+    for (int y = 0; y < golden->h; y++) {
+        const uint32_t *row = (const uint32_t *)((const uint8_t *)expected->pixels + (size_t)y * expected->pitch);
+        for (int x = 0; x < golden->w; x++) {
+            uint32_t actual = golden->pixels[y * golden->w + x];
+            // NOTE: BMPs keep no alpha, so only the colour is compared
+            bool same = ((actual ^ row[x]) & 0x00ffffff) == 0;
+            golden->diff[y * golden->w + x] = same ? 0xff000000 | ((row[x] >> 2) & 0x003f3f3f) : DIFF_CHANGED;
+            changed += !same;
+        }
+    }
+    HH_FREE_SURFACE(expected);
+
+    snprintf(fname, sizeof(fname), "%s/tick%u_diff.bmp", golden->dir, tick);
+    if (save_frame(golden->diff, golden->w, golden->h, fname) != SUCCESS) {
+        LOG_INFO("golden_check", "couldn't write %s", fname);
+        return;
+    }
+    LOG_INFO("golden_check", "tick %u: %u pixels changed, see %s", tick, changed, fname);
+}
+
+static uint64_t rotl(const uint64_t x, const int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
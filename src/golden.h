@@ -0,0 +1,51 @@
+#ifndef HH_GOLDEN_H
+#define HH_GOLDEN_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_GOLDEN_FRAMES 512
+// Ticks between the frames checked when there's no list of them yet, one a second
+#define GOLDEN_EVERY 30
+#define GOLDEN_PATH_SIZE 512
+
+typedef struct {
+    uint32_t tick;
+    uint64_t hash;
+} golden_frame_t;
+
+// Frames drawn from a replay checked against the hashes of a run known to be right. A directory holds hashes.txt, one
+// "tick hash" line per frame checked, and the frames themselves as tick<n>.bmp to diff against when one doesn't match.
+typedef struct {
+    const char *dir;
+    // Writes the frames and their hashes instead of checking them
+    bool update;
+    // Updating without a list, so every GOLDEN_EVERY ticks is added to frames as it's reached
+    bool every;
+
+    golden_frame_t frames[MAX_GOLDEN_FRAMES];
+    uint32_t num_frames;
+    // The next in frames to check, or the number written when updating
+    uint32_t next;
+    uint32_t checked;
+    uint32_t mismatched;
+
+    int w;
+    int h;
+    uint32_t *pixels;
+    uint32_t *diff;
+} golden_t;
+
+// Reads the hashes in dir, when updating their ticks are kept and the rest of the file is rewritten. Frames are w x h.
+int golden_open(golden_t *golden, const char *dir, const bool update, const int w, const int h);
+// Reads frame back from the renderer, or what it last presented when NULL, on the ticks there's a golden frame for, or
+// on every GOLDEN_EVERY when updating without a list. Mismatches write tick<n>_actual.bmp and tick<n>_diff.bmp, changed
+// pixels red in the diff.
+int golden_check(golden_t *golden, SDL_Renderer *renderer, SDL_Texture *frame, const uint32_t tick);
+// Writes the hashes when updating, otherwise fails if any frame didn't match or wasn't reached
+int golden_close(golden_t *golden);
+// 64 bits of a fast non-cryptographic hash, four independent lanes so the multiplies overlap
+uint64_t golden_hash(const uint32_t *pixels, const size_t count);
+
+#endif // !HH_GOLDEN_H
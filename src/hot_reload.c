@@ -0,0 +1,256 @@
+// poll() is POSIX, not C11
+#define _POSIX_C_SOURCE 200112L
+
+#include "hot_reload.h"
+#include "assets.h"
+#include "common.h"
+#include "error.h"
+#include "game.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ASSETS_DIR "res/assets"
+#define DATA_DIR "res/data"
+// How long the watcher waits for changes before checking whether it's been asked to stop
+#define POLL_MS 100
+
+bool hot_reload_pop(hot_reload_t *reload, reload_t *next)
+{
+    uint32_t head = (uint32_t)SDL_AtomicGet(&reload->head);
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&reload->tail);
+
+    SDL_MemoryBarrierAcquire();
+
+    if (head == tail) {
+        return false;
+    }
+
+    *next = reload->reloads[head & (HOT_RELOAD_QUEUE_SIZE - 1)];
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&reload->head, (int)(head + 1));
+
+    return true;
+}
+
+#ifdef __linux__
+
+static int watch(void *data);
+static void reload_changed(hot_reload_t *reload, bool *tiles, bool *levels);
+static reload_t *queue_slot(hot_reload_t *reload);
+static void queue_push(hot_reload_t *reload);
+
+int hot_reload_start(hot_reload_t *reload)
+{
+    LOG_INFO("hot_reload_start", "watching %s and %s", ASSETS_DIR, DATA_DIR);
+
+    memset(reload, 0, sizeof(hot_reload_t));
+
+    reload->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reload->fd < 0) {
+        return err_fatal(ERR_HOT_RELOAD, strerror(errno));
+    }
+
+    // NOTE: editors that save to a temporary file and rename it over the original only show up as IN_MOVED_TO
+    reload->assets_wd = inotify_add_watch(reload->fd, ASSETS_DIR, IN_CLOSE_WRITE | IN_MOVED_TO);
+    reload->data_wd = inotify_add_watch(reload->fd, DATA_DIR, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (reload->assets_wd < 0 || reload->data_wd < 0) {
+        close(reload->fd);
+        return err_fatal(ERR_HOT_RELOAD, strerror(errno));
+    }
+
+    reload->thread = SDL_CreateThread(watch, "hot reload", reload);
+    if (!reload->thread) {
+        close(reload->fd);
+        return err_fatal(ERR_HOT_RELOAD, SDL_GetError());
+    }
+
+    return SUCCESS;
+}
+
+void hot_reload_stop(hot_reload_t *reload)
+{
+    if (!reload->thread) {
+        return;
+    }
+
+    SDL_AtomicSet(&reload->stop, 1);
+    SDL_WaitThread(reload->thread, NULL);
+    reload->thread = NULL;
+    close(reload->fd);
+
+    // Anything decoded but never swapped in
+    reload_t next;
+    while (hot_reload_pop(reload, &next)) {
+        if (next.type == RELOAD_TILE) {
+            SDL_FreeSurface(next.surface);
+        }
+    }
+}
+
+static int watch(void *data)
+{
+    hot_reload_t *reload = data;
+    // Big enough for a burst of saves, events are never split across reads
+    _Alignas(struct inotify_event) char buffer[4096];
+    struct pollfd pfd = {.fd = reload->fd, .events = POLLIN};
+
+    while (!SDL_AtomicGet(&reload->stop)) {
+        if (poll(&pfd, 1, POLL_MS) <= 0) {
+            continue;
+        }
+
+        // Saving a file usually fires more than once, so collect everything that's waiting and decode each file once
+        bool tiles[NUM_TILES] = {0};
+        bool levels[NUM_LEVELS] = {0};
+        ssize_t len;
+
+        while ((len = read(reload->fd, buffer, sizeof(buffer))) > 0) {
+            for (char *ptr = buffer; ptr < buffer + len;) {
+                const struct inotify_event *event = (const struct inotify_event *)ptr;
+                ptr += sizeof(struct inotify_event) + event->len;
+
+                unsigned int index;
+                char ext[5];
+                if (!event->len) {
+                    continue;
+                }
+                if (event->wd == reload->assets_wd && sscanf(event->name, "tile%u.%4s", &index, ext) == 2 &&
+                    strcmp(ext, "bmp") == 0 && index < NUM_TILES) {
+                    tiles[index] = true;
+                }
+                // NOTE: a level's script is compiled along with it, so a change to either reloads both
+                if (event->wd == reload->data_wd && sscanf(event->name, "level%u.%4s", &index, ext) == 2 &&
+                    (strcmp(ext, "dat") == 0 || strcmp(ext, SCRIPT_EXT) == 0) && index < NUM_LEVELS) {
+                    levels[index] = true;
+                }
+            }
+        }
+
+        reload_changed(reload, tiles, levels);
+    }
+
+    return 0;
+}
+
+static void reload_changed(hot_reload_t *reload, bool *tiles, bool *levels)
+{
+    // Player tiles are composited with their mask tile, so a new mask means those have to be made again too
+    for (uint16_t i = 0; i < NUM_TILES; i++) {
+        uint8_t mask;
+        if (assets_mask_tile((uint8_t)i, &mask) && mask < NUM_TILES && tiles[mask]) {
+            tiles[i] = true;
+        }
+    }
+
+    for (uint16_t i = 0; i < NUM_TILES; i++) {
+        if (!tiles[i]) {
+            continue;
+        }
+
+        reload_t *next = queue_slot(reload);
+        if (!next) {
+            return;
+        }
+
+        // NOTE: a file that's broken half way through an edit is left as it was, the next save tries again
+        char error[ERR_ADDITIONAL_SIZE];
+        int err = assets_read_tile((uint8_t)i, &next->surface, error, sizeof(error));
+        if (err != SUCCESS) {
+            LOG_INFO("hot_reload", "couldn't load tile %u: %s %s", i, err_messages[err], error);
+            continue;
+        }
+        next->type = RELOAD_TILE;
+        next->index = (uint8_t)i;
+        queue_push(reload);
+
+        LOG_INFO("hot_reload", "reloaded tile %u", i);
+    }
+
+    for (uint8_t i = 0; i < NUM_LEVELS; i++) {
+        if (!levels[i]) {
+            continue;
+        }
+
+        char fname[DATA_FNAME_SIZE];
+        snprintf(fname, sizeof(fname), DATA_DIR "/level%u.dat", i);
+
+        // Truncated levels would load with the missing tiles filled in with garbage
+        struct stat info;
+        const level_t *level = NULL;
+        if (stat(fname, &info) != 0 || (size_t)info.st_size < sizeof(level->path) + sizeof(level->tiles)) {
+            LOG_INFO("hot_reload", "skipping %s, it's too short to be a level", fname);
+            continue;
+        }
+
+        reload_t *next = queue_slot(reload);
+        if (!next) {
+            return;
+        }
+
+        char error[ERR_ADDITIONAL_SIZE];
+        int err = sim_read_level(&next->level, fname, error, sizeof(error));
+        if (err != SUCCESS) {
+            LOG_INFO("hot_reload", "couldn't load %s: %s %s", fname, err_messages[err], error);
+            continue;
+        }
+        next->type = RELOAD_LEVEL;
+        next->index = i;
+        queue_push(reload);
+
+        LOG_INFO("hot_reload", "reloaded level %u", i);
+    }
+}
+
+// The next free slot, waiting for the game to catch up when the ring is full rather than dropping a change. Only NULL
+// when the watcher has been asked to stop.
+static reload_t *queue_slot(hot_reload_t *reload)
+{
+    for (;;) {
+        uint32_t tail = (uint32_t)SDL_AtomicGet(&reload->tail);
+        uint32_t head = (uint32_t)SDL_AtomicGet(&reload->head);
+
+        SDL_MemoryBarrierAcquire();
+
+        if (tail - head < HOT_RELOAD_QUEUE_SIZE) {
+            return &reload->reloads[tail & (HOT_RELOAD_QUEUE_SIZE - 1)];
+        }
+        if (SDL_AtomicGet(&reload->stop)) {
+            return NULL;
+        }
+
+        SDL_Delay(POLL_MS);
+    }
+}
+
+static void queue_push(hot_reload_t *reload)
+{
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&reload->tail);
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&reload->tail, (int)(tail + 1));
+}
+
+#else
+
+int hot_reload_start(hot_reload_t *reload)
+{
+    memset(reload, 0, sizeof(hot_reload_t));
+    return err_fatal(ERR_HOT_RELOAD, "watching files isn't supported on this platform yet");
+}
+
+void hot_reload_stop(hot_reload_t *reload)
+{
+    (void)reload;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef HH_HOT_RELOAD_H
+#define HH_HOT_RELOAD_H
+
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: must be a power of two
+#define HOT_RELOAD_QUEUE_SIZE 16
+
+enum {
+    RELOAD_TILE,
+    RELOAD_LEVEL,
+};
+
+// A tile or level decoded off the main thread, waiting to be swapped in at the start of a frame
+typedef struct {
+    uint8_t type;
+    uint8_t index;
+    // RELOAD_TILE, untracked until it's taken off the queue
+    SDL_Surface *surface;
+    // RELOAD_LEVEL
+    level_t level;
+} reload_t;
+
+// Watches res/assets and res/data for files being saved and decodes only what changed on its own thread, handing the
+// results over through a single-producer/single-consumer ring so the frame never waits on the disk
+typedef struct {
+    int fd;
+    int assets_wd;
+    int data_wd;
+    SDL_Thread *thread;
+    SDL_atomic_t stop;
+
+    reload_t reloads[HOT_RELOAD_QUEUE_SIZE];
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+} hot_reload_t;
+
+int hot_reload_start(hot_reload_t *reload);
+// The next thing to swap in, false once there's nothing left
+bool hot_reload_pop(hot_reload_t *reload, reload_t *next);
+void hot_reload_stop(hot_reload_t *reload);
+
+#endif // !HH_HOT_RELOAD_H
@@ -0,0 +1,216 @@
+#include "input.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+// Single-producer/single-consumer ring of timestamped input events. The producer is the SDL event watch, which SDL
+// calls as each event is queued, the consumer is the game loop sampling input right before the simulation step.
+typedef struct {
+    input_event_t events[INPUT_QUEUE_SIZE];
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t dropped;
+} input_queue_t;
+
+static input_queue_t queue;
+
+// Producer-side axis state, used to turn analogue stick motion into button presses and releases
+static uint8_t axis_buttons[2];
+
+// Consumer-side button state per source
+static uint8_t held[NUM_INPUT_SOURCES];
+
+static int SDLCALL input_event_watch(void *userdata, SDL_Event *event);
+static void queue_push(const uint8_t buttons, const uint8_t source, const bool pressed);
+static uint8_t keyboard_button(const SDL_Scancode scancode);
+static uint8_t controller_button(const uint8_t button);
+static void controller_axis(const uint8_t axis, const int16_t value);
+
+int input_init(void)
+{
+    LOG_INFO("input_init", "initialising input queue");
+
+    memset(&queue, 0, sizeof(queue));
+    memset(axis_buttons, 0, sizeof(axis_buttons));
+    memset(held, 0, sizeof(held));
+
+    SDL_AddEventWatch(input_event_watch, NULL);
+
+    return SUCCESS;
+}
+
+void input_destroy(void)
+{
+    SDL_DelEventWatch(input_event_watch, NULL);
+
+    int dropped = SDL_AtomicGet(&queue.dropped);
+    if (dropped) {
+        LOG_INFO("input_destroy", "input queue dropped %d events", dropped);
+    }
+}
+
+input_sample_t input_sample(void)
+{
+    input_sample_t sample = {0};
+    uint8_t pressed = 0;
+    uint32_t head = (uint32_t)SDL_AtomicGet(&queue.head);
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&queue.tail);
+
+    SDL_MemoryBarrierAcquire();
+
+    for (; head != tail; head++) {
+        const input_event_t *event = &queue.events[head & (INPUT_QUEUE_SIZE - 1)];
+
+        if (event->pressed) {
+            held[event->source] |= event->buttons;
+            // Remember presses so that a tap released before the sample still reaches the simulation
+            pressed |= event->buttons;
+            if (!sample.oldest_press) {
+                sample.oldest_press = event->timestamp;
+            }
+        } else {
+            held[event->source] &= ~event->buttons;
+        }
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue.head, (int)head);
+
+    for (size_t i = 0; i < NUM_INPUT_SOURCES; i++) {
+        sample.buttons |= held[i];
+    }
+    sample.buttons |= pressed;
+
+    return sample;
+}
+
+void input_release_source(const uint8_t source)
+{
+    // NOTE: consumer side only e.g. a controller was unplugged with buttons held down
+    held[source] = 0;
+}
+
+static int SDLCALL input_event_watch(void *userdata, SDL_Event *event)
+{
+    (void)userdata;
+
+    switch (event->type) {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP: {
+        uint8_t button = keyboard_button(event->key.keysym.scancode);
+        if (button && !event->key.repeat) {
+            queue_push(button, INPUT_SOURCE_KEYBOARD, event->type == SDL_KEYDOWN);
+        }
+    } break;
+
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP: {
+        uint8_t button = controller_button(event->cbutton.button);
+        if (button) {
+            queue_push(button, INPUT_SOURCE_CONTROLLER, event->type == SDL_CONTROLLERBUTTONDOWN);
+        }
+    } break;
+
+    case SDL_CONTROLLERAXISMOTION: {
+        controller_axis(event->caxis.axis, event->caxis.value);
+    } break;
+
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+static void queue_push(const uint8_t buttons, const uint8_t source, const bool pressed)
+{
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&queue.tail);
+    uint32_t head = (uint32_t)SDL_AtomicGet(&queue.head);
+
+    SDL_MemoryBarrierAcquire();
+
+    if (tail - head >= INPUT_QUEUE_SIZE) {
+        SDL_AtomicIncRef(&queue.dropped);
+        return;
+    }
+
+    input_event_t *event = &queue.events[tail & (INPUT_QUEUE_SIZE - 1)];
+    event->timestamp = SDL_GetPerformanceCounter();
+    event->buttons = buttons;
+    event->source = source;
+    event->pressed = pressed;
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue.tail, (int)(tail + 1));
+}
+
+static uint8_t keyboard_button(const SDL_Scancode scancode)
+{
+    switch (scancode) {
+    case SDL_SCANCODE_RIGHT:
+        return INPUT_RIGHT;
+    case SDL_SCANCODE_LEFT:
+        return INPUT_LEFT;
+    case SDL_SCANCODE_UP:
+        return INPUT_UP;
+    case SDL_SCANCODE_DOWN:
+        return INPUT_DOWN;
+    case SDL_SCANCODE_SPACE:
+        return INPUT_JUMP;
+    case SDL_SCANCODE_LCTRL:
+        return INPUT_FIRE;
+    case SDL_SCANCODE_LALT:
+        return INPUT_JETPACK;
+    default:
+        return 0;
+    }
+}
+
+static uint8_t controller_button(const uint8_t button)
+{
+    switch (button) {
+    case SDL_CONTROLLER_BUTTON_A:
+        return INPUT_JUMP;
+    case SDL_CONTROLLER_BUTTON_B:
+        return INPUT_FIRE;
+    case SDL_CONTROLLER_BUTTON_X:
+        return INPUT_JETPACK;
+    default:
+        return 0;
+    }
+}
+
+static void controller_axis(const uint8_t axis, const int16_t value)
+{
+    uint8_t negative, positive;
+
+    if (axis == SDL_CONTROLLER_AXIS_LEFTX) {
+        negative = INPUT_LEFT;
+        positive = INPUT_RIGHT;
+    } else if (axis == SDL_CONTROLLER_AXIS_LEFTY) {
+        negative = INPUT_UP;
+        positive = INPUT_DOWN;
+    } else {
+        return;
+    }
+
+    uint8_t buttons = 0;
+    if (value < -DEAD_ZONE) {
+        buttons = negative;
+    } else if (value > DEAD_ZONE) {
+        buttons = positive;
+    }
+
+    // Only queue the edges
+    uint8_t released = axis_buttons[axis] & ~buttons;
+    uint8_t pressed = buttons & ~axis_buttons[axis];
+    axis_buttons[axis] = buttons;
+
+    if (released) {
+        queue_push(released, INPUT_SOURCE_CONTROLLER, false);
+    }
+    if (pressed) {
+        queue_push(pressed, INPUT_SOURCE_CONTROLLER, true);
+    }
+}
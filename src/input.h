@@ -0,0 +1,40 @@
+#ifndef HH_INPUT_H
+#define HH_INPUT_H
+
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: must be a power of two
+#define INPUT_QUEUE_SIZE 256
+
+#define DEAD_ZONE 8000
+
+enum {
+    INPUT_SOURCE_KEYBOARD,
+    INPUT_SOURCE_CONTROLLER,
+    NUM_INPUT_SOURCES,
+};
+
+typedef struct {
+    // High-resolution time (SDL_GetPerformanceCounter) the event was queued by SDL
+    uint64_t timestamp;
+    uint8_t buttons;
+    uint8_t source;
+    bool pressed;
+} input_event_t;
+
+typedef struct {
+    // Buttons held right now, plus any pressed and released again since the last sample
+    uint8_t buttons;
+    // Timestamp of the oldest press consumed by this sample, 0 if there was none
+    uint64_t oldest_press;
+} input_sample_t;
+
+int input_init(void);
+void input_destroy(void);
+input_sample_t input_sample(void);
+void input_release_source(const uint8_t source);
+
+#endif // !HH_INPUT_H
@@ -3,21 +3,59 @@
 #include "error.h"
 #include "game.h"
 #include "log.h"
+#include <stdlib.h>
 #include <string.h>
 
 // TODO:(lukefilewalker) remove res dir from gitignore when new assets have been created!
 
 int main(int argc, char *argv[])
 {
-    bool debug = false;
-    if (argc > 1) {
-        if (strncmp(argv[1], "--debug", strlen("--debug")) == 0) {
+    game_options_t options = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--debug", strlen("--debug")) == 0) {
             log_visibility(LOG_DEBUG);
-            debug = true;
+            options.debug = true;
+        } else if (strncmp(argv[i], "--headless", strlen("--headless")) == 0) {
+            options.headless = true;
+        } else if (strncmp(argv[i], "--assert-no-alloc", strlen("--assert-no-alloc")) == 0) {
+            options.assert_no_alloc = true;
+        } else if (strncmp(argv[i], "--record", strlen("--record")) == 0 && i + 1 < argc) {
+            options.record_fname = argv[++i];
+        } else if (strncmp(argv[i], "--replay", strlen("--replay")) == 0 && i + 1 < argc) {
+            options.replay_fname = argv[++i];
+        } else if (strncmp(argv[i], "--net", strlen("--net")) == 0 && i + 1 < argc) {
+            options.net_address = argv[++i];
+        } else if (strncmp(argv[i], "--player", strlen("--player")) == 0 && i + 1 < argc) {
+            options.net_player = (uint8_t)atoi(argv[++i]);
+        } else if (strncmp(argv[i], "--feed", strlen("--feed")) == 0 && i + 1 < argc) {
+            options.feed_name = argv[++i];
+        } else if (strncmp(argv[i], "--audio-out", strlen("--audio-out")) == 0 && i + 1 < argc) {
+            options.audio_fname = argv[++i];
+        } else if (strncmp(argv[i], "--hot-reload", strlen("--hot-reload")) == 0) {
+            options.hot_reload = true;
+        } else if (strncmp(argv[i], "--perf-json", strlen("--perf-json")) == 0 && i + 1 < argc) {
+            options.perf = true;
+            options.perf_fname = argv[++i];
+        } else if (strncmp(argv[i], "--perf", strlen("--perf")) == 0) {
+            options.perf = true;
+        } else if (strncmp(argv[i], "--fullscreen", strlen("--fullscreen")) == 0) {
+            options.fullscreen = true;
+        } else if (strncmp(argv[i], "--post", strlen("--post")) == 0 && i + 1 < argc) {
+            options.post_filters = argv[++i];
+        } else if (strncmp(argv[i], "--ghosts", strlen("--ghosts")) == 0 && i + 1 < argc) {
+            options.ghosts_dir = argv[++i];
+        } else if (strncmp(argv[i], "--background-fps", strlen("--background-fps")) == 0 && i + 1 < argc) {
+            options.background_fps = (uint8_t)atoi(argv[++i]);
+        } else if (strncmp(argv[i], "--golden-update", strlen("--golden-update")) == 0 && i + 1 < argc) {
+            options.golden_dir = argv[++i];
+            options.golden_update = true;
+        } else if (strncmp(argv[i], "--golden", strlen("--golden")) == 0 && i + 1 < argc) {
+            options.golden_dir = argv[++i];
         }
     }
 
-    err_handle(game_init(debug));
+    err_handle(game_init(&options));
     err_handle(game_run());
     err_handle(game_destroy());
 
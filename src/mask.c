@@ -0,0 +1,114 @@
+#include "mask.h"
+#include "assets.h"
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include "sim.h"
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+// Sprites the simulation collides, and the size each is drawn at
+typedef struct {
+    uint8_t first;
+    uint8_t last;
+    uint8_t w;
+    uint8_t h;
+} sprite_range_t;
+
+static const sprite_range_t SPRITES[] = {
+    {TILE_FIRST_PLAYER, TILE_LAST_PLAYER, PLAYER_W, PLAYER_H},
+    {TILE_FIRST_ENEMY, TILE_LAST_ENEMY, PLAYER_W, PLAYER_H},
+    {TILE_ENEMY_BULLET_LEFT, TILE_PLAYER_BULLET_RIGHT, BULLET_W, BULLET_H},
+};
+
+static void from_surface(mask_t *mask, SDL_Surface *surface, const uint8_t w, const uint8_t h);
+
+int mask_load_sprites(mask_t *masks)
+{
+    LOG_INFO("mask_load_sprites", "building collision masks");
+
+    memset(masks, 0, sizeof(mask_t) * NUM_TILES);
+
+    for (size_t i = 0; i < sizeof(SPRITES) / sizeof(SPRITES[0]); i++) {
+        const sprite_range_t *range = &SPRITES[i];
+
+        for (uint16_t tile = range->first; tile <= range->last; tile++) {
+            SDL_Surface *surface;
+            int err = assets_decode_tile((uint8_t)tile, &surface);
+            if (err != SUCCESS) {
+                return err;
+            }
+
+            from_surface(&masks[tile], surface, range->w, range->h);
+            SDL_FreeSurface(surface);
+        }
+    }
+
+    return SUCCESS;
+}
+
+bool mask_update_sprite(mask_t *masks, const uint8_t tile, SDL_Surface *surface)
+{
+    for (size_t i = 0; i < sizeof(SPRITES) / sizeof(SPRITES[0]); i++) {
+        const sprite_range_t *range = &SPRITES[i];
+        if (tile >= range->first && tile <= range->last) {
+            memset(&masks[tile], 0, sizeof(mask_t));
+            from_surface(&masks[tile], surface, range->w, range->h);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Cheap box test first, then one AND per row the two share with one of them shifted into line with the other
+bool mask_overlap(const mask_t *a, const int32_t ax, const int32_t ay, const mask_t *b, const int32_t bx,
+                  const int32_t by)
+{
+    if (ax >= bx + b->w || bx >= ax + a->w || ay >= by + b->h || by >= ay + a->h) {
+        return false;
+    }
+
+    // NOTE: the boxes overlap, so the shift is always less than the width of a row
+    int32_t dx = bx - ax;
+    int32_t top = ay > by ? ay : by;
+    int32_t bottom = ay + a->h < by + b->h ? ay + a->h : by + b->h;
+
+    for (int32_t y = top; y < bottom; y++) {
+        uint64_t row_a = a->rows[y - ay], row_b = b->rows[y - by];
+        if (dx >= 0 ? row_a & row_b << dx : row_a << -dx & row_b) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Samples the tile the way SDL_RenderCopy() scales it into a w by h box. A pixel counts if it isn't the colour key, or
+// isn't black for tiles without one as that's what's behind them.
+static void from_surface(mask_t *mask, SDL_Surface *surface, const uint8_t w, const uint8_t h)
+{
+    uint32_t key = 0;
+    SDL_GetColorKey(surface, &key);
+
+    const uint8_t bpp = surface->format->BytesPerPixel;
+    mask->w = w;
+    mask->h = h;
+
+    for (uint8_t y = 0; y < h; y++) {
+        const uint8_t *row = (const uint8_t *)surface->pixels + (size_t)(y * surface->h / h) * surface->pitch;
+
+        for (uint8_t x = 0; x < w; x++) {
+            const uint8_t *pixel = row + (size_t)(x * surface->w / w) * bpp;
+            uint32_t value = 0;
+            for (uint8_t i = 0; i < bpp; i++) {
+                value |= (uint32_t)pixel[i] << (i * 8);
+            }
+
+            if (value != key) {
+                mask->rows[y] |= (uint64_t)1 << x;
+            }
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef HH_MASK_H
+#define HH_MASK_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MASK_MAX_H 16
+
+// Which pixels of a sprite are drawn, 1 bit each. Bit x of a row is pixel x from the left, so sprites up to 64 pixels
+// wide fit a row in one word.
+typedef struct {
+    uint8_t w;
+    uint8_t h;
+    uint64_t rows[MASK_MAX_H];
+} mask_t;
+
+// Builds the masks of every player, enemy and bullet frame at the size they're drawn, into an array of NUM_TILES
+int mask_load_sprites(mask_t *masks);
+// Builds tile's mask again from a new surface, false if it isn't a sprite the simulation collides
+bool mask_update_sprite(mask_t *masks, const uint8_t tile, SDL_Surface *surface);
+bool mask_overlap(const mask_t *a, const int32_t ax, const int32_t ay, const mask_t *b, const int32_t bx,
+                  const int32_t by);
+
+#endif // !HH_MASK_H
@@ -0,0 +1,222 @@
+#include "particles.h"
+#include "common.h"
+#include <string.h>
+
+#ifdef HH_SSE2
+#include <emmintrin.h>
+#endif
+
+// How a burst of particles looks
+typedef struct {
+    uint16_t count;
+    float min_speed;
+    float max_speed;
+    float gravity;
+    uint8_t min_life;
+    uint8_t max_life;
+    SDL_Color colours[3];
+} burst_t;
+
+static const burst_t EXPLOSION = {120, 0.5f, 3.0f, 0.15f, 15, 40, {{0xff, 0xd0, 0x40, 0xff}, {0xff, 0x70, 0x10, 0xff},
+                                                                    {0xc0, 0x20, 0x10, 0xff}}};
+static const burst_t MUZZLE_FLASH = {12, 1.5f, 4.0f, 0.0f, 3, 8, {{0xff, 0xff, 0xc0, 0xff}, {0xff, 0xe0, 0x60, 0xff},
+                                                                  {0xff, 0xff, 0xff, 0xff}}};
+static const burst_t SPARKLE = {30, 0.3f, 1.5f, -0.02f, 15, 30, {{0xff, 0xff, 0xff, 0xff}, {0x80, 0xe0, 0xff, 0xff},
+                                                                {0xff, 0xe0, 0x40, 0xff}}};
+static const burst_t EXHAUST = {4, 1.5f, 3.0f, 0.05f, 8, 14, {{0xff, 0xa0, 0x20, 0xff}, {0xe0, 0x60, 0x10, 0xff},
+                                                             {0x90, 0x90, 0x90, 0xff}}};
+
+static void handle_event(particles_t *particles, const game_event_t *event);
+static void burst(particles_t *particles, const burst_t *burst, const float x, const float y, const float dir_x,
+                  const float dir_y);
+static void integrate(particles_t *particles);
+static void collide(particles_t *particles, const game_state_t *game);
+static float random_between(particles_t *particles, const float min, const float max);
+
+void particles_init(particles_t *particles)
+{
+    memset(particles, 0, sizeof(particles_t));
+    particles->rng = 0x9e3779b9u;
+
+    // Live particles are kept packed at the front, so the first count quads are drawn and their indices are fixed
+    for (int i = 0; i < MAX_PARTICLES; i++) {
+        int *quad = &particles->indices[i * 6];
+        quad[0] = i * 4;
+        quad[1] = i * 4 + 1;
+        quad[2] = i * 4 + 2;
+        quad[3] = i * 4 + 2;
+        quad[4] = i * 4 + 3;
+        quad[5] = i * 4;
+    }
+}
+
+void particles_update(particles_t *particles, const game_state_t *game)
+{
+    game_event_t event;
+    while (event_pop(&particles->queue, &event)) {
+        handle_event(particles, &event);
+    }
+
+    for (size_t i = 0; i < game->num_players; i++) {
+        const player_t *player = &game->players[i];
+        if (player->using_jetpack && !player->dying) {
+            burst(particles, &EXHAUST, player->px + PLAYER_W / 2.0f, player->py + PLAYER_H, 0.0f, 1.0f);
+        }
+    }
+
+    integrate(particles);
+    collide(particles, game);
+}
+
+void particles_render(particles_t *particles, SDL_Renderer *renderer, const float left, const float top)
+{
+    if (!particles->count) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < particles->count; i++) {
+        float x = particles->x[i] + left, y = particles->y[i] + top;
+        SDL_Color colour = particles->colour[i];
+        // Fade out over the last few ticks
+        colour.a = particles->life[i] >= 8.0f ? 0xff : (uint8_t)(particles->life[i] * 32.0f);
+
+        SDL_Vertex *quad = &particles->vertices[i * 4];
+        quad[0] = (SDL_Vertex){{x, y}, colour, {0.0f, 0.0f}};
+        quad[1] = (SDL_Vertex){{x + 1.0f, y}, colour, {0.0f, 0.0f}};
+        quad[2] = (SDL_Vertex){{x + 1.0f, y + 1.0f}, colour, {0.0f, 0.0f}};
+        quad[3] = (SDL_Vertex){{x, y + 1.0f}, colour, {0.0f, 0.0f}};
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(renderer, NULL, particles->vertices, (int)particles->count * 4, particles->indices,
+                       (int)particles->count * 6);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
+
+static void handle_event(particles_t *particles, const game_event_t *event)
+{
+    // NOTE: events only know the tile things happened on, so bursts start from its middle
+    float x = event->x * TILE_SIZE + TILE_SIZE / 2.0f;
+    float y = event->y * TILE_SIZE + TILE_SIZE / 2.0f;
+
+    switch (event->type) {
+    case EVENT_PLAYER_DIED:
+    case EVENT_ENEMY_KILLED: {
+        burst(particles, &EXPLOSION, x, y, 0.0f, 0.0f);
+    } break;
+
+    case EVENT_PLAYER_FIRED: {
+        float dir = (int8_t)event->value < 0 ? -1.0f : 1.0f;
+        burst(particles, &MUZZLE_FLASH, x + dir * PLAYER_W / 2.0f, y, dir, 0.0f);
+    } break;
+
+    case EVENT_PICKUP: {
+        burst(particles, &SPARKLE, x, y, 0.0f, 0.0f);
+    } break;
+
+    default:
+        break;
+    }
+}
+
+// dir_x and dir_y point the burst somewhere, all zero sends it every which way
+static void burst(particles_t *particles, const burst_t *burst, const float x, const float y, const float dir_x,
+                  const float dir_y)
+{
+    for (uint16_t i = 0; i < burst->count; i++) {
+        if (particles->count == MAX_PARTICLES) {
+            particles->dropped += burst->count - i;
+            return;
+        }
+
+        uint32_t p = particles->count++;
+        float speed = random_between(particles, burst->min_speed, burst->max_speed);
+        float spread_x = random_between(particles, -1.0f, 1.0f), spread_y = random_between(particles, -1.0f, 1.0f);
+
+        particles->x[p] = x;
+        particles->y[p] = y;
+        // Mostly along the direction with some spread either side
+        particles->vx[p] = (dir_x + spread_x * (dir_x || dir_y ? 0.3f : 1.0f)) * speed;
+        particles->vy[p] = (dir_y + spread_y * (dir_x || dir_y ? 0.3f : 1.0f)) * speed;
+        particles->gravity[p] = burst->gravity;
+        particles->life[p] = random_between(particles, burst->min_life, burst->max_life);
+        particles->colour[p] = burst->colours[(uint32_t)random_between(particles, 0.0f, 2.99f)];
+    }
+}
+
+static void integrate(particles_t *particles)
+{
+    uint32_t i = 0;
+
+#ifdef HH_SSE2
+    // NOTE: the arrays are padded out to a multiple of 4, whatever is past the live ones is left alone when dropped
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i < particles->count; i += 4) {
+        __m128 vy = _mm_add_ps(_mm_load_ps(&particles->vy[i]), _mm_load_ps(&particles->gravity[i]));
+        _mm_store_ps(&particles->vy[i], vy);
+        _mm_store_ps(&particles->x[i], _mm_add_ps(_mm_load_ps(&particles->x[i]), _mm_load_ps(&particles->vx[i])));
+        _mm_store_ps(&particles->y[i], _mm_add_ps(_mm_load_ps(&particles->y[i]), vy));
+        _mm_store_ps(&particles->life[i], _mm_sub_ps(_mm_load_ps(&particles->life[i]), one));
+    }
+#endif
+
+    for (; i < particles->count; i++) {
+        particles->vy[i] += particles->gravity[i];
+        particles->x[i] += particles->vx[i];
+        particles->y[i] += particles->vy[i];
+        particles->life[i] -= 1.0f;
+    }
+}
+
+// Bounces particles off solid tiles, losing most of their speed, and removes the ones that have died or left the level
+static void collide(particles_t *particles, const game_state_t *game)
+{
+    const uint8_t *tiles = game->level->tiles;
+
+    for (uint32_t i = 0; i < particles->count;) {
+        float x = particles->x[i], y = particles->y[i];
+
+        if (particles->life[i] <= 0.0f || x < 0.0f || y < 0.0f || x >= LEVEL_W * TILE_SIZE ||
+            y >= LEVEL_H * TILE_SIZE) {
+            // Take the last one's place
+            uint32_t last = --particles->count;
+            particles->x[i] = particles->x[last];
+            particles->y[i] = particles->y[last];
+            particles->vx[i] = particles->vx[last];
+            particles->vy[i] = particles->vy[last];
+            particles->gravity[i] = particles->gravity[last];
+            particles->life[i] = particles->life[last];
+            particles->colour[i] = particles->colour[last];
+            continue;
+        }
+
+        if (sim_is_solid(tiles[(int)y / TILE_SIZE * LEVEL_W + (int)x / TILE_SIZE])) {
+            float old_x = x - particles->vx[i], old_y = y - particles->vy[i];
+
+            // Coming in from above or below if moving back up or down is enough to get out
+            if (old_y >= 0.0f && old_y < LEVEL_H * TILE_SIZE &&
+                !sim_is_solid(tiles[(int)old_y / TILE_SIZE * LEVEL_W + (int)x / TILE_SIZE])) {
+                particles->y[i] = old_y;
+                particles->vy[i] *= -0.4f;
+                particles->vx[i] *= 0.7f;
+            } else {
+                particles->x[i] = old_x;
+                particles->vx[i] *= -0.4f;
+            }
+        }
+
+        i++;
+    }
+}
+
+// xorshift, nothing here needs to be the same from run to run
+static float random_between(particles_t *particles, const float min, const float max)
+{
+    uint32_t x = particles->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    particles->rng = x;
+
+    return min + (max - min) * (float)(x >> 8) / (float)(1u << 24);
+}
@@ -0,0 +1,43 @@
+#ifndef HH_PARTICLES_H
+#define HH_PARTICLES_H
+
+#include "event.h"
+#include "sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: must be a multiple of 4, the update runs 4 particles at a time
+#define MAX_PARTICLES 16384
+
+// Explosions, muzzle flashes, jetpack exhaust and pickup sparkles. Purely for show: they're spawned from the events the
+// simulation emits and never feed back into it, so replays and netplay are unaffected.
+typedef struct {
+    // Live particles are kept packed at the front, a structure of arrays so the update can work on 4 at once. Position
+    // and velocity are in world pixels (per tick), life in ticks.
+    _Alignas(16) float x[MAX_PARTICLES];
+    _Alignas(16) float y[MAX_PARTICLES];
+    _Alignas(16) float vx[MAX_PARTICLES];
+    _Alignas(16) float vy[MAX_PARTICLES];
+    _Alignas(16) float gravity[MAX_PARTICLES];
+    _Alignas(16) float life[MAX_PARTICLES];
+    SDL_Color colour[MAX_PARTICLES];
+    uint32_t count;
+    // Not spawned for want of room
+    uint32_t dropped;
+    uint32_t rng;
+
+    event_queue_t queue;
+
+    // Everything is drawn with one call, two triangles per particle
+    SDL_Vertex vertices[MAX_PARTICLES * 4];
+    int indices[MAX_PARTICLES * 6];
+} particles_t;
+
+void particles_init(particles_t *particles);
+// Spawns whatever the events since the last frame call for and moves everything on a tick
+void particles_update(particles_t *particles, const game_state_t *game);
+// left and top are where the world's origin is on screen
+void particles_render(particles_t *particles, SDL_Renderer *renderer, const float left, const float top);
+
+#endif // !HH_PARTICLES_H
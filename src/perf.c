@@ -0,0 +1,322 @@
+// syscall() is neither POSIX nor C11, and perf_event_open() has no wrapper of its own
+#define _DEFAULT_SOURCE
+
+#include "perf.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *PERF_PHASE_NAMES[NUM_PERF_PHASES] = {"frame",  "sim",          "check_collisions", "move_enemies",
+                                                 "render", "render_world", "post"};
+static const char *COUNTER_NAMES[NUM_PERF_COUNTERS] = {"cycles", "instructions", "l1d_misses", "llc_misses",
+                                                       "branch_misses"};
+
+// Misses per 1000 instructions, so phases doing different amounts of work compare
+static const struct {
+    uint8_t counter;
+    const char *name;
+    const char *key;
+} MISS_RATES[] = {
+    {PERF_L1D_MISSES, "L1D", "l1d_mpki"},
+    {PERF_LLC_MISSES, "LLC", "llc_mpki"},
+    {PERF_BRANCH_MISSES, "branch", "branch_mpki"},
+};
+#define NUM_MISS_RATES (sizeof(MISS_RATES) / sizeof(MISS_RATES[0]))
+
+static perf_stats_t stats;
+static bool enabled;
+// Counts when each phase began
+static uint64_t begun[NUM_PERF_PHASES][NUM_PERF_COUNTERS];
+
+static bool read_counters(uint64_t *counts);
+static void write_json_counts(FILE *fd, const perf_counts_t *counts);
+
+#ifdef __linux__
+
+// One group so a phase costs a single read() at each end, and all the counters cover exactly the same instructions
+static int fds[NUM_PERF_COUNTERS];
+// Which counter each value a group read returns is, in the order they joined
+static uint8_t order[NUM_PERF_COUNTERS];
+static uint8_t num_open;
+static char open_error[64];
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} EVENTS[NUM_PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+bool perf_open(void)
+{
+    LOG_INFO("perf_open", "opening hardware performance counters");
+
+    memset(&stats, 0, sizeof(perf_stats_t));
+    num_open = 0;
+
+    for (uint8_t i = 0; i < NUM_PERF_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = EVENTS[i].type;
+        attr.config = EVENTS[i].config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // NOTE: user space only, which most kernels allow without privileges
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        int leader = num_open ? fds[0] : -1;
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd < 0) {
+            // e.g. ENOENT for an event this CPU doesn't have, EACCES or ENOSYS where counters are off limits
+            snprintf(open_error, sizeof(open_error), "%s", strerror(errno));
+            LOG_INFO("perf_open", "%s unavailable: %s", COUNTER_NAMES[i], open_error);
+            continue;
+        }
+
+        fds[num_open] = fd;
+        order[num_open++] = i;
+        stats.available[i] = true;
+    }
+
+    enabled = num_open > 0;
+    if (!enabled) {
+        stats.unavailable = open_error;
+    }
+
+    return enabled;
+}
+
+void perf_close(void)
+{
+    // Members go before the leader
+    for (uint8_t i = num_open; i > 0; i--) {
+        close(fds[i - 1]);
+    }
+    num_open = 0;
+    enabled = false;
+}
+
+static bool read_counters(uint64_t *counts)
+{
+    // nr, time enabled, time running, then a value per member
+    uint64_t values[3 + NUM_PERF_COUNTERS];
+
+    if (read(fds[0], values, sizeof(values)) < (ssize_t)(3 * sizeof(uint64_t)) || values[0] != num_open) {
+        return false;
+    }
+
+    uint64_t time_enabled = values[1], time_running = values[2];
+    if (!time_running) {
+        return false;
+    }
+    if (time_running < time_enabled) {
+        stats.multiplexed++;
+    }
+
+    for (uint8_t i = 0; i < num_open; i++) {
+        uint64_t value = values[3 + i];
+        // Estimate for the whole time when the counters had to take turns
+        counts[order[i]] =
+            time_running < time_enabled ? (uint64_t)((double)value * time_enabled / time_running) : value;
+    }
+
+    return true;
+}
+
+#else
+
+bool perf_open(void)
+{
+    memset(&stats, 0, sizeof(perf_stats_t));
+    stats.unavailable = "performance counters aren't supported on this platform yet";
+    return false;
+}
+
+void perf_close(void) {}
+
+static bool read_counters(uint64_t *counts)
+{
+    (void)counts;
+    return false;
+}
+
+#endif
+
+bool perf_enabled(void) { return enabled; }
+
+void perf_begin(const uint8_t phase)
+{
+    if (!enabled) {
+        return;
+    }
+
+    // A failed read leaves nothing to count from, rather than the counts of some earlier call
+    if (!read_counters(begun[phase])) {
+        memset(begun[phase], 0xff, sizeof(begun[phase]));
+    }
+}
+
+void perf_end(const uint8_t phase)
+{
+    if (!enabled) {
+        return;
+    }
+
+    uint64_t counts[NUM_PERF_COUNTERS] = {0};
+    if (!read_counters(counts)) {
+        return;
+    }
+
+    perf_counts_t *cur = &stats.cur_frame[phase];
+    for (uint8_t i = 0; i < NUM_PERF_COUNTERS; i++) {
+        // NOTE: scaled estimates can go backwards a little
+        cur->counts[i] += counts[i] > begun[phase][i] ? counts[i] - begun[phase][i] : 0;
+    }
+    cur->calls++;
+}
+
+void perf_frame_end(void)
+{
+    if (!enabled) {
+        return;
+    }
+
+    for (uint8_t phase = 0; phase < NUM_PERF_PHASES; phase++) {
+        for (uint8_t i = 0; i < NUM_PERF_COUNTERS; i++) {
+            stats.total[phase].counts[i] += stats.cur_frame[phase].counts[i];
+        }
+        stats.total[phase].calls += stats.cur_frame[phase].calls;
+    }
+
+    memcpy(stats.frame, stats.cur_frame, sizeof(stats.frame));
+    memset(stats.cur_frame, 0, sizeof(stats.cur_frame));
+    stats.frames++;
+}
+
+const perf_stats_t *perf_stats(void) { return &stats; }
+
+void perf_format(const perf_counts_t *counts, char *buf, const size_t size)
+{
+    double instructions = (double)counts->counts[PERF_INSTRUCTIONS];
+    int len = 0;
+
+    if (stats.available[PERF_CYCLES] && stats.available[PERF_INSTRUCTIONS] && counts->counts[PERF_CYCLES]) {
+        len = snprintf(buf, size, "IPC %.2f", instructions / (double)counts->counts[PERF_CYCLES]);
+    } else {
+        len = snprintf(buf, size, "IPC -");
+    }
+
+    for (size_t i = 0; i < NUM_MISS_RATES && len > 0 && (size_t)len < size; i++) {
+        if (stats.available[MISS_RATES[i].counter] && instructions > 0) {
+            len += snprintf(buf + len, size - len, ", %s %.1f", MISS_RATES[i].name,
+                            counts->counts[MISS_RATES[i].counter] * 1000.0 / instructions);
+        } else {
+            len += snprintf(buf + len, size - len, ", %s -", MISS_RATES[i].name);
+        }
+    }
+
+    if (len > 0 && (size_t)len < size) {
+        snprintf(buf + len, size - len, " MPKI");
+    }
+}
+
+void perf_report(void)
+{
+    if (stats.unavailable) {
+        printf("perf counters: unavailable (%s)\n", stats.unavailable);
+        return;
+    }
+
+    printf("perf counters over %u frames%s:\n", stats.frames,
+           stats.multiplexed ? ", some scaled up from sharing the hardware" : "");
+
+    for (uint8_t phase = 0; phase < NUM_PERF_PHASES; phase++) {
+        const perf_counts_t *total = &stats.total[phase];
+        if (!total->calls) {
+            continue;
+        }
+
+        char rates[128];
+        perf_format(total, rates, sizeof(rates));
+        printf("  %-16s %8u calls, %12.0f cycles/call, %12.0f instructions/call, %s\n", PERF_PHASE_NAMES[phase],
+               total->calls, (double)total->counts[PERF_CYCLES] / total->calls,
+               (double)total->counts[PERF_INSTRUCTIONS] / total->calls, rates);
+    }
+}
+
+// Totals and the rates made from them for every phase, for benchmarks to compare between runs
+int perf_write_json(const char *fname)
+{
+    FILE *fd = fopen(fname, "w");
+    if (!fd) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    fprintf(fd, "{\n  \"frames\": %u,\n  \"multiplexed_reads\": %u,\n", stats.frames, stats.multiplexed);
+    if (stats.unavailable) {
+        fprintf(fd, "  \"unavailable\": \"%s\",\n", stats.unavailable);
+    }
+    fprintf(fd, "  \"available\": {");
+    for (uint8_t i = 0; i < NUM_PERF_COUNTERS; i++) {
+        fprintf(fd, "%s\"%s\": %s", i ? ", " : "", COUNTER_NAMES[i], stats.available[i] ? "true" : "false");
+    }
+    fprintf(fd, "},\n  \"phases\": {");
+
+    for (uint8_t phase = 0; phase < NUM_PERF_PHASES; phase++) {
+        fprintf(fd, "%s\n    \"%s\": ", phase ? "," : "", PERF_PHASE_NAMES[phase]);
+        write_json_counts(fd, &stats.total[phase]);
+    }
+    fprintf(fd, "\n  }\n}\n");
+
+    if (fclose(fd) != 0) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    return SUCCESS;
+}
+
+// Counters that aren't available are null rather than 0, which would look like a measurement
+static void write_json_counts(FILE *fd, const perf_counts_t *counts)
+{
+    double cycles = (double)counts->counts[PERF_CYCLES];
+    double instructions = (double)counts->counts[PERF_INSTRUCTIONS];
+
+    fprintf(fd, "{\"calls\": %u", counts->calls);
+    for (uint8_t i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (stats.available[i]) {
+            fprintf(fd, ", \"%s\": %llu", COUNTER_NAMES[i], (unsigned long long)counts->counts[i]);
+        } else {
+            fprintf(fd, ", \"%s\": null", COUNTER_NAMES[i]);
+        }
+    }
+
+    if (stats.available[PERF_CYCLES] && stats.available[PERF_INSTRUCTIONS] && cycles > 0) {
+        fprintf(fd, ", \"ipc\": %.3f", instructions / cycles);
+    } else {
+        fprintf(fd, ", \"ipc\": null");
+    }
+
+    for (size_t i = 0; i < NUM_MISS_RATES; i++) {
+        if (stats.available[MISS_RATES[i].counter] && instructions > 0) {
+            fprintf(fd, ", \"%s\": %.3f", MISS_RATES[i].key,
+                    counts->counts[MISS_RATES[i].counter] * 1000.0 / instructions);
+        } else {
+            fprintf(fd, ", \"%s\": null", MISS_RATES[i].key);
+        }
+    }
+    fprintf(fd, "}");
+}
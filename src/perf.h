@@ -0,0 +1,69 @@
+#ifndef HH_PERF_H
+#define HH_PERF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    NUM_PERF_COUNTERS,
+};
+
+// Parts of a frame the counters are read around. NOTE: phases nest, e.g. the simulation is part of the frame.
+enum {
+    PERF_FRAME,
+    PERF_SIM,
+    PERF_COLLISIONS,
+    PERF_ENEMIES,
+    PERF_RENDER,
+    PERF_RENDER_WORLD,
+    // NOTE: only the main thread's band of the filtering is counted
+    PERF_POST,
+    NUM_PERF_PHASES,
+};
+
+typedef struct {
+    uint64_t counts[NUM_PERF_COUNTERS];
+    uint32_t calls;
+} perf_counts_t;
+
+typedef struct {
+    // The last completed frame and the current one
+    perf_counts_t frame[NUM_PERF_PHASES];
+    perf_counts_t cur_frame[NUM_PERF_PHASES];
+    perf_counts_t total[NUM_PERF_PHASES];
+    uint32_t frames;
+
+    // Counters this machine has, the others stay at 0. NOTE: containers and VMs often have none at all.
+    bool available[NUM_PERF_COUNTERS];
+    // Why no counter could be opened
+    const char *unavailable;
+    // Reads where the kernel had to share the hardware with other events, scaled up from the time they ran
+    uint32_t multiplexed;
+} perf_stats_t;
+
+extern const char *PERF_PHASE_NAMES[NUM_PERF_PHASES];
+
+// Opens what counters it can for the calling thread. The game carries on without them, so failing isn't an error.
+// NOTE: counts the thread that opened them only, begin and end phases from the main thread
+bool perf_open(void);
+void perf_close(void);
+bool perf_enabled(void);
+
+// Cheap no-ops until perf_open() manages to open a counter
+void perf_begin(const uint8_t phase);
+void perf_end(const uint8_t phase);
+void perf_frame_end(void);
+
+const perf_stats_t *perf_stats(void);
+// IPC and misses per 1000 instructions of some counts, e.g. "IPC 1.85, L1D 12.3, LLC 0.4, branch 2.1 MPKI"
+void perf_format(const perf_counts_t *counts, char *buf, const size_t size);
+void perf_report(void);
+int perf_write_json(const char *fname);
+
+#endif // !HH_PERF_H
@@ -0,0 +1,770 @@
+#include "post.h"
+#include "alloc.h"
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HH_SSE2
+#include <emmintrin.h>
+#endif
+
+// NOTE: GCC and Clang build the AVX2 kernels whatever the target and pick them at run time, MSVC only has them when
+// building for AVX2 with /arch:AVX2
+#if defined(HH_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define POST_AVX2
+#define POST_TARGET_AVX2 __attribute__((target("avx2")))
+#define POST_HAS_AVX2() __builtin_cpu_supports("avx2")
+#include <immintrin.h>
+#elif defined(HH_SSE2) && defined(__AVX2__)
+#define POST_AVX2
+#define POST_TARGET_AVX2
+#define POST_HAS_AVX2() true
+#include <immintrin.h>
+#endif
+
+// Pixels with a channel at least this bright glow, at BLOOM_STRENGTH / 256 of their colour spread over a 5x5 box
+#define BLOOM_THRESHOLD 0xa0
+#define BLOOM_STRENGTH 160
+#define BLOOM_RADIUS 2
+// How bright the dark part of a scanline is, out of 256
+#define SCANLINE_LEVEL 150
+// How far the corners are pushed out, as a fraction of the picture
+#define CRT_CURVATURE 0.08f
+#define BLACK 0xff000000u
+
+const char *POST_FILTER_NAMES[NUM_POST_FILTERS] = {"scale2x", "bloom", "scanlines", "crt"};
+
+// A row at a time, so the work can be split into bands however suits
+typedef struct {
+    const char *isa;
+    // Scale2x's top left and top right pixels for every pixel of row. Swap above and below for the bottom two.
+    void (*epx)(const uint32_t *above, const uint32_t *row, const uint32_t *below, const int width, uint32_t *left,
+                uint32_t *right);
+    // Adds the colours of src to dst, saturating each channel
+    void (*add)(uint32_t *dst, const uint32_t *src, const int n);
+    // Scales each channel by level / 256
+    void (*shade)(uint32_t *row, const int n, const uint16_t level);
+    // dst[i] = src[map[i]], black where map[i] is -1
+    void (*remap)(uint32_t *dst, const uint32_t *src, const int32_t *map, const int n);
+} kernels_t;
+
+static bool enabled;
+static kernels_t kernels;
+static post_stats_t stats;
+
+// The filters after the upscale. Everything but the CRT works on a pixel at a time, so a stage is the upscale or a
+// CRT followed by the filters up to the next CRT, run a row at a time while the row is still in the cache.
+static bool scale2x;
+static bool bloom;
+static uint8_t chain[POST_MAX_FILTERS];
+static uint8_t chain_len;
+// NOTE: the upscale's stage, one for each CRT and the end of the last, so a chain of nothing but CRTs needs two more
+static uint8_t stage_starts[POST_MAX_FILTERS + 2];
+static uint8_t num_stages;
+
+// The frame as it's drawn, and its glow
+static int src_w, src_h;
+static uint32_t *frame;
+static uint32_t *glow;
+static uint32_t *glow_rows;
+// Each column's red, green and blue sums while blurring down
+static uint32_t *glow_sums;
+
+// The frame scaled up. Only a CRT needs a whole picture to read from, the last stage writes straight to the texture.
+static int scale, out_w, out_h;
+static uint32_t *buffers[2];
+static int32_t *crt_map;
+static SDL_Texture *texture;
+
+// What the stage being run reads and writes, pitch in pixels
+static uint8_t stage;
+static const uint32_t *stage_src;
+static uint32_t *stage_dst;
+static int stage_pitch;
+
+// Each band's own working space: Scale2x's pixels for a row of the frame, then the row being filtered, the last
+// upscaled row and the last row of glow scaled up, as consecutive rows often share those
+static uint32_t *pairs[POST_MAX_THREADS];
+static uint32_t *rows[POST_MAX_THREADS];
+
+// Band 0 runs on the calling thread, the rest are woken for each stage and signal done when their band is finished
+static SDL_Thread *workers[POST_MAX_THREADS];
+static SDL_sem *wake[POST_MAX_THREADS];
+static SDL_sem *done;
+static SDL_atomic_t stop;
+
+static void epx_pixels(const uint32_t *above, const uint32_t *row, const uint32_t *below, const int width,
+                       uint32_t *left, uint32_t *right, const int x0, const int x1);
+#ifndef HH_SSE2
+static void epx_scalar(const uint32_t *above, const uint32_t *row, const uint32_t *below, const int width,
+                       uint32_t *left, uint32_t *right);
+#endif
+static void add_scalar(uint32_t *dst, const uint32_t *src, const int n);
+static void shade_scalar(uint32_t *row, const int n, const uint16_t level);
+static void remap_scalar(uint32_t *dst, const uint32_t *src, const int32_t *map, const int n);
+static kernels_t pick_kernels(void);
+
+static int start_workers(void);
+static int worker_run(void *data);
+static void run_stage(void);
+static void stage_band(const uint8_t band);
+
+static void build_glow(void);
+static void blur_row(const uint32_t *in, uint32_t *out);
+static void blur_columns(void);
+static void build_crt_map(void);
+static void upscale_row(const uint8_t band, const int y, uint32_t *out, int *upscaled_row);
+static void free_output(void);
+
+int post_init(const char *filters, const int width, const int height)
+{
+    LOG_INFO("post_init", "setting up post-processing: %s", filters);
+
+    memset(&stats, 0, sizeof(post_stats_t));
+    scale2x = bloom = false;
+    chain_len = 0;
+    num_stages = 1;
+    stage_starts[0] = 0;
+
+    const char *name = filters;
+    while (*name) {
+        size_t len = strcspn(name, ",");
+        uint8_t filter = len ? NUM_POST_FILTERS : POST_SCALE2X;
+        for (uint8_t i = 0; i < NUM_POST_FILTERS && len; i++) {
+            if (strlen(POST_FILTER_NAMES[i]) == len && strncmp(name, POST_FILTER_NAMES[i], len) == 0) {
+                filter = i;
+            }
+        }
+        if (filter == NUM_POST_FILTERS) {
+            char unknown[64];
+            snprintf(unknown, sizeof(unknown), "unknown filter %.*s", (int)len, name);
+            return err_fatal(ERR_POST, unknown);
+        }
+
+        // NOTE: the upscaler is part of the first stage wherever it's listed
+        if (filter == POST_SCALE2X) {
+            scale2x |= len > 0;
+        } else if (chain_len < POST_MAX_FILTERS) {
+            if (filter == POST_CRT) {
+                stage_starts[num_stages++] = chain_len;
+            }
+            bloom |= filter == POST_BLOOM;
+            chain[chain_len++] = filter;
+        }
+
+        name += len;
+        if (*name == ',') {
+            name++;
+        }
+    }
+    stage_starts[num_stages] = chain_len;
+
+    src_w = width;
+    src_h = height;
+    frame = HH_MALLOC((size_t)width * height * sizeof(uint32_t));
+    glow = HH_MALLOC((size_t)width * height * sizeof(uint32_t));
+    glow_rows = HH_MALLOC((size_t)width * height * sizeof(uint32_t));
+    glow_sums = HH_MALLOC((size_t)width * 3 * sizeof(uint32_t));
+    if (!frame || !glow || !glow_rows || !glow_sums) {
+        return err_fatal(ERR_ALLOC, "post-processing frame");
+    }
+
+    kernels = pick_kernels();
+    stats.isa = kernels.isa;
+
+    int cpus = SDL_GetCPUCount();
+    stats.threads = cpus < 1 ? 1 : cpus > POST_MAX_THREADS ? POST_MAX_THREADS : (uint8_t)cpus;
+    for (uint8_t i = 0; i < stats.threads; i++) {
+        pairs[i] = HH_MALLOC((size_t)width * 2 * sizeof(uint32_t));
+        if (!pairs[i]) {
+            return err_fatal(ERR_ALLOC, "post-processing rows");
+        }
+    }
+
+    int err = start_workers();
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    LOG_INFO("post_init", "%u filters in %u stages after %s upscaling, %s kernels on %u threads", chain_len,
+             num_stages, scale2x ? "scale2x" : "nearest", stats.isa, stats.threads);
+    enabled = true;
+
+    return SUCCESS;
+}
+
+static int start_workers(void)
+{
+    SDL_AtomicSet(&stop, 0);
+
+    done = SDL_CreateSemaphore(0);
+    if (!done) {
+        return err_fatal(ERR_POST, SDL_GetError());
+    }
+
+    for (uint8_t i = 1; i < stats.threads; i++) {
+        wake[i] = SDL_CreateSemaphore(0);
+        if (!wake[i]) {
+            return err_fatal(ERR_POST, SDL_GetError());
+        }
+        workers[i] = SDL_CreateThread(worker_run, "post-processing", (void *)(uintptr_t)i);
+        if (!workers[i]) {
+            return err_fatal(ERR_POST, SDL_GetError());
+        }
+    }
+
+    return SUCCESS;
+}
+
+void post_destroy(void)
+{
+    SDL_AtomicSet(&stop, 1);
+    for (uint8_t i = 1; i < POST_MAX_THREADS; i++) {
+        if (workers[i]) {
+            SDL_SemPost(wake[i]);
+            SDL_WaitThread(workers[i], NULL);
+            workers[i] = NULL;
+        }
+        if (wake[i]) {
+            SDL_DestroySemaphore(wake[i]);
+            wake[i] = NULL;
+        }
+    }
+    if (done) {
+        SDL_DestroySemaphore(done);
+        done = NULL;
+    }
+
+    free_output();
+    for (uint8_t i = 0; i < POST_MAX_THREADS; i++) {
+        HH_FREE(pairs[i]);
+        pairs[i] = NULL;
+    }
+    HH_FREE(frame);
+    HH_FREE(glow);
+    HH_FREE(glow_rows);
+    HH_FREE(glow_sums);
+    frame = glow = glow_rows = glow_sums = NULL;
+    enabled = false;
+}
+
+bool post_enabled(void) { return enabled; }
+
+const post_stats_t *post_stats(void) { return &stats; }
+
+int post_resize(SDL_Renderer *renderer, const int new_scale)
+{
+    int s = new_scale < 1 ? 1 : new_scale;
+    if (texture && s == scale) {
+        return SUCCESS;
+    }
+
+    free_output();
+    scale = s;
+    out_w = src_w * scale;
+    out_h = src_h * scale;
+    size_t pixels = (size_t)out_w * out_h;
+
+    LOG_INFO("post_resize", "filtering at %dx%d", out_w, out_h);
+
+    // Stages before the last write to these in turn
+    for (uint8_t i = 0; i + 1 < num_stages && i < 2; i++) {
+        buffers[i] = HH_MALLOC(pixels * sizeof(uint32_t));
+        if (!buffers[i]) {
+            return err_fatal(ERR_ALLOC, "post-processing buffers");
+        }
+    }
+
+    for (uint8_t i = 0; i < stats.threads; i++) {
+        rows[i] = HH_MALLOC((size_t)out_w * 3 * sizeof(uint32_t));
+        if (!rows[i]) {
+            return err_fatal(ERR_ALLOC, "post-processing rows");
+        }
+    }
+
+    if (num_stages > 1) {
+        crt_map = HH_MALLOC(pixels * sizeof(int32_t));
+        if (!crt_map) {
+            return err_fatal(ERR_ALLOC, "post-processing CRT map");
+        }
+        build_crt_map();
+    }
+
+    texture = HH_CREATE_TEXTURE(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, out_w, out_h);
+    if (!texture) {
+        return err_fatal(ERR_POST, SDL_GetError());
+    }
+
+    return SUCCESS;
+}
+
+static void free_output(void)
+{
+    HH_DESTROY_TEXTURE(texture);
+    texture = NULL;
+    HH_FREE(buffers[0]);
+    HH_FREE(buffers[1]);
+    buffers[0] = buffers[1] = NULL;
+    HH_FREE(crt_map);
+    crt_map = NULL;
+    for (uint8_t i = 0; i < POST_MAX_THREADS; i++) {
+        HH_FREE(rows[i]);
+        rows[i] = NULL;
+    }
+}
+
+SDL_Texture *post_process(SDL_Renderer *renderer)
+{
+    if (!texture) {
+        return NULL;
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    // NOTE: waits for the renderer to finish drawing the frame, which can be most of what post-processing costs
+    if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, frame, src_w * (int)sizeof(uint32_t)) != 0) {
+        return NULL;
+    }
+
+    if (bloom) {
+        build_glow();
+    }
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, NULL, &pixels, &pitch) != 0) {
+        return NULL;
+    }
+
+    for (stage = 0; stage < num_stages; stage++) {
+        stage_src = stage ? buffers[(stage - 1) % 2] : frame;
+        if (stage + 1 == num_stages) {
+            stage_dst = pixels;
+            stage_pitch = pitch / (int)sizeof(uint32_t);
+        } else {
+            stage_dst = buffers[stage % 2];
+            stage_pitch = out_w;
+        }
+        run_stage();
+    }
+
+    SDL_UnlockTexture(texture);
+
+    float ms = (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    stats.last_ms = ms;
+    if (ms > stats.max_ms) {
+        stats.max_ms = ms;
+    }
+    stats.frames++;
+    stats.avg_ms += (ms - stats.avg_ms) / stats.frames;
+
+    return texture;
+}
+
+static void run_stage(void)
+{
+    // NOTE: the semaphores order the writes either side of them, so each stage sees everything the last one wrote
+    for (uint8_t i = 1; i < stats.threads; i++) {
+        SDL_SemPost(wake[i]);
+    }
+    stage_band(0);
+    for (uint8_t i = 1; i < stats.threads; i++) {
+        SDL_SemWait(done);
+    }
+}
+
+static int worker_run(void *data)
+{
+    uint8_t band = (uint8_t)(uintptr_t)data;
+
+    for (;;) {
+        SDL_SemWait(wake[band]);
+        if (SDL_AtomicGet(&stop)) {
+            return 0;
+        }
+        stage_band(band);
+        SDL_SemPost(done);
+    }
+}
+
+static void stage_band(const uint8_t band)
+{
+    uint32_t *row = rows[band], *upscaled = row + out_w, *glow_row = upscaled + out_w;
+    int y0 = out_h * band / stats.threads, y1 = out_h * (band + 1) / stats.threads;
+    uint8_t first = stage_starts[stage], last = stage_starts[stage + 1];
+    // The bottom third of each scaled up row, at least a line of it, and nothing until there's more than one line
+    int dark = scale < 2 ? 0 : scale < 3 ? 1 : scale / 3;
+    int upscaled_row = -1, glow_y = -1;
+
+    for (int y = y0; y < y1; y++) {
+        const uint32_t *out = row;
+        if (stage == 0) {
+            upscale_row(band, y, upscaled, &upscaled_row);
+            if (first == last) {
+                out = upscaled;
+            } else {
+                memcpy(row, upscaled, (size_t)out_w * sizeof(uint32_t));
+            }
+        } else {
+            // Stages after the first start with their CRT
+            kernels.remap(row, stage_src, crt_map + (size_t)y * out_w, out_w);
+            first = stage_starts[stage] + 1;
+        }
+
+        for (uint8_t i = first; i < last; i++) {
+            switch (chain[i]) {
+            case POST_BLOOM: {
+                // The glow is worked out at the frame's size, where it's cheap, and scaled up as it's added
+                if (y / scale != glow_y) {
+                    glow_y = y / scale;
+                    const uint32_t *from = glow + (size_t)glow_y * src_w;
+                    for (int x = 0; x < src_w; x++) {
+                        for (int j = 0; j < scale; j++) {
+                            glow_row[x * scale + j] = from[x];
+                        }
+                    }
+                }
+                kernels.add(row, glow_row, out_w);
+            } break;
+
+            case POST_SCANLINES: {
+                if (y % scale >= scale - dark) {
+                    kernels.shade(row, out_w, SCANLINE_LEVEL);
+                }
+            } break;
+
+            default:
+                break;
+            }
+        }
+
+        memcpy(stage_dst + (size_t)y * stage_pitch, out, (size_t)out_w * sizeof(uint32_t));
+    }
+}
+
+// Scales a row of the frame up, each pixel becoming a scale x scale block. With Scale2x the block's quarters take the
+// colour of the neighbours either side of them when those match, and an odd scale's middle row and column keep the
+// pixel's own.
+static void upscale_row(const uint8_t band, const int y, uint32_t *out, int *upscaled_row)
+{
+    int half = scale / 2, mid = scale - 2 * half;
+    int sy = y / scale, sub = y % scale;
+    // 0 the top half of the block, 1 the middle, 2 the bottom
+    int part = sub < half ? 0 : sub >= scale - half ? 2 : 1;
+
+    // Rows of the same part of a block are the same, so out is left as it was
+    if (*upscaled_row == sy * 3 + part) {
+        return;
+    }
+    *upscaled_row = sy * 3 + part;
+
+    const uint32_t *row = frame + (size_t)sy * src_w;
+    const uint32_t *above = sy > 0 ? row - src_w : row;
+    const uint32_t *below = sy + 1 < src_h ? row + src_w : row;
+    const uint32_t *l = row, *r = row;
+    uint32_t *left = pairs[band], *right = pairs[band] + src_w;
+    if (scale2x && part == 0) {
+        kernels.epx(above, row, below, src_w, left, right);
+        l = left, r = right;
+    } else if (scale2x && part == 2) {
+        kernels.epx(below, row, above, src_w, left, right);
+        l = left, r = right;
+    }
+
+    for (int x = 0; x < src_w; x++) {
+        uint32_t *block = out + x * scale;
+        for (int i = 0; i < half; i++) {
+            block[i] = l[x];
+            block[half + mid + i] = r[x];
+        }
+        for (int i = 0; i < mid; i++) {
+            block[half + i] = row[x];
+        }
+    }
+}
+
+static void build_glow(void)
+{
+    // Bright pass into glow, blur across into glow_rows, then blur down back into glow
+    for (size_t i = 0; i < (size_t)src_w * src_h; i++) {
+        uint32_t px = frame[i];
+        bool bright = ((px >> 16) & 0xff) >= BLOOM_THRESHOLD || ((px >> 8) & 0xff) >= BLOOM_THRESHOLD ||
+                      (px & 0xff) >= BLOOM_THRESHOLD;
+        // NOTE: alpha stays 0 so adding the glow leaves it alone
+        glow[i] = bright ? px & ~BLACK : 0;
+    }
+
+    for (int y = 0; y < src_h; y++) {
+        blur_row(glow + (size_t)y * src_w, glow_rows + (size_t)y * src_w);
+    }
+    blur_columns();
+}
+
+// Box blurs with a running sum over the window, repeating the pixels at the ends
+static void blur_row(const uint32_t *in, uint32_t *out)
+{
+    uint32_t r = 0, g = 0, b = 0;
+
+    for (int x = -BLOOM_RADIUS; x <= BLOOM_RADIUS; x++) {
+        uint32_t px = in[x < 0 ? 0 : x >= src_w ? src_w - 1 : x];
+        r += (px >> 16) & 0xff, g += (px >> 8) & 0xff, b += px & 0xff;
+    }
+
+    for (int x = 0; x < src_w; x++) {
+        out[x] = r / (2 * BLOOM_RADIUS + 1) << 16 | g / (2 * BLOOM_RADIUS + 1) << 8 | b / (2 * BLOOM_RADIUS + 1);
+
+        int next = x + BLOOM_RADIUS + 1, prev = x - BLOOM_RADIUS;
+        uint32_t add = in[next >= src_w ? src_w - 1 : next], sub = in[prev < 0 ? 0 : prev];
+        r += ((add >> 16) & 0xff) - ((sub >> 16) & 0xff);
+        g += ((add >> 8) & 0xff) - ((sub >> 8) & 0xff);
+        b += (add & 0xff) - (sub & 0xff);
+    }
+}
+
+// The same down every column of glow_rows into glow, a row at a time so it reads through memory in order, and at
+// BLOOM_STRENGTH
+static void blur_columns(void)
+{
+    uint32_t *r = glow_sums, *g = glow_sums + src_w, *b = glow_sums + 2 * src_w;
+    memset(glow_sums, 0, (size_t)src_w * 3 * sizeof(uint32_t));
+
+    for (int y = -BLOOM_RADIUS; y <= BLOOM_RADIUS; y++) {
+        const uint32_t *row = glow_rows + (size_t)(y < 0 ? 0 : y >= src_h ? src_h - 1 : y) * src_w;
+        for (int x = 0; x < src_w; x++) {
+            r[x] += (row[x] >> 16) & 0xff, g[x] += (row[x] >> 8) & 0xff, b[x] += row[x] & 0xff;
+        }
+    }
+
+    for (int y = 0; y < src_h; y++) {
+        int next = y + BLOOM_RADIUS + 1, prev = y - BLOOM_RADIUS;
+        const uint32_t *add = glow_rows + (size_t)(next >= src_h ? src_h - 1 : next) * src_w;
+        const uint32_t *sub = glow_rows + (size_t)(prev < 0 ? 0 : prev) * src_w;
+        uint32_t *out = glow + (size_t)y * src_w;
+
+        for (int x = 0; x < src_w; x++) {
+            uint32_t divisor = (2 * BLOOM_RADIUS + 1) * 256;
+            out[x] = r[x] * BLOOM_STRENGTH / divisor << 16 | g[x] * BLOOM_STRENGTH / divisor << 8 |
+                     b[x] * BLOOM_STRENGTH / divisor;
+            r[x] += ((add[x] >> 16) & 0xff) - ((sub[x] >> 16) & 0xff);
+            g[x] += ((add[x] >> 8) & 0xff) - ((sub[x] >> 8) & 0xff);
+            b[x] += (add[x] & 0xff) - (sub[x] & 0xff);
+        }
+    }
+}
+
+// Where each pixel of the curved picture comes from, pushed further out the further it is from the middle
+static void build_crt_map(void)
+{
+    for (int y = 0; y < out_h; y++) {
+        float ny = 2.0f * (y + 0.5f) / out_h - 1.0f;
+        for (int x = 0; x < out_w; x++) {
+            float nx = 2.0f * (x + 0.5f) / out_w - 1.0f;
+            float sx = nx * (1.0f + CRT_CURVATURE * ny * ny);
+            float sy = ny * (1.0f + CRT_CURVATURE * nx * nx);
+
+            int32_t *from = &crt_map[(size_t)y * out_w + x];
+            if (sx < -1.0f || sx >= 1.0f || sy < -1.0f || sy >= 1.0f) {
+                *from = -1;
+                continue;
+            }
+            int ix = (int)((sx + 1.0f) * 0.5f * out_w), iy = (int)((sy + 1.0f) * 0.5f * out_h);
+            ix = ix >= out_w ? out_w - 1 : ix;
+            iy = iy >= out_h ? out_h - 1 : iy;
+            *from = iy * out_w + ix;
+        }
+    }
+}
+
+static void epx_pixels(const uint32_t *above, const uint32_t *row, const uint32_t *below, const int width,
+                       uint32_t *left, uint32_t *right, const int x0, const int x1)
+{
+    for (int x = x0; x < x1; x++) {
+        uint32_t p = row[x], a = above[x], d = below[x];
+        uint32_t c = x > 0 ? row[x - 1] : p, b = x + 1 < width ? row[x + 1] : p;
+        left[x] = c == a && c != d && a != b ? a : p;
+        right[x] = a == b && a != c && b != d ? b : p;
+    }
+}
+
+#ifndef HH_SSE2
+static void epx_scalar(const uint32_t *above, const uint32_t *row, const uint32_t *below, const int width,
+                       uint32_t *left, uint32_t *right)
+{
+    epx_pixels(above, row, below, width, left, right, 0, width);
+}
+#endif
+
+static void add_scalar(uint32_t *dst, const uint32_t *src, const int n)
+{
+    for (int i = 0; i < n; i++) {
+        uint32_t sum = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t channel = ((dst[i] >> shift) & 0xff) + ((src[i] >> shift) & 0xff);
+            sum |= (channel > 0xff ? 0xff : channel) << shift;
+        }
+        dst[i] = sum;
+    }
+}
+
+static void shade_scalar(uint32_t *row, const int n, const uint16_t level)
+{
+    for (int i = 0; i < n; i++) {
+        uint32_t px = row[i];
+        row[i] = (px & BLACK) | (((px >> 16) & 0xff) * level >> 8) << 16 | (((px >> 8) & 0xff) * level >> 8) << 8 |
+                 ((px & 0xff) * level >> 8);
+    }
+}
+
+static void remap_scalar(uint32_t *dst, const uint32_t *src, const int32_t *map, const int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = map[i] < 0 ? BLACK : src[map[i]];
+    }
+}
+
+#ifdef HH_SSE2
+
+static void epx_sse2(const uint32_t *above, const uint32_t *row, const uint32_t *below, const int width,
+                     uint32_t *left, uint32_t *right)
+{
+    // NOTE: the first and last pixels are missing a neighbour, so they're left to the scalar code
+    int x = 1;
+    epx_pixels(above, row, below, width, left, right, 0, 1);
+
+    for (; x + 4 < width; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(row + x));
+        __m128i a = _mm_loadu_si128((const __m128i *)(above + x));
+        __m128i d = _mm_loadu_si128((const __m128i *)(below + x));
+        __m128i c = _mm_loadu_si128((const __m128i *)(row + x - 1));
+        __m128i b = _mm_loadu_si128((const __m128i *)(row + x + 1));
+
+        __m128i ca = _mm_cmpeq_epi32(c, a), ab = _mm_cmpeq_epi32(a, b);
+        __m128i cd = _mm_cmpeq_epi32(c, d), bd = _mm_cmpeq_epi32(b, d);
+        __m128i use_a = _mm_andnot_si128(_mm_or_si128(cd, ab), ca);
+        __m128i use_b = _mm_andnot_si128(_mm_or_si128(ca, bd), ab);
+
+        _mm_storeu_si128((__m128i *)(left + x), _mm_or_si128(_mm_and_si128(use_a, a), _mm_andnot_si128(use_a, p)));
+        _mm_storeu_si128((__m128i *)(right + x), _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, p)));
+    }
+
+    epx_pixels(above, row, below, width, left, right, x, width);
+}
+
+static void add_sse2(uint32_t *dst, const uint32_t *src, const int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epu8(d, s));
+    }
+    add_scalar(dst + i, src + i, n - i);
+}
+
+static void shade_sse2(uint32_t *row, const int n, const uint16_t level)
+{
+    // Each channel widened to 16 bits, multiplied and narrowed again, with alpha put back as it was
+    __m128i zero = _mm_setzero_si128(), factor = _mm_set1_epi16((short)level);
+    __m128i alpha = _mm_set1_epi32((int)BLACK);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), factor), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), factor), 8);
+        __m128i shaded = _mm_or_si128(_mm_andnot_si128(alpha, _mm_packus_epi16(lo, hi)), _mm_and_si128(alpha, px));
+        _mm_storeu_si128((__m128i *)(row + i), shaded);
+    }
+    shade_scalar(row + i, n - i, level);
+}
+
+#endif
+
+#ifdef POST_AVX2
+
+POST_TARGET_AVX2 static void epx_avx2(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                                      const int width, uint32_t *left, uint32_t *right)
+{
+    int x = 1;
+    epx_pixels(above, row, below, width, left, right, 0, 1);
+
+    for (; x + 8 < width; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(row + x));
+        __m256i a = _mm256_loadu_si256((const __m256i *)(above + x));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(below + x));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(row + x - 1));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(row + x + 1));
+
+        __m256i ca = _mm256_cmpeq_epi32(c, a), ab = _mm256_cmpeq_epi32(a, b);
+        __m256i cd = _mm256_cmpeq_epi32(c, d), bd = _mm256_cmpeq_epi32(b, d);
+        __m256i use_a = _mm256_andnot_si256(_mm256_or_si256(cd, ab), ca);
+        __m256i use_b = _mm256_andnot_si256(_mm256_or_si256(ca, bd), ab);
+
+        _mm256_storeu_si256((__m256i *)(left + x), _mm256_blendv_epi8(p, a, use_a));
+        _mm256_storeu_si256((__m256i *)(right + x), _mm256_blendv_epi8(p, b, use_b));
+    }
+
+    epx_pixels(above, row, below, width, left, right, x, width);
+}
+
+POST_TARGET_AVX2 static void add_avx2(uint32_t *dst, const uint32_t *src, const int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epu8(d, s));
+    }
+    add_scalar(dst + i, src + i, n - i);
+}
+
+POST_TARGET_AVX2 static void shade_avx2(uint32_t *row, const int n, const uint16_t level)
+{
+    __m256i zero = _mm256_setzero_si256(), factor = _mm256_set1_epi16((short)level);
+    __m256i alpha = _mm256_set1_epi32((int)BLACK);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256((const __m256i *)(row + i));
+        // NOTE: unpacking and packing both work within 128 bit lanes, so the pixels come back in the order they went
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(px, zero), factor), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(px, zero), factor), 8);
+        __m256i shaded =
+            _mm256_or_si256(_mm256_andnot_si256(alpha, _mm256_packus_epi16(lo, hi)), _mm256_and_si256(alpha, px));
+        _mm256_storeu_si256((__m256i *)(row + i), shaded);
+    }
+    shade_scalar(row + i, n - i, level);
+}
+
+POST_TARGET_AVX2 static void remap_avx2(uint32_t *dst, const uint32_t *src, const int32_t *map, const int n)
+{
+    __m256i black = _mm256_set1_epi32((int)BLACK), none = _mm256_set1_epi32(-1);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i *)(map + i));
+        __m256i inside = _mm256_cmpgt_epi32(index, none);
+        __m256i px = _mm256_mask_i32gather_epi32(black, (const int *)src, index, inside, 4);
+        _mm256_storeu_si256((__m256i *)(dst + i), px);
+    }
+    remap_scalar(dst + i, src, map + i, n - i);
+}
+
+#endif
+
+static kernels_t pick_kernels(void)
+{
+#ifdef POST_AVX2
+    if (POST_HAS_AVX2()) {
+        return (kernels_t){"avx2", epx_avx2, add_avx2, shade_avx2, remap_avx2};
+    }
+#endif
+#ifdef HH_SSE2
+    // NOTE: SSE2 has no gather, so the CRT's remapping stays scalar
+    return (kernels_t){"sse2", epx_sse2, add_sse2, shade_sse2, remap_scalar};
+#else
+    return (kernels_t){"scalar", epx_scalar, add_scalar, shade_scalar, remap_scalar};
+#endif
+}
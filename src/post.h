@@ -0,0 +1,50 @@
+#ifndef HH_POST_H
+#define HH_POST_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define POST_MAX_THREADS 8
+#define POST_MAX_FILTERS 8
+
+enum {
+    // Upscales with Scale2x (EPX), which rounds off diagonal edges instead of repeating pixels. Always runs first.
+    POST_SCALE2X,
+    // Bright pixels glow onto their neighbours, like phosphor does
+    POST_BLOOM,
+    // Darkens the bottom of each scaled up row
+    POST_SCANLINES,
+    // Bends the picture like the glass of a CRT, with black corners
+    POST_CRT,
+    NUM_POST_FILTERS,
+};
+
+extern const char *POST_FILTER_NAMES[NUM_POST_FILTERS];
+
+typedef struct {
+    // Time post_process() took, the copy back from the renderer and the upload included
+    float last_ms;
+    float avg_ms;
+    float max_ms;
+    uint32_t frames;
+
+    // Threads the work is split over, the calling thread included
+    uint8_t threads;
+    // "avx2", "sse2" or "scalar", whichever kernels this machine runs
+    const char *isa;
+} post_stats_t;
+
+// Filters are given by name separated by commas e.g. "scale2x,bloom,scanlines,crt", and run in that order after the
+// upscale. Frames are width x height.
+int post_init(const char *filters, const int width, const int height);
+void post_destroy(void);
+bool post_enabled(void);
+// Makes the output the frame scaled up by a whole number, called whenever the window changes size
+int post_resize(SDL_Renderer *renderer, const int scale);
+// Runs the frame the renderer is drawing to through the filters, returning the texture to show. NULL if that failed,
+// the frame is then best shown as it is.
+SDL_Texture *post_process(SDL_Renderer *renderer);
+const post_stats_t *post_stats(void);
+
+#endif // !HH_POST_H
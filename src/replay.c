@@ -0,0 +1,111 @@
+#include "replay.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t read_u32(const uint8_t *bytes);
+static void write_u32(uint8_t *bytes, const uint32_t value);
+
+int replay_load(replay_t *replay, const char *fname)
+{
+    LOG_INFO("replay_load", "loading replay %s", fname);
+
+    FILE *fd = fopen(fname, "rb");
+    if (!fd) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    if (fread(header, 1, REPLAY_HEADER_SIZE, fd) != REPLAY_HEADER_SIZE ||
+        memcmp(header, REPLAY_MAGIC, strlen(REPLAY_MAGIC)) != 0) {
+        fclose(fd);
+        return err_fatal(ERR_REPLAY, fname);
+    }
+
+    replay->start_level = header[4];
+    replay->final_level = header[5];
+    replay->final_lives = header[6];
+    replay->final_score = read_u32(&header[8]);
+    replay->num_ticks = read_u32(&header[12]);
+
+    if (replay->start_level >= NUM_LEVELS || replay->num_ticks > REPLAY_MAX_TICKS ||
+        fread(replay->inputs, 1, replay->num_ticks, fd) != replay->num_ticks) {
+        fclose(fd);
+        return err_fatal(ERR_REPLAY, fname);
+    }
+
+    fclose(fd);
+
+    return SUCCESS;
+}
+
+int replay_save(const replay_t *replay, const char *fname)
+{
+    LOG_INFO("replay_save", "saving %u ticks to %s", replay->num_ticks, fname);
+
+    FILE *fd = fopen(fname, "wb");
+    if (!fd) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE] = {0};
+    memcpy(header, REPLAY_MAGIC, strlen(REPLAY_MAGIC));
+    header[4] = replay->start_level;
+    header[5] = replay->final_level;
+    header[6] = replay->final_lives;
+    write_u32(&header[8], replay->final_score);
+    write_u32(&header[12], replay->num_ticks);
+
+    if (fwrite(header, 1, REPLAY_HEADER_SIZE, fd) != REPLAY_HEADER_SIZE ||
+        fwrite(replay->inputs, 1, replay->num_ticks, fd) != replay->num_ticks) {
+        fclose(fd);
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    fclose(fd);
+
+    return SUCCESS;
+}
+
+void replay_start(replay_t *replay, const game_state_t *game)
+{
+    replay->start_level = game->cur_level;
+    replay->num_ticks = 0;
+}
+
+bool replay_record(replay_t *replay, const uint8_t input)
+{
+    if (replay->num_ticks == REPLAY_MAX_TICKS) {
+        return false;
+    }
+    replay->inputs[replay->num_ticks++] = input;
+
+    return true;
+}
+
+void replay_finish(replay_t *replay, const game_state_t *game)
+{
+    replay->final_level = game->cur_level;
+    replay->final_lives = game->players[0].lives;
+    replay->final_score = game->players[0].score;
+}
+
+bool replay_matches(const replay_t *replay, const game_state_t *game)
+{
+    return replay->final_level == game->cur_level && replay->final_lives == game->players[0].lives &&
+           replay->final_score == game->players[0].score;
+}
+
+static uint32_t read_u32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static void write_u32(uint8_t *bytes, const uint32_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8) & 0xff;
+    bytes[2] = (value >> 16) & 0xff;
+    bytes[3] = (value >> 24) & 0xff;
+}
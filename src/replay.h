@@ -0,0 +1,37 @@
+#ifndef HH_REPLAY_H
+#define HH_REPLAY_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Replay files are a 16 byte little-endian header followed by one input byte (INPUT_*) per tick
+//   0 magic "HHR2"
+//   4 start level, final level, final lives, reserved (written as 0)
+//   8 final score
+//  12 number of ticks
+// NOTE: HHR2 has the same fields as HHR1. What changed is the sim they're played back on: deaths, jumps, the jetpack's
+// switch delay and fuel, and enemy deaths run on the timer wheel, so the same inputs end somewhere else. HHR1 files are
+// turned away rather than played back wrong.
+#define REPLAY_MAGIC "HHR2"
+#define REPLAY_HEADER_SIZE 16
+// An hour at 30 ticks a second
+#define REPLAY_MAX_TICKS (30 * 60 * 60)
+
+typedef struct {
+    uint8_t start_level;
+    uint8_t final_level;
+    uint8_t final_lives;
+    uint32_t final_score;
+    uint32_t num_ticks;
+    uint8_t inputs[REPLAY_MAX_TICKS];
+} replay_t;
+
+int replay_load(replay_t *replay, const char *fname);
+int replay_save(const replay_t *replay, const char *fname);
+void replay_start(replay_t *replay, const game_state_t *game);
+bool replay_record(replay_t *replay, const uint8_t input);
+void replay_finish(replay_t *replay, const game_state_t *game);
+bool replay_matches(const replay_t *replay, const game_state_t *game);
+
+#endif // !HH_REPLAY_H
@@ -0,0 +1,264 @@
+#include "rollback.h"
+#include "error.h"
+#include "log.h"
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+static int catch_up(rollback_t *rollback, const uint32_t now_ms);
+static void receive(rollback_t *rollback, const uint8_t *packet, const size_t size, const uint32_t now_ms);
+static void resimulate(rollback_t *rollback);
+static void simulate(rollback_t *rollback, const uint32_t tick);
+static int verify(rollback_t *rollback);
+static int send_inputs(rollback_t *rollback);
+static uint8_t predict(const rollback_t *rollback);
+static uint32_t read_u32(const uint8_t *bytes);
+static void write_u32(uint8_t *bytes, const uint32_t value);
+
+// NOTE: the game has to be set up for MAX_PLAYERS and its level started before the first tick
+void rollback_init(rollback_t *rollback, game_state_t *game, transport_t *transport, const uint8_t local,
+                   const uint32_t now_ms)
+{
+    memset(rollback, 0, sizeof(rollback_t));
+    rollback->game = game;
+    rollback->transport = transport;
+    rollback->local = local;
+    rollback->remote = local ? 0 : 1;
+    rollback->mispredicted = UINT32_MAX;
+    rollback->last_heard_ms = now_ms;
+
+    for (size_t i = 0; i < NUM_LEVELS; i++) {
+        memcpy(rollback->tiles[i], game->levels[i].tiles, sizeof(rollback->tiles[i]));
+    }
+}
+
+// Catches up with the other peer, then simulates the next tick with the local input unless this peer is too far ahead
+// of the other one
+int rollback_advance(rollback_t *rollback, const uint8_t input, const uint32_t now_ms)
+{
+    int err = catch_up(rollback, now_ms);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    rollback->advanced = false;
+    if (rollback->tick < rollback->confirmed + ROLLBACK_MAX_PREDICTION && rollback->game->is_running) {
+        rollback->inputs[rollback->tick % ROLLBACK_HISTORY][rollback->local] = input;
+        simulate(rollback, rollback->tick++);
+        rollback->advanced = true;
+    } else if (rollback->game->is_running) {
+        rollback->stalls++;
+    }
+
+    return send_inputs(rollback);
+}
+
+// Catches up with the other peer without moving on, e.g. to let them catch up before stopping
+int rollback_poll(rollback_t *rollback, const uint32_t now_ms)
+{
+    int err = catch_up(rollback, now_ms);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    rollback->advanced = false;
+
+    return send_inputs(rollback);
+}
+
+bool rollback_settled(const rollback_t *rollback)
+{
+    return rollback->confirmed >= rollback->tick;
+}
+
+void rollback_report(const rollback_t *rollback)
+{
+    printf("netplay: %u ticks, %u rollbacks re-simulating %u ticks (longest %u), %u stalls\n", rollback->tick,
+           rollback->rollbacks, rollback->resimulated, rollback->max_rollback, rollback->stalls);
+    if (rollback->rollbacks) {
+        printf("netplay: rollbacks took %.3f ms on average, %.3f ms at most\n",
+               rollback->total_resim_ms / rollback->rollbacks, rollback->max_resim_ms);
+    }
+}
+
+// Takes in whatever the other peer has sent and corrects any wrong guesses
+static int catch_up(rollback_t *rollback, const uint32_t now_ms)
+{
+    uint8_t packet[MAX_PACKET_SIZE];
+    size_t size;
+
+    while ((size = transport_recv(rollback->transport, packet, sizeof(packet)))) {
+        receive(rollback, packet, size, now_ms);
+    }
+
+    if (rollback->mispredicted < rollback->tick) {
+        resimulate(rollback);
+    }
+    rollback->mispredicted = UINT32_MAX;
+
+    int err = verify(rollback);
+    if (err != SUCCESS) {
+        return err;
+    }
+
+    if (rollback->connected && now_ms - rollback->last_heard_ms > ROLLBACK_TIMEOUT_MS) {
+        return err_fatal(ERR_NET_TIMEOUT, NULL);
+    }
+
+    return SUCCESS;
+}
+
+static void receive(rollback_t *rollback, const uint8_t *packet, const size_t size, const uint32_t now_ms)
+{
+    if (size < ROLLBACK_HEADER_SIZE || memcmp(packet, ROLLBACK_MAGIC, strlen(ROLLBACK_MAGIC)) != 0 ||
+        size < ROLLBACK_HEADER_SIZE + (size_t)packet[20]) {
+        return;
+    }
+
+    if (!rollback->connected) {
+        LOG_INFO("rollback", "the other player is here");
+    }
+    rollback->connected = true;
+    rollback->last_heard_ms = now_ms;
+
+    uint32_t first = read_u32(&packet[4]);
+    uint32_t ack = read_u32(&packet[8]);
+    uint32_t checked = read_u32(&packet[12]);
+
+    // NOTE: packets can arrive out of order, older ones know less
+    if (ack > rollback->acked && ack <= rollback->tick) {
+        rollback->acked = ack;
+    }
+    if (checked > rollback->remote_checked) {
+        rollback->remote_checked = checked;
+        rollback->remote_checksum = read_u32(&packet[16]);
+    }
+
+    // The other peer can't be more than ROLLBACK_MAX_PREDICTION ticks past the input it has from this one
+    for (uint32_t tick = rollback->confirmed; tick >= first && tick < first + packet[20]; tick++) {
+        if (tick >= rollback->tick + ROLLBACK_MAX_PREDICTION) {
+            break;
+        }
+
+        uint8_t *inputs = rollback->inputs[tick % ROLLBACK_HISTORY];
+        uint8_t input = packet[ROLLBACK_HEADER_SIZE + tick - first];
+
+        if (tick < rollback->tick && inputs[rollback->remote] != input && tick < rollback->mispredicted) {
+            rollback->mispredicted = tick;
+        }
+        inputs[rollback->remote] = input;
+        rollback->confirmed = tick + 1;
+    }
+}
+
+// Goes back to before the first wrong guess and plays the ticks since again with what is known now
+static void resimulate(rollback_t *rollback)
+{
+    game_state_t *game = rollback->game;
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint32_t end = rollback->tick;
+    uint8_t level = game->cur_level;
+
+    sim_restore(game, &rollback->snapshots[rollback->mispredicted % ROLLBACK_HISTORY]);
+    for (uint8_t i = game->cur_level + 1; i <= level; i++) {
+        memcpy(game->levels[i].tiles, rollback->tiles[i], sizeof(rollback->tiles[i]));
+    }
+
+    // NOTE: the game may now end sooner than it did, in which case the ticks after that are thrown away
+    for (rollback->tick = rollback->mispredicted; rollback->tick < end && game->is_running;) {
+        simulate(rollback, rollback->tick++);
+    }
+
+    float ms = (float)(SDL_GetPerformanceCounter() - start) * 1000.0f / (float)SDL_GetPerformanceFrequency();
+    uint32_t ticks = end - rollback->mispredicted;
+
+    rollback->rollbacks++;
+    rollback->resimulated += ticks;
+    rollback->last_resim_ms = ms;
+    rollback->total_resim_ms += ms;
+    if (ticks > rollback->max_rollback) {
+        rollback->max_rollback = ticks;
+    }
+    if (ms > rollback->max_resim_ms) {
+        rollback->max_resim_ms = ms;
+    }
+}
+
+static void simulate(rollback_t *rollback, const uint32_t tick)
+{
+    uint32_t slot = tick % ROLLBACK_HISTORY;
+
+    if (tick >= rollback->confirmed) {
+        rollback->inputs[slot][rollback->remote] = predict(rollback);
+    }
+
+    sim_save(rollback->game, &rollback->snapshots[slot]);
+    sim_tick(rollback->game, rollback->inputs[slot]);
+    rollback->checksums[slot] = sim_checksum(rollback->game);
+}
+
+// Both peers have simulated the other's checked ticks with the same inputs by now, so the states have to agree
+static int verify(rollback_t *rollback)
+{
+    uint32_t checked = rollback->remote_checked;
+
+    if (!checked || checked > rollback->confirmed || checked > rollback->tick ||
+        checked + ROLLBACK_HISTORY <= rollback->tick) {
+        return SUCCESS;
+    }
+
+    if (rollback->checksums[(checked - 1) % ROLLBACK_HISTORY] != rollback->remote_checksum) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "tick %u", checked - 1);
+        return err_fatal(ERR_NET_DESYNC, msg);
+    }
+
+    return SUCCESS;
+}
+
+static int send_inputs(rollback_t *rollback)
+{
+    uint8_t packet[ROLLBACK_HEADER_SIZE + ROLLBACK_HISTORY] = {0};
+    uint32_t first = rollback->acked;
+    uint32_t checked = rollback->confirmed < rollback->tick ? rollback->confirmed : rollback->tick;
+
+    // NOTE: only happens if the other peer stopped acknowledging, what has gone is gone
+    if (rollback->tick - first > ROLLBACK_HISTORY) {
+        first = rollback->tick - ROLLBACK_HISTORY;
+    }
+
+    memcpy(packet, ROLLBACK_MAGIC, strlen(ROLLBACK_MAGIC));
+    write_u32(&packet[4], first);
+    write_u32(&packet[8], rollback->confirmed);
+    write_u32(&packet[12], checked);
+    write_u32(&packet[16], checked ? rollback->checksums[(checked - 1) % ROLLBACK_HISTORY] : 0);
+    packet[20] = (uint8_t)(rollback->tick - first);
+    for (uint32_t tick = first; tick < rollback->tick; tick++) {
+        packet[ROLLBACK_HEADER_SIZE + tick - first] = rollback->inputs[tick % ROLLBACK_HISTORY][rollback->local];
+    }
+
+    return transport_send(rollback->transport, packet, ROLLBACK_HEADER_SIZE + packet[20]);
+}
+
+// The other player keeps holding whatever they held last
+static uint8_t predict(const rollback_t *rollback)
+{
+    if (!rollback->confirmed) {
+        return 0;
+    }
+
+    return rollback->inputs[(rollback->confirmed - 1) % ROLLBACK_HISTORY][rollback->remote];
+}
+
+static uint32_t read_u32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static void write_u32(uint8_t *bytes, const uint32_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8) & 0xff;
+    bytes[2] = (value >> 16) & 0xff;
+    bytes[3] = (value >> 24) & 0xff;
+}
@@ -0,0 +1,82 @@
+#ifndef HH_ROLLBACK_H
+#define HH_ROLLBACK_H
+
+#include "sim.h"
+#include "transport.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Two peers each run the whole game. The local player's input is applied straight away and the other player's is
+// guessed (they keep doing what they last did). When the real input turns out to differ, the game is put back to the
+// snapshot taken before the first wrong guess and the ticks since are simulated again.
+
+// How far a peer may run ahead of the other player's input before it waits for them
+#define ROLLBACK_MAX_PREDICTION 8
+// Ticks of input, snapshots and checksums kept. NOTE: must be a power of two and comfortably more than twice
+// ROLLBACK_MAX_PREDICTION, as a peer resends everything the other hasn't acknowledged yet.
+#define ROLLBACK_HISTORY 32
+// Silence from a peer that has been heard from before, after which the game gives up on them
+#define ROLLBACK_TIMEOUT_MS 5000
+
+// Packets are little-endian
+//   0 magic "HN"
+//   2 reserved
+//   4 tick of the first input
+//   8 ack - ticks before this of the receiver's input have arrived
+//  12 ticks checked - number of ticks the checksum covers, 0 for none
+//  16 checksum after the last of those ticks
+//  20 number of inputs
+//  21 one input per tick
+#define ROLLBACK_MAGIC "HN"
+#define ROLLBACK_HEADER_SIZE 21
+
+typedef struct {
+    game_state_t *game;
+    transport_t *transport;
+    uint8_t local;
+    uint8_t remote;
+
+    // Next tick to simulate
+    uint32_t tick;
+    // Ticks before this were simulated with the remote player's real input
+    uint32_t confirmed;
+    // Ticks before this of the local input have reached the other peer
+    uint32_t acked;
+    // Earliest tick simulated with a wrong guess, UINT32_MAX if there isn't one
+    uint32_t mispredicted;
+    // Whether the last rollback_advance() simulated a new tick
+    bool advanced;
+
+    uint8_t inputs[ROLLBACK_HISTORY][MAX_PLAYERS];
+    // State before each tick, and the checksum after it
+    sim_snapshot_t snapshots[ROLLBACK_HISTORY];
+    uint32_t checksums[ROLLBACK_HISTORY];
+    // Every level's tiles as loaded. Rolling back past the end of a level has to put back the items picked up since.
+    uint8_t tiles[NUM_LEVELS][LEVEL_W * LEVEL_H];
+
+    // The other peer's latest checksum, compared once this peer has simulated the same ticks
+    uint32_t remote_checked;
+    uint32_t remote_checksum;
+
+    bool connected;
+    uint32_t last_heard_ms;
+
+    // Stats
+    uint32_t rollbacks;
+    uint32_t resimulated;
+    uint32_t max_rollback;
+    uint32_t stalls;
+    float last_resim_ms;
+    float max_resim_ms;
+    float total_resim_ms;
+} rollback_t;
+
+void rollback_init(rollback_t *rollback, game_state_t *game, transport_t *transport, const uint8_t local,
+                   const uint32_t now_ms);
+int rollback_advance(rollback_t *rollback, const uint8_t input, const uint32_t now_ms);
+int rollback_poll(rollback_t *rollback, const uint32_t now_ms);
+// Every tick simulated so far used both players' real input
+bool rollback_settled(const rollback_t *rollback);
+void rollback_report(const rollback_t *rollback);
+
+#endif // !HH_ROLLBACK_H
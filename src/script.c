@@ -0,0 +1,257 @@
+#include "script.h"
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include "sim.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_LINE_SIZE 128
+#define SCRIPT_ERROR_SIZE 200
+
+static const uint8_t OP_SIZES[NUM_SCRIPT_OPS] = {
+    [SCRIPT_END] = 1,
+    [SCRIPT_JUMP] = 3,
+    [SCRIPT_WAIT] = 2,
+    [SCRIPT_MOVE] = 3,
+    [SCRIPT_MOVE_TO] = 3,
+    [SCRIPT_HUNT] = 1,
+    [SCRIPT_FIRE] = 1,
+    [SCRIPT_WAIT_NEAR] = 2,
+    [SCRIPT_WAIT_PLAYER] = 4,
+    [SCRIPT_REPEAT] = 2,
+    [SCRIPT_NEXT] = 3,
+    [SCRIPT_SET_TILE] = 4,
+};
+
+typedef struct {
+    script_t *script;
+    const char *fname;
+    unsigned line;
+    // NUM_ROUTINES until the first routine starts
+    uint8_t routine;
+    uint16_t start;
+    // Just after the SCRIPT_REPEAT the routine is in, SCRIPT_NONE when it isn't in one
+    uint16_t repeat;
+    char error[SCRIPT_ERROR_SIZE];
+} compiler_t;
+
+static int compile_line(compiler_t *c, char *line);
+static int end_routine(compiler_t *c);
+static int emit(compiler_t *c, const uint8_t op, const uint8_t a, const uint8_t b, const uint8_t d);
+static int fail(compiler_t *c, const char *fmt, ...);
+
+int script_load(script_t *script, const char *fname)
+{
+    char error[ERR_ADDITIONAL_SIZE];
+    int err = script_read(script, fname, error, sizeof(error));
+
+    return err == SUCCESS ? SUCCESS : err_fatal(err, error);
+}
+
+int script_read(script_t *script, const char *fname, char *error, const size_t error_size)
+{
+    script_clear(script);
+
+    // NOTE: most levels don't have one
+    FILE *fd = fopen(fname, "r");
+    if (!fd) {
+        return SUCCESS;
+    }
+
+    compiler_t c = {
+        .script = script,
+        .fname = fname,
+        .routine = NUM_ROUTINES,
+        .repeat = SCRIPT_NONE,
+    };
+    char line[SCRIPT_LINE_SIZE];
+    int err = SUCCESS;
+    while (err == SUCCESS && fgets(line, sizeof(line), fd)) {
+        c.line++;
+        err = compile_line(&c, line);
+    }
+    fclose(fd);
+
+    if (err == SUCCESS) {
+        err = end_routine(&c);
+    }
+    if (err != SUCCESS) {
+        // NOTE: half a script is worse than none
+        script_clear(script);
+        snprintf(error, error_size, "%s", c.error);
+        return err;
+    }
+
+    LOG_INFO("script_load", "compiled %s, %u bytes", fname, script->size);
+
+    return SUCCESS;
+}
+
+void script_clear(script_t *script)
+{
+    memset(script, 0, sizeof(script_t));
+    for (size_t i = 0; i < NUM_ROUTINES; i++) {
+        script->entry[i] = SCRIPT_NONE;
+    }
+}
+
+uint8_t script_op_size(const uint8_t op)
+{
+    return op < NUM_SCRIPT_OPS ? OP_SIZES[op] : 1;
+}
+
+static int compile_line(compiler_t *c, char *line)
+{
+    char *comment = strchr(line, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+
+    char word[16];
+    int a = 0, b = 0, d = 0;
+    int n = sscanf(line, "%15s %d %d %d", word, &a, &b, &d) - 1;
+    if (n < 0) {
+        return SUCCESS;
+    }
+
+    if (strcmp(word, "enemy") == 0 || strcmp(word, "level") == 0) {
+        int err = end_routine(c);
+        if (err != SUCCESS) {
+            return err;
+        }
+
+        bool level = word[0] == 'l';
+        if (!level && (n != 1 || a < 1 || a > NUM_ENEMIES)) {
+            return fail(c, "enemies are numbered from 1 to %d", NUM_ENEMIES);
+        }
+        c->routine = level ? LEVEL_ROUTINE : (uint8_t)(a - 1);
+        if (c->script->entry[c->routine] != SCRIPT_NONE) {
+            return fail(c, "that routine was already written");
+        }
+        c->start = c->script->size;
+        c->script->entry[c->routine] = c->start;
+        return SUCCESS;
+    }
+
+    if (c->routine == NUM_ROUTINES) {
+        return fail(c, "instructions have to be in a routine, start one with enemy N or level");
+    }
+
+    bool enemy = c->routine != LEVEL_ROUTINE;
+    if (strcmp(word, "wait") == 0) {
+        if (n != 1 || a < 1 || a > 255) {
+            return fail(c, "wait takes 1 to 255 ticks");
+        }
+        return emit(c, SCRIPT_WAIT, (uint8_t)a, 0, 0);
+    }
+    if (strcmp(word, "move") == 0 && enemy) {
+        if (n != 2 || abs(a) > SCRIPT_MOVE_MAX || abs(b) > SCRIPT_MOVE_MAX || (!a && !b)) {
+            return fail(c, "move takes tiles across and down, up to %d either way", SCRIPT_MOVE_MAX);
+        }
+        return emit(c, SCRIPT_MOVE, (uint8_t)(int8_t)(a * TILE_SIZE), (uint8_t)(int8_t)(b * TILE_SIZE), 0);
+    }
+    if (strcmp(word, "move_to") == 0 && enemy) {
+        if (n != 2 || a < 0 || a >= LEVEL_W || b < 0 || b >= LEVEL_H) {
+            return fail(c, "move_to takes a tile in the level");
+        }
+        return emit(c, SCRIPT_MOVE_TO, (uint8_t)a, (uint8_t)b, 0);
+    }
+    if (strcmp(word, "hunt") == 0 && enemy) {
+        return emit(c, SCRIPT_HUNT, 0, 0, 0);
+    }
+    if (strcmp(word, "fire") == 0 && enemy) {
+        return emit(c, SCRIPT_FIRE, 0, 0, 0);
+    }
+    if (strcmp(word, "near") == 0 && enemy) {
+        if (n != 1 || a < 0 || a > 255) {
+            return fail(c, "near takes a range of 0 to 255 tiles");
+        }
+        return emit(c, SCRIPT_WAIT_NEAR, (uint8_t)a, 0, 0);
+    }
+    if (strcmp(word, "player_at") == 0) {
+        if (n != 3 || a < 0 || a >= LEVEL_W || b < 0 || b >= LEVEL_H || d < 0 || d > 255) {
+            return fail(c, "player_at takes a tile in the level and a range of 0 to 255 tiles");
+        }
+        return emit(c, SCRIPT_WAIT_PLAYER, (uint8_t)a, (uint8_t)b, (uint8_t)d);
+    }
+    if (strcmp(word, "repeat") == 0) {
+        if (n != 1 || a < 1 || a > 255) {
+            return fail(c, "repeat takes a count of 1 to 255");
+        }
+        if (c->repeat != SCRIPT_NONE) {
+            return fail(c, "repeats can't be inside each other");
+        }
+        int err = emit(c, SCRIPT_REPEAT, (uint8_t)a, 0, 0);
+        c->repeat = c->script->size;
+        return err;
+    }
+    if (strcmp(word, "next") == 0) {
+        if (c->repeat == SCRIPT_NONE) {
+            return fail(c, "next without a repeat");
+        }
+        int err = emit(c, SCRIPT_NEXT, c->repeat & 0xff, c->repeat >> 8, 0);
+        c->repeat = SCRIPT_NONE;
+        return err;
+    }
+    if (strcmp(word, "tile") == 0) {
+        if (n != 3 || a < 0 || a >= LEVEL_W || b < 0 || b >= LEVEL_H || d < 0 || d >= NUM_TILES) {
+            return fail(c, "tile takes a tile in the level and what to change it to");
+        }
+        return emit(c, SCRIPT_SET_TILE, (uint8_t)a, (uint8_t)b, (uint8_t)d);
+    }
+    if (strcmp(word, "loop") == 0) {
+        return emit(c, SCRIPT_JUMP, c->start & 0xff, c->start >> 8, 0);
+    }
+    if (strcmp(word, "end") == 0) {
+        return emit(c, SCRIPT_END, 0, 0, 0);
+    }
+
+    return fail(c, enemy ? "unknown instruction" : "unknown instruction, or one only enemies have");
+}
+
+// Every routine ends, whether or not it was written with one
+static int end_routine(compiler_t *c)
+{
+    if (c->routine == NUM_ROUTINES) {
+        return SUCCESS;
+    }
+    if (c->repeat != SCRIPT_NONE) {
+        return fail(c, "repeat without a next");
+    }
+
+    return emit(c, SCRIPT_END, 0, 0, 0);
+}
+
+static int emit(compiler_t *c, const uint8_t op, const uint8_t a, const uint8_t b, const uint8_t d)
+{
+    uint8_t size = OP_SIZES[op];
+    script_t *script = c->script;
+
+    // NOTE: room is kept for the end of the routine
+    if (script->size + size + (op == SCRIPT_END ? 0 : OP_SIZES[SCRIPT_END]) > SCRIPT_CODE_SIZE) {
+        return fail(c, "the level's routines don't fit in %d bytes", SCRIPT_CODE_SIZE);
+    }
+
+    uint8_t operands[3] = {a, b, d};
+    script->code[script->size] = op;
+    memcpy(&script->code[script->size + 1], operands, size - 1);
+    script->size += size;
+
+    return SUCCESS;
+}
+
+static int fail(compiler_t *c, const char *fmt, ...)
+{
+    int len = snprintf(c->error, sizeof(c->error), "%s:%u: ", c->fname, c->line);
+    if (len >= 0 && (size_t)len < sizeof(c->error)) {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(&c->error[len], sizeof(c->error) - (size_t)len, fmt, args);
+        va_end(args);
+    }
+
+    return ERR_SCRIPT;
+}
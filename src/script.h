@@ -0,0 +1,102 @@
+#ifndef HH_SCRIPT_H
+#define HH_SCRIPT_H
+
+#include "enemy.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A level's routines, one per enemy and the level's own, packed into code one after the other
+#define SCRIPT_CODE_SIZE 256
+#define NUM_ROUTINES (NUM_ENEMIES + 1)
+#define LEVEL_ROUTINE NUM_ENEMIES
+#define SCRIPT_NONE 0xffff
+// Instructions a routine runs before it has to give way until the next tick, so one that never waits can't hang a tick
+#define SCRIPT_BUDGET 32
+// Next to the level's file, levelN.hhs
+#define SCRIPT_EXT "hhs"
+// Room for the script's path wherever the level is loaded from
+#define SCRIPT_FNAME_SIZE 512
+// Furthest a single move goes on either axis, in tiles
+#define SCRIPT_MOVE_MAX 7
+
+// Instructions, each a byte followed by its operands
+enum {
+    // Stops the routine, the enemy stays where it is
+    SCRIPT_END,
+    // addr16, where `loop` goes back to the start of the routine
+    SCRIPT_JUMP,
+    // ticks8, sleeps on the timer wheel
+    SCRIPT_WAIT,
+    // dx8 dy8 pixels, waits until the enemy has got there
+    SCRIPT_MOVE,
+    // x8 y8 tiles, moves in a straight line a few tiles at a time until the enemy is there
+    SCRIPT_MOVE_TO,
+    // A tile along the level's flow field towards the nearest player
+    SCRIPT_HUNT,
+    // Shoots at the nearest player if no enemy bullet is in the air and the enemy is on screen
+    SCRIPT_FIRE,
+    // range8 tiles, waits until a player is that close to the enemy
+    SCRIPT_WAIT_NEAR,
+    // x8 y8 range8 tiles, waits until a player is that close to the tile
+    SCRIPT_WAIT_PLAYER,
+    // count8, runs what's up to the next SCRIPT_NEXT that many times
+    SCRIPT_REPEAT,
+    // addr16 of the instruction after SCRIPT_REPEAT
+    SCRIPT_NEXT,
+    // x8 y8 tile8, changes a tile of the level e.g. opening a wall
+    SCRIPT_SET_TILE,
+    NUM_SCRIPT_OPS,
+};
+
+// Routines as bytecode, read only while playing so they can be shared by every simulation of the level
+typedef struct {
+    // Where each routine starts in code, SCRIPT_NONE for an enemy that follows the path or hunts as usual
+    uint16_t entry[NUM_ROUTINES];
+    uint16_t size;
+    uint8_t code[SCRIPT_CODE_SIZE];
+} script_t;
+
+enum {
+    ROUTINE_DONE,
+    // Runs again next tick, either carrying on or trying the instruction it stopped at again
+    ROUTINE_RUNNING,
+    // Until the enemy has moved as far as it was told
+    ROUTINE_MOVING,
+    // Until its timer fires
+    ROUTINE_WAITING,
+};
+
+// Where a routine is. Nothing else is kept between ticks, which makes routines part of the snapshot like the rest of
+// the game state, so replays and rollback take them back and forth for free.
+typedef struct {
+    uint16_t pc;
+    uint8_t state;
+    // The count left of the SCRIPT_REPEAT it's in
+    uint8_t counter;
+} routine_t;
+
+// Compiles the routines in fname, leaving the script empty when there's no such file. The source is a line per
+// instruction, # starting a comment:
+//   enemy N             the routine of the Nth spawn's enemy, 1 to NUM_ENEMIES
+//   level               the level's own routine, which has no enemy to move
+//   wait TICKS          1 to 255
+//   move DX DY          tiles, up to SCRIPT_MOVE_MAX either way
+//   move_to X Y         tiles
+//   hunt                a tile towards the nearest player
+//   fire
+//   near RANGE          until a player is within RANGE tiles of the enemy
+//   player_at X Y RANGE until a player is within RANGE tiles of the tile
+//   repeat COUNT ... next
+//   tile X Y TILE
+//   loop                back to the start of the routine
+//   end
+int script_load(script_t *script, const char *fname);
+// The same off the main thread, with what went wrong written to error rather than err_additional
+int script_read(script_t *script, const char *fname, char *error, const size_t error_size);
+// No routines at all, for a level made rather than loaded
+void script_clear(script_t *script);
+// Bytes an instruction takes up, operands included
+uint8_t script_op_size(const uint8_t op);
+
+#endif // !HH_SCRIPT_H
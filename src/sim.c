@@ -0,0 +1,1415 @@
+#include "sim.h"
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include "perf.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t PLAYER_START_POS[10][2] = {
+    {2, 8},
+    {1, 8},
+    {2, 5},
+    {1, 5},
+    {2, 8},
+    {2, 8},
+    {1, 2},
+    {2, 8},
+    {6, 1},
+    {2, 8},
+};
+
+static void check_collisions(game_state_t *game, player_t *player);
+static void update(game_state_t *game, float);
+static void scroll_screen(player_t *player);
+static void update_level(game_state_t *game);
+static void restart_level(game_state_t *game, player_t *player);
+static void update_pbullet(game_state_t *game, player_t *player);
+static void update_ebullet(game_state_t *game);
+static void verify_input(game_state_t *game, player_t *player);
+static void move_player(game_state_t *game, player_t *player, float dt);
+static void move_enemies(game_state_t *game, float dt);
+static void update_flow(game_state_t *game);
+static void hunt(const game_state_t *game, enemy_t *m);
+static void fire(game_state_t *game, const uint8_t i);
+static void run_routines(game_state_t *game);
+static void resume(game_state_t *game, const uint8_t r);
+static void stop_routine(game_state_t *game, const uint8_t r);
+static bool player_near(const game_state_t *game, const int x, const int y, const int range);
+static void pickup_item(game_state_t *game, player_t *player, uint8_t, uint8_t);
+static uint32_t hash_value(uint32_t hash, const uint32_t value);
+static uint32_t hash_bullet(uint32_t hash, const bullet_t *bullet);
+static void add_score(game_state_t *game, player_t *player, uint16_t new_score);
+
+static void expire_timers(game_state_t *game);
+static uint8_t player_timer(const game_state_t *game, const player_t *player, const uint8_t timer);
+static void switch_jetpack(game_state_t *game, player_t *player);
+static void kill_player(game_state_t *game, player_t *player, const uint8_t cause);
+static void emit(game_state_t *game, const uint8_t type, const uint8_t x, const uint8_t y, const uint32_t value);
+
+static uint8_t is_clear(game_state_t *game, uint16_t px, uint16_t py);
+static uint8_t player_touch(game_state_t *game, player_t *player, uint16_t px, uint16_t py);
+static uint8_t is_visible(game_state_t *game, uint16_t px);
+static uint8_t in_view(const player_t *player, uint16_t px);
+
+int sim_load_levels(level_t *levels)
+{
+    LOG_INFO("sim_load_levels", "loading levels");
+
+    char fname[DATA_FNAME_SIZE];
+    char file_num[4];
+    char *basename = "res/data/level";
+
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        fname[0] = '\0';
+        strncat(fname, basename, strlen(basename));
+        sprintf(&file_num[0], "%u", i);
+        strncat(fname, file_num, strlen(file_num));
+        strncat(fname, ".dat", strlen(".dat") + 1);
+
+        int err = sim_load_level(&levels[i], fname);
+        if (err != SUCCESS) {
+            return err;
+        }
+    }
+
+    return SUCCESS;
+}
+
+int sim_load_level(level_t *level, const char *fname)
+{
+    char error[ERR_ADDITIONAL_SIZE];
+    int err = sim_read_level(level, fname, error, sizeof(error));
+
+    return err == SUCCESS ? SUCCESS : err_fatal(err, error);
+}
+
+int sim_read_level(level_t *level, const char *fname, char *error, const size_t error_size)
+{
+    uint8_t padding[LEVEL_PADDING_SIZE] = {0};
+
+    FILE *fd_level = fopen(fname, "rb");
+    if (!fd_level) {
+        snprintf(error, error_size, "%s", fname);
+        return ERR_OPENING_FILE;
+    }
+
+    for (size_t j = 0; j < sizeof(level->path); j++) {
+        level->path[j] = fgetc(fd_level);
+    }
+    for (size_t j = 0; j < sizeof(level->tiles); j++) {
+        level->tiles[j] = fgetc(fd_level);
+    }
+    // NOTE: some of the original files are short, which leaves the padding zeroed
+    size_t padding_size = fread(padding, 1, sizeof(padding), fd_level);
+    (void)padding_size;
+
+    fclose(fd_level);
+
+    level->has_extra = memcmp(padding, LEVEL_EXTRA_MAGIC, strlen(LEVEL_EXTRA_MAGIC)) == 0;
+    level->num_spawns = 0;
+    level->flags = 0;
+    if (level->has_extra) {
+        level->start_x = padding[4];
+        level->start_y = padding[5];
+        level->num_spawns = padding[6] < NUM_ENEMIES ? padding[6] : NUM_ENEMIES;
+        for (size_t i = 0; i < level->num_spawns; i++) {
+            level->spawns[i].type = padding[7 + i * 3];
+            level->spawns[i].x = padding[8 + i * 3];
+            level->spawns[i].y = padding[9 + i * 3];
+        }
+        level->flags = padding[22];
+    }
+
+    // levelN.dat's routines are in levelN.hhs
+    char script_fname[SCRIPT_FNAME_SIZE];
+    size_t len = strlen(fname);
+    if (len > 4 && strcmp(&fname[len - 4], ".dat") == 0) {
+        len -= 4;
+    }
+    int written = snprintf(script_fname, sizeof(script_fname), "%.*s." SCRIPT_EXT, (int)len, fname);
+    if (written < 0 || (size_t)written >= sizeof(script_fname)) {
+        snprintf(error, error_size, "the level's path is too long to find its script");
+        return ERR_SCRIPT;
+    }
+
+    return script_read(&level->script, script_fname, error, error_size);
+}
+
+int sim_save_level(const level_t *level, const char *fname)
+{
+    uint8_t padding[LEVEL_PADDING_SIZE] = {0};
+
+    if (level->has_extra) {
+        memcpy(padding, LEVEL_EXTRA_MAGIC, strlen(LEVEL_EXTRA_MAGIC));
+        padding[4] = level->start_x;
+        padding[5] = level->start_y;
+        padding[6] = level->num_spawns;
+        for (size_t i = 0; i < level->num_spawns && i < NUM_ENEMIES; i++) {
+            padding[7 + i * 3] = level->spawns[i].type;
+            padding[8 + i * 3] = level->spawns[i].x;
+            padding[9 + i * 3] = level->spawns[i].y;
+        }
+        padding[22] = level->flags;
+    }
+
+    FILE *fd_level = fopen(fname, "wb");
+    if (!fd_level) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    size_t written = fwrite(level->path, 1, sizeof(level->path), fd_level);
+    written += fwrite(level->tiles, 1, sizeof(level->tiles), fd_level);
+    written += fwrite(padding, 1, sizeof(padding), fd_level);
+    fclose(fd_level);
+
+    if (written != sizeof(level->path) + sizeof(level->tiles) + sizeof(padding)) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    return SUCCESS;
+}
+
+void sim_level_start(const level_t *level, const uint8_t index, uint8_t *x, uint8_t *y)
+{
+    *x = level->has_extra ? level->start_x : PLAYER_START_POS[index][0];
+    *y = level->has_extra ? level->start_y : PLAYER_START_POS[index][1];
+}
+
+void sim_level_defaults(level_t *level, const uint8_t index)
+{
+    if (level->has_extra) {
+        return;
+    }
+
+    sim_level_start(level, index, &level->start_x, &level->start_y);
+    level->has_extra = true;
+    level->num_spawns = 0;
+    for (size_t i = 0; i < NUM_ENEMIES && ENEMIES_START_STATE[index][i].type; i++) {
+        level->spawns[level->num_spawns++] = (spawn_t){
+            .type = ENEMIES_START_STATE[index][i].type,
+            .x = (uint8_t)(ENEMIES_START_STATE[index][i].px / TILE_SIZE),
+            .y = (uint8_t)(ENEMIES_START_STATE[index][i].py / TILE_SIZE),
+        };
+    }
+}
+
+void sim_init(game_state_t *game, level_t *levels, const mask_t *masks, flow_field_t *flow, event_buffer_t *events)
+{
+    memset(game, 0, sizeof(game_state_t));
+    game->levels = levels;
+    game->masks = masks;
+    game->flow = flow;
+    game->events = events;
+    flow_init(game->flow);
+    game->events->count = 0;
+    game->cur_level = LEVEL_1;
+    game->is_running = true;
+    game->num_players = 1;
+    timer_init(&game->timers);
+
+    // Init players
+    for (size_t i = 0; i < MAX_PLAYERS; i++) {
+        game->players[i].on_ground = 1;
+        game->players[i].lives = NUM_START_LIVES;
+    }
+}
+
+void sim_start_level(game_state_t *game)
+{
+    game->level = &game->levels[game->cur_level];
+
+    for (size_t i = 0; i < game->num_players; i++) {
+        restart_level(game, &game->players[i]);
+    }
+
+    for (int i = 0; i < NUM_ENEMIES; i++) {
+        game->enemies[i].type = 0;
+    }
+
+    // Set enemy start state for current level
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        game->enemies[i] = ENEMIES_START_STATE[game->cur_level][i];
+    }
+    if (game->level->has_extra) {
+        memset(game->enemies, 0, sizeof(game->enemies));
+        for (size_t i = 0; i < game->level->num_spawns; i++) {
+            game->enemies[i].type = game->level->spawns[i].type;
+            game->enemies[i].px = game->level->spawns[i].x * TILE_SIZE;
+            game->enemies[i].py = game->level->spawns[i].y * TILE_SIZE;
+            game->enemies[i].x = game->level->spawns[i].x;
+            game->enemies[i].y = game->level->spawns[i].y;
+        }
+    }
+    // TODO:(lukefilewalker) move to enemies[]?
+    game->ebullet.px = 0;
+    game->ebullet.py = 0;
+    game->ebullet.dir = 0;
+    timer_init(&game->timers);
+
+    game->awake = 0;
+    for (uint8_t i = 0; i < NUM_ROUTINES; i++) {
+        sim_restart_routine(game, i);
+    }
+
+    // Set player start state for current level
+    for (size_t i = 0; i < game->num_players; i++) {
+        player_t *player = &game->players[i];
+
+        player->camera_x = 0;
+        player->camera_y = 0;
+        player->px = player->x * TILE_SIZE;
+        player->py = player->y * TILE_SIZE;
+        player->has_trophy = false;
+        player->has_gun = false;
+        player->fire = false;
+        player->using_jetpack = false;
+        player->jetpack_fuel = 0;
+        player->dying = false;
+        player->check_door = true;
+        player->jump = false;
+        player->last_dir = 0;
+        player->bullet.px = 0;
+        player->bullet.py = 0;
+        player->bullet.dir = 0;
+    }
+
+    emit(game, EVENT_LEVEL_START, game->players[0].x, game->players[0].y, game->cur_level);
+}
+
+void sim_tick(game_state_t *game, const uint8_t *inputs)
+{
+    perf_begin(PERF_SIM);
+    game->events->count = 0;
+    expire_timers(game);
+
+    for (size_t i = 0; i < game->num_players; i++) {
+        player_t *player = &game->players[i];
+
+        player->try_right = inputs[i] & INPUT_RIGHT;
+        player->try_left = inputs[i] & INPUT_LEFT;
+        player->try_up = inputs[i] & INPUT_UP;
+        player->try_down = inputs[i] & INPUT_DOWN;
+        player->try_jump = inputs[i] & INPUT_JUMP;
+        player->try_fire = inputs[i] & INPUT_FIRE;
+        player->try_jetpack = inputs[i] & INPUT_JETPACK;
+    }
+
+    for (size_t i = 0; i < game->num_players; i++) {
+        perf_begin(PERF_COLLISIONS);
+        check_collisions(game, &game->players[i]);
+        perf_end(PERF_COLLISIONS);
+        pickup_item(game, &game->players[i], game->players[i].pickup_x, game->players[i].pickup_y);
+    }
+    update(game, 1);
+    perf_end(PERF_SIM);
+}
+
+void sim_restart_routine(game_state_t *game, const uint8_t routine)
+{
+    uint16_t entry = game->level->script.entry[routine];
+    const enemy_t *enemy = routine == LEVEL_ROUTINE ? NULL : &game->enemies[routine];
+    if (entry == SCRIPT_NONE || (enemy && (!enemy->type || enemy->dying))) {
+        game->routines[routine] = (routine_t){.pc = SCRIPT_NONE, .state = ROUTINE_DONE};
+        game->awake &= (uint8_t)~(1 << routine);
+        return;
+    }
+
+    timer_cancel(&game->timers, routine == LEVEL_ROUTINE ? LEVEL_SCRIPT_TIMER : ENEMY_TIMER(routine));
+    game->routines[routine] = (routine_t){.pc = entry, .state = ROUTINE_RUNNING};
+    game->awake |= (uint8_t)(1 << routine);
+}
+
+void sim_save(const game_state_t *game, sim_snapshot_t *snapshot)
+{
+    memcpy(&snapshot->state, game, sizeof(game_state_t));
+    memcpy(snapshot->tiles, game->level->tiles, sizeof(snapshot->tiles));
+}
+
+// NOTE: only the tiles of the level the snapshot was taken on come back, levels entered since are the caller's to reset
+void sim_restore(game_state_t *game, const sim_snapshot_t *snapshot)
+{
+    memcpy(game, &snapshot->state, sizeof(game_state_t));
+    memcpy(game->level->tiles, snapshot->tiles, sizeof(snapshot->tiles));
+    // NOTE: routines can open and close tiles, which the flow field would otherwise not know had been undone
+    flow_invalidate(game->flow);
+}
+
+// FNV-1a over everything that decides what happens next, so two runs fed the same inputs can be compared tick by tick.
+// The pointers are left out as they differ between processes.
+// NOTE: field by field rather than the struct's bytes, whatever is in the padding between fields can differ between two
+// processes holding the same state. A field added to the state has to be added here too.
+uint32_t sim_checksum(const game_state_t *game)
+{
+    uint32_t hash = 2166136261u;
+
+    hash = hash_value(hash, game->is_running);
+    hash = hash_value(hash, game->tick);
+    hash = hash_value(hash, game->cur_level);
+    hash = hash_value(hash, game->num_players);
+    hash = hash_bullet(hash, &game->ebullet);
+
+    for (size_t i = 0; i < MAX_PLAYERS; i++) {
+        const player_t *p = &game->players[i];
+        hash = hash_value(hash, (uint8_t)p->x);
+        hash = hash_value(hash, (uint8_t)p->y);
+        hash = hash_value(hash, (uint16_t)p->px);
+        hash = hash_value(hash, (uint16_t)p->py);
+        hash = hash_value(hash, p->score);
+        hash = hash_value(hash, p->lives);
+        hash = hash_value(hash, (uint8_t)p->tick);
+        hash = hash_value(hash, (uint8_t)p->last_dir);
+        hash = hash_value(hash, p->jetpack_fuel);
+        hash = hash_value(hash, p->collision_points);
+        hash = hash_value(hash, p->pickup_x);
+        hash = hash_value(hash, p->pickup_y);
+        hash = hash_value(hash, p->camera_x);
+        hash = hash_value(hash, p->camera_y);
+        hash = hash_value(hash, (uint8_t)p->scroll_x);
+
+        // The bitfields, one bit each
+        const bool flags[] = {
+            p->try_right, p->try_left,      p->try_down, p->try_jump,  p->try_up,    p->try_fire,   p->try_jetpack,
+            p->right,     p->left,          p->up,       p->down,      p->climb,     p->jump,       p->fire,
+            p->dying,     p->using_jetpack, p->on_ground, p->check_door, p->can_climb, p->has_trophy, p->has_gun,
+        };
+        uint32_t bits = 0;
+        for (size_t j = 0; j < sizeof(flags) / sizeof(flags[0]); j++) {
+            bits |= (uint32_t)flags[j] << j;
+        }
+        hash = hash_value(hash, bits);
+        hash = hash_bullet(hash, &p->bullet);
+    }
+
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        const enemy_t *m = &game->enemies[i];
+        hash = hash_value(hash, m->type);
+        hash = hash_value(hash, m->path_index);
+        hash = hash_value(hash, m->dying);
+        hash = hash_value(hash, m->x);
+        hash = hash_value(hash, m->y);
+        hash = hash_value(hash, m->px);
+        hash = hash_value(hash, m->py);
+        hash = hash_value(hash, (uint8_t)m->next_px);
+        hash = hash_value(hash, (uint8_t)m->next_py);
+    }
+
+    hash = hash_value(hash, game->timers.now);
+    for (size_t i = 0; i < sizeof(game->timers.heads); i++) {
+        hash = hash_value(hash, game->timers.heads[i]);
+    }
+    for (size_t i = 0; i < TIMER_WHEEL_SIZE; i++) {
+        const timer_entry_t *t = &game->timers.timers[i];
+        hash = hash_value(hash, t->deadline);
+        hash = hash_value(hash, t->slot);
+        hash = hash_value(hash, t->prev);
+        hash = hash_value(hash, t->next);
+    }
+
+    for (size_t i = 0; i < NUM_ROUTINES; i++) {
+        hash = hash_value(hash, game->routines[i].pc);
+        hash = hash_value(hash, game->routines[i].state);
+        hash = hash_value(hash, game->routines[i].counter);
+    }
+    hash = hash_value(hash, game->awake);
+
+    for (size_t i = 0; i < sizeof(game->level->tiles); i++) {
+        hash = (hash ^ game->level->tiles[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// A byte at a time from the lowest, so the hash is the same whichever way round the machine stores it
+static uint32_t hash_value(uint32_t hash, const uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((value >> shift) & 0xff)) * 16777619u;
+    }
+
+    return hash;
+}
+
+static uint32_t hash_bullet(uint32_t hash, const bullet_t *bullet)
+{
+    hash = hash_value(hash, bullet->px);
+    hash = hash_value(hash, bullet->py);
+
+    return hash_value(hash, (uint8_t)bullet->dir);
+}
+
+// Tiles that the player collides with
+bool sim_is_solid(const uint8_t tile)
+{
+    switch (tile) {
+    case 1:
+    case 3:
+    case 5:
+    case 15:
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+    case 21:
+    case 22:
+    case 23:
+    case 24:
+    case 29:
+    case 30:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Tiles that kill the player on touch
+bool sim_is_hazard(const uint8_t tile) { return tile == 6 || tile == 25 || tile == 36; }
+
+uint8_t sim_player_tile(const player_t *player)
+{
+    uint8_t tile_index = TILE_PLAYER_STANDING;
+    if (player->last_dir) {
+        tile_index = player->last_dir > 0 ? TILE_PLAYER_WALKING_RIGHT : TILE_PLAYER_WALKING_LEFT;
+        tile_index += (player->tick / 5) % 3;
+    }
+
+    if (player->using_jetpack) {
+        tile_index = player->last_dir >= 0 ? TILE_JETPACK_LEFT : TILE_JETPACK_RIGHT;
+    } else {
+        if (player->jump || !player->on_ground) {
+            tile_index = player->last_dir >= 0 ? TILE_PLAYER_JUMP_LEFT : TILE_PLAYER_JUMP_RIGHT;
+        }
+
+        if (player->climb) {
+            tile_index = TILE_PLAYER_CLIMBING + (player->tick / 5) % 3;
+        }
+    }
+
+    if (player->dying) {
+        tile_index = TILE_DEATH + (player->tick / 3) % 4;
+    }
+
+    return tile_index;
+}
+
+uint8_t sim_enemy_tile(const game_state_t *game, const enemy_t *enemy)
+{
+    return enemy->type + (game->tick / 3) % 4;
+}
+
+uint8_t sim_jetpack_fuel(const game_state_t *game, const player_t *player)
+{
+    if (!player->using_jetpack) {
+        return player->jetpack_fuel;
+    }
+
+    return timer_left(&game->timers, player_timer(game, player, TIMER_JETPACK_FUEL));
+}
+
+// TODO:(lukefilewalker): change to is_colliding
+// TODO:(lukefilewalker) refactor this puppy still
+static void check_collisions(game_state_t *game, player_t *player)
+{
+    player->collision_points = player_touch(game, player, player->px + 4, player->py - 1) << 0 |
+                               player_touch(game, player, player->px + 10, player->py - 1) << 1 |
+                               player_touch(game, player, player->px + 11, player->py + 4) << 2 |
+                               player_touch(game, player, player->px + 11, player->py + 12) << 3 |
+                               player_touch(game, player, player->px + 10, player->py + 16) << 4 |
+                               player_touch(game, player, player->px + 4, player->py + 16) << 5 |
+                               player_touch(game, player, player->px + 3, player->py + 12) << 6 |
+                               player_touch(game, player, player->px + 3, player->py + 4) << 7;
+    player->on_ground = ((!COLLISION_POINT(*player, 4) && !COLLISION_POINT(*player, 5)) || player->climb);
+
+    uint8_t grid_x = (player->px + 6) / TILE_SIZE;
+    uint8_t grid_y = (player->py + 8) / TILE_SIZE;
+    uint8_t type;
+
+    if (grid_x < 100 && grid_y < 10) {
+        type = game->level->tiles[grid_y * 100 + grid_x];
+    } else {
+        type = 0;
+    }
+
+    if ((type >= TILE_TREE_1 && type <= TILE_TREE_3) || type == TILE_STAR) {
+        player->can_climb = 1;
+    } else {
+        player->can_climb = 0;
+        player->climb = 0;
+    }
+}
+
+static void update(game_state_t *game, float dt)
+{
+    for (size_t i = 0; i < game->num_players; i++) {
+        update_pbullet(game, &game->players[i]);
+    }
+    update_ebullet(game);
+    for (size_t i = 0; i < game->num_players; i++) {
+        verify_input(game, &game->players[i]);
+        move_player(game, &game->players[i], dt);
+    }
+    perf_begin(PERF_ENEMIES);
+    move_enemies(game, dt);
+    perf_end(PERF_ENEMIES);
+    for (size_t i = 0; i < game->num_players; i++) {
+        scroll_screen(&game->players[i]);
+    }
+    update_level(game);
+}
+
+static void scroll_screen(player_t *player)
+{
+    // If player is at tile 18 in x, set amount to scroll view/camera to 15 tiles
+    if (player->x - player->camera_x >= RIGHT_CAMERA_SCROLL_TRIGGER_TILE) {
+        player->scroll_x = NUM_TILES_TO_SCROLL_CAMERA;
+    }
+    // If camera/view needs to scroll, advance it by camera scroll amount
+    if (player->scroll_x > 0) {
+        // TODO:(lukefilewalker) was ist das?
+        if (player->camera_x == 80) {
+            player->scroll_x = 0;
+        } else {
+            player->camera_x++;
+            player->scroll_x--;
+        }
+    }
+
+    // If player is at tile 0, 1 in x, set amount to scroll view/camera back by 15 tiles
+    if (player->x - player->camera_x < LEFT_CAMERA_SCROLL_TRIGGER_TILE) {
+        player->scroll_x = -NUM_TILES_TO_SCROLL_CAMERA;
+    }
+
+    // If camera/view needs to scroll, reverse it by camera scroll amount
+    if (player->scroll_x < 0) {
+        // If camera has scrolled, reset scroll_x
+        if (player->camera_x == 0) {
+            player->scroll_x = 0;
+        } else {
+            player->camera_x--;
+            player->scroll_x++;
+        }
+    }
+}
+
+static void update_level(game_state_t *game)
+{
+    game->tick++;
+
+    // Whoever carries the trophy out of the door clears the level for everyone
+    for (size_t i = 0; i < game->num_players; i++) {
+        player_t *player = &game->players[i];
+
+        if (player->check_door) {
+            if (player->has_trophy) {
+                add_score(game, player, SCORE_LEVEL_COMPLETION);
+                emit(game, EVENT_LEVEL_CLEARED, player->x, player->y, game->cur_level);
+
+                if (game->cur_level < LEVEL_10) {
+                    game->cur_level++;
+                    sim_start_level(game);
+                } else {
+                    // TODO:(lukefilewalker) game cleared screen!
+                    emit(game, EVENT_GAME_WON, player->x, player->y, player->score);
+                    game->is_running = false;
+                }
+
+                return;
+            } else {
+                player->check_door = 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        if (game->enemies[i].type && !game->enemies[i].dying) {
+            for (size_t j = 0; j < game->num_players; j++) {
+                player_t *player = &game->players[j];
+
+                // If player and enemy collide, everyone dies
+                if (mask_overlap(&game->masks[sim_player_tile(player)], player->px, player->py,
+                                 &game->masks[sim_enemy_tile(game, &game->enemies[i])], game->enemies[i].px,
+                                 game->enemies[i].py)) {
+                    // Commence with the dying!
+                    kill_player(game, player, DEATH_BY_ENEMY);
+                    game->enemies[i].dying = true;
+                    timer_schedule(&game->timers, ENEMY_TIMER(i), DEATH_DURATION);
+                    emit(game, EVENT_ENEMY_KILLED, game->enemies[i].x, game->enemies[i].y, i);
+                }
+            }
+        }
+    }
+}
+
+static void restart_level(game_state_t *game, player_t *player)
+{
+    uint8_t x, y;
+    sim_level_start(game->level, game->cur_level, &x, &y);
+    player->x = (int8_t)x;
+    player->y = (int8_t)y;
+    player->px = player->x * TILE_SIZE;
+    player->py = player->y * TILE_SIZE;
+}
+
+static void update_pbullet(game_state_t *game, player_t *player)
+{
+    if (!player->bullet.px || !player->bullet.py) {
+        return;
+    }
+
+    // If bullet hits a collidable tile, remove the bullet
+    if (!is_clear(game, player->bullet.px, player->bullet.py)) {
+        player->bullet.px = player->bullet.py = 0;
+    }
+
+    uint8_t grid_x = player->bullet.px / TILE_SIZE;
+
+    // If bullet reaches the end of the screen, remove it
+    if (grid_x - player->camera_x < 1 || grid_x - player->camera_x > 20) {
+        player->bullet.px = player->bullet.py = 0;
+    }
+
+    if (player->bullet.px) {
+        player->bullet.px += player->bullet.dir * BULLET_SPEED;
+        uint8_t tile = player->bullet.dir > 0 ? TILE_PLAYER_BULLET_LEFT : TILE_PLAYER_BULLET_RIGHT;
+
+        for (size_t i = 0; i < NUM_ENEMIES; i++) {
+            if (game->enemies[i].type && !game->enemies[i].dying) {
+                uint8_t mx = game->enemies[i].x;
+                uint8_t my = game->enemies[i].y;
+
+                if (mask_overlap(&game->masks[tile], player->bullet.px, player->bullet.py,
+                                 &game->masks[sim_enemy_tile(game, &game->enemies[i])], game->enemies[i].px,
+                                 game->enemies[i].py)) {
+                    player->bullet.px = player->bullet.py = 0;
+                    game->enemies[i].dying = true;
+                    timer_schedule(&game->timers, ENEMY_TIMER(i), DEATH_DURATION);
+                    add_score(game, player, SCORE_ENEMY_KILL);
+                    emit(game, EVENT_ENEMY_KILLED, mx, my, i);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// TODO:(lukefilewalker): combine with pullet update?
+static void update_ebullet(game_state_t *game)
+{
+    if (!game->ebullet.px || !game->ebullet.py) {
+        return;
+    }
+
+    // If bullet hits a collidable tile, remove it
+    if (!is_clear(game, game->ebullet.px, game->ebullet.py)) {
+        game->ebullet.px = game->ebullet.py = 0;
+    }
+
+    // If bullet reaches the end of the screen, remove it
+    if (!is_visible(game, game->ebullet.px)) {
+        game->ebullet.px = game->ebullet.py = 0;
+    }
+
+    if (game->ebullet.px) {
+        game->ebullet.px += game->ebullet.dir * BULLET_SPEED;
+        uint8_t tile = game->ebullet.dir > 0 ? TILE_ENEMY_BULLET_LEFT : TILE_ENEMY_BULLET_RIGHT;
+
+        for (size_t i = 0; i < game->num_players; i++) {
+            player_t *player = &game->players[i];
+
+            const mask_t *harry = &game->masks[sim_player_tile(player)];
+
+            if (mask_overlap(&game->masks[tile], game->ebullet.px, game->ebullet.py, harry, player->px, player->py)) {
+                game->ebullet.px = game->ebullet.py = 0;
+                kill_player(game, player, DEATH_BY_ENEMY_BULLET);
+                break;
+            }
+        }
+    }
+}
+
+static void verify_input(game_state_t *game, player_t *player)
+{
+    if (player->dying) {
+        return;
+    }
+
+    if (player->try_right && COLLISION_POINT(*player, 2) && COLLISION_POINT(*player, 3)) {
+        player->right = true;
+    }
+
+    if (player->try_left && COLLISION_POINT(*player, 6) && COLLISION_POINT(*player, 7)) {
+        player->left = true;
+    }
+
+    if (player->try_jump && player->on_ground && !player->jump && !player->using_jetpack && !player->can_climb &&
+        COLLISION_POINT(*player, 0) && COLLISION_POINT(*player, 1)) {
+        player->jump = true;
+    }
+
+    if (player->try_up && player->can_climb) {
+        player->up = true;
+        player->climb = true;
+    }
+
+    if (player->try_fire && player->has_gun && !player->bullet.px && !player->bullet.py) {
+        player->fire = true;
+    }
+
+    if (player->try_jetpack && player->jetpack_fuel &&
+        !timer_pending(&game->timers, player_timer(game, player, TIMER_JETPACK_DELAY))) {
+        switch_jetpack(game, player);
+    }
+
+    if (player->try_down && (player->using_jetpack || player->climb) && COLLISION_POINT(*player, 4) &&
+        COLLISION_POINT(*player, 5)) {
+        player->down = true;
+    }
+
+    if (player->try_jump && player->using_jetpack && COLLISION_POINT(*player, 0) && COLLISION_POINT(*player, 1)) {
+        player->up = true;
+    }
+}
+
+static void move_player(game_state_t *game, player_t *player, float dt)
+{
+    // if (player->dying) {
+    //     return;
+    // }
+
+    player->x = player->px / TILE_SIZE;
+    player->y = player->py / TILE_SIZE;
+
+    if (player->y > 9) {
+        player->y = 0;
+        player->py = -16;
+    }
+
+    if (player->right) {
+        // float px = PLAYER_MOVE; // * MUL * dt;
+        player->px += PLAYER_MOVE;
+        player->right = 0;
+        player->last_dir = 1;
+        player->tick++;
+    }
+    if (player->left) {
+        // float px = PLAYER_MOVE; // * MUL * dt;
+        player->px -= PLAYER_MOVE;
+        player->left = 0;
+        player->last_dir = -1;
+        player->tick++;
+    }
+
+    if (player->down) {
+        player->py += PLAYER_MOVE;
+        player->down = 0;
+    }
+
+    if (player->up) {
+        player->py -= PLAYER_MOVE;
+        player->up = 0;
+    }
+
+    uint8_t jump_timer = player_timer(game, player, TIMER_JUMP);
+
+    if (player->jetpack_fuel) {
+        player->jump = 0;
+        timer_cancel(&game->timers, jump_timer);
+    }
+
+    // NOTE: the jump ends when its timer fires
+    if (player->jump) {
+        if (!timer_pending(&game->timers, jump_timer)) {
+            timer_schedule(&game->timers, jump_timer, JUMP_DURATION);
+            player->last_dir = 0;
+        }
+
+        // TODO:(lukefilewalker): add delta time to jump
+        uint8_t jump_left = timer_left(&game->timers, jump_timer);
+        if (COLLISION_POINT(*player, 0) && COLLISION_POINT(*player, 1)) {
+            if (jump_left > 16) {
+                player->py -= PLAYER_MOVE;
+            }
+            if (jump_left >= 12 && jump_left <= 15) {
+                player->py -= PLAYER_MOVE / 2;
+            }
+        }
+    }
+
+    // Add gravity
+    if (!player->jump && !player->on_ground && !player->using_jetpack && !player->climb) {
+        if (player_touch(game, player, player->px + 4, player->py + 17)) {
+            player->py += PLAYER_MOVE;
+        } else {
+            uint8_t not_aligned = player->py % TILE_SIZE;
+            if (not_aligned) {
+                player->py = not_aligned < 8 ? player->py - not_aligned : player->py + TILE_SIZE - not_aligned;
+            }
+        }
+    }
+
+    // Firing the gun
+    if (player->fire) {
+        player->bullet.dir = player->last_dir;
+
+        if (!player->bullet.dir) {
+            player->bullet.dir = 1;
+        }
+
+        if (player->bullet.dir == 1) {
+            player->bullet.px = player->px + 18;
+        }
+
+        if (player->bullet.dir == -1) {
+            player->bullet.px = player->px - 8;
+        }
+
+        player->bullet.py = player->py + 8;
+        player->fire = false;
+        emit(game, EVENT_PLAYER_FIRED, player->x, player->y, (uint32_t)player->bullet.dir);
+    }
+}
+
+static void move_enemies(game_state_t *game, float dt)
+{
+    bool hunters = game->level->has_extra && (game->level->flags & LEVEL_HUNTERS);
+    if (hunters) {
+        update_flow(game);
+    }
+    run_routines(game);
+
+    for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
+        enemy_t *m = &game->enemies[i];
+        if (m->type && !m->dying) {
+            // Move enemies twice as fast
+            // TODO:(lukefilewalker) is there a better way to do this?
+            for (int j = 0; j < 2; j++) {
+                if (game->level->script.entry[i] != SCRIPT_NONE) {
+                    // NOTE: its routine has already said where to go
+                } else if (hunters) {
+                    if (!m->next_px && !m->next_py) {
+                        hunt(game, m);
+                    }
+                } else {
+                    if (!m->next_px && !m->next_py) {
+                        m->next_px = game->level->path[m->path_index];
+                        m->next_py = game->level->path[m->path_index + 1];
+                        m->path_index += 2;
+                    }
+
+                    // If end of path, reset path to beginning
+                    if (m->next_px == (int8_t)0xea && m->next_py == (int8_t)0xea) {
+                        m->next_px = game->level->path[0];
+                        m->next_py = game->level->path[1];
+                        m->path_index += 2;
+                    }
+                }
+
+                if (m->next_px < 0) {
+                    m->px -= 1;
+                    m->next_px++;
+                }
+                if (m->next_px > 0) {
+                    m->px += 1;
+                    m->next_px--;
+                }
+
+                if (m->next_py < 0) {
+                    m->py -= 1;
+                    m->next_py++;
+                }
+                if (m->next_py > 0) {
+                    m->py += 1;
+                    m->next_py--;
+                }
+            }
+
+            m->x = m->px / TILE_SIZE;
+            m->y = m->py / TILE_SIZE;
+        }
+    }
+
+    // enemies firing, scripted ones only when their routine says so
+    if (!game->ebullet.px && !game->ebullet.py) {
+        for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
+            if (game->enemies[i].type && is_visible(game, game->enemies[i].px) && !game->enemies[i].dying &&
+                game->level->script.entry[i] == SCRIPT_NONE) {
+                fire(game, i);
+            }
+        }
+    }
+}
+
+static void fire(game_state_t *game, const uint8_t i)
+{
+    // Aim at whoever is closest
+    const player_t *target = &game->players[0];
+    for (size_t j = 1; j < game->num_players; j++) {
+        if (abs(game->players[j].px - game->enemies[i].px) < abs(target->px - game->enemies[i].px)) {
+            target = &game->players[j];
+        }
+    }
+
+    game->ebullet.dir = target->px < game->enemies[i].px ? -1 : 1;
+
+    // Default direction of bullet should be right
+    if (!game->ebullet.dir) {
+        game->ebullet.dir = 1;
+    }
+
+    // Create the bullet on the appropriate side of the enemy
+    if (game->ebullet.dir == 1) {
+        game->ebullet.px = game->enemies[i].px + 18;
+    }
+    if (game->ebullet.dir == -1) {
+        game->ebullet.px = game->enemies[i].px - 8;
+    }
+
+    game->ebullet.py = game->enemies[i].py + 8;
+    emit(game, EVENT_ENEMY_FIRED, game->enemies[i].x, game->enemies[i].y, i);
+}
+
+// Every player in the level is a target, the field is only searched again once one of them is on another tile
+static void update_flow(game_state_t *game)
+{
+    uint16_t targets[FLOW_MAX_TARGETS];
+    uint8_t num_targets = 0;
+
+    for (size_t i = 0; i < game->num_players && num_targets < FLOW_MAX_TARGETS; i++) {
+        const player_t *player = &game->players[i];
+        if (player->x >= 0 && player->x < LEVEL_W && player->y >= 0 && player->y < LEVEL_H) {
+            targets[num_targets++] = (uint16_t)(player->y * LEVEL_W + player->x);
+        }
+    }
+
+    flow_update(game->flow, game->level->tiles, targets, num_targets);
+}
+
+// Hunters only move a whole tile at a time, so the tile they're on is where the step is read from
+static void hunt(const game_state_t *game, enemy_t *m)
+{
+    uint8_t step = FLOW_STAY;
+    if (m->px / TILE_SIZE < LEVEL_W && m->py / TILE_SIZE < LEVEL_H) {
+        step = flow_step(game->flow, (uint16_t)(m->py / TILE_SIZE * LEVEL_W + m->px / TILE_SIZE));
+    }
+
+    m->next_px = (int8_t)(FLOW_STEP_X[step] * TILE_SIZE);
+    m->next_py = (int8_t)(FLOW_STEP_Y[step] * TILE_SIZE);
+}
+
+// Resumes only the routines that are awake, the waiting ones cost nothing until their timer fires
+static void run_routines(game_state_t *game)
+{
+    for (uint8_t r = 0; game->awake >> r; r++) {
+        if (game->awake & (1 << r)) {
+            resume(game, r);
+        }
+    }
+}
+
+// Runs a routine until it has to wait, move or give way to the others. An instruction waiting on something stays put,
+// to be tried again next tick.
+static void resume(game_state_t *game, const uint8_t r)
+{
+    routine_t *routine = &game->routines[r];
+    const script_t *script = &game->level->script;
+    enemy_t *m = r == LEVEL_ROUTINE ? NULL : &game->enemies[r];
+
+    // Shot or run into
+    if (m && (!m->type || m->dying)) {
+        stop_routine(game, r);
+        return;
+    }
+    if (routine->state == ROUTINE_MOVING) {
+        if (m->next_px || m->next_py) {
+            return;
+        }
+        routine->state = ROUTINE_RUNNING;
+    }
+
+    for (uint8_t budget = SCRIPT_BUDGET; budget; budget--) {
+        const uint8_t *op = &script->code[routine->pc];
+        if (routine->pc + script_op_size(op[0]) > SCRIPT_CODE_SIZE) {
+            stop_routine(game, r);
+            return;
+        }
+
+        switch (op[0]) {
+        case SCRIPT_WAIT: {
+            timer_schedule(&game->timers, m ? ENEMY_TIMER(r) : LEVEL_SCRIPT_TIMER, op[1]);
+            routine->pc += 2;
+            routine->state = ROUTINE_WAITING;
+            game->awake &= (uint8_t)~(1 << r);
+            return;
+        }
+
+        case SCRIPT_MOVE: {
+            m->next_px = (int8_t)op[1];
+            m->next_py = (int8_t)op[2];
+            routine->pc += 3;
+            routine->state = ROUTINE_MOVING;
+            return;
+        }
+
+        case SCRIPT_MOVE_TO: {
+            int dx = op[1] * TILE_SIZE - m->px;
+            int dy = op[2] * TILE_SIZE - m->py;
+            if (dx || dy) {
+                // NOTE: the furthest a single move can go, it comes back here until the enemy is there
+                int most = SCRIPT_MOVE_MAX * TILE_SIZE;
+                m->next_px = (int8_t)(dx < -most ? -most : dx > most ? most : dx);
+                m->next_py = (int8_t)(dy < -most ? -most : dy > most ? most : dy);
+                routine->state = ROUTINE_MOVING;
+                return;
+            }
+            routine->pc += 3;
+        } break;
+
+        case SCRIPT_HUNT: {
+            update_flow(game);
+            hunt(game, m);
+            routine->pc += 1;
+            if (m->next_px || m->next_py) {
+                routine->state = ROUTINE_MOVING;
+            }
+            return;
+        }
+
+        case SCRIPT_FIRE: {
+            if (!game->ebullet.px && !game->ebullet.py && is_visible(game, m->px)) {
+                fire(game, r);
+            }
+            routine->pc += 1;
+        } break;
+
+        case SCRIPT_WAIT_NEAR: {
+            if (!player_near(game, m->x, m->y, op[1])) {
+                return;
+            }
+            routine->pc += 2;
+        } break;
+
+        case SCRIPT_WAIT_PLAYER: {
+            if (!player_near(game, op[1], op[2], op[3])) {
+                return;
+            }
+            routine->pc += 4;
+        } break;
+
+        case SCRIPT_REPEAT: {
+            routine->counter = op[1];
+            routine->pc += 2;
+        } break;
+
+        case SCRIPT_NEXT: {
+            routine->pc = --routine->counter ? (uint16_t)(op[1] | op[2] << 8) : routine->pc + 3;
+        } break;
+
+        case SCRIPT_JUMP: {
+            routine->pc = (uint16_t)(op[1] | op[2] << 8);
+        } break;
+
+        case SCRIPT_SET_TILE: {
+            uint16_t cell = (uint16_t)(op[2] * LEVEL_W + op[1]);
+            game->level->tiles[cell] = op[3];
+            flow_tile_changed(game->flow, game->level->tiles, cell);
+            emit(game, EVENT_TILE_SET, op[1], op[2], op[3]);
+            routine->pc += 4;
+        } break;
+
+        case SCRIPT_END:
+        default: {
+            stop_routine(game, r);
+            return;
+        }
+        }
+    }
+}
+
+static void stop_routine(game_state_t *game, const uint8_t r)
+{
+    game->routines[r].state = ROUTINE_DONE;
+    game->awake &= (uint8_t)~(1 << r);
+}
+
+// Within range tiles of x, y on both axes
+static bool player_near(const game_state_t *game, const int x, const int y, const int range)
+{
+    for (size_t i = 0; i < game->num_players; i++) {
+        if (abs(game->players[i].x - x) <= range && abs(game->players[i].y - y) <= range) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void pickup_item(game_state_t *game, player_t *player, uint8_t grid_x, uint8_t grid_y)
+{
+    if (!grid_x || !grid_y) {
+        return;
+    }
+
+    uint8_t type = game->level->tiles[grid_y * 100 + grid_x];
+
+    emit(game, EVENT_PICKUP, grid_x, grid_y, type);
+
+    switch (type) {
+    case TILE_JETPACK: {
+        player->jetpack_fuel = JETPACK_START_FUEL;
+        if (player->using_jetpack) {
+            timer_schedule(&game->timers, player_timer(game, player, TIMER_JETPACK_FUEL), JETPACK_START_FUEL);
+        }
+    } break;
+
+    case TILE_TROPHY: {
+        add_score(game, player, SCORE_TROPHY);
+        player->has_trophy = true;
+    } break;
+
+    case TILE_GUN: {
+        player->has_gun = true;
+    } break;
+
+    // TODO:(lukefilewalker) pull these magic nums out
+    case 47: {
+        add_score(game, player, 100);
+    } break;
+
+    case 48: {
+        add_score(game, player, 50);
+    } break;
+
+    case 49: {
+        add_score(game, player, 150);
+
+    } break;
+    case 50: {
+        add_score(game, player, 300);
+    } break;
+
+    case 51: {
+        add_score(game, player, 200);
+    } break;
+
+    case 52: {
+        add_score(game, player, 500);
+    } break;
+
+    default:
+        break;
+    }
+
+    game->level->tiles[grid_y * 100 + grid_x] = 0;
+
+    player->pickup_x = 0;
+    player->pickup_y = 0;
+}
+
+static void add_score(game_state_t *game, player_t *player, uint16_t new_score)
+{
+    if (player->score / SCORE_NEW_LIFE != (player->score + new_score) / SCORE_NEW_LIFE) {
+        player->lives++;
+        emit(game, EVENT_EXTRA_LIFE, player->x, player->y, player->lives);
+    }
+    player->score += new_score;
+}
+
+// Carries out whatever the timers firing this tick were counting down to, before anything else moves
+static void expire_timers(game_state_t *game)
+{
+    uint8_t expired[TIMER_WHEEL_SIZE];
+    uint8_t count = timer_advance(&game->timers, expired);
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (expired[i] == LEVEL_SCRIPT_TIMER) {
+            game->routines[LEVEL_ROUTINE].state = ROUTINE_RUNNING;
+            game->awake |= 1 << LEVEL_ROUTINE;
+            continue;
+        }
+        if (expired[i] >= ENEMY_TIMER(0)) {
+            uint8_t index = expired[i] - ENEMY_TIMER(0);
+            enemy_t *enemy = &game->enemies[index];
+            // Still alive, so it was its routine waiting
+            if (!enemy->dying) {
+                game->routines[index].state = ROUTINE_RUNNING;
+                game->awake |= (uint8_t)(1 << index);
+                continue;
+            }
+            enemy->type = 0;
+            enemy->dying = false;
+            continue;
+        }
+
+        player_t *player = &game->players[expired[i] / NUM_PLAYER_TIMERS];
+
+        switch (expired[i] % NUM_PLAYER_TIMERS) {
+        case TIMER_DEATH: {
+            player->dying = false;
+            // And player has lives remaining
+            if (player->lives > 0) {
+                // Deduct a life and restart level
+                player->lives--;
+                emit(game, EVENT_LIFE_LOST, player->x, player->y, player->lives);
+                // TODO:(lukefilewalker): does this have to be its own func? i.e. start_level(cur_level)
+                restart_level(game, player);
+            } else {
+                // Else, game over - for everyone, as nobody is left to play with
+                emit(game, EVENT_GAME_OVER, player->x, player->y, player->score);
+                game->is_running = false;
+            }
+        } break;
+
+        case TIMER_JUMP: {
+            player->jump = 0;
+        } break;
+
+        // Out of fuel
+        case TIMER_JETPACK_FUEL: {
+            player->using_jetpack = false;
+            player->jetpack_fuel = 0;
+            emit(game, EVENT_JETPACK, player->x, player->y, false);
+        } break;
+
+        // NOTE: only ever asked whether it's still pending
+        case TIMER_JETPACK_DELAY:
+        default:
+            break;
+        }
+    }
+}
+
+static uint8_t player_timer(const game_state_t *game, const player_t *player, const uint8_t timer)
+{
+    return (uint8_t)PLAYER_TIMER(player - game->players, timer);
+}
+
+// Switching off keeps what's left of the fuel, switching on burns it until the fuel timer fires
+static void switch_jetpack(game_state_t *game, player_t *player)
+{
+    uint8_t fuel_timer = player_timer(game, player, TIMER_JETPACK_FUEL);
+
+    player->using_jetpack = !player->using_jetpack;
+    if (player->using_jetpack) {
+        timer_schedule(&game->timers, fuel_timer, player->jetpack_fuel);
+    } else {
+        player->jetpack_fuel = timer_left(&game->timers, fuel_timer);
+        timer_cancel(&game->timers, fuel_timer);
+    }
+    timer_schedule(&game->timers, player_timer(game, player, TIMER_JETPACK_DELAY), JETPACK_DELAY);
+
+    emit(game, EVENT_JETPACK, player->x, player->y, player->using_jetpack);
+}
+
+static void kill_player(game_state_t *game, player_t *player, const uint8_t cause)
+{
+    if (!player->dying) {
+        emit(game, EVENT_PLAYER_DIED, player->x, player->y, cause);
+    }
+    player->dying = true;
+    timer_schedule(&game->timers, player_timer(game, player, TIMER_DEATH), DEATH_DURATION);
+}
+
+static void emit(game_state_t *game, const uint8_t type, const uint8_t x, const uint8_t y, const uint32_t value)
+{
+    event_buffer_t *events = game->events;
+
+    // NOTE: the buffer is sized so that this shouldn't happen, drop rather than stall the simulation
+    if (events->count >= MAX_EVENTS_PER_TICK) {
+        return;
+    }
+
+    events->events[events->count++] = (game_event_t){
+        .type = type,
+        .level = game->cur_level,
+        .x = x,
+        .y = y,
+        .value = value,
+    };
+}
+
+static uint8_t is_clear(game_state_t *game, uint16_t px, uint16_t py)
+{
+    uint8_t grid_x = px / TILE_SIZE;
+    uint8_t grid_y = py / TILE_SIZE;
+
+    if (grid_x >= GAME_AREA_TOP || grid_y >= GAME_AREA_BOTTOM) {
+        return 1;
+    }
+
+    return !sim_is_solid(game->level->tiles[grid_y * 100 + grid_x]);
+}
+
+// Same as is_clear, but also reacts to the player touching doors, items and hazards
+static uint8_t player_touch(game_state_t *game, player_t *player, uint16_t px, uint16_t py)
+{
+    if (!is_clear(game, px, py)) {
+        return 0;
+    }
+
+    uint8_t grid_x = px / TILE_SIZE;
+    uint8_t grid_y = py / TILE_SIZE;
+
+    if (grid_x >= GAME_AREA_TOP || grid_y >= GAME_AREA_BOTTOM) {
+        return 1;
+    }
+
+    uint8_t type = game->level->tiles[grid_y * 100 + grid_x];
+
+    switch (type) {
+    case TILE_DOOR: {
+        if (!player->check_door) {
+            emit(game, EVENT_DOOR_REACHED, grid_x, grid_y, player->has_trophy);
+        }
+        player->check_door = true;
+    } break;
+
+    case TILE_GUN:
+    case TILE_JETPACK:
+    case TILE_TROPHY:
+    case 47:
+    case 48:
+    case 49:
+    case 50:
+    case 51:
+    case 52: {
+        player->pickup_x = grid_x;
+        player->pickup_y = grid_y;
+    } break;
+
+    default: {
+        if (sim_is_hazard(type) && !player->dying) {
+            emit(game, EVENT_HAZARD_TOUCHED, grid_x, grid_y, type);
+            kill_player(game, player, DEATH_BY_HAZARD);
+        }
+    } break;
+    }
+
+    return 1;
+}
+
+// On screen for any of the players
+static uint8_t is_visible(game_state_t *game, uint16_t px)
+{
+    for (size_t i = 0; i < game->num_players; i++) {
+        if (in_view(&game->players[i], px)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static inline uint8_t in_view(const player_t *player, uint16_t px)
+{
+    uint8_t posx = px / TILE_SIZE;
+    return posx - player->camera_x < 20 && posx - player->camera_x >= 0;
+}
+
+bool sim_in_view(const player_t *player, const uint16_t px)
+{
+    return in_view(player, px);
+}
@@ -0,0 +1,334 @@
+#ifndef HH_SIM_H
+#define HH_SIM_H
+
+#include "common.h"
+#include "enemy.h"
+#include "flow.h"
+#include "mask.h"
+#include "script.h"
+#include "timer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Input buttons - one bit each in an input frame
+#define INPUT_RIGHT (1 << 0)
+#define INPUT_LEFT (1 << 1)
+#define INPUT_UP (1 << 2)
+#define INPUT_DOWN (1 << 3)
+#define INPUT_JUMP (1 << 4)
+#define INPUT_FIRE (1 << 5)
+#define INPUT_JETPACK (1 << 6)
+#define NUM_INPUT_BUTTONS 7
+
+#define DATA_FNAME_SIZE 20
+#define GAME_AREA_TOP 100
+#define GAME_AREA_BOTTOM 10
+
+#define NUM_START_LIVES 3
+
+#define SCORE_NEW_LIFE 20000
+#define SCORE_LEVEL_COMPLETION 2000
+#define SCORE_TROPHY 1000
+
+#define DEATH_DURATION 30
+#define JUMP_DURATION 30
+// Ticks before the jetpack can be switched again
+#define JETPACK_DELAY 10
+
+#define RIGHT_CAMERA_SCROLL_TRIGGER_TILE 18
+#define LEFT_CAMERA_SCROLL_TRIGGER_TILE 2
+#define CAMERA_SCROLL_AMOUNT 80
+#define NUM_TILES_TO_SCROLL_CAMERA 15
+
+#define PLAYER_W 20
+#define PLAYER_H 16
+#define PLAYER_START_X 2
+#define PLAYER_START_Y 8
+#define PLAYER_MOVE 2
+#define BULLET_SPEED 4
+#define BULLET_W 12
+#define BULLET_H 3
+#define JETPACK_START_FUEL 255
+
+// Harrys sharing a level, only netplay has more than one
+#define MAX_PLAYERS 2
+
+#define LEVEL_1 0
+#define LEVEL_2 1
+#define LEVEL_3 2
+#define LEVEL_4 3
+#define LEVEL_5 4
+#define LEVEL_6 5
+#define LEVEL_7 6
+#define LEVEL_8 7
+#define LEVEL_9 8
+#define LEVEL_10 9
+
+#define TILE_DOOR 2
+#define TILE_JETPACK 4
+#define TILE_TROPHY 10
+#define TILE_GUN 20
+#define TILE_TREE_1 33
+#define TILE_TREE_2 34
+#define TILE_TREE_3 35
+#define TILE_STAR 41
+#define TILE_DEATH 129
+
+// Player tiles
+#define NUM_TILES_PLAYER_WALKING 7
+static const uint8_t TILES_PLAYER_WALKING[NUM_TILES_PLAYER_WALKING] = {53, 54, 55, 56, 57, 58, 59};
+#define TILES_PLAYER_WALKING_MASK_OFFSET 7
+#define TILE_PLAYER_STANDING 56
+#define TILE_PLAYER_JUMP_LEFT 67
+#define TILE_PLAYER_JUMP_RIGHT 68
+#define TILE_PLAYER_JUMP_MASK_OFFSET 2
+#define NUM_TILES_PLAYER_CLIMBING 7
+static const uint8_t TILES_PLAYER_CLIMBING[NUM_TILES_PLAYER_CLIMBING] = {71, 72, 73};
+#define TILES_PLAYER_CLIMBING_MASK_OFFSET 3
+#define TILE_PLAYER_BULLET_LEFT 127
+#define TILE_PLAYER_BULLET_RIGHT 128
+#define NUM_TILES_PLAYER_JETPACK 6
+static const uint8_t TILES_PLAYER_JETPACK[NUM_TILES_PLAYER_JETPACK] = {77, 78, 79, 80, 81, 82};
+#define TILES_PLAYER_JETPACK_MASK_OFFSET 6
+#define TILE_JETPACK_LEFT 77
+#define TILE_JETPACK_RIGHT 80
+#define TILE_PLAYER_WALKING_RIGHT 53
+#define TILE_PLAYER_WALKING_LEFT 57
+#define TILE_PLAYER_CLIMBING 71
+
+// Sprites the simulation collides, the player tiles include their mask tiles
+#define TILE_FIRST_PLAYER 53
+#define TILE_LAST_PLAYER 88
+#define TILE_FIRST_ENEMY 89
+#define TILE_LAST_ENEMY 120
+
+// NOTE: level files are 1280 bytes - the path and tiles, followed by 24 bytes of padding. The original levels leave
+// the padding unused, generated levels keep their own start position and enemy spawns in it:
+//   0 magic "HHL1"
+//   4 player start x, y (tiles)
+//   6 number of spawns
+//   7 type, x, y (tiles) per spawn
+//  22 flags (LEVEL_*)
+#define LEVEL_PADDING_SIZE 24
+#define LEVEL_EXTRA_MAGIC "HHL1"
+
+#define LEVEL_W 100
+#define LEVEL_H 10
+
+// Enemies hunt the nearest player through the level's flow field instead of following the path
+#define LEVEL_HUNTERS (1 << 0)
+
+typedef struct {
+    uint8_t type;
+    uint8_t x;
+    uint8_t y;
+} spawn_t;
+
+typedef struct {
+    uint8_t path[256];
+    uint8_t tiles[LEVEL_W * LEVEL_H];
+
+    // Only set for levels with LEVEL_EXTRA_MAGIC, the rest use the built-in start positions and enemies
+    bool has_extra;
+    uint8_t start_x;
+    uint8_t start_y;
+    uint8_t num_spawns;
+    spawn_t spawns[NUM_ENEMIES];
+    uint8_t flags;
+
+    // Routines for the enemies and the level, from the file next to the level's, see script_load()
+    script_t script;
+} level_t;
+
+// Points around the player that are checked for collisions, one bit each in player_t.collision_points
+#define NUM_COLLISION_POINTS 8
+#define COLLISION_POINT(player, i) (((player).collision_points >> (i)) & 1)
+
+typedef struct {
+    uint16_t px;
+    uint16_t py;
+    int8_t dir;
+} bullet_t;
+
+typedef struct {
+    // Tile grid numbers/locations are 8bit ints. [-128, 127] as there 20x10 tiles
+    int8_t x;
+    int8_t y;
+    // Tile pixel x,y locations are 16bit ints. [-32378, 32377] as there ??x?? pixels in the window
+    int16_t px;
+    int16_t py;
+
+    uint32_t score;
+    uint8_t lives;
+    int8_t tick;
+    int8_t last_dir;
+    // Fuel left when the jetpack was last switched off, see sim_jetpack_fuel() for while it's burning
+    uint8_t jetpack_fuel;
+    uint8_t collision_points;
+
+    // Grid location of an item to pick up, 0 if there is none
+    uint8_t pickup_x;
+    uint8_t pickup_y;
+
+    // What this player sees of the level, so two players can be in different parts of it
+    uint8_t camera_x;
+    uint8_t camera_y;
+    int8_t scroll_x;
+
+    bool try_right : 1;
+    bool try_left : 1;
+    bool try_down : 1;
+    bool try_jump : 1;
+    bool try_up : 1;
+    bool try_fire : 1;
+    bool try_jetpack : 1;
+
+    bool right : 1;
+    bool left : 1;
+    bool up : 1;
+    bool down : 1;
+    bool climb : 1;
+    bool jump : 1;
+    bool fire : 1;
+    bool using_jetpack : 1;
+    // Until the death timer fires
+    bool dying : 1;
+
+    bool on_ground : 1;
+    bool check_door : 1;
+    bool can_climb : 1;
+    bool has_trophy : 1;
+    bool has_gun : 1;
+
+    bullet_t bullet;
+} player_t;
+
+// Gameplay events emitted by the simulation
+enum {
+    EVENT_LEVEL_START,
+    EVENT_LEVEL_CLEARED,
+    EVENT_PICKUP,
+    // Every tick the player overlaps the door
+    EVENT_DOOR_REACHED,
+    EVENT_HAZARD_TOUCHED,
+    EVENT_ENEMY_KILLED,
+    EVENT_PLAYER_DIED,
+    EVENT_LIFE_LOST,
+    EVENT_EXTRA_LIFE,
+    EVENT_PLAYER_FIRED,
+    EVENT_ENEMY_FIRED,
+    EVENT_JETPACK,
+    EVENT_GAME_OVER,
+    EVENT_GAME_WON,
+    // A routine changed a tile, the value is the tile it's now
+    EVENT_TILE_SET,
+    NUM_EVENT_TYPES,
+};
+
+// What killed the player, in the value of EVENT_PLAYER_DIED
+enum {
+    DEATH_BY_HAZARD,
+    DEATH_BY_ENEMY,
+    DEATH_BY_ENEMY_BULLET,
+    NUM_DEATH_CAUSES,
+};
+
+#define MAX_EVENTS_PER_TICK 32
+
+typedef struct {
+    uint8_t type;
+    uint8_t level;
+    // Grid location the event happened at
+    uint8_t x;
+    uint8_t y;
+    // e.g. the tile picked up or the score
+    uint32_t value;
+    // Stamped by whoever publishes the event, the simulation leaves it 0
+    uint32_t tick;
+} game_event_t;
+
+typedef struct {
+    uint8_t count;
+    game_event_t events[MAX_EVENTS_PER_TICK];
+} event_buffer_t;
+
+// Countdowns are timers on the wheel rather than counters ticked down every tick. Each player has one of each of these,
+// then each enemy has a death timer.
+enum {
+    TIMER_DEATH,
+    TIMER_JUMP,
+    TIMER_JETPACK_DELAY,
+    TIMER_JETPACK_FUEL,
+    NUM_PLAYER_TIMERS,
+};
+#define PLAYER_TIMER(player_index, timer) ((player_index) * NUM_PLAYER_TIMERS + (timer))
+#define ENEMY_TIMER(enemy_index) (MAX_PLAYERS * NUM_PLAYER_TIMERS + (enemy_index))
+// NOTE: an enemy's timer counts down its routine's waits until it dies, the level's routine has its own
+#define LEVEL_SCRIPT_TIMER ENEMY_TIMER(NUM_ENEMIES)
+#define NUM_TIMERS (LEVEL_SCRIPT_TIMER + 1)
+_Static_assert(NUM_TIMERS <= TIMER_WHEEL_SIZE, "the timer wheel needs room for every countdown");
+
+// Everything touched every tick. Allocated on a cache line boundary and kept to five cache lines.
+typedef struct {
+    bool is_running;
+    uint8_t tick;
+    uint8_t cur_level;
+    // Players in the game, 1 unless set before sim_start_level()
+    uint8_t num_players;
+
+    bullet_t ebullet;
+    player_t players[MAX_PLAYERS];
+    enemy_t enemies[NUM_ENEMIES];
+    timer_wheel_t timers;
+    routine_t routines[NUM_ROUTINES];
+    // One bit per routine that's running or moving, the waiting ones are left alone until their timer fires
+    uint8_t awake;
+
+    // All levels and the current level, owned by the caller of sim_init()
+    level_t *levels;
+    level_t *level;
+    // Collision masks of every sprite frame, see mask_load_sprites()
+    const mask_t *masks;
+    // Events emitted by the current tick, cleared at the start of each one
+    event_buffer_t *events;
+    // Where hunting enemies go next, only depends on the tiles and where the players are
+    flow_field_t *flow;
+} game_state_t;
+_Static_assert(NUM_ROUTINES <= 8, "awake has a bit per routine");
+_Static_assert(sizeof(game_state_t) <= 5 * 64, "the hot state fits in five cache lines");
+
+// Everything a tick can change: the hot state and the tiles of the current level, which lose items as they're picked up
+typedef struct {
+    game_state_t state;
+    uint8_t tiles[LEVEL_W * LEVEL_H];
+} sim_snapshot_t;
+
+int sim_load_levels(level_t *levels);
+int sim_load_level(level_t *level, const char *fname);
+// The same off the main thread, with what went wrong written to error rather than err_additional
+int sim_read_level(level_t *level, const char *fname, char *error, const size_t error_size);
+int sim_save_level(const level_t *level, const char *fname);
+// Where players start on level index, its own start or the built-in one
+void sim_level_start(const level_t *level, const uint8_t index, uint8_t *x, uint8_t *y);
+// Gives one of the original levels its built-in start position and enemies as its own, so they can be changed
+void sim_level_defaults(level_t *level, const uint8_t index);
+void sim_init(game_state_t *game, level_t *levels, const mask_t *masks, flow_field_t *flow, event_buffer_t *events);
+void sim_start_level(game_state_t *game);
+// Starts a routine of the current level from the beginning, if it has one and its enemy is there
+void sim_restart_routine(game_state_t *game, const uint8_t routine);
+// One input frame (INPUT_*) per player
+void sim_tick(game_state_t *game, const uint8_t *inputs);
+void sim_save(const game_state_t *game, sim_snapshot_t *snapshot);
+void sim_restore(game_state_t *game, const sim_snapshot_t *snapshot);
+uint32_t sim_checksum(const game_state_t *game);
+bool sim_is_solid(const uint8_t tile);
+bool sim_is_hazard(const uint8_t tile);
+// The frame a player or enemy is drawn with, which is also what it collides with
+uint8_t sim_player_tile(const player_t *player);
+uint8_t sim_enemy_tile(const game_state_t *game, const enemy_t *enemy);
+uint8_t sim_jetpack_fuel(const game_state_t *game, const player_t *player);
+// Whether the column of pixels at px is on player's screen
+bool sim_in_view(const player_t *player, const uint16_t px);
+
+#endif // !HH_SIM_H
@@ -0,0 +1,106 @@
+#include "timer.h"
+#include <stddef.h>
+#include <string.h>
+
+static void link(timer_wheel_t *wheel, const uint8_t id);
+static void unlink(timer_wheel_t *wheel, const uint8_t id);
+
+void timer_init(timer_wheel_t *wheel)
+{
+    wheel->now = 0;
+    memset(wheel->heads, TIMER_NONE, sizeof(wheel->heads));
+
+    for (size_t i = 0; i < TIMER_WHEEL_SIZE; i++) {
+        wheel->timers[i] = (timer_entry_t){.slot = TIMER_NONE, .prev = TIMER_NONE, .next = TIMER_NONE};
+    }
+}
+
+void timer_schedule(timer_wheel_t *wheel, const uint8_t id, const uint16_t delay)
+{
+    uint16_t ticks = delay < 1 ? 1 : delay > TIMER_MAX_DELAY ? TIMER_MAX_DELAY : delay;
+
+    unlink(wheel, id);
+    wheel->timers[id].deadline = (uint8_t)(wheel->now + ticks);
+    link(wheel, id);
+}
+
+void timer_cancel(timer_wheel_t *wheel, const uint8_t id) { unlink(wheel, id); }
+
+bool timer_pending(const timer_wheel_t *wheel, const uint8_t id) { return wheel->timers[id].slot != TIMER_NONE; }
+
+uint8_t timer_left(const timer_wheel_t *wheel, const uint8_t id)
+{
+    const timer_entry_t *timer = &wheel->timers[id];
+    return timer->slot != TIMER_NONE ? (uint8_t)(timer->deadline - wheel->now) : 0;
+}
+
+uint8_t timer_advance(timer_wheel_t *wheel, uint8_t *expired)
+{
+    wheel->now++;
+
+    // Each lap of the first level starts by bringing down the timers due during it
+    if (wheel->now % TIMER_WHEEL_SLOTS == 0) {
+        uint8_t slot = TIMER_WHEEL_SLOTS + wheel->now / TIMER_WHEEL_SLOTS;
+        uint8_t id = wheel->heads[slot];
+        wheel->heads[slot] = TIMER_NONE;
+
+        while (id != TIMER_NONE) {
+            uint8_t next = wheel->timers[id].next;
+            wheel->timers[id].slot = TIMER_NONE;
+            link(wheel, id);
+            id = next;
+        }
+    }
+
+    uint8_t slot = wheel->now % TIMER_WHEEL_SLOTS;
+    uint8_t id = wheel->heads[slot];
+    uint8_t count = 0;
+    wheel->heads[slot] = TIMER_NONE;
+
+    for (; id != TIMER_NONE; id = wheel->timers[id].next) {
+        wheel->timers[id].slot = TIMER_NONE;
+
+        // Insertion sort, so what fires first doesn't depend on how the slot was filled
+        uint8_t i = count++;
+        for (; i > 0 && expired[i - 1] > id; i--) {
+            expired[i] = expired[i - 1];
+        }
+        expired[i] = id;
+    }
+
+    return count;
+}
+
+// Timers due before the first level comes round again go in it, the rest wait in the second for their lap
+static void link(timer_wheel_t *wheel, const uint8_t id)
+{
+    timer_entry_t *timer = &wheel->timers[id];
+    uint8_t left = (uint8_t)(timer->deadline - wheel->now);
+
+    timer->slot = left < TIMER_WHEEL_SLOTS ? timer->deadline % TIMER_WHEEL_SLOTS
+                                           : TIMER_WHEEL_SLOTS + timer->deadline / TIMER_WHEEL_SLOTS;
+    timer->prev = TIMER_NONE;
+    timer->next = wheel->heads[timer->slot];
+    if (timer->next != TIMER_NONE) {
+        wheel->timers[timer->next].prev = id;
+    }
+    wheel->heads[timer->slot] = id;
+}
+
+static void unlink(timer_wheel_t *wheel, const uint8_t id)
+{
+    timer_entry_t *timer = &wheel->timers[id];
+    if (timer->slot == TIMER_NONE) {
+        return;
+    }
+
+    if (timer->prev != TIMER_NONE) {
+        wheel->timers[timer->prev].next = timer->next;
+    } else {
+        wheel->heads[timer->slot] = timer->next;
+    }
+    if (timer->next != TIMER_NONE) {
+        wheel->timers[timer->next].prev = timer->prev;
+    }
+    timer->slot = timer->prev = timer->next = TIMER_NONE;
+}
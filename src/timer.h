@@ -0,0 +1,41 @@
+#ifndef HH_TIMER_H
+#define HH_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Two levels of 16 slots: the first a tick each, the second 16 ticks each, which covers TIMER_MAX_DELAY
+#define TIMER_WHEEL_SLOTS 16
+#define TIMER_WHEEL_LEVELS 2
+#define TIMER_MAX_DELAY (TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_SIZE 16
+#define TIMER_NONE 0xff
+
+// NOTE: indices rather than pointers, so a wheel copied with memcpy() e.g. into a snapshot carries on as it was
+typedef struct {
+    // Tick it fires on, wrapping like the wheel's clock
+    uint8_t deadline;
+    // TIMER_NONE when not scheduled, otherwise level * TIMER_WHEEL_SLOTS + slot
+    uint8_t slot;
+    uint8_t prev;
+    uint8_t next;
+} timer_entry_t;
+
+typedef struct {
+    uint8_t now;
+    uint8_t heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    timer_entry_t timers[TIMER_WHEEL_SIZE];
+} timer_wheel_t;
+
+void timer_init(timer_wheel_t *wheel);
+// Fires the timer that many ticks from now, moving it if it's already scheduled. Delays are 1 to TIMER_MAX_DELAY.
+void timer_schedule(timer_wheel_t *wheel, const uint8_t id, const uint16_t delay);
+void timer_cancel(timer_wheel_t *wheel, const uint8_t id);
+bool timer_pending(const timer_wheel_t *wheel, const uint8_t id);
+// Ticks until the timer fires, 0 if it isn't scheduled
+uint8_t timer_left(const timer_wheel_t *wheel, const uint8_t id);
+// Moves the clock on a tick and writes the timers that fire to expired, lowest id first. Returns how many fired.
+// NOTE: only the timers that fire and, once every TIMER_WHEEL_SLOTS ticks, the ones moving down a level are touched.
+uint8_t timer_advance(timer_wheel_t *wheel, uint8_t *expired);
+
+#endif // !HH_TIMER_H
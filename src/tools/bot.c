@@ -0,0 +1,393 @@
+// Sockets and friends are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../sim.h"
+#include "protocol.h"
+#include <SDL.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load tests hh-server. Opens a number of connections from one thread, each playing its own game with random buttons
+// sent every tick, and measures how long it takes an input to show up in an update from the server. Keeps a mirror of
+// what each game looks like from the updates and checks they arrive in order. A finished game is replaced with a new one
+// so the load stays the same.
+//
+// -s takes the script the server plays the start level with (its -s), and checks that the tiles the level's routine
+// sets straight away are in the mirror by the end of the first update on the level.
+//
+//   hh-bot (-u SOCKET_PATH | -t PORT) [-c CONNECTIONS] [-d SECONDS] [-l LEVEL] [-s SCRIPT.hhs]
+
+#define MAX_EPOLL_EVENTS 256
+// Inputs kept waiting for the server to use them, one per tick
+#define SENT_HISTORY 16
+#define IN_BUFFER_SIZE (4 * MAX_UPDATE_SIZE)
+
+typedef struct {
+    int fd;
+    uint32_t game;
+
+    uint32_t seq;
+    uint64_t sent_us[SENT_HISTORY];
+    uint32_t acked;
+
+    bool has_tick;
+    uint32_t tick;
+    view_t view;
+    uint8_t tiles[LEVEL_W * LEVEL_H];
+
+    uint8_t in[IN_BUFFER_SIZE];
+    uint32_t in_size;
+} connection_t;
+
+static const char *socket_path;
+static uint16_t port;
+static uint8_t start_level = LEVEL_1;
+
+static level_t levels[NUM_LEVELS];
+// The tiles the start level's routine sets before it does anything else, with -s
+static uint16_t scripted[SCRIPT_BUDGET];
+static uint8_t scripted_values[SCRIPT_BUDGET];
+static uint8_t num_scripted;
+static connection_t *connections;
+static uint32_t num_connections = 1000;
+static int epoll_fd;
+
+// Stats
+static latency_hist_t latency;
+static uint64_t updates, bytes_in;
+static uint32_t games, dropped, out_of_order, malformed, failed_connects;
+static uint32_t script_checks, script_misses;
+
+static bool connect_game(const uint32_t index);
+static void receive(const uint32_t index);
+static void apply(connection_t *connection, const uint8_t *update, const size_t size);
+static void send_input(const uint32_t index, const uint64_t now);
+static uint8_t random_input(const uint32_t game, const uint32_t seq);
+static void load_scripted(const char *fname);
+
+int main(int argc, char *argv[])
+{
+    uint32_t duration_s = 10;
+    const char *script_fname = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-u", strlen("-u")) == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strncmp(argv[i], "-t", strlen("-t")) == 0 && i + 1 < argc) {
+            port = (uint16_t)atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-c", strlen("-c")) == 0 && i + 1 < argc) {
+            num_connections = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-d", strlen("-d")) == 0 && i + 1 < argc) {
+            duration_s = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-l", strlen("-l")) == 0 && i + 1 < argc) {
+            start_level = (uint8_t)(atoi(argv[++i]) - 1);
+        } else if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            script_fname = argv[++i];
+        }
+    }
+
+    if ((!socket_path && !port) || !num_connections || start_level >= NUM_LEVELS) {
+        fprintf(stderr, "usage: %s (-u SOCKET_PATH | -t PORT) [-c CONNECTIONS] [-d SECONDS] [-l LEVEL] "
+                        "[-s SCRIPT.hhs]\n",
+                argv[0]);
+        return 1;
+    }
+
+    err_handle(sim_load_levels(levels));
+    if (script_fname) {
+        load_scripted(script_fname);
+    }
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    connections = calloc(num_connections, sizeof(connection_t));
+    epoll_fd = epoll_create1(0);
+    if (!connections || epoll_fd < 0) {
+        err_handle(err_fatal(ERR_ALLOC, "bot connections"));
+    }
+
+    for (uint32_t i = 0; i < num_connections; i++) {
+        connections[i].game = i;
+        if (!connect_game(i)) {
+            err_handle(err_fatal(ERR_NET, "couldn't connect to the server"));
+        }
+    }
+
+    printf("%u connections to %s%s for %u s\n", num_connections, socket_path ? socket_path : "localhost",
+           socket_path ? "" : " over TCP", duration_s);
+
+    // Every connection sends once a tick, spread evenly over it. NOTE: input i of round r is due at
+    // start + r * SESSION_TICK_US + i * SESSION_TICK_US / num_connections.
+    uint64_t started = now_us(), end = started + (uint64_t)duration_s * 1000000;
+    uint64_t round = 0;
+    uint32_t next = 0;
+
+    for (;;) {
+        uint64_t now = now_us();
+        if (now >= end) {
+            break;
+        }
+
+        for (;;) {
+            uint64_t due = started + round * SESSION_TICK_US + (uint64_t)next * SESSION_TICK_US / num_connections;
+            if (due > now) {
+                break;
+            }
+
+            send_input(next, now);
+            if (++next == num_connections) {
+                next = 0;
+                round++;
+            }
+        }
+
+        struct epoll_event events[MAX_EPOLL_EVENTS];
+        int n = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, 1);
+        for (int i = 0; i < n; i++) {
+            receive(events[i].data.u32);
+        }
+    }
+
+    double seconds = (double)(now_us() - started) / 1000000.0;
+
+    printf("updates: %lu (%.0f/s), %.1f bytes on average\n", (unsigned long)updates, (double)updates / seconds,
+           updates ? (double)bytes_in / (double)updates : 0.0);
+    printf("games: %u finished, %u dropped by the server, %u failed connections\n", games, dropped, failed_connects);
+    printf("updates: %u out of order, %u malformed\n", out_of_order, malformed);
+    if (script_fname) {
+        printf("scripted tiles: %u levels started, %u missing some of the %u\n", script_checks, script_misses,
+               num_scripted);
+    }
+    printf("input to update: p50 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms\n",
+           latency_percentile(&latency, 50) / 1000.0, latency_percentile(&latency, 99) / 1000.0,
+           latency_percentile(&latency, 99.9) / 1000.0, latency.max_us / 1000.0);
+
+    for (uint32_t i = 0; i < num_connections; i++) {
+        if (connections[i].fd >= 0) {
+            close(connections[i].fd);
+        }
+    }
+    close(epoll_fd);
+    free(connections);
+
+    return out_of_order || malformed || script_misses || (script_fname && !script_checks) ? 1 : 0;
+}
+
+static bool connect_game(const uint32_t index)
+{
+    connection_t *connection = &connections[index];
+    int fd;
+
+    if (socket_path) {
+        struct sockaddr_un address = {0};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        struct sockaddr_in address = {0};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        int on = 1;
+        if (fd >= 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+    }
+
+    connection->fd = fd;
+    if (fd < 0) {
+        failed_connects++;
+        return false;
+    }
+
+    uint8_t hello[MSG_HELLO_SIZE];
+    write_hello(hello, start_level);
+    if (write(fd, hello, sizeof(hello)) != (ssize_t)sizeof(hello)) {
+        close(fd);
+        connection->fd = -1;
+        failed_connects++;
+        return false;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = index};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+
+    connection->seq = 0;
+    connection->acked = 0;
+    connection->has_tick = false;
+    connection->in_size = 0;
+    view_init(&connection->view);
+
+    return true;
+}
+
+static void receive(const uint32_t index)
+{
+    connection_t *connection = &connections[index];
+
+    for (;;) {
+        ssize_t got = read(connection->fd, &connection->in[connection->in_size],
+                           IN_BUFFER_SIZE - connection->in_size);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+
+        // The server hangs up once the game is over, or if this end fell too far behind. Either way start another game.
+        if (got <= 0) {
+            if (connection->view.is_running) {
+                dropped++;
+            } else {
+                games++;
+            }
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+            close(connection->fd);
+            connection->game += num_connections;
+            connect_game(index);
+            return;
+        }
+
+        bytes_in += (uint64_t)got;
+        connection->in_size += (uint32_t)got;
+
+        uint32_t used = 0;
+        while (connection->in_size - used >= 2) {
+            size_t size = connection->in[used] | connection->in[used + 1] << 8;
+            if (connection->in_size - used < 2 + size) {
+                break;
+            }
+            apply(connection, &connection->in[used + 2], size);
+            used += 2 + (uint32_t)size;
+        }
+
+        memmove(connection->in, &connection->in[used], connection->in_size - used);
+        connection->in_size -= used;
+    }
+}
+
+static void apply(connection_t *connection, const uint8_t *update, const size_t size)
+{
+    uint8_t level = connection->view.level;
+    uint32_t tick, ack;
+
+    if (!read_update(update, size, &tick, &ack, &connection->view)) {
+        malformed++;
+        return;
+    }
+    updates++;
+
+    if ((connection->has_tick && tick != connection->tick + 1) || (!connection->has_tick && tick != 0)) {
+        out_of_order++;
+    }
+    connection->has_tick = true;
+    connection->tick = tick;
+
+    // A new level starts with its tiles as loaded, then loses whatever is picked up and changes what routines set
+    bool new_level = connection->view.level != level && connection->view.level < NUM_LEVELS;
+    if (new_level) {
+        memcpy(connection->tiles, levels[connection->view.level].tiles, sizeof(connection->tiles));
+    }
+    for (size_t i = 0; i < connection->view.num_tiles; i++) {
+        if (connection->view.tiles[i] < LEVEL_W * LEVEL_H) {
+            connection->tiles[connection->view.tiles[i]] = connection->view.tile_values[i];
+        }
+    }
+
+    // NOTE: the routine runs in the tick that starts the level, so the server must have sent its tiles already
+    if (new_level && num_scripted && connection->view.level == start_level) {
+        script_checks++;
+        for (uint8_t i = 0; i < num_scripted; i++) {
+            if (connection->tiles[scripted[i]] != scripted_values[i]) {
+                script_misses++;
+                break;
+            }
+        }
+    }
+
+    // Measured from when the input was sent to the first update after the server used it
+    if (ack > connection->acked && connection->seq - ack < SENT_HISTORY) {
+        latency_add(&latency, now_us() - connection->sent_us[ack % SENT_HISTORY]);
+        connection->acked = ack;
+    }
+}
+
+static void send_input(const uint32_t index, const uint64_t now)
+{
+    connection_t *connection = &connections[index];
+    if (connection->fd < 0) {
+        return;
+    }
+
+    uint8_t msg[MSG_INPUT_SIZE];
+    uint32_t seq = ++connection->seq;
+    write_input(msg, random_input(connection->game, seq), seq);
+
+    connection->sent_us[seq % SENT_HISTORY] = now;
+    if (send(connection->fd, msg, sizeof(msg), MSG_NOSIGNAL) != (ssize_t)sizeof(msg)) {
+        // NOTE: a full socket means the server is behind, which the latency will show
+        connection->seq--;
+    }
+}
+
+// Holds a random combination of buttons for a few ticks at a time
+static uint8_t random_input(const uint32_t game, const uint32_t seq)
+{
+    uint64_t hash = ((uint64_t)game * 0x9e3779b97f4a7c15ULL) ^ (seq / 8);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return hash & 0x7f;
+}
+
+static void load_scripted(const char *fname)
+{
+    script_t script;
+    err_handle(script_load(&script, fname));
+    if (script.entry[LEVEL_ROUTINE] == SCRIPT_NONE) {
+        err_handle(err_fatal(ERR_SCRIPT, "the script has no level routine"));
+    }
+
+    for (uint16_t pc = script.entry[LEVEL_ROUTINE]; pc < script.size && num_scripted < SCRIPT_BUDGET;) {
+        const uint8_t *op = &script.code[pc];
+        if (op[0] != SCRIPT_SET_TILE) {
+            break;
+        }
+        scripted[num_scripted] = (uint16_t)(op[2] * LEVEL_W + op[1]);
+        scripted_values[num_scripted++] = op[3];
+        pc += script_op_size(op[0]);
+    }
+
+    if (!num_scripted) {
+        err_handle(err_fatal(ERR_SCRIPT, "the level routine doesn't start by setting tiles"));
+    }
+}
@@ -0,0 +1,166 @@
+// shm_open(), mmap() and friends are POSIX, not C11
+#define _POSIX_C_SOURCE 200112L
+
+#include "feed_reader.h"
+#include "../error.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Attempts at copying a slot the game keeps writing to before giving up for now
+#define MAX_TRIES 4
+
+static int load(const SDL_atomic_t *atomic);
+static bool read_frame(feed_reader_t *reader, const uint32_t number, feed_frame_t *frame);
+
+int feed_reader_open(feed_reader_t *reader, const char *name)
+{
+    memset(reader, 0, sizeof(feed_reader_t));
+
+    reader->fd = shm_open(name, O_RDONLY, 0);
+    if (reader->fd < 0) {
+        return err_fatal(ERR_FEED, strerror(errno));
+    }
+
+    // NOTE: the game may have created the object but not sized it yet
+    struct stat info;
+    if (fstat(reader->fd, &info) != 0 || (size_t)info.st_size < sizeof(feed_shared_t)) {
+        close(reader->fd);
+        return err_fatal(ERR_FEED, "not ready yet");
+    }
+
+    void *shared = mmap(NULL, sizeof(feed_shared_t), PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (shared == MAP_FAILED) {
+        close(reader->fd);
+        return err_fatal(ERR_FEED, strerror(errno));
+    }
+    reader->shared = shared;
+
+    SDL_MemoryBarrierAcquire();
+    if (memcmp(reader->shared->magic, FEED_MAGIC, sizeof(reader->shared->magic)) != 0 ||
+        reader->shared->version != FEED_VERSION || reader->shared->frame_size != sizeof(feed_frame_t) ||
+        reader->shared->num_slots != FEED_SLOTS) {
+        feed_reader_close(reader);
+        return err_fatal(ERR_FEED, "not a feed this reader understands");
+    }
+
+    // Start from the frame on screen now rather than waiting for the next one
+    uint32_t published = (uint32_t)load(&reader->shared->published);
+    reader->next = published ? published - 1 : 0;
+
+    return SUCCESS;
+}
+
+int feed_reader_next(feed_reader_t *reader, feed_frame_t *frame)
+{
+    uint32_t published = (uint32_t)load(&reader->shared->published);
+
+    if (published == reader->next) {
+        return FEED_NONE;
+    }
+
+    // Too far behind to still be in the ring, or a new game started counting from 0 again. NOTE: a frame a whole turn
+    // of the ring behind is being written over next, so that one is out too.
+    if (published - reader->next >= FEED_SLOTS || published < reader->next) {
+        reader->skipped++;
+        return feed_reader_latest(reader, frame) ? FEED_SKIPPED : FEED_NONE;
+    }
+
+    if (!read_frame(reader, reader->next, frame)) {
+        // Overwritten while being read, so this reader has fallen behind
+        reader->skipped++;
+        return feed_reader_latest(reader, frame) ? FEED_SKIPPED : FEED_NONE;
+    }
+
+    reader->next++;
+    reader->frames++;
+
+    return FEED_FRAME;
+}
+
+bool feed_reader_latest(feed_reader_t *reader, feed_frame_t *frame)
+{
+    for (uint32_t i = 0; i < MAX_TRIES; i++) {
+        uint32_t published = (uint32_t)load(&reader->shared->published);
+        if (!published) {
+            return false;
+        }
+
+        if (read_frame(reader, published - 1, frame)) {
+            reader->next = published;
+            reader->frames++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void feed_reader_tiles(const feed_reader_t *reader, uint8_t *level, uint8_t *tiles)
+{
+    const feed_shared_t *shared = reader->shared;
+
+    for (;;) {
+        int before = load(&shared->tiles_seq);
+        if (before & 1) {
+            continue;
+        }
+
+        *level = shared->level;
+        memcpy(tiles, shared->tiles, sizeof(shared->tiles));
+
+        SDL_MemoryBarrierAcquire();
+        if (load(&shared->tiles_seq) == before) {
+            return;
+        }
+    }
+}
+
+void feed_reader_close(feed_reader_t *reader)
+{
+    if (!reader->shared) {
+        return;
+    }
+
+    munmap((void *)reader->shared, sizeof(feed_shared_t));
+    close(reader->fd);
+    reader->shared = NULL;
+}
+
+// NOTE: the mapping is read-only, which rules out SDL_AtomicGet() as it may be built on compare-and-swap
+static int load(const SDL_atomic_t *atomic)
+{
+    int value = *(const volatile int *)&atomic->value;
+    SDL_MemoryBarrierAcquire();
+
+    return value;
+}
+
+static bool read_frame(feed_reader_t *reader, const uint32_t number, feed_frame_t *frame)
+{
+    const feed_slot_t *slot = &reader->shared->slots[number % FEED_SLOTS];
+
+    for (uint32_t i = 0; i < MAX_TRIES; i++) {
+        int before = load(&slot->seq);
+        if (before & 1) {
+            reader->torn++;
+            continue;
+        }
+
+        memcpy(frame, &slot->frame, sizeof(feed_frame_t));
+
+        SDL_MemoryBarrierAcquire();
+        if (load(&slot->seq) != before) {
+            reader->torn++;
+            continue;
+        }
+
+        // Still the frame wanted rather than one a turn of the ring later
+        return frame->frame == number;
+    }
+
+    return false;
+}
@@ -0,0 +1,51 @@
+#ifndef HH_FEED_READER_H
+#define HH_FEED_READER_H
+
+#include "../feed.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Follows a game's state feed from another process. Readers only ever read the shared memory, so any number of them
+// can follow one game without it noticing.
+//
+//   feed_reader_t reader;
+//   err_handle(feed_reader_open(&reader, FEED_DEFAULT_NAME));
+//   feed_frame_t frame;
+//   while (...) {
+//       if (feed_reader_next(&reader, &frame) == FEED_FRAME) { ... }
+//   }
+//   feed_reader_close(&reader);
+
+enum {
+    // Nothing new since the last frame
+    FEED_NONE,
+    FEED_FRAME,
+    // Fell more than FEED_SLOTS behind, or the game started again, and skipped to the latest frame
+    FEED_SKIPPED,
+};
+
+typedef struct {
+    int fd;
+    const feed_shared_t *shared;
+
+    // Next frame wanted
+    uint32_t next;
+
+    // Stats
+    uint32_t frames;
+    uint32_t skipped;
+    // Copies thrown away because the game was writing the slot at the time
+    uint32_t torn;
+} feed_reader_t;
+
+int feed_reader_open(feed_reader_t *reader, const char *name);
+// The frame after the last one read, FEED_SKIPPED means frame is the latest one instead
+int feed_reader_next(feed_reader_t *reader, feed_frame_t *frame);
+// The newest frame, skipping anything in between. False if there hasn't been one yet.
+bool feed_reader_latest(feed_reader_t *reader, feed_frame_t *frame);
+// The current level's tiles, for starting a mirror of the level or after a frame with all_tiles set
+void feed_reader_tiles(const feed_reader_t *reader, uint8_t *level, uint8_t *tiles);
+void feed_reader_close(feed_reader_t *reader);
+
+#endif // !HH_FEED_READER_H
@@ -0,0 +1,206 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../feed.h"
+#include "../sim.h"
+#include "feed_reader.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Follows a running game's state feed and draws what one of the players sees as text, e.g. to watch a game over ssh. A
+// sample of using the feed reader: it mirrors the level from the changed tiles in each frame rather than the game's
+// memory.
+//
+//   hh-feed-view [-n FEED_NAME] [-p PLAYER] [-1]
+//
+// -1 prints a single frame and exits.
+
+#define VIEW_W 20
+#define POLL_MS 5
+#define OPEN_TIMEOUT_MS 5000
+
+static uint8_t level = UINT8_MAX;
+static uint8_t tiles[LEVEL_W * LEVEL_H];
+
+static void mirror(const feed_reader_t *reader, const feed_frame_t *frame);
+static void draw(const feed_reader_t *reader, const feed_frame_t *frame, const uint8_t player, const bool clear);
+static char tile_char(const uint8_t tile);
+
+int main(int argc, char *argv[])
+{
+    const char *name = FEED_DEFAULT_NAME;
+    uint8_t player = 0;
+    bool once = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-n", strlen("-n")) == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strncmp(argv[i], "-p", strlen("-p")) == 0 && i + 1 < argc) {
+            player = (uint8_t)(atoi(argv[++i]) - 1);
+        } else if (strncmp(argv[i], "-1", strlen("-1")) == 0) {
+            once = true;
+        }
+    }
+    if (player >= MAX_PLAYERS) {
+        player = 0;
+    }
+
+    // The game may not have started yet
+    feed_reader_t reader;
+    int err;
+    for (uint32_t waited = 0; (err = feed_reader_open(&reader, name)) != SUCCESS; waited += 100) {
+        if (waited >= OPEN_TIMEOUT_MS) {
+            err_handle(err);
+        }
+        memset(err_additional, 0, sizeof(err_additional));
+        SDL_Delay(100);
+    }
+
+    feed_frame_t frame;
+    bool running = true;
+
+    while (running) {
+        int got = feed_reader_next(&reader, &frame);
+        if (got == FEED_NONE) {
+            SDL_Delay(POLL_MS);
+            continue;
+        }
+
+        mirror(&reader, &frame);
+        draw(&reader, &frame, player, !once);
+
+        running = frame.is_running && !once;
+    }
+
+    feed_reader_close(&reader);
+
+    return 0;
+}
+
+// Keeps the local copy of the level up to date, going back to the shared copy only when the frame's list of changes
+// isn't enough
+static void mirror(const feed_reader_t *reader, const feed_frame_t *frame)
+{
+    if (frame->all_tiles || frame->level != level) {
+        feed_reader_tiles(reader, &level, tiles);
+        return;
+    }
+
+    for (size_t i = 0; i < frame->num_tiles; i++) {
+        tiles[frame->tiles[i]] = frame->tile_values[i];
+    }
+}
+
+static void draw(const feed_reader_t *reader, const feed_frame_t *frame, const uint8_t player, const bool clear)
+{
+    char screen[LEVEL_H][VIEW_W + 1];
+    const feed_player_t *me = &frame->players[player];
+    int16_t left = me->camera_x * TILE_SIZE;
+
+    for (int y = 0; y < LEVEL_H; y++) {
+        for (int x = 0; x < VIEW_W; x++) {
+            uint8_t column = me->camera_x + x;
+            screen[y][x] = column < LEVEL_W ? tile_char(tiles[y * LEVEL_W + column]) : ' ';
+        }
+        screen[y][VIEW_W] = '\0';
+    }
+
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        const feed_enemy_t *enemy = &frame->enemies[i];
+        int x = (enemy->px - left) / TILE_SIZE, y = enemy->py / TILE_SIZE;
+        if (enemy->type && x >= 0 && x < VIEW_W && y >= 0 && y < LEVEL_H) {
+            screen[y][x] = enemy->dying ? '*' : 'E';
+        }
+    }
+
+    const bullet_t *bullets[MAX_PLAYERS + 1] = {&frame->ebullet};
+    for (size_t i = 0; i < frame->num_players; i++) {
+        bullets[i + 1] = &frame->players[i].bullet;
+    }
+    for (size_t i = 0; i < frame->num_players + 1u; i++) {
+        int x = (bullets[i]->px - left) / TILE_SIZE, y = bullets[i]->py / TILE_SIZE;
+        if (bullets[i]->px && x >= 0 && x < VIEW_W && y >= 0 && y < LEVEL_H) {
+            screen[y][x] = '-';
+        }
+    }
+
+    for (uint8_t i = 0; i < frame->num_players; i++) {
+        const feed_player_t *harry = &frame->players[i];
+        int x = (harry->px - left + TILE_SIZE / 2) / TILE_SIZE, y = (harry->py + TILE_SIZE / 2) / TILE_SIZE;
+        if (x >= 0 && x < VIEW_W && y >= 0 && y < LEVEL_H) {
+            screen[y][x] = harry->flags & FEED_DYING ? 'X' : i == player ? '@' : '&';
+        }
+    }
+
+    if (clear) {
+        printf("\033[H\033[2J");
+    }
+    printf("level %u  score %u  lives %u  fuel %u%s%s\n", frame->level + 1, me->score, me->lives, me->jetpack_fuel,
+           me->flags & FEED_HAS_TROPHY ? "  trophy" : "", me->flags & FEED_HAS_GUN ? "  gun" : "");
+    printf("+--------------------+\n");
+    for (int y = 0; y < LEVEL_H; y++) {
+        printf("|%s|\n", screen[y]);
+    }
+    printf("+--------------------+\n");
+    printf("frame %u, %u read, %u skipped, %u torn%s\n", frame->frame, reader->frames, reader->skipped, reader->torn,
+           frame->is_running ? "" : "  GAME OVER");
+    fflush(stdout);
+}
+
+static char tile_char(const uint8_t tile)
+{
+    switch (tile) {
+    case 0:
+        return ' ';
+    case TILE_DOOR:
+        return 'D';
+    case TILE_JETPACK:
+        return 'J';
+    case TILE_TROPHY:
+        return 'T';
+    case TILE_GUN:
+        return 'G';
+    // Hazards
+    case 6:
+    case 25:
+    case 36:
+        return '~';
+    // Items worth points
+    case 47:
+    case 48:
+    case 49:
+    case 50:
+    case 51:
+    case 52:
+        return 'o';
+    // Climbable
+    case TILE_TREE_1:
+    case TILE_TREE_2:
+    case TILE_TREE_3:
+    case TILE_STAR:
+        return '|';
+    // Solid, the same tiles the simulation collides with
+    case 1:
+    case 3:
+    case 5:
+    case 15:
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+    case 21:
+    case 22:
+    case 23:
+    case 24:
+    case 29:
+    case 30:
+        return '#';
+    // Scenery
+    default:
+        return '.';
+    }
+}
@@ -0,0 +1,733 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../log.h"
+#include "../mask.h"
+#include "../replay.h"
+#include "../sim.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fuzzes the simulation with mutated input sequences on every core, checking invariants after every tick. Runs that
+// reach a state no run has reached before join the corpus to be mutated further, and a run that breaks an invariant is
+// shrunk and saved as a replay (<invariant>.hhr in the output directory, one per invariant) that `make replay` plays.
+//
+//   hh-fuzz [-j THREADS] [-s SEED] [-t SECONDS] [-l LEVEL] [-o OUT_DIR] [SEED_REPLAY...]
+//   hh-fuzz -r CRASH_FILE REPLAY
+//
+// Built with -DHH_LIBFUZZER (make fuzz-libfuzzer) it's a libFuzzer target instead, guided by code coverage: the first
+// byte is the level and the rest one input per tick, and -r turns the crash files libFuzzer finds into replays.
+
+#define MAX_WORKERS 64
+#define MAX_PATH_SIZE 512
+#define MAX_CORPUS 8192
+// A little over a minute of play, long enough to get through any level
+#define MAX_RUN_TICKS 2048
+// Runs tried while shrinking a failure
+#define MAX_SHRINK_RUNS 4096
+
+// Features are hashed into this many bits, see feature()
+#define COVERAGE_BITS (1 << 20)
+#define ALL_INPUTS ((1 << NUM_INPUT_BUTTONS) - 1)
+
+// What a run broke, one replay is saved for each
+enum {
+    BROKE_NOTHING,
+    BROKE_LEVEL,
+    BROKE_POSITION,
+    BROKE_CAMERA,
+    BROKE_SOLID,
+    BROKE_SCORE,
+    BROKE_LIVES,
+    BROKE_FUEL,
+    BROKE_ENEMY,
+    NUM_INVARIANTS,
+};
+
+static const char *INVARIANT_NAMES[NUM_INVARIANTS] = {
+    "nothing",       "level_in_range", "player_in_level", "camera_in_range", "player_not_in_wall",
+    "score_rises",   "lives_bounded",  "fuel_burns",      "enemy_in_level",
+};
+
+typedef struct {
+    uint8_t start_level;
+    uint32_t num_ticks;
+    uint8_t inputs[MAX_RUN_TICKS];
+} run_t;
+
+typedef struct {
+    uint8_t invariant;
+    uint8_t player;
+    uint32_t tick;
+    uint32_t ticks_run;
+} outcome_t;
+
+// What the previous tick left, to compare the next one against
+typedef struct {
+    uint32_t score[MAX_PLAYERS];
+    uint8_t fuel[MAX_PLAYERS];
+    bool using_jetpack[MAX_PLAYERS];
+} history_t;
+
+typedef struct {
+    uint8_t id;
+    SDL_Thread *thread;
+    uint64_t rng;
+
+    // The level copies and game each run is executed in, reset from the loaded levels at the start of every run
+    level_t levels[NUM_LEVELS];
+    game_state_t game;
+    event_buffer_t events;
+    flow_field_t flow;
+    run_t run;
+    run_t shrunk;
+    // Features this worker has seen, checked before the shared coverage so it's only touched for new ones
+    uint8_t seen[COVERAGE_BITS / 8];
+    uint32_t new_features;
+    uint32_t broke[NUM_INVARIANTS];
+
+    // Read by the main thread for the progress line
+    SDL_atomic_t runs;
+    SDL_atomic_t ticks;
+} worker_t;
+
+static level_t levels[NUM_LEVELS];
+static mask_t masks[NUM_TILES];
+
+static SDL_atomic_t coverage[COVERAGE_BITS / 32];
+static SDL_atomic_t num_features;
+
+#ifndef HH_LIBFUZZER
+static const char *out_dir = ".";
+// -1 for any level
+static int only_level = -1;
+
+static run_t *corpus;
+static SDL_atomic_t corpus_size;
+static SDL_SpinLock corpus_lock;
+static SDL_atomic_t reported[NUM_INVARIANTS];
+static SDL_atomic_t stop;
+
+static worker_t *workers;
+static uint8_t num_workers;
+#endif
+
+static outcome_t execute(worker_t *worker, const run_t *run, const bool track);
+static uint8_t check_invariants(const game_state_t *game, history_t *history, uint8_t *player);
+static bool in_wall(const game_state_t *game, const player_t *player);
+static void record_history(const game_state_t *game, history_t *history);
+static void cover(worker_t *worker, const uint32_t feature);
+static uint32_t feature(const uint32_t a, const uint32_t b);
+static void from_bytes(run_t *run, const uint8_t *data, const size_t size);
+
+#ifndef HH_LIBFUZZER
+static int SDLCALL worker_run(void *data);
+static void mutate(worker_t *worker, run_t *run);
+static void random_run(worker_t *worker, run_t *run);
+static void hold(run_t *run, const uint32_t start, const uint32_t len, const uint8_t input);
+static void add_to_corpus(const run_t *run);
+static void shrink(worker_t *worker, run_t *run, const outcome_t *outcome);
+static bool still_breaks(worker_t *worker, const run_t *run, const uint8_t invariant, uint32_t *ticks);
+static int save_replay(worker_t *worker, const run_t *run, const char *fname);
+static uint64_t next_random(worker_t *worker);
+static uint32_t random_below(worker_t *worker, const uint32_t n);
+#endif
+
+#ifdef HH_LIBFUZZER
+
+// Allocated on the first run, libFuzzer runs one input at a time
+static worker_t *single;
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (!single) {
+        err_handle(sim_load_levels(levels));
+        err_handle(mask_load_sprites(masks));
+        single = calloc(1, sizeof(worker_t));
+        if (!single) {
+            err_handle(err_fatal(ERR_ALLOC, "fuzzer worker"));
+        }
+    }
+
+    from_bytes(&single->run, data, size);
+    outcome_t outcome = execute(single, &single->run, false);
+    if (outcome.invariant != BROKE_NOTHING) {
+        fprintf(stderr, "%s broken by player %u on tick %u of level %u\n", INVARIANT_NAMES[outcome.invariant],
+                outcome.player + 1, outcome.tick, single->run.start_level + 1);
+        // NOTE: libFuzzer treats the abort as the crash, then minimises it with -minimize_crash=1
+        abort();
+    }
+
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+    int threads = SDL_GetCPUCount();
+    uint64_t seed = SDL_GetPerformanceCounter();
+    uint32_t seconds_limit = 60;
+    const char *crash_fname = NULL;
+    const char *seeds[MAX_CORPUS];
+    uint32_t num_seeds = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-j", strlen("-j")) == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-t", strlen("-t")) == 0 && i + 1 < argc) {
+            seconds_limit = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-l", strlen("-l")) == 0 && i + 1 < argc) {
+            only_level = atoi(argv[++i]) - 1;
+        } else if (strncmp(argv[i], "-o", strlen("-o")) == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strncmp(argv[i], "-r", strlen("-r")) == 0 && i + 1 < argc) {
+            crash_fname = argv[++i];
+        } else if (argv[i][0] != '-' && num_seeds < MAX_CORPUS) {
+            seeds[num_seeds++] = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [-j THREADS] [-s SEED] [-t SECONDS] [-l LEVEL] [-o OUT_DIR] [SEED_REPLAY...]\n"
+                            "       %s -r CRASH_FILE REPLAY\n",
+                    argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (only_level >= NUM_LEVELS) {
+        fprintf(stderr, "levels are 1 to %d\n", NUM_LEVELS);
+        return 1;
+    }
+
+    num_workers = threads < 1 ? 1 : threads > MAX_WORKERS ? MAX_WORKERS : (uint8_t)threads;
+
+    err_handle(sim_load_levels(levels));
+    err_handle(mask_load_sprites(masks));
+
+    workers = calloc(num_workers, sizeof(worker_t));
+    corpus = malloc(MAX_CORPUS * sizeof(run_t));
+    if (!workers || !corpus) {
+        err_handle(err_fatal(ERR_ALLOC, "fuzzer workers"));
+    }
+
+    // Converting what libFuzzer found
+    if (crash_fname) {
+        if (num_seeds != 1) {
+            fprintf(stderr, "-r needs the replay to write\n");
+            return 1;
+        }
+
+        FILE *fd = fopen(crash_fname, "rb");
+        if (!fd) {
+            err_handle(err_fatal(ERR_OPENING_FILE, crash_fname));
+        }
+        static uint8_t bytes[MAX_RUN_TICKS + 1];
+        size_t size = fread(bytes, 1, sizeof(bytes), fd);
+        fclose(fd);
+
+        from_bytes(&workers[0].run, bytes, size);
+        outcome_t outcome = execute(&workers[0], &workers[0].run, false);
+        printf("%s: %s on tick %u\n", crash_fname, INVARIANT_NAMES[outcome.invariant], outcome.tick);
+        err_handle(save_replay(&workers[0], &workers[0].run, seeds[0]));
+
+        return 0;
+    }
+
+    // Runs to start from, cut down to the longest run fuzzed
+    static replay_t replay;
+    for (uint32_t i = 0; i < num_seeds; i++) {
+        if (replay_load(&replay, seeds[i]) != SUCCESS) {
+            fprintf(stderr, "%s: couldn't read replay\n", seeds[i]);
+            continue;
+        }
+
+        run_t *run = &workers[0].run;
+        run->start_level = replay.start_level;
+        run->num_ticks = replay.num_ticks < MAX_RUN_TICKS ? replay.num_ticks : MAX_RUN_TICKS;
+        memcpy(run->inputs, replay.inputs, run->num_ticks);
+        add_to_corpus(run);
+    }
+
+    for (uint8_t i = 0; i < num_workers; i++) {
+        workers[i].id = i;
+        workers[i].rng = seed * 0x9e3779b97f4a7c15ULL + i + 1;
+    }
+
+    printf("fuzzing on %u threads with seed %llu, %u seed replays\n", num_workers, (unsigned long long)seed,
+           SDL_AtomicGet(&corpus_size));
+
+    uint64_t started = SDL_GetPerformanceCounter();
+
+    for (uint8_t i = 0; i < num_workers; i++) {
+        workers[i].thread = SDL_CreateThread(worker_run, "fuzzer", &workers[i]);
+        if (!workers[i].thread) {
+            fprintf(stderr, "couldn't start worker %u: %s\n", i, SDL_GetError());
+        }
+    }
+
+    // The main thread reports progress once a second
+    uint64_t total_runs = 0, total_ticks = 0, last_ticks = 0;
+    uint32_t seen_runs[MAX_WORKERS] = {0}, seen_ticks[MAX_WORKERS] = {0};
+    for (uint32_t second = 1; !seconds_limit || second <= seconds_limit; second++) {
+        SDL_Delay(1000);
+
+        // NOTE: the counters wrap, only the change since the last look matters
+        for (uint8_t i = 0; i < num_workers; i++) {
+            uint32_t runs = (uint32_t)SDL_AtomicGet(&workers[i].runs);
+            uint32_t ticks = (uint32_t)SDL_AtomicGet(&workers[i].ticks);
+            total_runs += runs - seen_runs[i];
+            total_ticks += ticks - seen_ticks[i];
+            seen_runs[i] = runs;
+            seen_ticks[i] = ticks;
+        }
+
+        printf("%4us: %llu runs, %llu ticks (%.2fM ticks/s), corpus %d, features %d\n", second,
+               (unsigned long long)total_runs, (unsigned long long)total_ticks, (total_ticks - last_ticks) / 1e6,
+               SDL_AtomicGet(&corpus_size), SDL_AtomicGet(&num_features));
+        fflush(stdout);
+        last_ticks = total_ticks;
+    }
+
+    SDL_AtomicSet(&stop, 1);
+    uint32_t broke[NUM_INVARIANTS] = {0}, failures = 0;
+    for (uint8_t i = 0; i < num_workers; i++) {
+        if (workers[i].thread) {
+            SDL_WaitThread(workers[i].thread, NULL);
+        }
+        for (uint8_t j = BROKE_NOTHING + 1; j < NUM_INVARIANTS; j++) {
+            broke[j] += workers[i].broke[j];
+            failures += workers[i].broke[j];
+        }
+    }
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - started) / (double)SDL_GetPerformanceFrequency();
+    printf("%llu ticks in %.1f s (%.2fM ticks/s), %u runs broke an invariant\n", (unsigned long long)total_ticks,
+           seconds, seconds > 0 ? total_ticks / seconds / 1e6 : 0, failures);
+    for (uint8_t i = BROKE_NOTHING + 1; i < NUM_INVARIANTS; i++) {
+        if (SDL_AtomicGet(&reported[i])) {
+            printf("  %s: %u runs, shrunk into %s/%s.hhr\n", INVARIANT_NAMES[i], broke[i], out_dir, INVARIANT_NAMES[i]);
+        }
+    }
+
+    free(corpus);
+    free(workers);
+
+    return failures ? 1 : 0;
+}
+
+#endif
+
+
+static outcome_t execute(worker_t *worker, const run_t *run, const bool track)
+{
+    game_state_t *game = &worker->game;
+    outcome_t outcome = {BROKE_NOTHING, 0, 0, 0};
+    history_t history;
+
+    // Start from the untouched levels, a previous run may have picked items up or had scripts change tiles
+    memcpy(worker->levels, levels, sizeof(levels));
+    sim_init(game, worker->levels, masks, &worker->flow, &worker->events);
+    game->cur_level = run->start_level;
+    sim_start_level(game);
+    record_history(game, &history);
+
+    for (uint32_t tick = 0; tick < run->num_ticks && game->is_running; tick++) {
+        sim_tick(game, &run->inputs[tick]);
+        outcome.ticks_run++;
+
+        outcome.invariant = check_invariants(game, &history, &outcome.player);
+        if (outcome.invariant != BROKE_NOTHING) {
+            outcome.tick = tick;
+            return outcome;
+        }
+
+        if (track) {
+            // Where each player is and what they're doing, and everything that happened
+            for (size_t i = 0; i < game->num_players; i++) {
+                const player_t *player = &game->players[i];
+                uint32_t state = player->on_ground | player->jump << 1 | player->using_jetpack << 2 |
+                                 player->climb << 3 | player->dying << 4 | player->has_gun << 5 |
+                                 player->has_trophy << 6;
+                cover(worker, feature(game->cur_level << 16 | (uint8_t)player->x << 8 | (uint8_t)player->y, state));
+            }
+            for (uint8_t i = 0; i < worker->events.count; i++) {
+                const game_event_t *event = &worker->events.events[i];
+                cover(worker, feature(1u << 31 | event->type << 24 | event->level << 16 | event->x << 8 | event->y,
+                                      event->value));
+            }
+        }
+    }
+
+    return outcome;
+}
+
+// What each tick has to leave true, the player number is set for those about a player
+static uint8_t check_invariants(const game_state_t *game, history_t *history, uint8_t *player_index)
+{
+    if (game->cur_level >= NUM_LEVELS) {
+        return BROKE_LEVEL;
+    }
+
+    for (uint8_t i = 0; i < game->num_players; i++) {
+        const player_t *player = &game->players[i];
+        *player_index = i;
+
+        // NOTE: falling out of the bottom of the level comes back in at the top, a tile above it
+        if (player->x < 0 || player->x >= LEVEL_W || player->y < 0 || player->y >= LEVEL_H || player->px < 0 ||
+            player->px > (LEVEL_W - 1) * TILE_SIZE || player->py < -TILE_SIZE || player->py >= LEVEL_H * TILE_SIZE) {
+            return BROKE_POSITION;
+        }
+        if (player->camera_x > LEVEL_W - 20) {
+            return BROKE_CAMERA;
+        }
+        if (in_wall(game, player)) {
+            return BROKE_SOLID;
+        }
+        if (player->score < history->score[i]) {
+            return BROKE_SCORE;
+        }
+        if (player->lives > NUM_START_LIVES + player->score / SCORE_NEW_LIFE) {
+            return BROKE_LIVES;
+        }
+
+        // Burning the whole time since the last tick means there's less left
+        uint8_t fuel = sim_jetpack_fuel(game, player);
+        if (player->using_jetpack && history->using_jetpack[i] && fuel >= history->fuel[i]) {
+            return BROKE_FUEL;
+        }
+    }
+
+    for (uint8_t i = 0; i < NUM_ENEMIES; i++) {
+        const enemy_t *enemy = &game->enemies[i];
+        if (enemy->type && (enemy->x >= LEVEL_W || enemy->y >= LEVEL_H)) {
+            *player_index = 0;
+            return BROKE_ENEMY;
+        }
+    }
+
+    record_history(game, history);
+
+    return BROKE_NOTHING;
+}
+
+// Whether the middle of the player overlaps a solid tile. NOTE: the points it collides with are a step further out, as
+// a move can take it up to PLAYER_MOVE into a wall before they stop it.
+static bool in_wall(const game_state_t *game, const player_t *player)
+{
+    static const uint8_t POINTS[][2] = {{5, 2}, {9, 2}, {5, 13}, {9, 13}};
+
+    for (size_t i = 0; i < sizeof(POINTS) / sizeof(POINTS[0]); i++) {
+        int x = (player->px + POINTS[i][0]) / TILE_SIZE;
+        int y = (player->py + POINTS[i][1]) / TILE_SIZE;
+        if (player->py + POINTS[i][1] < 0 || x >= LEVEL_W || y >= LEVEL_H) {
+            continue;
+        }
+        if (sim_is_solid(game->level->tiles[y * LEVEL_W + x])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void record_history(const game_state_t *game, history_t *history)
+{
+    for (uint8_t i = 0; i < game->num_players; i++) {
+        history->score[i] = game->players[i].score;
+        history->fuel[i] = sim_jetpack_fuel(game, &game->players[i]);
+        history->using_jetpack[i] = game->players[i].using_jetpack;
+    }
+}
+
+static void cover(worker_t *worker, const uint32_t bit)
+{
+    uint8_t mask = (uint8_t)(1 << (bit & 7));
+    if (worker->seen[bit >> 3] & mask) {
+        return;
+    }
+    worker->seen[bit >> 3] |= mask;
+
+    // Seen by this worker for the first time, but maybe not by the others
+    SDL_atomic_t *word = &coverage[bit >> 5];
+    int flag = 1 << (bit & 31);
+    for (;;) {
+        int old = SDL_AtomicGet(word);
+        if (old & flag) {
+            return;
+        }
+        if (SDL_AtomicCAS(word, old, old | flag)) {
+            worker->new_features++;
+            SDL_AtomicAdd(&num_features, 1);
+            return;
+        }
+    }
+}
+
+static uint32_t feature(const uint32_t a, const uint32_t b)
+{
+    uint64_t hash = ((uint64_t)a << 32 | b) * 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(hash >> 44) & (COVERAGE_BITS - 1);
+}
+
+// The first byte picks the level, each of the rest is a tick's input
+static void from_bytes(run_t *run, const uint8_t *data, const size_t size)
+{
+    run->start_level = size ? data[0] % NUM_LEVELS : 0;
+    run->num_ticks = size > 1 ? (uint32_t)(size - 1 < MAX_RUN_TICKS ? size - 1 : MAX_RUN_TICKS) : 0;
+    for (uint32_t i = 0; i < run->num_ticks; i++) {
+        run->inputs[i] = data[i + 1] & ALL_INPUTS;
+    }
+}
+
+#ifndef HH_LIBFUZZER
+
+static int SDLCALL worker_run(void *data)
+{
+    worker_t *worker = data;
+    run_t *run = &worker->run;
+
+    while (!SDL_AtomicGet(&stop)) {
+        int size = SDL_AtomicGet(&corpus_size);
+        // Mostly mutate what's been found so far, now and then start again from nothing
+        if (!size || random_below(worker, 16) == 0) {
+            random_run(worker, run);
+        } else {
+            *run = corpus[random_below(worker, (uint32_t)size)];
+            mutate(worker, run);
+        }
+
+        worker->new_features = 0;
+        outcome_t outcome = execute(worker, run, true);
+        SDL_AtomicAdd(&worker->runs, 1);
+        SDL_AtomicAdd(&worker->ticks, (int)outcome.ticks_run);
+
+        if (outcome.invariant != BROKE_NOTHING) {
+            worker->broke[outcome.invariant]++;
+
+            // Each invariant is shrunk and saved the first time it breaks, the rest are counted
+            if (SDL_AtomicCAS(&reported[outcome.invariant], 0, 1)) {
+                uint32_t ticks_before = outcome.tick + 1;
+                shrink(worker, run, &outcome);
+
+                char fname[MAX_PATH_SIZE];
+                snprintf(fname, sizeof(fname), "%s/%s.hhr", out_dir, INVARIANT_NAMES[outcome.invariant]);
+                if (save_replay(worker, run, fname) != SUCCESS) {
+                    fprintf(stderr, "couldn't write %s\n", fname);
+                } else {
+                    printf("%s broken by player %u on level %u, shrunk from %u to %u ticks: %s\n",
+                           INVARIANT_NAMES[outcome.invariant], outcome.player + 1, run->start_level + 1, ticks_before,
+                           run->num_ticks, fname);
+                }
+            }
+            continue;
+        }
+
+        if (worker->new_features) {
+            add_to_corpus(run);
+        }
+    }
+
+    return 0;
+}
+
+// Inputs are held for a while rather than changing every tick, like a player's are, so mutations work on stretches
+static void mutate(worker_t *worker, run_t *run)
+{
+    uint32_t count = 1 + random_below(worker, 4);
+
+    for (uint32_t m = 0; m < count; m++) {
+        uint32_t n = run->num_ticks ? run->num_ticks : 1;
+        uint32_t start = random_below(worker, n);
+        uint32_t len = 1 + random_below(worker, 64);
+
+        switch (random_below(worker, 7)) {
+        // Hold something else for a while
+        case 0: {
+            hold(run, start, len, (uint8_t)random_below(worker, ALL_INPUTS + 1));
+        } break;
+
+        // Press or let go of one button for a while
+        case 1: {
+            uint8_t button = (uint8_t)(1 << random_below(worker, NUM_INPUT_BUTTONS));
+            for (uint32_t i = start; i < start + len && i < run->num_ticks; i++) {
+                run->inputs[i] ^= button;
+            }
+        } break;
+
+        // Wait, or do something, before carrying on as before
+        case 2: {
+            if (run->num_ticks + len > MAX_RUN_TICKS) {
+                len = MAX_RUN_TICKS - run->num_ticks;
+            }
+            memmove(&run->inputs[start + len], &run->inputs[start], run->num_ticks - start);
+            run->num_ticks += len;
+            hold(run, start, len, (uint8_t)random_below(worker, ALL_INPUTS + 1));
+        } break;
+
+        // Skip ahead
+        case 3: {
+            if (start + len > run->num_ticks) {
+                len = run->num_ticks - start;
+            }
+            memmove(&run->inputs[start], &run->inputs[start + len], run->num_ticks - start - len);
+            run->num_ticks -= len;
+        } break;
+
+        // Carry on with part of another run
+        case 4: {
+            int size = SDL_AtomicGet(&corpus_size);
+            const run_t *other = &corpus[random_below(worker, (uint32_t)size)];
+            if (other->start_level == run->start_level && other->num_ticks > start) {
+                uint32_t end = other->num_ticks < MAX_RUN_TICKS ? other->num_ticks : MAX_RUN_TICKS;
+                memcpy(&run->inputs[start], &other->inputs[start], end - start);
+                run->num_ticks = end;
+            }
+        } break;
+
+        // Keep going past the end
+        case 5: {
+            uint32_t from = run->num_ticks;
+            hold(run, from, len, (uint8_t)random_below(worker, ALL_INPUTS + 1));
+        } break;
+
+        // The same thing on a different level
+        default: {
+            if (only_level < 0) {
+                run->start_level = (uint8_t)random_below(worker, NUM_LEVELS);
+            }
+        } break;
+        }
+    }
+}
+
+static void random_run(worker_t *worker, run_t *run)
+{
+    run->start_level = only_level < 0 ? (uint8_t)random_below(worker, NUM_LEVELS) : (uint8_t)only_level;
+    run->num_ticks = 0;
+
+    uint32_t target = 30 + random_below(worker, MAX_RUN_TICKS / 2);
+    while (run->num_ticks < target) {
+        hold(run, run->num_ticks, 1 + random_below(worker, 45), (uint8_t)random_below(worker, ALL_INPUTS + 1));
+    }
+}
+
+// Sets the inputs from start, growing the run if it goes past the end
+static void hold(run_t *run, const uint32_t start, const uint32_t len, const uint8_t input)
+{
+    uint32_t end = start + len < MAX_RUN_TICKS ? start + len : MAX_RUN_TICKS;
+    for (uint32_t i = start; i < end; i++) {
+        run->inputs[i] = input;
+    }
+    if (end > run->num_ticks) {
+        run->num_ticks = end;
+    }
+}
+
+static void add_to_corpus(const run_t *run)
+{
+    SDL_AtomicLock(&corpus_lock);
+    int size = SDL_AtomicGet(&corpus_size);
+    if (size < MAX_CORPUS) {
+        corpus[size] = *run;
+        // NOTE: SDL_AtomicSet() is a full barrier, so the run is there before anyone can pick it
+        SDL_AtomicSet(&corpus_size, size + 1);
+    }
+    SDL_AtomicUnlock(&corpus_lock);
+}
+
+// Cuts the run down to the fewest ticks and buttons that still break the same invariant: first whole stretches are
+// removed, halving their length each pass, then the same for letting go of every button
+static void shrink(worker_t *worker, run_t *run, const outcome_t *outcome)
+{
+    run_t *candidate = &worker->shrunk;
+    uint32_t tries = 0;
+    uint32_t ticks = outcome->tick + 1;
+    run->num_ticks = ticks;
+
+    for (uint32_t len = run->num_ticks / 2; len >= 1 && tries < MAX_SHRINK_RUNS; len /= 2) {
+        for (uint32_t start = 0; start + len <= run->num_ticks && tries < MAX_SHRINK_RUNS;) {
+            *candidate = *run;
+            memmove(&candidate->inputs[start], &candidate->inputs[start + len], run->num_ticks - start - len);
+            candidate->num_ticks -= len;
+            tries++;
+
+            if (candidate->num_ticks && still_breaks(worker, candidate, outcome->invariant, &ticks)) {
+                *run = *candidate;
+                run->num_ticks = ticks;
+            } else {
+                start += len;
+            }
+        }
+    }
+
+    for (uint32_t len = run->num_ticks; len >= 1 && tries < MAX_SHRINK_RUNS; len /= 2) {
+        for (uint32_t start = 0; start < run->num_ticks && tries < MAX_SHRINK_RUNS; start += len) {
+            uint32_t end = start + len < run->num_ticks ? start + len : run->num_ticks;
+            bool pressed = false;
+            *candidate = *run;
+            for (uint32_t i = start; i < end; i++) {
+                pressed |= candidate->inputs[i] != 0;
+                candidate->inputs[i] = 0;
+            }
+            if (!pressed) {
+                continue;
+            }
+            tries++;
+
+            if (still_breaks(worker, candidate, outcome->invariant, &ticks)) {
+                *run = *candidate;
+                run->num_ticks = ticks;
+            }
+        }
+    }
+}
+
+static bool still_breaks(worker_t *worker, const run_t *run, const uint8_t invariant, uint32_t *ticks)
+{
+    outcome_t outcome = execute(worker, run, false);
+    *ticks = outcome.tick + 1;
+    return outcome.invariant == invariant;
+}
+
+// NOTE: the run is played once more for the result the replay records
+static int save_replay(worker_t *worker, const run_t *run, const char *fname)
+{
+    replay_t *replay = malloc(sizeof(replay_t));
+    if (!replay) {
+        return err_fatal(ERR_ALLOC, "replay");
+    }
+
+    execute(worker, run, false);
+    replay->start_level = run->start_level;
+    replay->num_ticks = run->num_ticks;
+    memcpy(replay->inputs, run->inputs, run->num_ticks);
+    replay_finish(replay, &worker->game);
+
+    int err = replay_save(replay, fname);
+    free(replay);
+
+    return err;
+}
+
+// xorshift64*
+static uint64_t next_random(worker_t *worker)
+{
+    worker->rng ^= worker->rng >> 12;
+    worker->rng ^= worker->rng << 25;
+    worker->rng ^= worker->rng >> 27;
+    return worker->rng * 0x2545f4914f6cdd1dULL;
+}
+
+static uint32_t random_below(worker_t *worker, const uint32_t n)
+{
+    return (uint32_t)(next_random(worker) >> 33) % n;
+}
+
+#endif
@@ -0,0 +1,496 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../log.h"
+#include "../sim.h"
+#include "route.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Generates levels and keeps the ones that are proven completable. Each candidate is first checked with a cheap
+// tile-level reachability pass, then by searching the simulation itself for a route to the trophy and out of the door.
+// Levels whose fastest route found falls inside the difficulty target are written out as .dat files the game loads
+// (copy one over res/data/level<n>.dat to play it).
+//
+//   hh-level-gen [-n COUNT] [-j THREADS] [-s SEED] [-d MIN_TICKS:MAX_TICKS] [-b BUDGET] [-o OUT_DIR]
+
+#define MAX_WORKERS 64
+#define MAX_PATH_SIZE 512
+
+#define SEARCH_WEIGHT 3.0f
+// Open list room per node in the budget, past that children are dropped
+#define OPEN_PER_NODE 4
+
+// Solid tiles the generator builds with, and the ones the player dies touching
+static const uint8_t WALL_TILES[] = {17, 18, 19};
+static const uint8_t HAZARD_TILES[] = {6, 25, 36};
+static const uint8_t GEM_TILES[] = {47, 48, 49, 50, 51, 52};
+static const uint8_t ENEMY_TILES[] = {TILE_ENEMY_SPIDY,       TILE_ENEMY_PURPER, TILE_ENEMY_STARBOY,
+                                      TILE_ENEMY_DUMBELL_BRO, TILE_ENEMY_UFO,    TILE_ENEMY_HAMBURGER};
+#define COUNT_OF(array) (sizeof(array) / sizeof((array)[0]))
+
+// Rows platforms sit on, two apart so each is a jump above the one below
+static const uint8_t PLATFORM_ROWS[] = {7, 5, 3};
+
+#define START_X 2
+#define START_Y 8
+
+// How far a jump carries, in tiles
+#define JUMP_UP 2
+#define JUMP_ACROSS 3
+
+typedef struct {
+    SDL_Thread *thread;
+    uint64_t rng;
+
+    uint32_t candidates;
+    uint32_t unreachable;
+    uint32_t unsolved;
+    uint32_t out_of_range;
+
+    level_t level;
+    level_t levels[NUM_LEVELS];
+    route_info_t info;
+    uint64_t taken;
+    event_buffer_t events;
+    flow_field_t flow;
+
+    route_open_t open;
+    route_visited_t visited;
+} worker_t;
+
+static uint32_t count = 100;
+static uint64_t seed = 1;
+static uint32_t min_ticks = 200;
+static uint32_t max_ticks = 1500;
+static uint32_t budget = 50000;
+static const char *out_dir = ".";
+
+static SDL_atomic_t kept;
+static FILE *index_fd;
+static SDL_SpinLock index_lock;
+static mask_t masks[NUM_TILES];
+
+static worker_t *workers;
+static uint8_t num_workers;
+
+static int SDLCALL worker_run(void *data);
+static uint64_t next_random(worker_t *worker);
+static uint32_t random_below(worker_t *worker, const uint32_t n);
+static void generate(worker_t *worker, level_t *level);
+static void generate_path(worker_t *worker, level_t *level);
+static bool is_standable(const level_t *level, const int x, const int y);
+static bool reachable(const level_t *level);
+static uint32_t solve(worker_t *worker);
+
+int main(int argc, char *argv[])
+{
+    int threads = SDL_GetCPUCount();
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-n", strlen("-n")) == 0 && i + 1 < argc) {
+            count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-j", strlen("-j")) == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-d", strlen("-d")) == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u:%u", &min_ticks, &max_ticks) != 2) {
+                fprintf(stderr, "difficulty is MIN_TICKS:MAX_TICKS\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "-b", strlen("-b")) == 0 && i + 1 < argc) {
+            budget = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-o", strlen("-o")) == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-n COUNT] [-j THREADS] [-s SEED] [-d MIN:MAX_TICKS] [-b BUDGET] [-o OUT_DIR]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    num_workers = threads < 1 ? 1 : threads > MAX_WORKERS ? MAX_WORKERS : (uint8_t)threads;
+
+    char fname[MAX_PATH_SIZE];
+    snprintf(fname, sizeof(fname), "%s/levels.csv", out_dir);
+    index_fd = fopen(fname, "w");
+    if (!index_fd) {
+        err_handle(err_fatal(ERR_OPENING_FILE, fname));
+    }
+    fprintf(index_fd, "file,route_ticks,enemies,pickups\n");
+
+    err_handle(mask_load_sprites(masks));
+
+    workers = calloc(num_workers, sizeof(worker_t));
+    if (!workers) {
+        err_handle(err_fatal(ERR_ALLOC, "level generator workers"));
+    }
+
+    // Every node expanded can add a child per action, keep the visited set under half full
+    uint32_t visited_capacity = 1;
+    while (visited_capacity < budget * NUM_ROUTE_ACTIONS * 2) {
+        visited_capacity <<= 1;
+    }
+
+    for (uint8_t i = 0; i < num_workers; i++) {
+        workers[i].rng = seed * 0x9e3779b97f4a7c15ULL + i + 1;
+        err_handle(route_visited_init(&workers[i].visited, visited_capacity));
+        route_open_init(&workers[i].open, budget * OPEN_PER_NODE + 1);
+    }
+
+    uint64_t started = SDL_GetPerformanceCounter();
+
+    for (uint8_t i = 1; i < num_workers; i++) {
+        workers[i].thread = SDL_CreateThread(worker_run, "level generator", &workers[i]);
+        if (!workers[i].thread) {
+            err_handle(err_fatal(ERR_SDL_INIT, SDL_GetError()));
+        }
+    }
+    worker_run(&workers[0]);
+
+    uint32_t candidates = 0, unreachable = 0, unsolved = 0, out_of_range = 0;
+    for (uint8_t i = 0; i < num_workers; i++) {
+        if (workers[i].thread) {
+            SDL_WaitThread(workers[i].thread, NULL);
+        }
+        candidates += workers[i].candidates;
+        unreachable += workers[i].unreachable;
+        unsolved += workers[i].unsolved;
+        out_of_range += workers[i].out_of_range;
+        route_visited_free(&workers[i].visited);
+        route_open_free(&workers[i].open);
+    }
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - started) / (double)SDL_GetPerformanceFrequency();
+    uint32_t num_kept = (uint32_t)SDL_AtomicGet(&kept);
+    num_kept = num_kept > count ? count : num_kept;
+
+    printf("kept %u of %u candidates on %u threads in %.2f s (%.0f levels/min)\n", num_kept, candidates, num_workers,
+           seconds, seconds > 0 ? num_kept * 60.0 / seconds : 0);
+    printf("rejected: %u unreachable, %u not solved within %u nodes, %u outside %u-%u ticks\n", unreachable, unsolved,
+           budget, out_of_range, min_ticks, max_ticks);
+
+    fclose(index_fd);
+    free(workers);
+
+    return 0;
+}
+
+static int SDLCALL worker_run(void *data)
+{
+    worker_t *worker = data;
+
+    while ((uint32_t)SDL_AtomicGet(&kept) < count) {
+        worker->candidates++;
+        generate(worker, &worker->level);
+
+        if (!reachable(&worker->level)) {
+            worker->unreachable++;
+            continue;
+        }
+
+        uint32_t ticks = solve(worker);
+        if (!ticks) {
+            worker->unsolved++;
+            continue;
+        }
+        if (ticks < min_ticks || ticks > max_ticks) {
+            worker->out_of_range++;
+            continue;
+        }
+
+        uint32_t index = (uint32_t)SDL_AtomicAdd(&kept, 1);
+        if (index >= count) {
+            break;
+        }
+
+        char fname[MAX_PATH_SIZE];
+        snprintf(fname, sizeof(fname), "%s/level%05u.dat", out_dir, index);
+        if (sim_save_level(&worker->level, fname) != SUCCESS) {
+            fprintf(stderr, "couldn't write %s\n", fname);
+            continue;
+        }
+
+        SDL_AtomicLock(&index_lock);
+        fprintf(index_fd, "level%05u.dat,%u,%u,%u\n", index, ticks, worker->level.num_spawns, worker->info.num_pickups);
+        SDL_AtomicUnlock(&index_lock);
+    }
+
+    return 0;
+}
+
+// xorshift64*
+static uint64_t next_random(worker_t *worker)
+{
+    worker->rng ^= worker->rng >> 12;
+    worker->rng ^= worker->rng << 25;
+    worker->rng ^= worker->rng >> 27;
+
+    return worker->rng * 0x2545f4914f6cdd1dULL;
+}
+
+static uint32_t random_below(worker_t *worker, const uint32_t n)
+{
+    return (uint32_t)(next_random(worker) >> 33) % n;
+}
+
+static void generate(worker_t *worker, level_t *level)
+{
+    memset(level, 0, sizeof(level_t));
+    script_clear(&level->script);
+
+    uint8_t wall = WALL_TILES[random_below(worker, COUNT_OF(WALL_TILES))];
+    uint8_t *tiles = level->tiles;
+
+    // Ceiling, floor and the sides
+    for (int x = 0; x < LEVEL_W; x++) {
+        tiles[x] = wall;
+        tiles[(LEVEL_H - 1) * LEVEL_W + x] = wall;
+    }
+    for (int y = 0; y < LEVEL_H; y++) {
+        tiles[y * LEVEL_W] = wall;
+        tiles[y * LEVEL_W + LEVEL_W - 1] = wall;
+    }
+
+    // Platforms, leaving the start clear
+    for (size_t i = 0; i < COUNT_OF(PLATFORM_ROWS); i++) {
+        int y = PLATFORM_ROWS[i];
+        for (int x = START_X + 4; x < LEVEL_W - 2;) {
+            int length = 2 + (int)random_below(worker, 6);
+            int gap = 2 + (int)random_below(worker, 6);
+
+            for (int j = 0; j < length && x + j < LEVEL_W - 1; j++) {
+                tiles[y * LEVEL_W + x + j] = wall;
+            }
+            x += length + gap;
+        }
+    }
+
+    // Hazards on the floor, narrow enough to jump
+    for (int x = START_X + 6; x < LEVEL_W - 4; x += 6 + (int)random_below(worker, 10)) {
+        uint8_t hazard = HAZARD_TILES[random_below(worker, COUNT_OF(HAZARD_TILES))];
+        int width = 1 + (int)random_below(worker, 2);
+
+        for (int j = 0; j < width; j++) {
+            tiles[(LEVEL_H - 2) * LEVEL_W + x + j] = hazard;
+        }
+    }
+
+    // Trophy on something to stand on in the far half, the door on the floor. Falls back to the floor.
+    int trophy = -1;
+    for (int tries = 0; tries < 64 && trophy < 0; tries++) {
+        int x = LEVEL_W / 2 + (int)random_below(worker, LEVEL_W / 2 - 2);
+        int y = 1 + (int)random_below(worker, LEVEL_H - 2);
+        if (is_standable(level, x, y)) {
+            trophy = y * LEVEL_W + x;
+        }
+    }
+    if (trophy < 0) {
+        trophy = (LEVEL_H - 2) * LEVEL_W + LEVEL_W - 3;
+    }
+    tiles[trophy] = TILE_TROPHY;
+
+    int door = -1;
+    for (int tries = 0; tries < 64 && door < 0; tries++) {
+        int x = START_X + 8 + (int)random_below(worker, LEVEL_W - START_X - 10);
+        if (is_standable(level, x, LEVEL_H - 2) && !tiles[(LEVEL_H - 2) * LEVEL_W + x]) {
+            door = (LEVEL_H - 2) * LEVEL_W + x;
+        }
+    }
+    if (door < 0) {
+        door = (LEVEL_H - 2) * LEVEL_W + START_X + 2;
+    }
+    tiles[door] = TILE_DOOR;
+
+    // Gems, and sometimes the gun and the jetpack, anywhere there's something to stand on
+    int num_items = 6 + (int)random_below(worker, 10);
+    for (int i = 0; i < num_items; i++) {
+        int x = START_X + 2 + (int)random_below(worker, LEVEL_W - START_X - 4);
+        int y = 1 + (int)random_below(worker, LEVEL_H - 2);
+        if (!is_standable(level, x, y) || tiles[y * LEVEL_W + x]) {
+            continue;
+        }
+
+        uint8_t item = GEM_TILES[random_below(worker, COUNT_OF(GEM_TILES))];
+        if (i == 0 && random_below(worker, 2)) {
+            item = TILE_GUN;
+        } else if (i == 1 && random_below(worker, 3) == 0) {
+            item = TILE_JETPACK;
+        }
+        tiles[y * LEVEL_W + x] = item;
+    }
+
+    // Enemies patrol the upper rows, away from the start
+    level->has_extra = true;
+    level->start_x = START_X;
+    level->start_y = START_Y;
+    level->num_spawns = (uint8_t)random_below(worker, 4);
+    uint8_t enemy = ENEMY_TILES[random_below(worker, COUNT_OF(ENEMY_TILES))];
+    for (uint8_t i = 0; i < level->num_spawns; i++) {
+        level->spawns[i].type = enemy;
+        level->spawns[i].x = (uint8_t)(20 + random_below(worker, LEVEL_W - 30));
+        level->spawns[i].y = (uint8_t)(1 + random_below(worker, 2));
+    }
+    generate_path(worker, level);
+}
+
+// Enemies share one path of (dx, dy) pixel steps. A loop that goes out and retraces its steps back is repeated to
+// fill the whole path, so enemies end up where they started and the uint8_t path index wraps back onto the loop.
+static void generate_path(worker_t *worker, level_t *level)
+{
+    int8_t steps[8][2];
+    const size_t num_steps = COUNT_OF(steps);
+
+    for (size_t i = 0; i < num_steps; i++) {
+        steps[i][0] = (int8_t)((int)random_below(worker, 17) - 8);
+        steps[i][1] = (int8_t)((int)random_below(worker, 9) - 4);
+    }
+
+    size_t i = 0;
+    while (i + num_steps * 4 <= sizeof(level->path)) {
+        for (size_t j = 0; j < num_steps; j++) {
+            level->path[i++] = (uint8_t)steps[j][0];
+            level->path[i++] = (uint8_t)steps[j][1];
+        }
+        for (size_t j = num_steps; j-- > 0;) {
+            level->path[i++] = (uint8_t)-steps[j][0];
+            level->path[i++] = (uint8_t)-steps[j][1];
+        }
+    }
+}
+
+// Free of walls and hazards, with something solid underneath
+static bool is_standable(const level_t *level, const int x, const int y)
+{
+    if (x <= 0 || x >= LEVEL_W - 1 || y <= 0 || y >= LEVEL_H - 1) {
+        return false;
+    }
+
+    uint8_t tile = level->tiles[y * LEVEL_W + x];
+    uint8_t below = level->tiles[(y + 1) * LEVEL_W + x];
+
+    return !sim_is_solid(tile) && !sim_is_hazard(tile) && sim_is_solid(below);
+}
+
+// Flood fill over the places the player can stand, walking, falling and jumping between them. Cheap and a little
+// optimistic, the search in solve() has the final say.
+static bool reachable(const level_t *level)
+{
+    bool seen[LEVEL_H][LEVEL_W] = {{false}};
+    uint16_t queue[LEVEL_W * LEVEL_H];
+    uint32_t head = 0, tail = 0;
+    bool trophy = false, door = false;
+
+    seen[START_Y][START_X] = true;
+    queue[tail++] = START_Y * LEVEL_W + START_X;
+
+    while (head < tail) {
+        int x = queue[head] % LEVEL_W;
+        int y = queue[head] / LEVEL_W;
+        head++;
+
+        for (int dx = -JUMP_ACROSS; dx <= JUMP_ACROSS; dx++) {
+            for (int ty = y - JUMP_UP; ty < LEVEL_H - 1; ty++) {
+                int tx = x + dx;
+                if (tx <= 0 || tx >= LEVEL_W - 1 || ty <= 0) {
+                    continue;
+                }
+
+                // Walking only reaches the next tile over and falling only goes down, anything else is a jump and
+                // needs headroom
+                bool walk = ty == y && abs(dx) <= 1;
+                bool fall = ty > y;
+                if (!walk && !fall) {
+                    bool clear = true;
+                    for (int hy = y - 1; hy >= ty && hy >= y - JUMP_UP && clear; hy--) {
+                        clear = !sim_is_solid(level->tiles[hy * LEVEL_W + x]);
+                    }
+                    if (!clear) {
+                        continue;
+                    }
+                }
+
+                if (!is_standable(level, tx, ty) || seen[ty][tx]) {
+                    continue;
+                }
+                seen[ty][tx] = true;
+                queue[tail++] = (uint16_t)(ty * LEVEL_W + tx);
+
+                uint8_t tile = level->tiles[ty * LEVEL_W + tx];
+                trophy |= tile == TILE_TROPHY;
+                door |= tile == TILE_DOOR;
+            }
+        }
+    }
+
+    return trophy && door;
+}
+
+// Weighted best-first search of the simulation, see hh-solver. Returns the ticks the route found takes, 0 if there
+// wasn't one within the budget.
+static uint32_t solve(worker_t *worker)
+{
+    route_visited_clear(&worker->visited);
+    route_open_clear(&worker->open);
+
+    if (route_info_init(&worker->info, &worker->level) != SUCCESS) {
+        return 0;
+    }
+
+    // The level goes in slot 0 and the search starts at the same state the game would
+    memcpy(&worker->levels[0], &worker->level, sizeof(level_t));
+    worker->taken = 0;
+
+    route_node_t node = {0};
+    sim_init(&node.state, worker->levels, masks, &worker->flow, &worker->events);
+    sim_start_level(&node.state);
+    route_save_scripted(&worker->info, &worker->level, node.scripted);
+    route_visit(&worker->visited, route_state_hash(&worker->info, &node.state));
+    route_open_push(&worker->open, &node);
+
+    for (uint32_t expanded = 0; worker->open.num_open && expanded < budget; expanded++) {
+        route_open_pop(&worker->open, &node);
+
+        if (node.g >= max_ticks) {
+            continue;
+        }
+
+        for (size_t i = 0; i < NUM_ROUTE_ACTIONS; i++) {
+            if (!route_action_useful(&node.state, ROUTE_ACTIONS[i])) {
+                continue;
+            }
+
+            route_sync_level(&worker->info, &worker->levels[0], &worker->level, &worker->taken, &node, &worker->flow);
+
+            route_node_t child = node;
+            sim_tick(&child.state, &ROUTE_ACTIONS[i]);
+            child.g++;
+
+            uint64_t taken = route_taken(&worker->info, &worker->events);
+            child.taken |= taken;
+            worker->taken |= taken;
+            route_save_scripted(&worker->info, &worker->levels[0], child.scripted);
+
+            for (size_t j = 0; j < worker->events.count; j++) {
+                if (worker->events.events[j].type == EVENT_LEVEL_CLEARED) {
+                    return child.g;
+                }
+            }
+
+            if (child.state.players[0].dying ||
+                !route_visit(&worker->visited, route_state_hash(&worker->info, &child.state))) {
+                continue;
+            }
+
+            child.f = (float)child.g + SEARCH_WEIGHT * (float)route_ticks_left(&worker->info, &child.state);
+            route_open_push(&worker->open, &child);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../log.h"
+#include "../replay.h"
+#include "../rollback.h"
+#include "../sim.h"
+#include "../transport.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Plays two-player netplay matches in one process over a loopback link with latency, jitter and packet loss, and checks
+// that both peers end up exactly where a single simulation fed the same inputs in lockstep does. Then times how long
+// rolling back ROLLBACK_MAX_PREDICTION ticks takes. Players hold random buttons, or the first one follows a replay with
+// -r to get through levels.
+//
+//   hh-net-check [-n MATCHES] [-t TICKS] [-l LATENCY_MS] [-j JITTER_MS] [-p LOSS_PERCENT] [-s SEED] [-r REPLAY]
+
+#define FRAME_MS 33
+#define BENCH_ROUNDS 10000
+
+typedef struct {
+    level_t levels[NUM_LEVELS];
+    game_state_t game;
+    event_buffer_t events;
+    flow_field_t flow;
+    transport_t transport;
+    rollback_t rollback;
+} peer_t;
+
+static uint32_t num_matches = 20;
+static uint32_t max_ticks = 3000;
+static uint64_t seed = 1;
+static loopback_t loopback;
+static replay_t *replay;
+
+static level_t levels[NUM_LEVELS];
+static mask_t masks[NUM_TILES];
+static peer_t peers[MAX_PLAYERS];
+static peer_t reference;
+
+static void peer_init(peer_t *peer);
+static uint8_t script_input(const uint64_t match, const uint8_t player, const uint32_t tick);
+static int play(const uint64_t match, uint32_t *ticks);
+static void bench(void);
+static int compare_times(const void *a, const void *b);
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-n", strlen("-n")) == 0 && i + 1 < argc) {
+            num_matches = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-t", strlen("-t")) == 0 && i + 1 < argc) {
+            max_ticks = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-l", strlen("-l")) == 0 && i + 1 < argc) {
+            loopback.latency_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-j", strlen("-j")) == 0 && i + 1 < argc) {
+            loopback.jitter_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-p", strlen("-p")) == 0 && i + 1 < argc) {
+            loopback.loss = (uint8_t)atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-r", strlen("-r")) == 0 && i + 1 < argc) {
+            replay = malloc(sizeof(replay_t));
+            if (!replay) {
+                err_handle(err_fatal(ERR_ALLOC, "replay"));
+            }
+            err_handle(replay_load(replay, argv[++i]));
+        }
+    }
+
+    err_handle(sim_load_levels(levels));
+    err_handle(mask_load_sprites(masks));
+
+    printf("%u matches of up to %u ticks, latency %u ms, jitter %u ms, %u%% loss\n", num_matches, max_ticks,
+           loopback.latency_ms, loopback.jitter_ms, loopback.loss);
+
+    uint32_t failed = 0;
+    uint32_t rollbacks = 0, resimulated = 0, longest = 0, stalls = 0;
+    float max_ms = 0;
+
+    for (uint32_t i = 0; i < num_matches; i++) {
+        uint32_t ticks = 0;
+        int err = play(seed + i, &ticks);
+        if (err != SUCCESS) {
+            printf("match %u: FAILED after %u ticks - %s %s\n", i, ticks, err_messages[err], err_additional);
+            memset(err_additional, 0, sizeof(err_additional));
+            failed++;
+        }
+
+        for (size_t j = 0; j < MAX_PLAYERS; j++) {
+            const rollback_t *rollback = &peers[j].rollback;
+            rollbacks += rollback->rollbacks;
+            resimulated += rollback->resimulated;
+            stalls += rollback->stalls;
+            longest = rollback->max_rollback > longest ? rollback->max_rollback : longest;
+            max_ms = rollback->max_resim_ms > max_ms ? rollback->max_resim_ms : max_ms;
+        }
+    }
+
+    printf("matches: %u (%u passed, %u failed)\n", num_matches, num_matches - failed, failed);
+    printf("packets: %u sent, %u dropped\n", loopback.sent, loopback.dropped);
+    printf("rollbacks: %u re-simulating %u ticks (longest %u, slowest %.3f ms), %u stalls\n", rollbacks, resimulated,
+           longest, max_ms, stalls);
+
+    bench();
+    free(replay);
+
+    return failed ? 1 : 0;
+}
+
+static void peer_init(peer_t *peer)
+{
+    memcpy(peer->levels, levels, sizeof(levels));
+    sim_init(&peer->game, peer->levels, masks, &peer->flow, &peer->events);
+    peer->game.num_players = MAX_PLAYERS;
+    if (replay) {
+        peer->game.cur_level = replay->start_level;
+    }
+    sim_start_level(&peer->game);
+}
+
+// Each player holds a random combination of buttons for a few ticks at a time
+static uint8_t script_input(const uint64_t match, const uint8_t player, const uint32_t tick)
+{
+    if (replay && player == 0) {
+        return tick < replay->num_ticks ? replay->inputs[tick] : 0;
+    }
+
+    uint64_t hash = (match * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t)player << 32) ^ (tick / 8);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return hash & 0x7f;
+}
+
+static int play(const uint64_t match, uint32_t *ticks)
+{
+    loopback.now_ms = 0;
+    loopback.rng = match;
+    transport_open_loopback(&peers[0].transport, &peers[1].transport, &loopback);
+
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+        peer_init(&peers[i]);
+        rollback_init(&peers[i].rollback, &peers[i].game, &peers[i].transport, i, loopback.now_ms);
+    }
+
+    // Until both have played the same ticks with nothing left to correct
+    for (;;) {
+        rollback_t *a = &peers[0].rollback;
+        rollback_t *b = &peers[1].rollback;
+        bool finished = (a->tick >= max_ticks || !peers[0].game.is_running) &&
+                        (b->tick >= max_ticks || !peers[1].game.is_running);
+        if (finished && rollback_settled(a) && rollback_settled(b)) {
+            break;
+        }
+
+        loopback.now_ms += FRAME_MS;
+        for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+            rollback_t *rollback = &peers[i].rollback;
+            int err = rollback->tick < max_ticks
+                          ? rollback_advance(rollback, script_input(match, i, rollback->tick), loopback.now_ms)
+                          : rollback_poll(rollback, loopback.now_ms);
+            if (err != SUCCESS) {
+                *ticks = rollback->tick;
+                return err;
+            }
+        }
+    }
+
+    // Replay the same inputs in lockstep and compare against both peers
+    uint32_t end = peers[0].rollback.tick < peers[1].rollback.tick ? peers[0].rollback.tick : peers[1].rollback.tick;
+    uint8_t inputs[MAX_PLAYERS];
+
+    peer_init(&reference);
+    for (*ticks = 0; *ticks < end && reference.game.is_running; (*ticks)++) {
+        for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+            inputs[i] = script_input(match, i, *ticks);
+        }
+        sim_tick(&reference.game, inputs);
+    }
+
+    // NOTE: with no ticks played neither peer has a checksum kept to compare
+    uint32_t expected = sim_checksum(&reference.game);
+    for (size_t i = 0; i < MAX_PLAYERS; i++) {
+        if (*ticks != end || (end > 0 && peers[i].rollback.checksums[(end - 1) % ROLLBACK_HISTORY] != expected)) {
+            return err_fatal(ERR_NET_DESYNC, "differs from lockstep");
+        }
+    }
+
+    return SUCCESS;
+}
+
+// The worst case a frame can hit: back to the oldest snapshot kept and forward again to where the game was
+static void bench(void)
+{
+    static double times[BENCH_ROUNDS];
+    peer_t *peer = &peers[0];
+    sim_snapshot_t snapshot;
+    uint8_t inputs[MAX_PLAYERS] = {INPUT_RIGHT, INPUT_LEFT};
+    double total = 0;
+
+    peer_init(peer);
+    sim_save(&peer->game, &snapshot);
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint64_t start = SDL_GetPerformanceCounter();
+
+        sim_restore(&peer->game, &snapshot);
+        for (uint32_t tick = 0; tick < ROLLBACK_MAX_PREDICTION; tick++) {
+            sim_save(&peer->game, &peer->rollback.snapshots[tick]);
+            sim_tick(&peer->game, inputs);
+            peer->rollback.checksums[tick] = sim_checksum(&peer->game);
+        }
+
+        times[i] = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+        total += times[i];
+    }
+
+    // NOTE: the slowest rounds are the OS taking the core away, the 99th percentile says more
+    qsort(times, BENCH_ROUNDS, sizeof(times[0]), compare_times);
+    printf("rolling back %u ticks: %.4f ms on average, %.4f ms at the 99th percentile over %u rounds\n",
+           ROLLBACK_MAX_PREDICTION, total / BENCH_ROUNDS, times[BENCH_ROUNDS * 99 / 100], BENCH_ROUNDS);
+}
+
+static int compare_times(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,101 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../post.h"
+#include <SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runs a frame through chains of post-processing filters on SDL's software renderer, with no window, and fails if any
+// can't be set up or run. Built with AddressSanitizer by make check-post so a stage written past the end of its table
+// is caught, the chain of nothing but CRTs above all.
+//
+//   hh-post-check [-s SCALE]
+
+#define FRAME_W 320
+#define FRAME_H 200
+
+static const char *CHAINS[] = {
+    "scale2x",
+    "scale2x,bloom,scanlines,crt",
+    "crt,crt,crt,crt,crt,crt,crt,crt",
+    // One more than POST_MAX_FILTERS, the last is left off
+    "crt,bloom,crt,scanlines,crt,crt,crt,crt,crt",
+};
+
+static int run_chain(SDL_Renderer *renderer, const char *filters, const int scale);
+static void draw_pattern(SDL_Renderer *renderer);
+
+int main(int argc, char *argv[])
+{
+    int scale = 2;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            scale = atoi(argv[++i]);
+        }
+    }
+
+    SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, FRAME_W, FRAME_H, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!target) {
+        err_handle(err_fatal(ERR_POST, SDL_GetError()));
+    }
+    SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(target);
+    if (!renderer) {
+        err_handle(err_fatal(ERR_POST, SDL_GetError()));
+    }
+
+    uint32_t failed = 0;
+    uint32_t num_chains = sizeof(CHAINS) / sizeof(CHAINS[0]);
+    for (uint32_t i = 0; i < num_chains; i++) {
+        int err = run_chain(renderer, CHAINS[i], scale);
+        if (err != SUCCESS) {
+            printf("%s: FAILED - %s %s\n", CHAINS[i], err_messages[err], err_additional);
+            memset(err_additional, 0, sizeof(err_additional));
+            failed++;
+        } else {
+            printf("%s: passed\n", CHAINS[i]);
+        }
+    }
+
+    printf("chains: %u (%u passed, %u failed)\n", num_chains, num_chains - failed, failed);
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+
+    return failed ? 1 : 0;
+}
+
+static int run_chain(SDL_Renderer *renderer, const char *filters, const int scale)
+{
+    int err = post_init(filters, FRAME_W, FRAME_H);
+    if (err == SUCCESS) {
+        err = post_resize(renderer, scale);
+    }
+    if (err == SUCCESS) {
+        draw_pattern(renderer);
+        if (!post_process(renderer)) {
+            err = err_fatal(ERR_POST, "the frame wasn't filtered");
+        }
+    }
+
+    post_destroy();
+
+    return err;
+}
+
+// Bright blocks on a dark background, so the glow, scanlines and curve all have edges to work on
+static void draw_pattern(SDL_Renderer *renderer)
+{
+    SDL_SetRenderDrawColor(renderer, 0x10, 0x10, 0x30, 0xff);
+    SDL_RenderClear(renderer);
+
+    for (int y = 0; y < FRAME_H; y += 20) {
+        for (int x = (y / 20) % 2 * 20; x < FRAME_W; x += 40) {
+            SDL_Rect block = {x, y, 20, 20};
+            SDL_SetRenderDrawColor(renderer, (uint8_t)x, (uint8_t)(y + 40), 0xff, 0xff);
+            SDL_RenderFillRect(renderer, &block);
+        }
+    }
+}
@@ -0,0 +1,387 @@
+#include "protocol.h"
+#include <SDL.h>
+#include <string.h>
+
+static uint8_t *put_u16(uint8_t *out, const uint16_t value);
+static uint8_t *put_u32(uint8_t *out, const uint32_t value);
+static uint16_t get_u16(const uint8_t *in);
+static uint32_t get_u32(const uint8_t *in);
+static bool player_changed(const view_t *a, const view_t *b);
+static bool bullet_changed(const bullet_t *a, const bullet_t *b);
+static bool enemy_changed(const enemy_view_t *a, const enemy_view_t *b);
+static uint32_t latency_bucket(const uint64_t us);
+static uint64_t bucket_floor(const uint32_t bucket);
+
+// Sizes of each part, PART_ENEMIES and PART_TILES are followed by one entry per enemy or tile
+#define LEVEL_PART_SIZE 2
+#define PLAYER_PART_SIZE 13
+#define BULLETS_PART_SIZE 10
+#define ENEMY_ENTRY_SIZE 6
+#define TILE_ENTRY_SIZE 3
+
+size_t write_hello(uint8_t *out, const uint8_t level)
+{
+    out[0] = MSG_HELLO;
+    out[1] = level;
+
+    return MSG_HELLO_SIZE;
+}
+
+size_t write_input(uint8_t *out, const uint8_t buttons, const uint32_t seq)
+{
+    out[0] = MSG_INPUT;
+    out[1] = buttons;
+    put_u32(&out[2], seq);
+
+    return MSG_INPUT_SIZE;
+}
+
+size_t client_msg_size(const uint8_t *in, const size_t size)
+{
+    if (!size) {
+        return 0;
+    }
+
+    size_t needed = in[0] == MSG_HELLO ? MSG_HELLO_SIZE : in[0] == MSG_INPUT ? MSG_INPUT_SIZE : 0;
+
+    return needed && size >= needed ? needed : 0;
+}
+
+void read_input(const uint8_t *in, uint8_t *buttons, uint32_t *seq)
+{
+    *buttons = in[1];
+    *seq = get_u32(&in[2]);
+}
+
+void view_init(view_t *view)
+{
+    memset(view, 0, sizeof(view_t));
+    view->level = UINT8_MAX;
+}
+
+// NOTE: only the first player, a session is one Harry
+void view_from_game(view_t *view, const game_state_t *game)
+{
+    const player_t *player = &game->players[0];
+
+    view->level = game->cur_level;
+    view->is_running = game->is_running;
+
+    view->px = player->px;
+    view->py = player->py;
+    view->score = player->score;
+    view->lives = player->lives;
+    view->flags = (player->has_trophy ? VIEW_HAS_TROPHY : 0) | (player->has_gun ? VIEW_HAS_GUN : 0) |
+                  (player->using_jetpack ? VIEW_USING_JETPACK : 0) | (player->dying ? VIEW_DYING : 0);
+    view->jetpack_fuel = sim_jetpack_fuel(game, player);
+    view->last_dir = player->last_dir;
+    view->camera_x = player->camera_x;
+
+    view->bullet = player->bullet;
+    view->ebullet = game->ebullet;
+
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        const enemy_t *enemy = &game->enemies[i];
+        view->enemies[i].type = enemy->type;
+        view->enemies[i].px = enemy->px;
+        view->enemies[i].py = enemy->py;
+        view->enemies[i].dying = enemy->type && enemy->dying;
+    }
+
+    // Items picked up and tiles set by routines this tick. NOTE: changes from before the level changed went with the
+    // old level.
+    view->num_tiles = 0;
+    for (size_t i = 0; i < game->events->count && view->num_tiles < MAX_CHANGED_TILES; i++) {
+        const game_event_t *event = &game->events->events[i];
+        bool changed = event->type == EVENT_PICKUP || event->type == EVENT_TILE_SET;
+        if (!changed || event->level != game->cur_level) {
+            continue;
+        }
+
+        uint16_t tile = event->y * LEVEL_W + event->x;
+        view->tiles[view->num_tiles] = tile;
+        view->tile_values[view->num_tiles++] = game->level->tiles[tile];
+    }
+}
+
+// Writes the update that takes a client from sent to view, returns its size including the length prefix
+size_t write_update(uint8_t *out, const uint32_t tick, const uint32_t ack, const view_t *sent, const view_t *view)
+{
+    uint8_t *p = &out[2];
+    uint8_t parts = 0;
+
+    p = put_u32(p, tick);
+    p = put_u32(p, ack);
+    uint8_t *parts_at = p++;
+
+    bool level_changed = view->level != sent->level || view->is_running != sent->is_running;
+    if (level_changed) {
+        parts |= PART_LEVEL;
+        *p++ = view->level;
+        *p++ = view->is_running;
+    }
+
+    if (player_changed(sent, view)) {
+        parts |= PART_PLAYER;
+        p = put_u16(p, (uint16_t)view->px);
+        p = put_u16(p, (uint16_t)view->py);
+        p = put_u32(p, view->score);
+        *p++ = view->lives;
+        *p++ = view->flags;
+        *p++ = view->jetpack_fuel;
+        *p++ = (uint8_t)view->last_dir;
+        *p++ = view->camera_x;
+    }
+
+    if (bullet_changed(&sent->bullet, &view->bullet) || bullet_changed(&sent->ebullet, &view->ebullet)) {
+        parts |= PART_BULLETS;
+        p = put_u16(p, view->bullet.px);
+        p = put_u16(p, view->bullet.py);
+        *p++ = (uint8_t)view->bullet.dir;
+        p = put_u16(p, view->ebullet.px);
+        p = put_u16(p, view->ebullet.py);
+        *p++ = (uint8_t)view->ebullet.dir;
+    }
+
+    uint8_t enemies = 0;
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        if (enemy_changed(&sent->enemies[i], &view->enemies[i])) {
+            enemies |= 1 << i;
+        }
+    }
+    if (enemies) {
+        parts |= PART_ENEMIES;
+        *p++ = enemies;
+        for (size_t i = 0; i < NUM_ENEMIES; i++) {
+            if (!(enemies & (1 << i))) {
+                continue;
+            }
+            *p++ = view->enemies[i].type;
+            p = put_u16(p, view->enemies[i].px);
+            p = put_u16(p, view->enemies[i].py);
+            *p++ = view->enemies[i].dying;
+        }
+    }
+
+    if (view->num_tiles) {
+        parts |= PART_TILES;
+        *p++ = view->num_tiles;
+        for (size_t i = 0; i < view->num_tiles; i++) {
+            p = put_u16(p, view->tiles[i]);
+            *p++ = view->tile_values[i];
+        }
+    }
+
+    *parts_at = parts;
+    put_u16(out, (uint16_t)(p - &out[2]));
+
+    return (size_t)(p - out);
+}
+
+// Applies one update, without its length prefix, to the view the client had. False if it doesn't make sense.
+bool read_update(const uint8_t *in, const size_t size, uint32_t *tick, uint32_t *ack, view_t *view)
+{
+    const uint8_t *p = in, *end = in + size;
+
+    if (size < UPDATE_HEADER_SIZE) {
+        return false;
+    }
+
+    *tick = get_u32(p);
+    *ack = get_u32(p + 4);
+    uint8_t parts = p[8];
+    p += UPDATE_HEADER_SIZE;
+
+    if (parts & PART_LEVEL) {
+        if (end - p < LEVEL_PART_SIZE) {
+            return false;
+        }
+        view->level = p[0];
+        view->is_running = p[1];
+        p += LEVEL_PART_SIZE;
+    }
+
+    if (parts & PART_PLAYER) {
+        if (end - p < PLAYER_PART_SIZE) {
+            return false;
+        }
+        view->px = (int16_t)get_u16(p);
+        view->py = (int16_t)get_u16(p + 2);
+        view->score = get_u32(p + 4);
+        view->lives = p[8];
+        view->flags = p[9];
+        view->jetpack_fuel = p[10];
+        view->last_dir = (int8_t)p[11];
+        view->camera_x = p[12];
+        p += PLAYER_PART_SIZE;
+    }
+
+    if (parts & PART_BULLETS) {
+        if (end - p < BULLETS_PART_SIZE) {
+            return false;
+        }
+        view->bullet.px = get_u16(p);
+        view->bullet.py = get_u16(p + 2);
+        view->bullet.dir = (int8_t)p[4];
+        view->ebullet.px = get_u16(p + 5);
+        view->ebullet.py = get_u16(p + 7);
+        view->ebullet.dir = (int8_t)p[9];
+        p += BULLETS_PART_SIZE;
+    }
+
+    if (parts & PART_ENEMIES) {
+        if (end - p < 1) {
+            return false;
+        }
+        uint8_t enemies = *p++;
+        for (size_t i = 0; i < NUM_ENEMIES; i++) {
+            if (!(enemies & (1 << i))) {
+                continue;
+            }
+            if (end - p < ENEMY_ENTRY_SIZE) {
+                return false;
+            }
+            view->enemies[i].type = p[0];
+            view->enemies[i].px = get_u16(p + 1);
+            view->enemies[i].py = get_u16(p + 3);
+            view->enemies[i].dying = p[5];
+            p += ENEMY_ENTRY_SIZE;
+        }
+    }
+
+    view->num_tiles = 0;
+    if (parts & PART_TILES) {
+        if (end - p < 1 || p[0] > MAX_CHANGED_TILES || end - p < 1 + p[0] * TILE_ENTRY_SIZE) {
+            return false;
+        }
+        view->num_tiles = *p++;
+        for (size_t i = 0; i < view->num_tiles; i++) {
+            view->tiles[i] = get_u16(p);
+            view->tile_values[i] = p[2];
+            p += TILE_ENTRY_SIZE;
+        }
+    }
+
+    return p == end;
+}
+
+void latency_add(latency_hist_t *hist, const uint64_t us)
+{
+    hist->count++;
+    hist->total_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+    hist->buckets[latency_bucket(us)]++;
+}
+
+void latency_merge(latency_hist_t *into, const latency_hist_t *from)
+{
+    into->count += from->count;
+    into->total_us += from->total_us;
+    if (from->max_us > into->max_us) {
+        into->max_us = from->max_us;
+    }
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        into->buckets[i] += from->buckets[i];
+    }
+}
+
+// NOTE: accurate to within 1/32 of the value, which is plenty for telling 2 ms from 20 ms
+uint64_t latency_percentile(const latency_hist_t *hist, const double percentile)
+{
+    uint64_t wanted = (uint64_t)((double)hist->count * percentile / 100.0);
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen > wanted) {
+            return bucket_floor(i);
+        }
+    }
+
+    return hist->max_us;
+}
+
+uint64_t now_us(void)
+{
+    static uint64_t frequency;
+    if (!frequency) {
+        frequency = SDL_GetPerformanceFrequency();
+    }
+
+    uint64_t counter = SDL_GetPerformanceCounter();
+
+    return counter / frequency * 1000000 + counter % frequency * 1000000 / frequency;
+}
+
+static uint8_t *put_u16(uint8_t *out, const uint16_t value)
+{
+    out[0] = value & 0xff;
+    out[1] = (value >> 8) & 0xff;
+
+    return out + 2;
+}
+
+static uint8_t *put_u32(uint8_t *out, const uint32_t value)
+{
+    out[0] = value & 0xff;
+    out[1] = (value >> 8) & 0xff;
+    out[2] = (value >> 16) & 0xff;
+    out[3] = (value >> 24) & 0xff;
+
+    return out + 4;
+}
+
+static uint16_t get_u16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | in[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static bool player_changed(const view_t *a, const view_t *b)
+{
+    return a->px != b->px || a->py != b->py || a->score != b->score || a->lives != b->lives || a->flags != b->flags ||
+           a->jetpack_fuel != b->jetpack_fuel || a->last_dir != b->last_dir || a->camera_x != b->camera_x;
+}
+
+static bool bullet_changed(const bullet_t *a, const bullet_t *b)
+{
+    return a->px != b->px || a->py != b->py || a->dir != b->dir;
+}
+
+static bool enemy_changed(const enemy_view_t *a, const enemy_view_t *b)
+{
+    return a->type != b->type || a->px != b->px || a->py != b->py || a->dying != b->dying;
+}
+
+// Microseconds below 64 get a bucket each, after that each power of two is split into 32
+static uint32_t latency_bucket(const uint64_t us)
+{
+    if (us < 64) {
+        return (uint32_t)us;
+    }
+
+    uint32_t exponent = 6;
+    while (us >> (exponent + 1)) {
+        exponent++;
+    }
+    uint32_t bucket = 64 + (exponent - 6) * 32 + (uint32_t)((us >> (exponent - 5)) & 31);
+
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+static uint64_t bucket_floor(const uint32_t bucket)
+{
+    if (bucket < 64) {
+        return bucket;
+    }
+
+    uint32_t exponent = (bucket - 64) / 32 + 6;
+
+    return (uint64_t)(32 + (bucket - 64) % 32) << (exponent - 5);
+}
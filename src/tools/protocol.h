@@ -0,0 +1,112 @@
+#ifndef HH_PROTOCOL_H
+#define HH_PROTOCOL_H
+
+#include "../sim.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// What hh-server and its clients say to each other over a stream socket. Everything is little-endian.
+//
+// Client to server:
+//   hello  MSG_HELLO, start level                          2 bytes, once, first
+//   input  MSG_INPUT, buttons (INPUT_*), sequence number   6 bytes, whenever the held buttons change or more often
+//
+// Server to client, once per tick: a 2 byte length then
+//   0 tick
+//   4 sequence number of the last input the tick used
+//   8 parts present (PART_*), each only if it changed since the last update
+//   9 the parts in PART_* order
+#define MSG_HELLO 1
+#define MSG_INPUT 2
+#define MSG_HELLO_SIZE 2
+#define MSG_INPUT_SIZE 6
+
+#define PART_LEVEL (1 << 0)
+#define PART_PLAYER (1 << 1)
+#define PART_BULLETS (1 << 2)
+#define PART_ENEMIES (1 << 3)
+#define PART_TILES (1 << 4)
+
+#define UPDATE_HEADER_SIZE 9
+// Header, every part and a tick's worth of changed tiles
+#define MAX_UPDATE_SIZE 256
+
+// Tiles changed by one tick, i.e. items picked up and tiles set by routines. Each is an event, so as many as a tick can
+// emit, which a routine setting a whole wall at once can come close to.
+#define MAX_CHANGED_TILES MAX_EVENTS_PER_TICK
+
+// Sessions step at the game's 30 Hz
+#define SESSION_TICK_US 33333
+
+// Player flags in PART_PLAYER
+#define VIEW_HAS_TROPHY (1 << 0)
+#define VIEW_HAS_GUN (1 << 1)
+#define VIEW_USING_JETPACK (1 << 2)
+#define VIEW_DYING (1 << 3)
+
+typedef struct {
+    uint8_t type;
+    uint16_t px;
+    uint16_t py;
+    uint8_t dying;
+} enemy_view_t;
+
+// The part of a game a client needs to draw it. Both ends keep the last one sent and only the difference goes over.
+typedef struct {
+    // PART_LEVEL
+    uint8_t level;
+    bool is_running;
+
+    // PART_PLAYER
+    int16_t px;
+    int16_t py;
+    uint32_t score;
+    uint8_t lives;
+    uint8_t flags;
+    uint8_t jetpack_fuel;
+    int8_t last_dir;
+    uint8_t camera_x;
+
+    // PART_BULLETS
+    bullet_t bullet;
+    bullet_t ebullet;
+
+    // PART_ENEMIES
+    enemy_view_t enemies[NUM_ENEMIES];
+
+    // PART_TILES, which the receiver applies to its own copy of the level
+    uint8_t num_tiles;
+    uint16_t tiles[MAX_CHANGED_TILES];
+    uint8_t tile_values[MAX_CHANGED_TILES];
+} view_t;
+
+size_t write_hello(uint8_t *out, const uint8_t level);
+size_t write_input(uint8_t *out, const uint8_t buttons, const uint32_t seq);
+// Size of the client message at the start of in, 0 if it isn't one
+size_t client_msg_size(const uint8_t *in, const size_t size);
+void read_input(const uint8_t *in, uint8_t *buttons, uint32_t *seq);
+
+// What both ends start from, so the first update carries everything
+void view_init(view_t *view);
+void view_from_game(view_t *view, const game_state_t *game);
+size_t write_update(uint8_t *out, const uint32_t tick, const uint32_t ack, const view_t *sent, const view_t *view);
+bool read_update(const uint8_t *in, const size_t size, uint32_t *tick, uint32_t *ack, view_t *view);
+
+// Log-linear histogram of microsecond latencies, for percentiles without keeping every sample
+#define LATENCY_BUCKETS 1024
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+void latency_add(latency_hist_t *hist, const uint64_t us);
+void latency_merge(latency_hist_t *into, const latency_hist_t *from);
+uint64_t latency_percentile(const latency_hist_t *hist, const double percentile);
+
+uint64_t now_us(void);
+
+#endif // !HH_PROTOCOL_H
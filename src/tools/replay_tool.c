@@ -0,0 +1,494 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../log.h"
+#include "../replay.h"
+#include "../sim.h"
+#include <SDL.h>
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Re-simulates a directory of replays on every core, checks each one finishes with its recorded result and writes
+// per-level statistics (levels.csv) and death heatmaps (deaths_level<n>.ppm) to the output directory.
+//
+//   hh-replay-tool [-j THREADS] [-o OUT_DIR] REPLAY_DIR
+
+#define MAX_WORKERS 64
+#define MAX_PATH_SIZE 512
+#define REPLAY_EXT ".hhr"
+
+#define HEATMAP_SCALE 8
+
+typedef struct {
+    uint32_t starts;
+    uint32_t clears;
+    uint32_t deaths;
+    uint32_t deaths_by[NUM_DEATH_CAUSES];
+    uint32_t pickups;
+    uint32_t enemies_killed;
+    // Ticks from entering a level to leaving it through the door
+    uint64_t door_ticks;
+    uint32_t door_min;
+    uint32_t door_max;
+    uint32_t death_map[LEVEL_H][LEVEL_W];
+} level_stats_t;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t passed;
+    uint32_t failed;
+    uint32_t unreadable;
+    uint64_t ticks;
+    level_stats_t levels[NUM_LEVELS];
+} stats_t;
+
+// Chase-Lev deque of replay indices. The owner takes from the bottom, idle workers steal from the top. Nothing is
+// pushed once the workers start, so the buffer never has to grow.
+typedef struct {
+    uint32_t *items;
+    SDL_atomic_t top;
+    SDL_atomic_t bottom;
+} deque_t;
+
+typedef struct {
+    uint8_t id;
+    SDL_Thread *thread;
+    deque_t deque;
+    stats_t stats;
+    uint32_t stolen;
+
+    // Each replay is played back in these, so workers only share the loaded levels and the deques they steal from
+    level_t levels[NUM_LEVELS];
+    game_state_t game;
+    event_buffer_t events;
+    flow_field_t flow;
+    replay_t replay;
+} worker_t;
+
+static level_t levels[NUM_LEVELS];
+static mask_t masks[NUM_TILES];
+static char **fnames;
+static uint32_t num_fnames;
+static worker_t *workers;
+static uint8_t num_workers;
+
+static int list_replays(const char *dir);
+static int SDLCALL worker_run(void *data);
+static bool take(deque_t *deque, uint32_t *item);
+static bool steal(deque_t *deque, uint32_t *item);
+static void simulate(worker_t *worker, const char *fname);
+static void merge(stats_t *into, const stats_t *from);
+static int write_csv(const stats_t *stats, const char *out_dir);
+static int write_heatmap(const level_stats_t *stats, const uint8_t level, const char *out_dir);
+
+int main(int argc, char *argv[])
+{
+    const char *replay_dir = NULL;
+    const char *out_dir = ".";
+    int threads = SDL_GetCPUCount();
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-j", strlen("-j")) == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-o", strlen("-o")) == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else {
+            replay_dir = argv[i];
+        }
+    }
+
+    if (!replay_dir) {
+        fprintf(stderr, "usage: %s [-j THREADS] [-o OUT_DIR] REPLAY_DIR\n", argv[0]);
+        return 1;
+    }
+
+    num_workers = threads < 1 ? 1 : threads > MAX_WORKERS ? MAX_WORKERS : (uint8_t)threads;
+
+    err_handle(sim_load_levels(levels));
+    err_handle(mask_load_sprites(masks));
+    err_handle(list_replays(replay_dir));
+
+    workers = calloc(num_workers, sizeof(worker_t));
+    uint32_t *items = malloc(((size_t)num_fnames + 1) * sizeof(uint32_t));
+    if (!workers || !items) {
+        err_handle(err_fatal(ERR_ALLOC, "replay tool workers"));
+    }
+
+    // Deal out contiguous runs of replays, stealing evens out the rest
+    for (uint32_t i = 0; i < num_fnames; i++) {
+        items[i] = i;
+    }
+    for (uint8_t i = 0; i < num_workers; i++) {
+        uint32_t begin = (uint32_t)((uint64_t)num_fnames * i / num_workers);
+        uint32_t end = (uint32_t)((uint64_t)num_fnames * (i + 1) / num_workers);
+
+        workers[i].id = i;
+        workers[i].deque.items = &items[begin];
+        SDL_AtomicSet(&workers[i].deque.top, 0);
+        SDL_AtomicSet(&workers[i].deque.bottom, (int)(end - begin));
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    // The main thread is worker 0
+    for (uint8_t i = 1; i < num_workers; i++) {
+        workers[i].thread = SDL_CreateThread(worker_run, "replay worker", &workers[i]);
+        if (!workers[i].thread) {
+            fprintf(stderr, "couldn't start worker %u: %s\n", i, SDL_GetError());
+        }
+    }
+    worker_run(&workers[0]);
+
+    stats_t stats = {0};
+    uint32_t stolen = 0;
+    for (uint8_t i = 0; i < num_workers; i++) {
+        if (workers[i].thread) {
+            SDL_WaitThread(workers[i].thread, NULL);
+        }
+        merge(&stats, &workers[i].stats);
+        stolen += workers[i].stolen;
+    }
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+    printf("replays: %u (%u passed, %u failed, %u unreadable) on %u threads, %u stolen\n", stats.runs, stats.passed,
+           stats.failed, stats.unreadable, num_workers, stolen);
+    printf("time: %.3f s (%.0f replays/s, %.0f ticks/s)\n", seconds, seconds > 0 ? stats.runs / seconds : 0,
+           seconds > 0 ? stats.ticks / seconds : 0);
+
+    err_handle(write_csv(&stats, out_dir));
+    for (uint8_t i = 0; i < NUM_LEVELS; i++) {
+        if (stats.levels[i].deaths) {
+            err_handle(write_heatmap(&stats.levels[i], i, out_dir));
+        }
+    }
+
+    for (uint32_t i = 0; i < num_fnames; i++) {
+        free(fnames[i]);
+    }
+    free(fnames);
+    free(items);
+    free(workers);
+
+    return stats.failed || stats.unreadable ? 1 : 0;
+}
+
+static int list_replays(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        return err_fatal(ERR_OPENING_FILE, dir);
+    }
+
+    uint32_t capacity = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(d))) {
+        size_t len = strlen(entry->d_name);
+        if (len <= strlen(REPLAY_EXT) || strcmp(entry->d_name + len - strlen(REPLAY_EXT), REPLAY_EXT) != 0) {
+            continue;
+        }
+
+        if (num_fnames == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            char **grown = realloc(fnames, capacity * sizeof(char *));
+            if (!grown) {
+                closedir(d);
+                return err_fatal(ERR_ALLOC, "replay file names");
+            }
+            fnames = grown;
+        }
+
+        fnames[num_fnames] = malloc(MAX_PATH_SIZE);
+        if (!fnames[num_fnames]) {
+            closedir(d);
+            return err_fatal(ERR_ALLOC, "replay file names");
+        }
+        snprintf(fnames[num_fnames++], MAX_PATH_SIZE, "%s/%s", dir, entry->d_name);
+    }
+
+    closedir(d);
+
+    return SUCCESS;
+}
+
+static int SDLCALL worker_run(void *data)
+{
+    worker_t *worker = data;
+    uint32_t item;
+
+    for (;;) {
+        if (take(&worker->deque, &item)) {
+            simulate(worker, fnames[item]);
+            continue;
+        }
+
+        // Out of work, so try everyone else, starting with the next worker along
+        bool found = false;
+        for (uint8_t i = 1; i < num_workers && !found; i++) {
+            worker_t *victim = &workers[(worker->id + i) % num_workers];
+            while (steal(&victim->deque, &item)) {
+                worker->stolen++;
+                simulate(worker, fnames[item]);
+                found = true;
+            }
+        }
+
+        // NOTE: nothing is ever pushed, so a full pass without finding work means we're done
+        if (!found) {
+            return 0;
+        }
+    }
+}
+
+static bool take(deque_t *deque, uint32_t *item)
+{
+    int bottom = SDL_AtomicGet(&deque->bottom) - 1;
+    // NOTE: SDL_AtomicSet() is a full barrier, which keeps thieves from reading the old bottom after we read top
+    SDL_AtomicSet(&deque->bottom, bottom);
+    int top = SDL_AtomicGet(&deque->top);
+
+    if (top > bottom) {
+        SDL_AtomicSet(&deque->bottom, bottom + 1);
+        return false;
+    }
+
+    *item = deque->items[bottom];
+
+    // Racing thieves for the last item
+    if (top == bottom) {
+        bool won = SDL_AtomicCAS(&deque->top, top, top + 1);
+        SDL_AtomicSet(&deque->bottom, bottom + 1);
+        return won;
+    }
+
+    return true;
+}
+
+static bool steal(deque_t *deque, uint32_t *item)
+{
+    for (;;) {
+        int top = SDL_AtomicGet(&deque->top);
+        SDL_MemoryBarrierAcquire();
+        int bottom = SDL_AtomicGet(&deque->bottom);
+
+        if (top >= bottom) {
+            return false;
+        }
+
+        *item = deque->items[top];
+        if (SDL_AtomicCAS(&deque->top, top, top + 1)) {
+            return true;
+        }
+    }
+}
+
+static void simulate(worker_t *worker, const char *fname)
+{
+    stats_t *stats = &worker->stats;
+    replay_t *replay = &worker->replay;
+    game_state_t *game = &worker->game;
+    event_buffer_t *events = &worker->events;
+
+    stats->runs++;
+
+    // NOTE: err_fatal() details are shared between threads, so report the file name ourselves
+    if (replay_load(replay, fname) != SUCCESS) {
+        fprintf(stderr, "%s: couldn't read replay\n", fname);
+        stats->unreadable++;
+        return;
+    }
+
+    // The replay has to start on the levels as they were loaded, not as the last replay on this worker left them
+    memcpy(worker->levels, levels, sizeof(levels));
+    sim_init(game, worker->levels, masks, &worker->flow, events);
+    game->cur_level = replay->start_level;
+    sim_start_level(game);
+
+    uint32_t tick = 0;
+    uint32_t level_entered = 0;
+    uint8_t entered = game->cur_level;
+    stats->levels[entered].starts++;
+
+    for (; tick < replay->num_ticks && game->is_running; tick++) {
+        sim_tick(game, &replay->inputs[tick]);
+
+        for (size_t i = 0; i < events->count; i++) {
+            const game_event_t *event = &events->events[i];
+            level_stats_t *level = &stats->levels[event->level < NUM_LEVELS ? event->level : 0];
+
+            switch (event->type) {
+            case EVENT_PLAYER_DIED: {
+                level->deaths++;
+                if (event->value < NUM_DEATH_CAUSES) {
+                    level->deaths_by[event->value]++;
+                }
+                if (event->x < LEVEL_W && event->y < LEVEL_H) {
+                    level->death_map[event->y][event->x]++;
+                }
+            } break;
+
+            case EVENT_PICKUP: {
+                level->pickups++;
+            } break;
+
+            case EVENT_ENEMY_KILLED: {
+                level->enemies_killed++;
+            } break;
+
+            case EVENT_LEVEL_CLEARED: {
+                uint32_t ticks = tick - level_entered;
+                level->clears++;
+                level->door_ticks += ticks;
+                if (!level->door_min || ticks < level->door_min) {
+                    level->door_min = ticks;
+                }
+                if (ticks > level->door_max) {
+                    level->door_max = ticks;
+                }
+            } break;
+
+            case EVENT_LEVEL_START: {
+                // Restarting after a death doesn't count as entering the level again
+                if (event->value != entered) {
+                    entered = (uint8_t)event->value;
+                    level_entered = tick;
+                    stats->levels[entered < NUM_LEVELS ? entered : 0].starts++;
+                }
+            } break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    stats->ticks += tick;
+
+    if (replay_matches(replay, game)) {
+        stats->passed++;
+    } else {
+        stats->failed++;
+        fprintf(stderr, "%s: finished on level %u, lives %u, score %u (recorded: level %u, lives %u, score %u)\n",
+                fname, game->cur_level + 1, game->players[0].lives, game->players[0].score, replay->final_level + 1,
+                replay->final_lives, replay->final_score);
+    }
+}
+
+static void merge(stats_t *into, const stats_t *from)
+{
+    into->runs += from->runs;
+    into->passed += from->passed;
+    into->failed += from->failed;
+    into->unreadable += from->unreadable;
+    into->ticks += from->ticks;
+
+    for (size_t i = 0; i < NUM_LEVELS; i++) {
+        level_stats_t *a = &into->levels[i];
+        const level_stats_t *b = &from->levels[i];
+
+        a->starts += b->starts;
+        a->clears += b->clears;
+        a->deaths += b->deaths;
+        for (size_t j = 0; j < NUM_DEATH_CAUSES; j++) {
+            a->deaths_by[j] += b->deaths_by[j];
+        }
+        a->pickups += b->pickups;
+        a->enemies_killed += b->enemies_killed;
+        a->door_ticks += b->door_ticks;
+        if (b->door_min && (!a->door_min || b->door_min < a->door_min)) {
+            a->door_min = b->door_min;
+        }
+        if (b->door_max > a->door_max) {
+            a->door_max = b->door_max;
+        }
+        for (size_t y = 0; y < LEVEL_H; y++) {
+            for (size_t x = 0; x < LEVEL_W; x++) {
+                a->death_map[y][x] += b->death_map[y][x];
+            }
+        }
+    }
+}
+
+static int write_csv(const stats_t *stats, const char *out_dir)
+{
+    char fname[MAX_PATH_SIZE];
+    snprintf(fname, sizeof(fname), "%s/levels.csv", out_dir);
+
+    FILE *fd = fopen(fname, "w");
+    if (!fd) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    fprintf(fd, "level,starts,clears,deaths,deaths_hazard,deaths_enemy,deaths_enemy_bullet,pickups,enemies_killed,"
+                "door_ticks_avg,door_ticks_min,door_ticks_max\n");
+    for (size_t i = 0; i < NUM_LEVELS; i++) {
+        const level_stats_t *level = &stats->levels[i];
+        fprintf(fd, "%zu,%u,%u,%u,%u,%u,%u,%u,%u,%.1f,%u,%u\n", i + 1, level->starts, level->clears, level->deaths,
+                level->deaths_by[DEATH_BY_HAZARD], level->deaths_by[DEATH_BY_ENEMY],
+                level->deaths_by[DEATH_BY_ENEMY_BULLET], level->pickups, level->enemies_killed,
+                level->clears ? (double)level->door_ticks / level->clears : 0.0, level->door_min, level->door_max);
+    }
+
+    fclose(fd);
+    printf("wrote %s\n", fname);
+
+    return SUCCESS;
+}
+
+// Binary PPM, one HEATMAP_SCALE square per tile. Solid tiles are drawn grey for reference, deaths go from dark red
+// to yellow with the busiest tile brightest.
+static int write_heatmap(const level_stats_t *stats, const uint8_t level, const char *out_dir)
+{
+    char fname[MAX_PATH_SIZE];
+    snprintf(fname, sizeof(fname), "%s/deaths_level%u.ppm", out_dir, level + 1);
+
+    FILE *fd = fopen(fname, "wb");
+    if (!fd) {
+        return err_fatal(ERR_OPENING_FILE, fname);
+    }
+
+    uint32_t max = 1;
+    for (size_t y = 0; y < LEVEL_H; y++) {
+        for (size_t x = 0; x < LEVEL_W; x++) {
+            if (stats->death_map[y][x] > max) {
+                max = stats->death_map[y][x];
+            }
+        }
+    }
+
+    fprintf(fd, "P6\n%d %d\n255\n", LEVEL_W * HEATMAP_SCALE, LEVEL_H * HEATMAP_SCALE);
+
+    uint8_t row[LEVEL_W * HEATMAP_SCALE * 3];
+    for (size_t y = 0; y < LEVEL_H; y++) {
+        for (size_t x = 0; x < LEVEL_W; x++) {
+            uint8_t rgb[3] = {0, 0, 0};
+            uint32_t deaths = stats->death_map[y][x];
+
+            if (deaths) {
+                float heat = (float)deaths / (float)max;
+                rgb[0] = (uint8_t)(96 + heat * 159);
+                rgb[1] = (uint8_t)(heat * 255);
+            } else if (sim_is_solid(levels[level].tiles[y * LEVEL_W + x])) {
+                rgb[0] = rgb[1] = rgb[2] = 48;
+            }
+
+            for (size_t i = 0; i < HEATMAP_SCALE; i++) {
+                memcpy(&row[(x * HEATMAP_SCALE + i) * 3], rgb, 3);
+            }
+        }
+
+        for (size_t i = 0; i < HEATMAP_SCALE; i++) {
+            fwrite(row, 1, sizeof(row), fd);
+        }
+    }
+
+    fclose(fd);
+    printf("wrote %s\n", fname);
+
+    return SUCCESS;
+}
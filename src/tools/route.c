@@ -0,0 +1,450 @@
+#include "route.h"
+#include "../error.h"
+#include <stdlib.h>
+#include <string.h>
+
+const uint8_t ROUTE_ACTIONS[NUM_ROUTE_ACTIONS] = {
+    0,
+    INPUT_RIGHT,
+    INPUT_LEFT,
+    INPUT_JUMP,
+    INPUT_JUMP | INPUT_RIGHT,
+    INPUT_JUMP | INPUT_LEFT,
+    INPUT_UP,
+    INPUT_UP | INPUT_RIGHT,
+    INPUT_UP | INPUT_LEFT,
+    INPUT_DOWN,
+    INPUT_DOWN | INPUT_RIGHT,
+    INPUT_DOWN | INPUT_LEFT,
+    INPUT_JETPACK,
+    INPUT_FIRE,
+    INPUT_FIRE | INPUT_RIGHT,
+    INPUT_FIRE | INPUT_LEFT,
+};
+
+static void add_target(targets_t *targets, const uint16_t tile);
+static void add_scripted(route_info_t *info, const uint16_t tile);
+static int32_t ticks_to(const targets_t *targets, const int32_t px, const int32_t py, int32_t *to_px, int32_t *to_py);
+static bool open_before(const route_entry_t *a, const route_entry_t *b);
+static uint32_t visited_slot(const uint64_t hash, const uint32_t capacity);
+static uint64_t hash_value(const uint64_t hash, const uint32_t value);
+static uint64_t hash_bullet(uint64_t hash, const bullet_t *bullet);
+
+int route_info_init(route_info_t *info, const level_t *level)
+{
+    memset(info, 0, sizeof(route_info_t));
+
+    for (uint16_t i = 0; i < sizeof(level->tiles); i++) {
+        switch (level->tiles[i]) {
+        case TILE_TROPHY: {
+            add_target(&info->trophies, i);
+        } break;
+
+        case TILE_DOOR: {
+            add_target(&info->doors, i);
+        } break;
+
+        default:
+            break;
+        }
+
+        switch (level->tiles[i]) {
+        case TILE_GUN:
+        case TILE_JETPACK:
+        case TILE_TROPHY:
+        case 47:
+        case 48:
+        case 49:
+        case 50:
+        case 51:
+        case 52: {
+            // NOTE: anything past MAX_PICKUPS can still be picked up, the search just can't tell it apart
+            if (info->num_pickups < MAX_PICKUPS) {
+                info->pickups[info->num_pickups++] = i;
+            }
+        } break;
+
+        default:
+            break;
+        }
+    }
+
+    const script_t *script = &level->script;
+    for (uint16_t pc = 0; pc < script->size; pc += script_op_size(script->code[pc])) {
+        const uint8_t *op = &script->code[pc];
+        if (op[0] == SCRIPT_SET_TILE) {
+            add_scripted(info, (uint16_t)(op[2] * LEVEL_W + op[1]));
+        }
+    }
+
+    if (!info->trophies.count || !info->doors.count) {
+        return err_fatal(ERR_LEVEL, "no trophy or door");
+    }
+
+    return SUCCESS;
+}
+
+// Firing without the gun or toggling an empty jetpack would only repeat another action
+bool route_action_useful(const game_state_t *game, const uint8_t action)
+{
+    const player_t *player = &game->players[0];
+    return !(action & INPUT_FIRE && !player->has_gun) && !(action & INPUT_JETPACK && !player->jetpack_fuel);
+}
+
+// Ticks to the nearest trophy and then the nearest door at walking speed, if nothing were in the way. NOTE: not a
+// bound, landing snaps Harry to his tile up to half a tile at once and falling out of the bottom brings him back in at
+// the top, both quicker than walking. Dividing by those instead made the estimate too weak to finish level 3.
+int32_t route_ticks_left(const route_info_t *info, const game_state_t *game)
+{
+    int32_t px = (int16_t)game->players[0].px, py = (int16_t)game->players[0].py;
+    int32_t ticks = 0;
+
+    if (!game->players[0].has_trophy) {
+        ticks += ticks_to(&info->trophies, px, py, &px, &py);
+    }
+    ticks += ticks_to(&info->doors, px, py, &px, &py);
+
+    return ticks;
+}
+
+// FNV-1a over the parts of the state that change what happens next, field by field like sim_checksum() so the padding
+// between them is left out. Which pickups were taken only changes the score (the gun, jetpack and trophy are flags on
+// the player), so routes collecting fewer items merge. The cells routines change can open or close the way, so those
+// count. NOTE: a field added to the state that changes what happens next has to be added here too.
+uint64_t route_state_hash(const route_info_t *info, const game_state_t *game)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    // Left out: the tick and animation counters, the score and collision points, and the player's try_* inputs, which
+    // only last a tick
+    hash = hash_value(hash, game->is_running);
+    hash = hash_value(hash, game->cur_level);
+    hash = hash_value(hash, game->num_players);
+    hash = hash_bullet(hash, &game->ebullet);
+
+    const player_t *p = &game->players[0];
+    hash = hash_value(hash, (uint8_t)p->x);
+    hash = hash_value(hash, (uint8_t)p->y);
+    hash = hash_value(hash, (uint16_t)p->px);
+    hash = hash_value(hash, (uint16_t)p->py);
+    hash = hash_value(hash, p->lives);
+    hash = hash_value(hash, (uint8_t)p->last_dir);
+    hash = hash_value(hash, p->jetpack_fuel);
+    hash = hash_value(hash, p->pickup_x);
+    hash = hash_value(hash, p->pickup_y);
+    hash = hash_value(hash, p->camera_x);
+    hash = hash_value(hash, p->camera_y);
+    hash = hash_value(hash, (uint8_t)p->scroll_x);
+    const bool flags[] = {
+        p->right, p->left,          p->up,        p->down,       p->climb,     p->jump,       p->fire,
+        p->dying, p->using_jetpack, p->on_ground, p->check_door, p->can_climb, p->has_trophy, p->has_gun,
+    };
+    uint32_t bits = 0;
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        bits |= (uint32_t)flags[i] << i;
+    }
+    hash = hash_value(hash, bits);
+    hash = hash_bullet(hash, &p->bullet);
+
+    for (size_t i = 0; i < NUM_ENEMIES; i++) {
+        const enemy_t *m = &game->enemies[i];
+        hash = hash_value(hash, m->type);
+        hash = hash_value(hash, m->path_index);
+        hash = hash_value(hash, m->dying);
+        hash = hash_value(hash, m->x);
+        hash = hash_value(hash, m->y);
+        hash = hash_value(hash, m->px);
+        hash = hash_value(hash, m->py);
+        hash = hash_value(hash, (uint8_t)m->next_px);
+        hash = hash_value(hash, (uint8_t)m->next_py);
+    }
+
+    // Where the timers sit on the wheel depends on when they were set, only what's left of each changes what happens
+    for (uint8_t i = 0; i < NUM_TIMERS; i++) {
+        hash = hash_value(hash, timer_left(&game->timers, i));
+    }
+
+    for (size_t i = 0; i < NUM_ROUTINES; i++) {
+        hash = hash_value(hash, game->routines[i].pc);
+        hash = hash_value(hash, game->routines[i].state);
+        hash = hash_value(hash, game->routines[i].counter);
+    }
+    hash = hash_value(hash, game->awake);
+
+    for (uint8_t i = 0; i < info->num_scripted; i++) {
+        hash = hash_value(hash, game->level->tiles[info->scripted[i]]);
+    }
+    hash ^= hash >> 32;
+
+    return hash ? hash : 1;
+}
+
+// Bits for the pickups taken by the tick that emitted the events
+uint64_t route_taken(const route_info_t *info, const event_buffer_t *events)
+{
+    uint64_t taken = 0;
+
+    for (size_t i = 0; i < events->count; i++) {
+        const game_event_t *event = &events->events[i];
+        if (event->type != EVENT_PICKUP) {
+            continue;
+        }
+
+        for (uint8_t j = 0; j < info->num_pickups; j++) {
+            if (info->pickups[j] == event->y * LEVEL_W + event->x) {
+                taken |= 1ULL << j;
+            }
+        }
+    }
+
+    return taken;
+}
+
+// What the scripted cells hold in a level, to keep with the node that left it that way
+void route_save_scripted(const route_info_t *info, const level_t *level, uint8_t *scripted)
+{
+    for (uint8_t i = 0; i < info->num_scripted; i++) {
+        scripted[i] = level->tiles[info->scripted[i]];
+    }
+}
+
+// Brings a scratch copy of the level, currently with the pickups in `current` taken, in line with a node about to be
+// expanded. NOTE: the scratch copy is shared by every node a worker expands, so cells the node's routines changed are
+// put back as that node left them, and the worker's flow field told about any that opened or closed.
+void route_sync_level(const route_info_t *info, level_t *level, const level_t *original, uint64_t *current,
+                      const route_node_t *node, flow_field_t *flow)
+{
+    uint64_t taken = node->taken;
+    uint64_t changed = *current ^ taken;
+
+    for (uint8_t i = 0; changed; i++, changed >>= 1) {
+        if (changed & 1) {
+            uint16_t tile = info->pickups[i];
+            level->tiles[tile] = taken & (1ULL << i) ? 0 : original->tiles[tile];
+        }
+    }
+
+    *current = taken;
+
+    // After the pickups, a routine may have put something where one was
+    for (uint8_t i = 0; i < info->num_scripted; i++) {
+        uint16_t tile = info->scripted[i];
+        if (level->tiles[tile] != node->scripted[i]) {
+            level->tiles[tile] = node->scripted[i];
+            flow_tile_changed(flow, level->tiles, tile);
+        }
+    }
+}
+
+void route_open_init(route_open_t *open, const uint32_t max_nodes)
+{
+    memset(open, 0, sizeof(route_open_t));
+    open->max_nodes = max_nodes;
+}
+
+bool route_open_push(route_open_t *open, const route_node_t *node)
+{
+    if (!open->num_free && open->num_slab == open->capacity) {
+        if (open->capacity >= open->max_nodes) {
+            return false;
+        }
+
+        uint32_t capacity = open->capacity ? open->capacity * 2 : 1024;
+        capacity = capacity < open->max_nodes ? capacity : open->max_nodes;
+        route_node_t *slab = realloc(open->slab, capacity * sizeof(route_node_t));
+        uint32_t *free_slots = slab ? realloc(open->free_slots, capacity * sizeof(uint32_t)) : NULL;
+        route_entry_t *heap = free_slots ? realloc(open->heap, capacity * sizeof(route_entry_t)) : NULL;
+
+        if (slab) {
+            open->slab = slab;
+        }
+        if (free_slots) {
+            open->free_slots = free_slots;
+        }
+        if (!heap) {
+            // NOTE: dropping the node only makes the search less thorough
+            return false;
+        }
+        open->heap = heap;
+        open->capacity = capacity;
+    }
+
+    uint32_t slot = open->num_free ? open->free_slots[--open->num_free] : open->num_slab++;
+    open->slab[slot] = *node;
+
+    route_entry_t entry = {.f = node->f, .g = node->g, .slot = slot};
+    uint32_t i = open->num_open++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!open_before(&entry, &open->heap[parent])) {
+            break;
+        }
+        open->heap[i] = open->heap[parent];
+        i = parent;
+    }
+    open->heap[i] = entry;
+
+    return true;
+}
+
+void route_open_pop(route_open_t *open, route_node_t *node)
+{
+    route_entry_t *heap = open->heap;
+    *node = open->slab[heap[0].slot];
+    open->free_slots[open->num_free++] = heap[0].slot;
+
+    route_entry_t last = heap[--open->num_open];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= open->num_open) {
+            break;
+        }
+        if (child + 1 < open->num_open && open_before(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!open_before(&heap[child], &last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
+void route_open_clear(route_open_t *open)
+{
+    open->num_open = 0;
+    open->num_slab = 0;
+    open->num_free = 0;
+}
+
+void route_open_free(route_open_t *open)
+{
+    free(open->heap);
+    free(open->slab);
+    free(open->free_slots);
+    route_open_init(open, open->max_nodes);
+}
+
+int route_visited_init(route_visited_t *visited, const uint32_t capacity)
+{
+    visited->count = 0;
+    visited->capacity = capacity;
+    visited->hashes = calloc(capacity, sizeof(uint64_t));
+
+    return visited->hashes ? SUCCESS : err_fatal(ERR_ALLOC, "visited set");
+}
+
+bool route_visit(route_visited_t *visited, const uint64_t hash)
+{
+    if ((visited->count + 1) * 4 > visited->capacity * 3) {
+        uint32_t capacity = visited->capacity * 2;
+        uint64_t *hashes = calloc(capacity, sizeof(uint64_t));
+
+        if (hashes) {
+            for (uint32_t i = 0; i < visited->capacity; i++) {
+                uint64_t h = visited->hashes[i];
+                if (h) {
+                    uint32_t slot = visited_slot(h, capacity);
+                    while (hashes[slot]) {
+                        slot = (slot + 1) & (capacity - 1);
+                    }
+                    hashes[slot] = h;
+                }
+            }
+            free(visited->hashes);
+            visited->hashes = hashes;
+            visited->capacity = capacity;
+        }
+    }
+
+    for (uint32_t slot = visited_slot(hash, visited->capacity);; slot = (slot + 1) & (visited->capacity - 1)) {
+        if (visited->hashes[slot] == hash) {
+            return false;
+        }
+        if (!visited->hashes[slot]) {
+            // NOTE: if growing failed, fail shut rather than loop forever on a full table
+            if (visited->count + 1 >= visited->capacity) {
+                return false;
+            }
+            visited->hashes[slot] = hash;
+            visited->count++;
+            return true;
+        }
+    }
+}
+
+void route_visited_clear(route_visited_t *visited)
+{
+    memset(visited->hashes, 0, visited->capacity * sizeof(uint64_t));
+    visited->count = 0;
+}
+
+void route_visited_free(route_visited_t *visited)
+{
+    free(visited->hashes);
+    memset(visited, 0, sizeof(route_visited_t));
+}
+
+static void add_target(targets_t *targets, const uint16_t tile)
+{
+    if (targets->count < MAX_TARGETS) {
+        targets->px[targets->count] = (tile % LEVEL_W) * TILE_SIZE;
+        targets->py[targets->count] = (tile / LEVEL_W) * TILE_SIZE;
+        targets->count++;
+    }
+}
+
+static void add_scripted(route_info_t *info, const uint16_t tile)
+{
+    for (uint8_t i = 0; i < info->num_scripted; i++) {
+        if (info->scripted[i] == tile) {
+            return;
+        }
+    }
+    info->scripted[info->num_scripted++] = tile;
+}
+
+static int32_t ticks_to(const targets_t *targets, const int32_t px, const int32_t py, int32_t *to_px, int32_t *to_py)
+{
+    int32_t best = INT32_MAX;
+
+    for (uint8_t i = 0; i < targets->count; i++) {
+        // Horizontal and vertical movement happen in the same tick, hence the max
+        int32_t dx = abs(targets->px[i] - px), dy = abs(targets->py[i] - py);
+        int32_t ticks = (dx > dy ? dx : dy) / PLAYER_MOVE;
+
+        if (ticks < best) {
+            best = ticks;
+            *to_px = targets->px[i];
+            *to_py = targets->py[i];
+        }
+    }
+
+    return best;
+}
+
+// Ties go to the deeper node, which is closer to finishing for the same estimate
+static bool open_before(const route_entry_t *a, const route_entry_t *b)
+{
+    return a->f < b->f || (a->f == b->f && a->g > b->g);
+}
+
+// NOTE: from the high half, hh-solver picks a shard of visited sets with the low bits
+static uint32_t visited_slot(const uint64_t hash, const uint32_t capacity)
+{
+    return (uint32_t)(hash >> 32) & (capacity - 1);
+}
+
+// NOTE: a field at a time rather than sim_checksum()'s byte at a time, the hash never leaves the process so which way
+// round the machine stores it doesn't matter, and the search hashes every state it generates
+static uint64_t hash_value(const uint64_t hash, const uint32_t value) { return (hash ^ value) * 1099511628211ULL; }
+
+static uint64_t hash_bullet(uint64_t hash, const bullet_t *bullet)
+{
+    hash = hash_value(hash, bullet->px);
+    hash = hash_value(hash, bullet->py);
+
+    return hash_value(hash, (uint8_t)bullet->dir);
+}
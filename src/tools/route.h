@@ -0,0 +1,102 @@
+#ifndef HH_ROUTE_H
+#define HH_ROUTE_H
+
+#include "../sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Helpers for searching the simulation for a way through a level, shared by the solver and the level generator
+
+#define MAX_PICKUPS 64
+#define MAX_TARGETS 8
+// As many as a level's script has room for, at 4 bytes a SCRIPT_SET_TILE
+#define MAX_SCRIPTED_TILES (SCRIPT_CODE_SIZE / 4)
+
+// Inputs worth trying each tick, the rest are either redundant or cancel out
+#define NUM_ROUTE_ACTIONS 16
+extern const uint8_t ROUTE_ACTIONS[NUM_ROUTE_ACTIONS];
+
+// Pixel positions of every tile of one kind
+typedef struct {
+    uint8_t count;
+    int32_t px[MAX_TARGETS];
+    int32_t py[MAX_TARGETS];
+} targets_t;
+
+typedef struct {
+    targets_t trophies;
+    targets_t doors;
+    // Tile index of each pickup, bit i of a taken mask is pickups[i]
+    uint8_t num_pickups;
+    uint16_t pickups[MAX_PICKUPS];
+    // Tile index of each cell the level's routines can change
+    uint8_t num_scripted;
+    uint16_t scripted[MAX_SCRIPTED_TILES];
+} route_info_t;
+
+// A state reached by the search
+typedef struct {
+    float f;
+    uint32_t g;
+    // hh-solver's trail entry, so the route can be walked back
+    uint32_t trail;
+    // Pickups taken so far, see route_info_t
+    uint64_t taken;
+    // What each of route_info_t's scripted cells holds in this state
+    uint8_t scripted[MAX_SCRIPTED_TILES];
+    game_state_t state;
+} route_node_t;
+
+// Key of an open node, the nodes themselves sit still in a slab while the heap moves keys about
+typedef struct {
+    float f;
+    uint32_t g;
+    uint32_t slot;
+} route_entry_t;
+
+// Open list of a best-first search, a binary min-heap on f with ties broken towards the deeper node. Grows as needed up
+// to max_nodes, past which nodes are dropped.
+typedef struct {
+    route_entry_t *heap;
+    uint32_t num_open;
+    route_node_t *slab;
+    uint32_t *free_slots;
+    uint32_t num_slab, num_free;
+    uint32_t capacity;
+    uint32_t max_nodes;
+} route_open_t;
+
+// States seen so far by their route_state_hash(), open addressing with 0 marking an empty slot. Grows to keep the load
+// under 3/4.
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t *hashes;
+} route_visited_t;
+
+// ERR_LEVEL if there's no trophy or door to go to
+int route_info_init(route_info_t *info, const level_t *level);
+bool route_action_useful(const game_state_t *game, const uint8_t action);
+int32_t route_ticks_left(const route_info_t *info, const game_state_t *game);
+uint64_t route_state_hash(const route_info_t *info, const game_state_t *game);
+uint64_t route_taken(const route_info_t *info, const event_buffer_t *events);
+void route_save_scripted(const route_info_t *info, const level_t *level, uint8_t *scripted);
+void route_sync_level(const route_info_t *info, level_t *level, const level_t *original, uint64_t *current,
+                      const route_node_t *node, flow_field_t *flow);
+
+void route_open_init(route_open_t *open, const uint32_t max_nodes);
+// Returns false if the node was dropped, because the list is full or couldn't grow
+bool route_open_push(route_open_t *open, const route_node_t *node);
+void route_open_pop(route_open_t *open, route_node_t *node);
+// Empties the list, keeping its memory for the next search
+void route_open_clear(route_open_t *open);
+void route_open_free(route_open_t *open);
+
+// Capacity is a power of two
+int route_visited_init(route_visited_t *visited, const uint32_t capacity);
+// Returns true the first time a state is seen
+bool route_visit(route_visited_t *visited, const uint64_t hash);
+void route_visited_clear(route_visited_t *visited);
+void route_visited_free(route_visited_t *visited);
+
+#endif // !HH_ROUTE_H
@@ -0,0 +1,717 @@
+// Sockets, clock_gettime() and friends are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../log.h"
+#include "../sim.h"
+#include "protocol.h"
+#include <SDL.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Hosts many independent headless games in one process for leaderboard-verified play. Clients connect over a Unix
+// domain socket or localhost TCP, say which level to start on and then send their input whenever they like. The
+// server owns the simulation and steps each game at 30 Hz with the latest input it has, replying with what changed
+// (see protocol.h). Linux only, it is built on epoll.
+//
+// Each worker thread owns a shard of the sessions: their sockets are in its epoll set and their next ticks in its timer
+// wheel, so nothing is shared between workers once the main thread has handed a new connection over.
+//
+// -s plays a level with another script in place of its own, the first unless -l says otherwise.
+//
+//   hh-server [-u SOCKET_PATH] [-t PORT] [-j THREADS] [-m MAX_SESSIONS] [-d SECONDS] [-l LEVEL -s SCRIPT.hhs]
+
+#define MAX_WORKERS 64
+#define MAX_EPOLL_EVENTS 256
+#define STATUS_INTERVAL_MS 5000
+
+// Slots are a millisecond wide, and a wheel of 64 of them is more than the 33 ms a session waits between ticks, so a
+// session is never more than one turn of the wheel away
+#define WHEEL_SLOT_US 1000
+#define WHEEL_SLOTS 64
+#define NO_SESSION UINT32_MAX
+
+// Updates a client can fall behind by before it is dropped
+#define OUT_BUFFER_SIZE (8 * MAX_UPDATE_SIZE)
+#define IN_BUFFER_SIZE 64
+
+// epoll data of the pipe new connections arrive on, everything else is a session index
+#define HANDOFF_EVENT UINT64_MAX
+
+typedef struct {
+    game_state_t game;
+    event_buffer_t events;
+    flow_field_t flow;
+
+    int fd;
+    // A hello has arrived and the game is running, i.e. the session is in the timer wheel
+    bool started;
+    // The client has gone. The session is freed the next time its timer fires.
+    bool closed;
+    bool want_write;
+
+    // Next session in the same wheel slot, or on the free list
+    uint32_t next;
+    uint64_t due_us;
+    uint32_t tick;
+
+    // Latest input, used by every tick until the next one arrives
+    uint8_t input;
+    uint32_t input_seq;
+
+    uint8_t in[IN_BUFFER_SIZE];
+    uint32_t in_size;
+    uint8_t out[OUT_BUFFER_SIZE];
+    uint32_t out_size;
+
+    // What the client has been sent so far
+    view_t sent;
+
+    level_t levels[NUM_LEVELS];
+} session_t;
+
+typedef struct {
+    uint8_t id;
+    SDL_Thread *thread;
+    int epoll_fd;
+    // Connections accepted by the main thread arrive as file descriptors written down this pipe
+    int handoff[2];
+
+    session_t *sessions;
+    uint32_t capacity;
+    uint32_t free_list;
+    SDL_atomic_t num_sessions;
+
+    uint32_t wheel[WHEEL_SLOTS];
+    // The next slot to expire, an absolute count of WHEEL_SLOT_US since the epoch of now_us()
+    uint64_t wheel_slot;
+
+    // Stats
+    SDL_atomic_t steps_done;
+    uint64_t steps;
+    uint64_t step_us;
+    uint64_t bytes_out;
+    uint32_t games;
+    uint32_t too_slow;
+    uint32_t overruns;
+    latency_hist_t lateness;
+    double cpu_seconds;
+} worker_t;
+
+static level_t levels[NUM_LEVELS];
+static mask_t masks[NUM_TILES];
+static worker_t *workers;
+static uint8_t num_workers;
+static SDL_atomic_t stopping;
+
+static int listen_unix(const char *path);
+static int listen_tcp(const uint16_t port);
+static void raise_fd_limit(void);
+static void hand_over(const int fd);
+static void stop(int signum);
+static int SDLCALL worker_run(void *data);
+static void adopt(worker_t *worker);
+static void receive(worker_t *worker, const uint32_t index);
+static void start(worker_t *worker, const uint32_t index, const uint8_t level);
+static void expire(worker_t *worker, const uint64_t now);
+static void step(worker_t *worker, const uint32_t index, const uint64_t now);
+static void schedule(worker_t *worker, const uint32_t index);
+static void flush(worker_t *worker, const uint32_t index);
+static void watch_writes(worker_t *worker, const uint32_t index, const bool want_write);
+static void close_session(worker_t *worker, const uint32_t index);
+static void free_session(worker_t *worker, const uint32_t index);
+static void report(const double seconds);
+
+int main(int argc, char *argv[])
+{
+    const char *socket_path = NULL;
+    uint16_t port = 0;
+    int threads = SDL_GetCPUCount();
+    uint32_t max_sessions = 10000;
+    uint32_t duration_s = 0;
+    uint8_t script_level = LEVEL_1;
+    const char *script_fname = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-u", strlen("-u")) == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strncmp(argv[i], "-t", strlen("-t")) == 0 && i + 1 < argc) {
+            port = (uint16_t)atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", strlen("-j")) == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-m", strlen("-m")) == 0 && i + 1 < argc) {
+            max_sessions = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-d", strlen("-d")) == 0 && i + 1 < argc) {
+            duration_s = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-l", strlen("-l")) == 0 && i + 1 < argc) {
+            script_level = (uint8_t)(atoi(argv[++i]) - 1);
+        } else if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            script_fname = argv[++i];
+        }
+    }
+
+    if ((!socket_path && !port) || script_level >= NUM_LEVELS) {
+        fprintf(stderr,
+                "usage: %s [-u SOCKET_PATH] [-t PORT] [-j THREADS] [-m MAX_SESSIONS] [-d SECONDS] "
+                "[-l LEVEL -s SCRIPT.hhs]\n",
+                argv[0]);
+        return 1;
+    }
+
+    num_workers = threads < 1 ? 1 : threads > MAX_WORKERS ? MAX_WORKERS : (uint8_t)threads;
+
+    err_handle(sim_load_levels(levels));
+    err_handle(mask_load_sprites(masks));
+    if (script_fname) {
+        // NOTE: a missing script is an empty one to the game, here it's a mistake
+        err_handle(script_load(&levels[script_level].script, script_fname));
+        if (!levels[script_level].script.size) {
+            err_handle(err_fatal(ERR_SCRIPT, script_fname));
+        }
+    }
+    raise_fd_limit();
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    int listeners[2] = {-1, -1};
+    if (socket_path && (listeners[0] = listen_unix(socket_path)) < 0) {
+        err_handle(err_fatal(ERR_NET, socket_path));
+    }
+    if (port && (listeners[1] = listen_tcp(port)) < 0) {
+        err_handle(err_fatal(ERR_NET, "couldn't listen on the TCP port"));
+    }
+
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        err_handle(err_fatal(ERR_NET, "epoll"));
+    }
+    for (size_t i = 0; i < 2; i++) {
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = (uint32_t)i};
+        if (listeners[i] >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listeners[i], &event);
+        }
+    }
+
+    workers = calloc(num_workers, sizeof(worker_t));
+    if (!workers) {
+        err_handle(err_fatal(ERR_ALLOC, "server workers"));
+    }
+
+    for (uint8_t i = 0; i < num_workers; i++) {
+        worker_t *worker = &workers[i];
+        worker->id = i;
+        worker->capacity = (max_sessions + num_workers - 1) / num_workers;
+        worker->sessions = calloc(worker->capacity, sizeof(session_t));
+        worker->epoll_fd = epoll_create1(0);
+        if (!worker->sessions || worker->epoll_fd < 0 || pipe(worker->handoff) != 0) {
+            err_handle(err_fatal(ERR_ALLOC, "server sessions"));
+        }
+
+        fcntl(worker->handoff[0], F_SETFL, O_NONBLOCK);
+        struct epoll_event event = {.events = EPOLLIN, .data.u64 = HANDOFF_EVENT};
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->handoff[0], &event);
+
+        worker->thread = SDL_CreateThread(worker_run, "server worker", worker);
+        if (!worker->thread) {
+            err_handle(err_fatal(ERR_NET, SDL_GetError()));
+        }
+    }
+
+    printf("serving up to %u sessions on %u threads%s%s%s\n", max_sessions, num_workers,
+           socket_path ? ", unix:" : "", socket_path ? socket_path : "", port ? ", tcp" : "");
+    fflush(stdout);
+
+    // The main thread only accepts connections and hands them to whichever worker has the fewest sessions
+    uint64_t started = now_us(), last_status = started;
+    uint64_t last_steps = 0;
+
+    while (!SDL_AtomicGet(&stopping)) {
+        struct epoll_event events[2];
+        int n = epoll_wait(epoll_fd, events, 2, 100);
+
+        for (int i = 0; i < n; i++) {
+            int listener = listeners[events[i].data.u32];
+            int fd;
+            while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                if (listener == listeners[1]) {
+                    int on = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                }
+                hand_over(fd);
+            }
+        }
+
+        uint64_t now = now_us();
+        if (duration_s && now - started >= (uint64_t)duration_s * 1000000) {
+            break;
+        }
+        if (now - last_status >= STATUS_INTERVAL_MS * 1000) {
+            uint64_t steps = 0;
+            uint32_t sessions = 0;
+            for (uint8_t i = 0; i < num_workers; i++) {
+                steps += (uint32_t)SDL_AtomicGet(&workers[i].steps_done);
+                sessions += (uint32_t)SDL_AtomicGet(&workers[i].num_sessions);
+            }
+            printf("sessions: %u, %.0f ticks/s\n", sessions,
+                   (double)(steps - last_steps) * 1000000.0 / (double)(now - last_status));
+            fflush(stdout);
+            last_steps = steps;
+            last_status = now;
+        }
+    }
+
+    SDL_AtomicSet(&stopping, 1);
+    for (uint8_t i = 0; i < num_workers; i++) {
+        SDL_WaitThread(workers[i].thread, NULL);
+    }
+
+    report((double)(now_us() - started) / 1000000.0);
+
+    for (size_t i = 0; i < 2; i++) {
+        if (listeners[i] >= 0) {
+            close(listeners[i]);
+        }
+    }
+    if (socket_path) {
+        unlink(socket_path);
+    }
+    close(epoll_fd);
+    for (uint8_t i = 0; i < num_workers; i++) {
+        close(workers[i].handoff[0]);
+        close(workers[i].handoff[1]);
+        close(workers[i].epoll_fd);
+        free(workers[i].sessions);
+    }
+    free(workers);
+
+    return 0;
+}
+
+static int listen_unix(const char *path)
+{
+    struct sockaddr_un address = {0};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    // NOTE: a server that was killed leaves its socket behind
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    return fd;
+}
+
+// Only on localhost, anything further away should go through something that terminates TLS
+static int listen_tcp(const uint16_t port)
+{
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    return fd;
+}
+
+// Thousands of sessions are thousands of sockets, more than the usual soft limit of 1024
+static void raise_fd_limit(void)
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void hand_over(const int fd)
+{
+    worker_t *least = NULL;
+    int fewest = INT32_MAX;
+
+    for (uint8_t i = 0; i < num_workers; i++) {
+        int sessions = SDL_AtomicGet(&workers[i].num_sessions);
+        if (sessions < fewest && (uint32_t)sessions < workers[i].capacity) {
+            fewest = sessions;
+            least = &workers[i];
+        }
+    }
+
+    // NOTE: counted here rather than by the worker so the next connection sees it straight away
+    if (!least || write(least->handoff[1], &fd, sizeof(fd)) != (ssize_t)sizeof(fd)) {
+        LOG_INFO("hand_over", "full, turning a connection away");
+        close(fd);
+        return;
+    }
+    SDL_AtomicAdd(&least->num_sessions, 1);
+}
+
+static void stop(int signum)
+{
+    (void)signum;
+    SDL_AtomicSet(&stopping, 1);
+}
+
+static int SDLCALL worker_run(void *data)
+{
+    worker_t *worker = data;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    for (uint32_t i = 0; i < worker->capacity; i++) {
+        worker->sessions[i].next = i + 1 < worker->capacity ? i + 1 : NO_SESSION;
+    }
+    worker->free_list = worker->capacity ? 0 : NO_SESSION;
+    for (size_t i = 0; i < WHEEL_SLOTS; i++) {
+        worker->wheel[i] = NO_SESSION;
+    }
+    worker->wheel_slot = now_us() / WHEEL_SLOT_US;
+
+    while (!SDL_AtomicGet(&stopping)) {
+        // Sleep until the current slot is over, unless a socket has something first
+        uint64_t now = now_us();
+        uint64_t slot_end = (worker->wheel_slot + 1) * WHEEL_SLOT_US;
+        int timeout_ms = slot_end > now ? (int)((slot_end - now + 999) / 1000) : 0;
+
+        int n = epoll_wait(worker->epoll_fd, events, MAX_EPOLL_EVENTS, timeout_ms);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == HANDOFF_EVENT) {
+                adopt(worker);
+                continue;
+            }
+
+            uint32_t index = (uint32_t)events[i].data.u64;
+            if (events[i].events & EPOLLOUT) {
+                flush(worker, index);
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                receive(worker, index);
+            }
+        }
+
+        expire(worker, now_us());
+    }
+
+    for (uint32_t i = 0; i < worker->capacity; i++) {
+        if (worker->sessions[i].fd > 0 && !worker->sessions[i].closed) {
+            close(worker->sessions[i].fd);
+        }
+    }
+
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    worker->cpu_seconds = (double)cpu.tv_sec + (double)cpu.tv_nsec / 1e9;
+
+    return 0;
+}
+
+static void adopt(worker_t *worker)
+{
+    int fd;
+
+    while (read(worker->handoff[0], &fd, sizeof(fd)) == (ssize_t)sizeof(fd)) {
+        uint32_t index = worker->free_list;
+        if (index == NO_SESSION) {
+            close(fd);
+            SDL_AtomicAdd(&worker->num_sessions, -1);
+            continue;
+        }
+
+        session_t *session = &worker->sessions[index];
+        worker->free_list = session->next;
+
+        session->fd = fd;
+        session->started = false;
+        session->closed = false;
+        session->want_write = false;
+        session->in_size = 0;
+        session->out_size = 0;
+
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        struct epoll_event event = {.events = EPOLLIN, .data.u64 = index};
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close_session(worker, index);
+        }
+    }
+}
+
+static void receive(worker_t *worker, const uint32_t index)
+{
+    session_t *session = &worker->sessions[index];
+
+    for (;;) {
+        if (session->closed) {
+            return;
+        }
+
+        ssize_t got = read(session->fd, &session->in[session->in_size], IN_BUFFER_SIZE - session->in_size);
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close_session(worker, index);
+            return;
+        }
+        if (got < 0) {
+            return;
+        }
+        session->in_size += (uint32_t)got;
+
+        uint32_t used = 0;
+        size_t size;
+        while ((size = client_msg_size(&session->in[used], session->in_size - used))) {
+            const uint8_t *msg = &session->in[used];
+            used += (uint32_t)size;
+
+            if (msg[0] == MSG_HELLO && !session->started) {
+                start(worker, index, msg[1]);
+            } else if (msg[0] == MSG_INPUT && session->started) {
+                read_input(msg, &session->input, &session->input_seq);
+            }
+        }
+
+        // Anything that isn't the start of a message is a client that doesn't speak the protocol
+        if (session->in_size - used && !(session->in[used] == MSG_HELLO || session->in[used] == MSG_INPUT)) {
+            close_session(worker, index);
+            return;
+        }
+
+        memmove(session->in, &session->in[used], session->in_size - used);
+        session->in_size -= used;
+    }
+}
+
+static void start(worker_t *worker, const uint32_t index, const uint8_t level)
+{
+    session_t *session = &worker->sessions[index];
+
+    memcpy(session->levels, levels, sizeof(levels));
+    sim_init(&session->game, session->levels, masks, &session->flow, &session->events);
+    session->game.cur_level = level < NUM_LEVELS ? level : LEVEL_1;
+    sim_start_level(&session->game);
+
+    session->started = true;
+    session->tick = 0;
+    session->input = 0;
+    session->input_seq = 0;
+    view_init(&session->sent);
+
+    // Spread the sessions over the tick so a burst of connections doesn't become a burst of work every 33 ms
+    session->due_us = now_us() + (uint64_t)index * 7919 % SESSION_TICK_US;
+    schedule(worker, index);
+}
+
+// Steps every session whose slot has passed. NOTE: the cost is the number of sessions due, plus one per empty slot.
+static void expire(worker_t *worker, const uint64_t now)
+{
+    while ((worker->wheel_slot + 1) * WHEEL_SLOT_US <= now) {
+        uint32_t *slot = &worker->wheel[worker->wheel_slot % WHEEL_SLOTS];
+        uint32_t index = *slot;
+        *slot = NO_SESSION;
+        worker->wheel_slot++;
+
+        while (index != NO_SESSION) {
+            uint32_t next = worker->sessions[index].next;
+            step(worker, index, now);
+            index = next;
+        }
+    }
+}
+
+static void step(worker_t *worker, const uint32_t index, const uint64_t now)
+{
+    session_t *session = &worker->sessions[index];
+
+    if (session->closed) {
+        free_session(worker, index);
+        return;
+    }
+
+    uint64_t start = now_us();
+    latency_add(&worker->lateness, start > session->due_us ? start - session->due_us : 0);
+
+    sim_tick(&session->game, &session->input);
+
+    view_t view;
+    view_from_game(&view, &session->game);
+    if (session->out_size + MAX_UPDATE_SIZE > OUT_BUFFER_SIZE) {
+        // NOTE: deltas only work if every one arrives, so there's no skipping some for a client that can't keep up
+        worker->too_slow++;
+        close_session(worker, index);
+        free_session(worker, index);
+        return;
+    }
+    session->out_size += (uint32_t)write_update(&session->out[session->out_size], session->tick++,
+                                                session->input_seq, &session->sent, &view);
+    session->sent = view;
+    flush(worker, index);
+
+    worker->steps++;
+    worker->step_us += now_us() - start;
+    SDL_AtomicAdd(&worker->steps_done, 1);
+
+    // The last update says the game is over, the client can see itself out
+    if (!session->game.is_running) {
+        worker->games++;
+        close_session(worker, index);
+        free_session(worker, index);
+        return;
+    }
+
+    session->due_us += SESSION_TICK_US;
+    if (session->due_us + SESSION_TICK_US < now) {
+        // A whole tick behind - the worker is overloaded. Carry on from now rather than trying to catch up.
+        worker->overruns++;
+        session->due_us = now;
+    }
+    schedule(worker, index);
+}
+
+static void schedule(worker_t *worker, const uint32_t index)
+{
+    session_t *session = &worker->sessions[index];
+    uint64_t slot = session->due_us / WHEEL_SLOT_US;
+
+    // NOTE: the slot being expired has already been taken off the wheel. Nothing is due more than a tick from now, so
+    // nothing lands a whole turn of the wheel ahead.
+    if (slot < worker->wheel_slot) {
+        slot = worker->wheel_slot;
+    }
+
+    session->next = worker->wheel[slot % WHEEL_SLOTS];
+    worker->wheel[slot % WHEEL_SLOTS] = index;
+}
+
+static void flush(worker_t *worker, const uint32_t index)
+{
+    session_t *session = &worker->sessions[index];
+    if (session->closed || !session->out_size) {
+        return;
+    }
+
+    ssize_t sent = send(session->fd, session->out, session->out_size, MSG_NOSIGNAL);
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        close_session(worker, index);
+        return;
+    }
+
+    if (sent > 0) {
+        worker->bytes_out += (uint64_t)sent;
+        memmove(session->out, &session->out[sent], session->out_size - (uint32_t)sent);
+        session->out_size -= (uint32_t)sent;
+    }
+
+    watch_writes(worker, index, session->out_size > 0);
+}
+
+// Only asks to hear about the socket being writable while there is something waiting to go out
+static void watch_writes(worker_t *worker, const uint32_t index, const bool want_write)
+{
+    session_t *session = &worker->sessions[index];
+    if (session->want_write == want_write) {
+        return;
+    }
+
+    struct epoll_event event = {.events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.u64 = index};
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, session->fd, &event);
+    session->want_write = want_write;
+}
+
+// NOTE: a session in the wheel stays there until its timer fires, see step()
+static void close_session(worker_t *worker, const uint32_t index)
+{
+    session_t *session = &worker->sessions[index];
+    if (session->closed) {
+        return;
+    }
+
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    session->closed = true;
+
+    if (!session->started) {
+        free_session(worker, index);
+    }
+}
+
+static void free_session(worker_t *worker, const uint32_t index)
+{
+    session_t *session = &worker->sessions[index];
+
+    session->fd = -1;
+    session->started = false;
+    session->next = worker->free_list;
+    worker->free_list = index;
+    SDL_AtomicAdd(&worker->num_sessions, -1);
+}
+
+static void report(const double seconds)
+{
+    latency_hist_t lateness = {0};
+    uint64_t steps = 0, step_us = 0, bytes_out = 0;
+    uint32_t games = 0, too_slow = 0, overruns = 0;
+    double cpu_seconds = 0;
+
+    for (uint8_t i = 0; i < num_workers; i++) {
+        worker_t *worker = &workers[i];
+        latency_merge(&lateness, &worker->lateness);
+        steps += worker->steps;
+        step_us += worker->step_us;
+        bytes_out += worker->bytes_out;
+        games += worker->games;
+        too_slow += worker->too_slow;
+        overruns += worker->overruns;
+        cpu_seconds += worker->cpu_seconds;
+    }
+
+    printf("ran %.1f s on %u threads: %lu ticks (%.0f/s), %u games finished, %u clients too slow, %u overruns\n",
+           seconds, num_workers, (unsigned long)steps, steps / seconds, games, too_slow, overruns);
+    if (!steps) {
+        return;
+    }
+
+    printf("updates: %.1f bytes on average\n", (double)bytes_out / (double)steps);
+    printf("tick: %.2f us on average to simulate, diff and send\n", (double)step_us / (double)steps);
+    printf("lateness: p50 %lu us, p99 %lu us, p99.9 %lu us, max %lu us\n",
+           (unsigned long)latency_percentile(&lateness, 50), (unsigned long)latency_percentile(&lateness, 99),
+           (unsigned long)latency_percentile(&lateness, 99.9), (unsigned long)lateness.max_us);
+
+    // Everything a worker spent its time on, epoll and the sockets included, over what one session needs per second
+    if (cpu_seconds > 0) {
+        double per_session = cpu_seconds / (double)steps * 30.0;
+        printf("cpu: %.2f s across workers, %.0f sessions per core at 30 Hz\n", cpu_seconds, 1.0 / per_session);
+    }
+}
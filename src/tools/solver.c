@@ -0,0 +1,387 @@
+#define SDL_MAIN_HANDLED
+
+#include "../error.h"
+#include "../log.h"
+#include "../replay.h"
+#include "../sim.h"
+#include "route.h"
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Searches for a fast way through a level by running the simulation itself, one tick per edge, best first on ticks
+// taken plus an estimate of the ticks left (to the trophy, then to the door). Finding a route proves the level can be
+// beaten; the route is written out as a replay. The estimate can overshoot, so the route isn't always the fastest.
+// -s solves the level with another script in place of its own.
+//
+//   hh-solver [-l LEVEL] [-s SCRIPT.hhs] [-j THREADS] [-w WEIGHT] [-n MAX_NODES] [-o OUT.hhr]
+
+#define MAX_WORKERS 64
+#define EXPAND_BATCH 32
+
+#define NUM_VISITED_SHARDS 64
+#define VISITED_SHARD_START_SIZE 4096
+
+#define NO_PARENT UINT32_MAX
+
+// How each state was reached, enough to walk back from the goal to the start
+typedef struct {
+    uint32_t parent;
+    uint8_t input;
+} trail_t;
+
+typedef struct {
+    SDL_SpinLock lock;
+    route_visited_t set;
+} visited_shard_t;
+
+typedef struct {
+    SDL_Thread *thread;
+    uint64_t expanded;
+    uint64_t duplicates;
+
+    // The level as the last node expanded left it, with `taken` picked up, see route_sync_level()
+    level_t levels[NUM_LEVELS];
+    uint64_t taken;
+    event_buffer_t events;
+    flow_field_t flow;
+
+    route_node_t batch[EXPAND_BATCH];
+    route_node_t children[EXPAND_BATCH * NUM_ROUTE_ACTIONS];
+} worker_t;
+
+static level_t levels[NUM_LEVELS];
+static mask_t masks[NUM_TILES];
+static uint8_t level;
+static float weight = 2.0f;
+static route_info_t info;
+
+// Open list, shared between workers
+static SDL_mutex *open_lock;
+static SDL_cond *open_changed;
+static route_open_t open;
+static uint8_t num_busy;
+
+static visited_shard_t visited[NUM_VISITED_SHARDS];
+
+static trail_t *trail;
+static uint32_t max_nodes = 1 << 24;
+static SDL_atomic_t num_trail;
+
+static SDL_atomic_t found;
+static uint32_t goal_trail;
+static uint32_t goal_ticks;
+
+static worker_t *workers;
+static uint8_t num_workers;
+
+static float heuristic(const route_node_t *node);
+static bool visit(const uint64_t hash);
+static int SDLCALL worker_run(void *data);
+static uint32_t expand(worker_t *worker, const route_node_t *node, route_node_t *children);
+static int write_route(const char *fname);
+
+int main(int argc, char *argv[])
+{
+    const char *out_fname = "solve.hhr";
+    const char *script_fname = NULL;
+    int threads = SDL_GetCPUCount();
+    int level_arg = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-l", strlen("-l")) == 0 && i + 1 < argc) {
+            level_arg = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", strlen("-j")) == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-w", strlen("-w")) == 0 && i + 1 < argc) {
+            weight = (float)atof(argv[++i]);
+        } else if (strncmp(argv[i], "-n", strlen("-n")) == 0 && i + 1 < argc) {
+            max_nodes = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-o", strlen("-o")) == 0 && i + 1 < argc) {
+            out_fname = argv[++i];
+        } else if (strncmp(argv[i], "-s", strlen("-s")) == 0 && i + 1 < argc) {
+            script_fname = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-l LEVEL] [-s SCRIPT.hhs] [-j THREADS] [-w WEIGHT] [-n MAX_NODES] "
+                            "[-o OUT.hhr]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (level_arg < 1 || level_arg > NUM_LEVELS) {
+        fprintf(stderr, "level must be 1 to %d\n", NUM_LEVELS);
+        return 1;
+    }
+    level = (uint8_t)(level_arg - 1);
+    num_workers = threads < 1 ? 1 : threads > MAX_WORKERS ? MAX_WORKERS : (uint8_t)threads;
+
+    err_handle(sim_load_levels(levels));
+    err_handle(mask_load_sprites(masks));
+    if (script_fname) {
+        // NOTE: a missing script is an empty one to the game, here it's a mistake
+        err_handle(script_load(&levels[level].script, script_fname));
+        if (!levels[level].script.size) {
+            err_handle(err_fatal(ERR_SCRIPT, script_fname));
+        }
+    }
+    err_handle(route_info_init(&info, &levels[level]));
+
+    workers = calloc(num_workers, sizeof(worker_t));
+    trail = malloc((size_t)max_nodes * sizeof(trail_t));
+    open_lock = SDL_CreateMutex();
+    open_changed = SDL_CreateCond();
+    if (!workers || !trail || !open_lock || !open_changed) {
+        err_handle(err_fatal(ERR_ALLOC, "solver"));
+    }
+    for (size_t i = 0; i < NUM_VISITED_SHARDS; i++) {
+        err_handle(route_visited_init(&visited[i].set, VISITED_SHARD_START_SIZE));
+    }
+    route_open_init(&open, max_nodes);
+
+    // Start from the same state the game does
+    route_node_t start = {0};
+    sim_init(&start.state, workers[0].levels, masks, &workers[0].flow, &workers[0].events);
+    memcpy(workers[0].levels, levels, sizeof(levels));
+    start.state.cur_level = level;
+    sim_start_level(&start.state);
+    start.trail = (uint32_t)SDL_AtomicAdd(&num_trail, 1);
+    trail[start.trail] = (trail_t){.parent = NO_PARENT};
+    start.f = heuristic(&start);
+    route_save_scripted(&info, &levels[level], start.scripted);
+    visit(route_state_hash(&info, &start.state));
+    route_open_push(&open, &start);
+
+    printf("solving level %u on %u threads (%u trophies, %u doors, %u pickups, %u scripted tiles)\n", level + 1,
+           num_workers, info.trophies.count, info.doors.count, info.num_pickups, info.num_scripted);
+
+    uint64_t started = SDL_GetPerformanceCounter();
+
+    for (uint8_t i = 1; i < num_workers; i++) {
+        workers[i].thread = SDL_CreateThread(worker_run, "solver worker", &workers[i]);
+        if (!workers[i].thread) {
+            err_handle(err_fatal(ERR_SDL_INIT, SDL_GetError()));
+        }
+    }
+    worker_run(&workers[0]);
+
+    uint64_t expanded = 0, duplicates = 0;
+    for (uint8_t i = 0; i < num_workers; i++) {
+        if (workers[i].thread) {
+            SDL_WaitThread(workers[i].thread, NULL);
+        }
+        expanded += workers[i].expanded;
+        duplicates += workers[i].duplicates;
+    }
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - started) / (double)SDL_GetPerformanceFrequency();
+    printf("%.3f s, %llu states expanded (%.0f/s), %u generated, %llu duplicates\n", seconds,
+           (unsigned long long)expanded, seconds > 0 ? expanded / seconds : 0, (uint32_t)SDL_AtomicGet(&num_trail),
+           (unsigned long long)duplicates);
+
+    int err = SUCCESS;
+    if (SDL_AtomicGet(&found) == 1) {
+        printf("route found: %u ticks (%.1f s of play)\n", goal_ticks, goal_ticks / 30.0);
+        err = write_route(out_fname);
+    } else {
+        printf("no route found%s\n", (uint32_t)SDL_AtomicGet(&num_trail) >= max_nodes ? " (ran out of nodes)" : "");
+    }
+
+    for (size_t i = 0; i < NUM_VISITED_SHARDS; i++) {
+        route_visited_free(&visited[i].set);
+    }
+    SDL_DestroyCond(open_changed);
+    SDL_DestroyMutex(open_lock);
+    route_open_free(&open);
+    free(trail);
+    free(workers);
+
+    err_handle(err);
+
+    return SDL_AtomicGet(&found) == 1 ? 0 : 1;
+}
+
+static float heuristic(const route_node_t *node)
+{
+    return (float)node->g + weight * (float)route_ticks_left(&info, &node->state);
+}
+
+// Returns true the first time a state is seen, in whichever shard its hash falls in
+static bool visit(const uint64_t hash)
+{
+    visited_shard_t *shard = &visited[hash % NUM_VISITED_SHARDS];
+
+    SDL_AtomicLock(&shard->lock);
+    bool added = route_visit(&shard->set, hash);
+    SDL_AtomicUnlock(&shard->lock);
+
+    return added;
+}
+
+static int SDLCALL worker_run(void *data)
+{
+    worker_t *worker = data;
+
+    memcpy(worker->levels, levels, sizeof(levels));
+    worker->taken = 0;
+
+    for (;;) {
+        SDL_LockMutex(open_lock);
+
+        while (!open.num_open && num_busy && !SDL_AtomicGet(&found)) {
+            SDL_CondWait(open_changed, open_lock);
+        }
+
+        // Done when something found the door or nothing is left to expand and nobody can add more
+        if (SDL_AtomicGet(&found) || !open.num_open) {
+            SDL_CondBroadcast(open_changed);
+            SDL_UnlockMutex(open_lock);
+            return 0;
+        }
+
+        // Take a few at a time to keep the lock quiet
+        uint32_t count = 0;
+        while (open.num_open && count < EXPAND_BATCH) {
+            route_open_pop(&open, &worker->batch[count++]);
+        }
+        num_busy++;
+
+        SDL_UnlockMutex(open_lock);
+
+        uint32_t num_children = 0;
+        for (uint32_t i = 0; i < count && !SDL_AtomicGet(&found); i++) {
+            num_children += expand(worker, &worker->batch[i], &worker->children[num_children]);
+        }
+
+        SDL_LockMutex(open_lock);
+        for (uint32_t i = 0; i < num_children; i++) {
+            route_open_push(&open, &worker->children[i]);
+        }
+        num_busy--;
+        SDL_CondBroadcast(open_changed);
+        SDL_UnlockMutex(open_lock);
+    }
+}
+
+// Steps every action from a node and returns the number of new states written to children
+static uint32_t expand(worker_t *worker, const route_node_t *node, route_node_t *children)
+{
+    uint32_t count = 0;
+
+    worker->expanded++;
+
+    for (size_t i = 0; i < NUM_ROUTE_ACTIONS; i++) {
+        route_node_t *child = &children[count];
+
+        if (!route_action_useful(&node->state, ROUTE_ACTIONS[i])) {
+            continue;
+        }
+
+        route_sync_level(&info, &worker->levels[level], &levels[level], &worker->taken, node, &worker->flow);
+
+        memcpy(child, node, sizeof(route_node_t));
+        child->state.levels = worker->levels;
+        child->state.level = &worker->levels[level];
+        child->state.events = &worker->events;
+        child->state.flow = &worker->flow;
+
+        sim_tick(&child->state, &ROUTE_ACTIONS[i]);
+        child->g = node->g + 1;
+
+        // Keep track of what the tick picked up in the worker's copy of the level
+        uint64_t taken = route_taken(&info, &worker->events);
+        child->taken |= taken;
+        worker->taken |= taken;
+        route_save_scripted(&info, &worker->levels[level], child->scripted);
+
+        bool cleared = false;
+        for (size_t j = 0; j < worker->events.count; j++) {
+            if (worker->events.events[j].type == EVENT_LEVEL_CLEARED) {
+                cleared = true;
+            }
+        }
+
+        // Routes that cost a life aren't worth following
+        if (child->state.players[0].dying || !child->state.is_running) {
+            continue;
+        }
+
+        if (!cleared && !visit(route_state_hash(&info, &child->state))) {
+            worker->duplicates++;
+            continue;
+        }
+
+        uint32_t index = (uint32_t)SDL_AtomicAdd(&num_trail, 1);
+        if (index >= max_nodes) {
+            // Out of room, stop everyone
+            SDL_AtomicSet(&num_trail, (int)max_nodes);
+            SDL_AtomicCAS(&found, 0, -1);
+            return count;
+        }
+        trail[index] = (trail_t){.parent = node->trail, .input = ROUTE_ACTIONS[i]};
+        child->trail = index;
+
+        if (cleared) {
+            if (SDL_AtomicCAS(&found, 0, 1)) {
+                goal_trail = index;
+                goal_ticks = child->g;
+            }
+            return count;
+        }
+
+        child->f = heuristic(child);
+        count++;
+    }
+
+    return count;
+}
+
+// Walks the trail back from the goal and re-simulates it to fill in the replay's final result
+static int write_route(const char *fname)
+{
+    replay_t *replay = calloc(1, sizeof(replay_t));
+    event_buffer_t events;
+    flow_field_t flow;
+    game_state_t game;
+
+    if (!replay) {
+        return err_fatal(ERR_ALLOC, "replay");
+    }
+    if (goal_ticks > REPLAY_MAX_TICKS) {
+        free(replay);
+        return err_fatal(ERR_REPLAY, "route too long for a replay");
+    }
+
+    uint32_t tick = goal_ticks;
+    for (uint32_t i = goal_trail; trail[i].parent != NO_PARENT; i = trail[i].parent) {
+        replay->inputs[--tick] = trail[i].input;
+    }
+
+    memcpy(workers[0].levels, levels, sizeof(levels));
+    sim_init(&game, workers[0].levels, masks, &flow, &events);
+    game.cur_level = level;
+    sim_start_level(&game);
+    replay_start(replay, &game);
+    replay->num_ticks = goal_ticks;
+    for (uint32_t i = 0; i < goal_ticks; i++) {
+        sim_tick(&game, &replay->inputs[i]);
+    }
+    replay_finish(replay, &game);
+
+    int err = SUCCESS;
+    if (game.cur_level == level) {
+        err = err_fatal(ERR_REPLAY_MISMATCH, "route doesn't clear the level when replayed");
+    } else {
+        err = replay_save(replay, fname);
+        if (err == SUCCESS) {
+            printf("wrote %s\n", fname);
+        }
+    }
+
+    free(replay);
+
+    return err;
+}
@@ -0,0 +1,248 @@
+// getaddrinfo() and friends are POSIX, not C11
+#define _POSIX_C_SOURCE 200112L
+
+#include "transport.h"
+#include "error.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static uint32_t loopback_random(loopback_t *loopback);
+
+void transport_open_loopback(transport_t *a, transport_t *b, loopback_t *loopback)
+{
+    memset(a, 0, sizeof(transport_t));
+    memset(b, 0, sizeof(transport_t));
+    loopback->queues[0].count = 0;
+    loopback->queues[1].count = 0;
+    if (!loopback->rng) {
+        loopback->rng = 1;
+    }
+
+    a->type = b->type = TRANSPORT_LOOPBACK;
+    a->loopback = b->loopback = loopback;
+    a->out = b->in = &loopback->queues[0];
+    a->in = b->out = &loopback->queues[1];
+}
+
+#ifndef _WIN32
+
+int transport_open_udp(transport_t *transport, const uint16_t local_port, const char *host, const uint16_t port)
+{
+    LOG_INFO("transport_open_udp", "listening on %u, sending to %s:%u", local_port, host, port);
+
+    memset(transport, 0, sizeof(transport_t));
+    transport->type = TRANSPORT_UDP;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    struct addrinfo hints = {0};
+    struct addrinfo *peer;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, service, &hints, &peer) != 0) {
+        return err_fatal(ERR_NET, host);
+    }
+    memcpy(transport->peer, peer->ai_addr, peer->ai_addrlen);
+    transport->peer_size = peer->ai_addrlen;
+    freeaddrinfo(peer);
+
+    transport->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (transport->fd < 0) {
+        return err_fatal(ERR_NET, strerror(errno));
+    }
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(local_port);
+    if (bind(transport->fd, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+        fcntl(transport->fd, F_SETFL, O_NONBLOCK) != 0) {
+        close(transport->fd);
+        return err_fatal(ERR_NET, strerror(errno));
+    }
+
+    return SUCCESS;
+}
+
+int transport_open_unix(transport_t *transport, const char *local_path, const char *peer_path)
+{
+    LOG_INFO("transport_open_unix", "listening on %s, sending to %s", local_path, peer_path);
+
+    memset(transport, 0, sizeof(transport_t));
+    transport->type = TRANSPORT_UNIX;
+
+    struct sockaddr_un local = {0};
+    struct sockaddr_un peer = {0};
+    if (strlen(local_path) >= sizeof(local.sun_path) || strlen(peer_path) >= sizeof(peer.sun_path)) {
+        return err_fatal(ERR_NET, "socket path too long");
+    }
+
+    local.sun_family = AF_UNIX;
+    strcpy(local.sun_path, local_path);
+    peer.sun_family = AF_UNIX;
+    strcpy(peer.sun_path, peer_path);
+    memcpy(transport->peer, &peer, sizeof(peer));
+    transport->peer_size = sizeof(peer);
+
+    transport->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (transport->fd < 0) {
+        return err_fatal(ERR_NET, strerror(errno));
+    }
+
+    // NOTE: a previous run that didn't shut down cleanly leaves its socket file behind
+    unlink(local_path);
+    if (bind(transport->fd, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+        fcntl(transport->fd, F_SETFL, O_NONBLOCK) != 0) {
+        close(transport->fd);
+        return err_fatal(ERR_NET, strerror(errno));
+    }
+    strcpy(transport->local_path, local_path);
+
+    return SUCCESS;
+}
+
+#else
+
+int transport_open_udp(transport_t *transport, const uint16_t local_port, const char *host, const uint16_t port)
+{
+    (void)transport;
+    (void)local_port;
+    (void)host;
+    (void)port;
+    return err_fatal(ERR_NET, "sockets aren't supported on this platform yet");
+}
+
+int transport_open_unix(transport_t *transport, const char *local_path, const char *peer_path)
+{
+    (void)transport;
+    (void)local_path;
+    (void)peer_path;
+    return err_fatal(ERR_NET, "sockets aren't supported on this platform yet");
+}
+
+#endif
+
+// Addresses look like udp:LOCAL_PORT:HOST:PORT or unix:LOCAL_PATH:PEER_PATH
+int transport_open(transport_t *transport, const char *address)
+{
+    char host[64];
+    char local_path[108];
+    char peer_path[108];
+    unsigned int local_port, port;
+
+    if (sscanf(address, "udp:%u:%63[^:]:%u", &local_port, host, &port) == 3 && local_port <= UINT16_MAX &&
+        port <= UINT16_MAX) {
+        return transport_open_udp(transport, (uint16_t)local_port, host, (uint16_t)port);
+    }
+    if (sscanf(address, "unix:%107[^:]:%107s", local_path, peer_path) == 2) {
+        return transport_open_unix(transport, local_path, peer_path);
+    }
+
+    return err_fatal(ERR_NET, address);
+}
+
+int transport_send(transport_t *transport, const void *data, const size_t size)
+{
+    if (size > MAX_PACKET_SIZE) {
+        return err_fatal(ERR_NET, "packet too big");
+    }
+
+    if (transport->type == TRANSPORT_LOOPBACK) {
+        loopback_t *loopback = transport->loopback;
+
+        loopback->sent++;
+        if (transport->out->count == LOOPBACK_QUEUE_SIZE || loopback_random(loopback) % 100 < loopback->loss) {
+            loopback->dropped++;
+            return SUCCESS;
+        }
+
+        loopback_packet_t *packet = &transport->out->packets[transport->out->count++];
+        packet->deliver_at = loopback->now_ms + loopback->latency_ms;
+        if (loopback->jitter_ms) {
+            packet->deliver_at += loopback_random(loopback) % (loopback->jitter_ms + 1);
+        }
+        packet->size = (uint16_t)size;
+        memcpy(packet->data, data, size);
+
+        return SUCCESS;
+    }
+
+#ifndef _WIN32
+    // NOTE: a full socket buffer or a peer that isn't listening yet is just another lost packet
+    sendto(transport->fd, data, size, 0, (const struct sockaddr *)transport->peer, transport->peer_size);
+#endif
+
+    return SUCCESS;
+}
+
+size_t transport_recv(transport_t *transport, void *data, const size_t size)
+{
+    if (transport->type == TRANSPORT_LOOPBACK) {
+        loopback_queue_t *in = transport->in;
+        uint32_t now = transport->loopback->now_ms;
+        uint32_t next = in->count;
+
+        // The earliest packet that has arrived by now
+        for (uint32_t i = 0; i < in->count; i++) {
+            if ((int32_t)(in->packets[i].deliver_at - now) <= 0 &&
+                (next == in->count || (int32_t)(in->packets[i].deliver_at - in->packets[next].deliver_at) < 0)) {
+                next = i;
+            }
+        }
+        if (next == in->count) {
+            return 0;
+        }
+
+        size_t received = in->packets[next].size < size ? in->packets[next].size : size;
+        memcpy(data, in->packets[next].data, received);
+        in->packets[next] = in->packets[--in->count];
+
+        return received;
+    }
+
+#ifndef _WIN32
+    ssize_t received = recv(transport->fd, data, size, 0);
+    if (received > 0) {
+        return (size_t)received;
+    }
+#endif
+
+    return 0;
+}
+
+void transport_close(transport_t *transport)
+{
+    if (transport->type == TRANSPORT_LOOPBACK) {
+        return;
+    }
+
+#ifndef _WIN32
+    close(transport->fd);
+    if (transport->local_path[0]) {
+        unlink(transport->local_path);
+    }
+#endif
+}
+
+// xorshift64*, good enough for deciding which packets to drop and delay
+static uint32_t loopback_random(loopback_t *loopback)
+{
+    loopback->rng ^= loopback->rng >> 12;
+    loopback->rng ^= loopback->rng << 25;
+    loopback->rng ^= loopback->rng >> 27;
+
+    return (uint32_t)((loopback->rng * 0x2545f4914f6cdd1dULL) >> 32);
+}
@@ -0,0 +1,74 @@
+#ifndef HH_TRANSPORT_H
+#define HH_TRANSPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Unreliable, unordered datagrams between two peers. Packets may be lost, duplicated or arrive out of order, whoever
+// sends them has to cope.
+#define MAX_PACKET_SIZE 256
+
+enum {
+    TRANSPORT_LOOPBACK,
+    TRANSPORT_UDP,
+    TRANSPORT_UNIX,
+};
+
+// NOTE: must be a power of two
+#define LOOPBACK_QUEUE_SIZE 256
+
+typedef struct {
+    // Simulated time the packet comes out of the far end
+    uint32_t deliver_at;
+    uint16_t size;
+    uint8_t data[MAX_PACKET_SIZE];
+} loopback_packet_t;
+
+// One direction of a loopback link
+typedef struct {
+    uint32_t count;
+    loopback_packet_t packets[LOOPBACK_QUEUE_SIZE];
+} loopback_queue_t;
+
+// A stand-in for the network between two transports in the same process, with a clock the caller advances so runs are
+// repeatable. Every packet is delayed by latency_ms plus up to jitter_ms, which reorders them too.
+typedef struct {
+    uint32_t now_ms;
+    uint32_t latency_ms;
+    uint32_t jitter_ms;
+    // Percentage of packets dropped
+    uint8_t loss;
+    uint64_t rng;
+
+    uint32_t sent;
+    uint32_t dropped;
+    loopback_queue_t queues[2];
+} loopback_t;
+
+typedef struct {
+    uint8_t type;
+
+    // Sockets
+    int fd;
+    uint32_t peer_size;
+    uint8_t peer[128];
+    // Unix sockets leave a file behind that is removed on close
+    char local_path[108];
+
+    // Loopback
+    loopback_t *loopback;
+    loopback_queue_t *in;
+    loopback_queue_t *out;
+} transport_t;
+
+void transport_open_loopback(transport_t *a, transport_t *b, loopback_t *loopback);
+int transport_open_udp(transport_t *transport, const uint16_t local_port, const char *host, const uint16_t port);
+int transport_open_unix(transport_t *transport, const char *local_path, const char *peer_path);
+int transport_open(transport_t *transport, const char *address);
+int transport_send(transport_t *transport, const void *data, const size_t size);
+// Size of the packet read into data, 0 if there wasn't one waiting
+size_t transport_recv(transport_t *transport, void *data, const size_t size);
+void transport_close(transport_t *transport);
+
+#endif // !HH_TRANSPORT_H
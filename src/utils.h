@@ -6,7 +6,7 @@
 #include <stdio.h>
 
 #ifndef _WIN32
-void itoa(int value, char *str, int base)
+static inline void itoa(int value, char *str, int base)
 {
     if (base == 10) {
         snprintf(str, 12, "%d", value);
@@ -21,7 +21,7 @@ void itoa(int value, char *str, int base)
 }
 #endif
 
-bool in_array(const uint8_t *haystack, const uint8_t needle, const size_t len)
+static inline bool in_array(const uint8_t *haystack, const uint8_t needle, const size_t len)
 {
     for (size_t i = 0; i < len; i++) {
         if (haystack[i] == needle) {